@@ -1940,6 +1940,37 @@ OIIO_FORCEINLINE OIIO_HOSTDEVICE float fast_atan2 (float y, float x) {
 }
 
 
+// Versions of fast_acos and fast_atan2 for the simd::vfloat types, which
+// compute the same approximations as the float ones on all lanes at once.
+template<typename T, typename intN = typename T::vint_t>
+OIIO_FORCEINLINE T fast_acos (const T& x) {
+    using namespace simd;
+    const T f = abs(x);
+    const T m = select(f < T(1.0f), T(1.0f) - (T(1.0f) - f), T(1.0f));
+    const T a = sqrt(T(1.0f) - m) * (T(1.5707963267f) + m * (T(-0.213300989f) + m * (T(0.077980478f) + m * T(-0.02164095f))));
+    return select(x < T::Zero(), T(float(M_PI)) - a, a);
+}
+
+template<typename T, typename intN = typename T::vint_t>
+OIIO_FORCEINLINE T fast_atan2 (const T& y, const T& x) {
+    using namespace simd;
+    const T a = abs(x);
+    const T b = abs(y);
+    auto b_is_greater_than_a = b > a;
+    T sa = select(b_is_greater_than_a, b, a);
+    T sb = select(b_is_greater_than_a, a, b);
+    const T k = select(b == T::Zero(), T::Zero(), sb / sa);
+    const T s = T(1.0f) - (T(1.0f) - k); // crush denormals
+    const T t = s * s;
+    T r = s * madd(T(0.430165678f), t, T(1.0f)) / madd(madd(T(0.0579354987f), t, T(0.763007998f)), t, T(1.0f));
+    r = select(b_is_greater_than_a, T(1.570796326794896557998982f) - r, r);
+    // test sign bits, as the float version does, so -0 acts as negative
+    const intN signbit(int(0x80000000u));
+    r = select((bitcast_to_int(x) & signbit) != intN::Zero(), T(float(M_PI)) - r, r);
+    return select((bitcast_to_int(y) & signbit) != intN::Zero(), -r, r);
+}
+
+
 template<typename T>
 OIIO_FORCEINLINE OIIO_HOSTDEVICE T fast_log2 (const T& xval) {
     using namespace simd;
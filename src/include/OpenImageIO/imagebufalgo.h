@@ -1074,6 +1074,98 @@ bool OIIO_API clamp (ImageBuf &dst, const ImageBuf &src,
 /// @}
 
 
+/// @defgroup expr (Deferred, fused per-pixel expressions)
+/// @{
+///
+/// Each of the arithmetic functions above makes a full pass over the
+/// pixels and produces a full image, so a chain of them spends most of its
+/// time moving intermediate images through memory. An `Expr` instead
+/// describes a per-pixel computation on images and constants without doing
+/// it. Expressions combine with the usual arithmetic operators and the
+/// methods below, and nothing is computed until `eval()`, which makes one
+/// threaded pass over the region, taking each scanline through the whole
+/// expression while it is in cache, without allocating any intermediate
+/// images. For example,
+///
+///     using namespace ImageBufAlgo;
+///     ImageBuf R = eval (Expr(A) * A + B);
+///     eval (R, (Expr(A) * 0.5f + B).clamp(0.0f, 1.0f));
+///
+/// is equivalent to `mad(A,A,B)`, then `mad(A,0.5,B)` followed by `clamp`.
+///
+/// An `Expr` refers to, but does not copy, the images (and color
+/// processors) from which it is built, so they must remain valid until it
+/// is evaluated. Constants are per-channel, with a single value (or the
+/// last one given) used for any remaining channels. Pixels outside the
+/// data window of an image are zero.
+
+class OIIO_API Expr {
+public:
+    /// The pixels of an image.
+    Expr (const ImageBuf &img);
+    /// A constant used for all channels.
+    Expr (float val);
+    /// A per-channel constant.
+    Expr (cspan<float> vals);
+    Expr (std::initializer_list<const float> vals)
+        : Expr(cspan<float>(vals)) {}
+
+    Expr operator- () const;
+    friend OIIO_API Expr operator+ (const Expr &A, const Expr &B);
+    friend OIIO_API Expr operator- (const Expr &A, const Expr &B);
+    friend OIIO_API Expr operator* (const Expr &A, const Expr &B);
+    /// Division by zero results in zero, as in `ImageBufAlgo::div()`.
+    friend OIIO_API Expr operator/ (const Expr &A, const Expr &B);
+
+    /// Per-pixel absolute value, like `ImageBufAlgo::abs()`.
+    Expr abs () const;
+    /// `1 - value`, like `ImageBufAlgo::invert()`.
+    Expr invert () const;
+    /// Raise to a power, like `ImageBufAlgo::pow()`.
+    Expr pow (const Expr &B) const;
+    /// Per-channel minimum and maximum with another expression, like
+    /// `ImageBufAlgo::min()` and `max()`.
+    Expr min (const Expr &B) const;
+    Expr max (const Expr &B) const;
+    /// Clamp to `[min, max]`, like `ImageBufAlgo::clamp()`.
+    Expr clamp (cspan<float> min, cspan<float> max) const;
+    Expr clamp (float min, float max) const;
+    /// Composite this over `B`, like `ImageBufAlgo::over()`. The alpha
+    /// channel index (relative to the channels being evaluated) defaults
+    /// to that of the first image in this expression; `eval()` fails if
+    /// there is none.
+    Expr over (const Expr &B, int alpha_channel = -1) const;
+    /// Transform color with `processor`, like `ImageBufAlgo::colorconvert()`.
+    /// If `unpremult` is true, the color channels are divided by the alpha
+    /// of the first image in this expression (if it has one and isn't
+    /// marked "oiio:UnassociatedAlpha") before the transform and
+    /// multiplied by it again after.
+    Expr colorconvert (const ColorProcessor *processor,
+                       bool unpremult = true) const;
+
+    /// Implementation details, opaque to users.
+    struct Node;
+    const Node* node () const { return m_node.get(); }
+
+private:
+    Expr (std::shared_ptr<const Node> node) : m_node(std::move(node)) {}
+    std::shared_ptr<const Node> m_node;
+};
+
+
+/// Compute `expr` for every pixel of `roi` in a single pass, returning
+/// the result image. If `roi` is not defined, it is the union of the data
+/// windows of the images in the expression (which must then have at least
+/// one).
+ImageBuf OIIO_API eval (const Expr &expr, ROI roi={}, int nthreads=0);
+/// Write to an existing image `dst` (allocating if it is uninitialized).
+/// `dst` may also appear in the expression.
+bool OIIO_API eval (ImageBuf &dst, const Expr &expr,
+                    ROI roi={}, int nthreads=0);
+
+/// @}
+
+
 /// @defgroup maxminchan (Maximum / minimum of channels)
 /// @{
 ///
@@ -1526,6 +1618,12 @@ inline bool make_kernel (ImageBuf &dst, string_view name,
 /// it defaults to the full size `src`. If `normalized` is true, the kernel will
 /// be normalized for the  convolution, otherwise the original values will
 /// be used.
+///
+/// For 2D images, a kernel that is separable (such as those that
+/// `make_kernel()` makes from separable filters) is applied as two 1D
+/// passes, and a large kernel that is not is applied by FFT over tiles of
+/// the image, whichever is estimated to be faster than summing directly.
+/// The results match the direct method to within floating point rounding.
 ImageBuf OIIO_API convolve (const ImageBuf &src, const ImageBuf &kernel,
                             bool normalize = true, ROI roi={}, int nthreads=0);
 /// Write to an existing image `dst` (allocating if it is uninitialized).
@@ -1685,6 +1783,10 @@ bool OIIO_API fillholes_pushpull (ImageBuf &dst, const ImageBuf &src,
 /// Median filters are good for removing high-frequency detail smaller than
 /// the window size (including noise), without blurring edges that are
 /// larger than the window size.
+///
+/// For 8- and 16-bit integer images, the cost per pixel does not grow with
+/// the window area (for 8 bits, it does not depend on the window size at
+/// all), so large windows are practical. Other types sort each window.
 ImageBuf OIIO_API median_filter (const ImageBuf &src,
                                  int width = 3, int height = -1,
                                  ROI roi={}, int nthreads=0);
@@ -1730,7 +1832,8 @@ bool OIIO_API unsharp_mask (ImageBuf &dst, const ImageBuf &src,
 /// the structuring element (which is taken to be a width x height square).
 /// If height is not set, it will default to be the same as width. Dilation
 /// makes bright features wider and more prominent, dark features thinner,
-/// and removes small isolated dark spots.
+/// and removes small isolated dark spots. The cost per pixel does not
+/// depend on the window size.
 ImageBuf OIIO_API dilate (const ImageBuf &src, int width=3, int height=-1,
                           ROI roi={}, int nthreads=0);
 /// Write to an existing image `dst` (allocating if it is uninitialized).
@@ -1743,7 +1846,8 @@ bool OIIO_API dilate (ImageBuf &dst, const ImageBuf &src,
 /// the structuring element (which is taken to be a width x height square).
 /// If height is not set, it will default to be the same as width. Erosion
 /// makes dark features wider, bright features thinner, and removes small
-/// isolated bright spots.
+/// isolated bright spots. The cost per pixel does not depend on the
+/// window size.
 ImageBuf OIIO_API erode (const ImageBuf &src, int width=3, int height=-1,
                          ROI roi={}, int nthreads=0);
 /// Write to an existing image `dst` (allocating if it is uninitialized).
@@ -2111,6 +2215,11 @@ enum MakeTextureMode {
 ///    - `maketx:compute_average` (int) :
 ///                           If nonzero, compute and store the average
 ///                           color of the texture (default: 1).
+///    - `maketx:tile_stats` (int) :
+///                           If nonzero, compute and store the min, max,
+///                           and average of every tile of every MIP level,
+///                           which lets the ImageCache fill constant tiles
+///                           without reading them (default: 0).
 ///    - `maketx:unpremult` (int) : If nonzero, unpremultiply color by alpha
 ///                           before color conversion, then multiply by
 ///                           alpha after color conversion (default: 0).
@@ -213,6 +213,160 @@ public:
     ///           enabled, this reduces the number of file opens, at the
     ///           expense of not being able to open files if their format do
     ///           not actually match their filename extension). Default: 0
+    /// - `int prefetch_threads` :
+    ///           The number of background I/O threads used to service
+    ///           `prefetch()` requests (and read-ahead). The threads are
+    ///           only started upon the first prefetch. Setting this to 0
+    ///           causes prefetch requests to be ignored. (Default: 4)
+    /// - `int readahead` :
+    ///           When nonzero, a thread whose `get_pixels()` calls sweep
+    ///           down an image (each request beginning on the scanline
+    ///           where its previous request of that image ended) will have
+    ///           this many rows of tiles below the current request
+    ///           prefetched in the background. (Default: 0, no read-ahead)
+    /// - `int microcache_tiles` :
+    ///           Each thread always remembers the last two tiles it used,
+    ///           so that it need not consult the shared tile cache when
+    ///           the next lookup is for one of them. When nonzero, each
+    ///           thread also keeps a set-associative cache of up to this
+    ///           many recently used tiles (4 per set, at most 16 in all),
+    ///           which helps access patterns that cycle among more than two
+    ///           tiles, such as filter footprints straddling tile corners.
+    ///           The tiles a thread remembers stay pinned in the cache
+    ///           until it replaces them, so they can't be evicted, and
+    ///           each thread can hold that much memory over
+    ///           `max_memory_MB`. (Default: 0)
+    /// - `int get_pixels_threads` :
+    ///           `get_pixels()` requests spanning several tiles are split
+    ///           at tile boundaries into pieces that are read (if not
+    ///           already cached) and converted in parallel by up to this
+    ///           many threads of the default thread pool. 1 forces the
+    ///           whole request to be done by the calling thread, as does
+    ///           calling from a thread of the pool itself. (Default: 0,
+    ///           meaning use all the pool's threads)
+    /// - `int max_inputs_per_file` :
+    ///           The maximum number of ImageInputs that may be open at once
+    ///           for any one file. When a tile read finds that file's
+    ///           ImageInput busy with another thread, it reads through an
+    ///           extra ("spare") one instead of waiting, so that many
+    ///           threads missing tiles of the same large texture can decode
+    ///           in parallel. Spares count toward `max_open_files` and are
+    ///           closed along with the file. (Default: 1, meaning all reads
+    ///           of a file go through a single ImageInput)
+    /// - `int access_stats` :
+    ///           When nonzero, gather statistics for each file and MIP
+    ///           level: tile lookups, misses, bytes read, time spent
+    ///           reading and decoding tiles, and time spent waiting for
+    ///           other threads reading the same tile or file. These are
+    ///           retrieved with `access_stats_json()` or per file with
+    ///           `get_image_info()`, and are useful for
+    ///           spotting textures whose finest levels are never used (and
+    ///           could be downsized) or that are costly to read. This adds
+    ///           a little overhead to every tile lookup. (Default: 0)
+    /// - `int tile_stats` :
+    ///           When nonzero, tiles that a texture made with `maketx
+    ///           --tilestats` records as being all one color are filled in
+    ///           directly, without reading or decompressing them from the
+    ///           file. (Default: 1)
+    /// - `int deduplicate_tiles` :
+    ///           When nonzero, the pixels of each tile read are hashed, and
+    ///           tiles whose pixels are identical to those of another tile
+    ///           in the cache (such as constant-color tiles, or the same
+    ///           tile repeated in several files of a UDIM set) share one
+    ///           copy in memory, which counts only once against
+    ///           `max_memory_MB`. Costs a hash of each tile as it is read.
+    ///           (Default: 0)
+    /// - `float degrade_churn` :
+    ///           When nonzero, the cache watches for thrashing: if more than
+    ///           this fraction of recent tile reads are re-reads of tiles
+    ///           that were evicted (including restores from the compressed
+    ///           tier, disk cache, or shared tile store), texture lookups
+    ///           on the files chosen by `degrade_files` are biased one more
+    ///           MIP level coarser (up to `degrade_max_bias` levels), and
+    ///           the bias is stepped back down once re-reads fall below
+    ///           half this fraction. This trades sharpness for staying
+    ///           within the memory and I/O budget, and suits interactive or
+    ///           preview renders. The current bias may be retrieved as
+    ///           `int stat:mip_bias`.
+    ///           (Default: 0, never degrade)
+    /// - `int degrade_max_bias` :
+    ///           The most MIP levels by which lookups may be biased when
+    ///           degrading. (Default: 2)
+    /// - `int degrade_max_res` :
+    ///           While degrading, also never use MIP levels with a width or
+    ///           height larger than this. (Default: 0, no such limit)
+    /// - `string degrade_files` :
+    ///           A regular expression selecting which files may be
+    ///           degraded: those whose names contain a match. (Default: "",
+    ///           meaning all files)
+    /// - `string eviction_policy` :
+    ///           How to choose which tiles to evict when the cache is full.
+    ///           `"clock"` evicts tiles that haven't been used since the
+    ///           last sweep, treating all tiles alike. `"cost"` also
+    ///           weights each tile by how expensive its file's tiles have
+    ///           been to read (from the I/O time recorded for each file):
+    ///           each doubling over the average tile read time lets a tile
+    ///           survive one more sweep without being used, so tiles from
+    ///           slow (e.g., remote or heavily compressed) files are kept
+    ///           in preference to those that are cheap to read again.
+    ///           (Default: "clock")
+    /// - `float max_compressed_memory_MB` :
+    ///           When nonzero, tiles evicted from the cache to stay within
+    ///           `max_memory_MB` are compressed and kept in a second tier
+    ///           of up to this many MB, from which they are restored
+    ///           (instead of being read from the file again) the next time
+    ///           they are needed. This memory is in addition to
+    ///           `max_memory_MB`. (Default: 0, no compressed tier)
+    /// - `string disk_tile_cache` :
+    ///           When not empty, the name of a directory (ideally on fast
+    ///           local disk) in which to keep a persistent cache of decoded
+    ///           tiles. Tiles read from image files are written there, and
+    ///           any process using the same directory will read them from
+    ///           there rather than from the (possibly remote, possibly
+    ///           compressed) image file. Entries are keyed by the image's
+    ///           fingerprint or its name and modification time, so
+    ///           modified images are never served stale tiles, and by the
+    ///           settings that affect its pixels (e.g. `forcefloat`,
+    ///           `unassociatedalpha`, or a configuration passed to
+    ///           `add_file()`), so caches set up differently don't
+    ///           share them. Nothing is
+    ///           ever removed from the directory; it is up to the user to
+    ///           clean it out. (Default: "", no disk cache)
+    /// - `string shared_tile_cache` :
+    ///           When not empty, the name of a POSIX shared memory segment
+    ///           holding a tile store shared by every process on the
+    ///           machine that uses the same name, so that they keep one
+    ///           copy of the tiles they have in common rather than one
+    ///           each. The segment is created (sized by
+    ///           `shared_tile_cache_MB`) by the first process to use it,
+    ///           and is never removed by OpenImageIO (on Linux, remove it
+    ///           from `/dev/shm` when it's no longer wanted). Tiles a
+    ///           process is using are counted against its `max_memory_MB`
+    ///           and can't be evicted from the shared store until that
+    ///           process releases them, so all the processes should use
+    ///           a `max_memory_MB` well below the shared store size. This
+    ///           can only be set once. Not supported on Windows.
+    ///           (Default: "", no shared tile store)
+    /// - `float shared_tile_cache_MB` :
+    ///           The size of the shared tile store, if this process is the
+    ///           one to create it; it must be set before
+    ///           `shared_tile_cache`. (Default: 1024)
+    /// - `int shared_tile_cache_mode` :
+    ///           The permissions of the shared tile store's segment, if
+    ///           this process is the one to create it (subject to the
+    ///           umask); it must be set before `shared_tile_cache`. The
+    ///           default allows only processes of the same user to share
+    ///           it; use 0660 or 0666 to share it across users.
+    ///           (Default: 0600)
+    /// - `string tile_trace` :
+    ///           When not empty, every tile request made of the cache
+    ///           (file, subimage, MIP level, tile, channels, thread, and
+    ///           time) is recorded to a compact binary trace file of this
+    ///           name, which `testtex --replay` can play back to compare
+    ///           cache settings without the application. Setting it again
+    ///           (or to "") ends the current trace; this, like destroying
+    ///           the cache, should only be done while no other threads are
+    ///           using the cache. (Default: "", no trace)
     ///
     /// - `string options`
     ///           This catch-all is simply a comma-separated list of
@@ -260,6 +414,28 @@ public:
     /// - `int stat:find_tile_calls` :
     ///           Number of times a filename was looked up in the file cache.
     ///
+    /// - `int64 stat:tiles_from_stats` :
+    ///           Number of constant-color tiles filled in from `maketx
+    ///           --tilestats` summaries instead of being read.
+    ///
+    /// - `int64 stat:tiles_deduplicated` ,
+    ///   `int64 stat:dedup_memory_saved` :
+    ///           With `deduplicate_tiles`, the total number of tiles found
+    ///           to duplicate the pixels of a tile already in memory, and
+    ///           the bytes currently saved by sharing them.
+    ///
+    /// - `int64 stat:find_tile_microcache_nway_hits` :
+    ///           Number of tile lookups satisfied by the per-thread
+    ///           set-associative cache enabled by `microcache_tiles`.
+    ///
+    /// - `int stat:spare_inputs_opened` :
+    ///           Number of extra ImageInputs opened for concurrent reads of
+    ///           the same file (see `max_inputs_per_file`).
+    ///
+    /// - `int64[] stat:mip_histogram` :
+    ///           Tile lookups per MIP level, summed over all files (with
+    ///           `access_stats` enabled), into an array of any length.
+    ///
     /// - `int64 stat:image_size` :
     ///           Total size (uncompressed bytes of pixel data) of all
     ///           images referenced by the ImageCache. (Note: Prior to 1.7,
@@ -275,6 +451,45 @@ public:
     /// - `int stat:unique_files` :
     ///           Number of unique files opened.
     ///
+    /// - `int stat:tiles_prefetched` :
+    ///           Number of tiles queued for reading by `prefetch()` or
+    ///           read-ahead.
+    ///
+    /// - `int64 stat:tier_demotions` :
+    ///           Number of evicted tiles compressed into the compressed
+    ///           tier (see `max_compressed_memory_MB`).
+    ///
+    /// - `int64 stat:tier_hits` :
+    ///           Number of tile reads satisfied from the compressed tier.
+    ///
+    /// - `int64 stat:tier_misses` :
+    ///           Number of tile reads that, with the compressed tier
+    ///           enabled, still had to go to the file.
+    ///
+    /// - `int64 stat:tier_memory_used` :
+    ///           Bytes of compressed tiles currently held.
+    ///
+    /// - `int64 stat:disk_cache_hits` :
+    ///           Number of tiles read from the `disk_tile_cache`.
+    ///
+    /// - `int64 stat:disk_cache_misses` :
+    ///           Number of tiles not found in the `disk_tile_cache`, that
+    ///           had to be read from their image files.
+    ///
+    /// - `int64 stat:disk_cache_writes` :
+    ///           Number of tiles written to the `disk_tile_cache`.
+    ///
+    /// - `int64 stat:shared_hits` :
+    ///           Number of tiles this process found already present in the
+    ///           `shared_tile_cache`.
+    ///
+    /// - `int64 stat:shared_misses` :
+    ///           Number of tiles this process had to read itself, with the
+    ///           `shared_tile_cache` enabled.
+    ///
+    /// - `int64 stat:shared_memory_used` :
+    ///           Bytes of the `shared_tile_cache` in use (by all processes).
+    ///
     /// - `float stat:fileio_time` :
     ///           Total I/O-related time (seconds).
     ///
@@ -472,6 +687,20 @@ public:
                                  thread_info);
     }
 
+    /// Retrieve handles for many images at once, as if by calling
+    /// `get_image_handle()` on each of the filenames, but opening the
+    /// files and reading their headers in parallel, by as many threads as
+    /// the default thread pool has (but no more than half of
+    /// `max_open_files`). When the files are on a high-latency file
+    /// system, this is much faster than opening them one after another.
+    /// Any of the filenames that are UDIM patterns also have all of their
+    /// tiles resolved and opened (see `TextureSystem::prewarm_udim()`).
+    ///
+    /// @returns
+    ///         A vector of the handles, in the same order as `filenames`.
+    ///         Use `good()` to find whether each could be opened.
+    virtual std::vector<ImageHandle*> preload(cspan<ustring> filenames) = 0;
+
     /// Return true if the image handle (previously returned by
     /// `get_image_handle()`) is a valid image that can be subsequently read.
     virtual bool good(ImageHandle* file) = 0;
@@ -627,6 +856,15 @@ public:
     /// - `"stat:is_duplicate"` : Stores 1 if this file was a duplicate of
     ///   another image, otherwise 0. (`int`)
     ///
+    /// - `"stat:mip_lookups"`, `"stat:mip_misses"`, `"stat:mip_bytesread"` :
+    ///   With the `access_stats` attribute enabled, the tile lookups, cache
+    ///   misses, and bytes read for each MIP level of the file, one element
+    ///   per level (`int64[]` of any length).
+    ///
+    /// - `"stat:mip_readtime"`, `"stat:mip_waittime"` : With `access_stats`
+    ///   enabled, the time in seconds spent reading tiles of each MIP
+    ///   level, and waiting for other threads reading them (`float[]`).
+    ///
     /// - *Anything else*  : For all other data names, the the metadata of
     ///   the image file will be searched for an item that matches both the
     ///   name and data type.
@@ -838,6 +1076,40 @@ public:
                              int xbegin, int xend, int ybegin, int yend,
                              int zbegin, int zend,
                              TypeDesc format, void *result) = 0;
+
+    /// Ask for the tiles of the given subimage and MIP level of an image
+    /// that overlap the pixel region `roi` (all of them, if `roi` is not
+    /// defined) to be read into the cache in the background, by the pool
+    /// of `prefetch_threads` I/O threads, and return without waiting for
+    /// them. A renderer might use this to request the tiles for its next
+    /// bucket while it is still shading the current one.
+    ///
+    /// Tiles that are already in the cache (or already on their way) are
+    /// left alone. A tile that has been requested but not yet read is
+    /// present in the cache, so any thread that needs it in the meantime
+    /// simply waits for it to arrive -- or reads it immediately itself, if
+    /// the I/O threads have not gotten to it yet.
+    ///
+    /// The `chbegin` and `chend` specify which channels of the tiles will
+    /// be cached, as for `get_tile()`, and should match the channel range
+    /// of the later lookups in order to be useful. If `chend < chbegin`,
+    /// tiles containing all channels will be prefetched.
+    ///
+    /// @returns
+    ///         `true` if the requested tiles have been queued (or were
+    ///         already present), `false` if the file could not be opened
+    ///         or does not have the requested subimage or MIP level.
+    virtual bool prefetch (ustring filename, int subimage, int miplevel,
+                           ROI roi = ROI::All(),
+                           int chbegin = 0, int chend = -1) = 0;
+
+    /// A more efficient variety of `prefetch()` for cases where you can
+    /// use an `ImageHandle*` to specify the image and optionally have a
+    /// `Perthread*` for the calling thread.
+    virtual bool prefetch (ImageHandle *file, Perthread *thread_info,
+                           int subimage, int miplevel,
+                           ROI roi = ROI::All(),
+                           int chbegin = 0, int chend = -1) = 0;
     /// @}
 
     /// @{
@@ -930,6 +1202,27 @@ public:
     /// not yet been released with `release_tile()`.
     virtual const void* tile_pixels(Tile* tile, TypeDesc& format) const = 0;
 
+    /// Retrieve the minimum, maximum, and average value of each channel in
+    /// the range `[chbegin,chend)` of the tile containing pixel (x,y,z), as
+    /// recorded by `maketx --tilestats`, without reading any pixels. Any of
+    /// `min`, `max`, or `avg` may be `nullptr` if not needed; the others
+    /// must have room for `chend-chbegin` floats. A tile whose min and max
+    /// are equal is a single constant color (for example, an entirely
+    /// transparent region of an opacity map), and the caller may skip
+    /// looking up its pixels at all. If `chend < chbegin`, all channels are
+    /// retrieved. Return `false` if the file has no such summaries for this
+    /// subimage and MIP level.
+    virtual bool get_tile_stats(ustring filename, int subimage, int miplevel,
+                                int x, int y, int z, int chbegin, int chend,
+                                float* min, float* max, float* avg) = 0;
+    /// A slightly more efficient variety of `get_tile_stats()` for cases
+    /// where you can use an `ImageHandle*` to specify the image and
+    /// optionally have a `Perthread*` for the calling thread.
+    virtual bool get_tile_stats(ImageHandle* file, Perthread* thread_info,
+                                int subimage, int miplevel, int x, int y,
+                                int z, int chbegin, int chend, float* min,
+                                float* max, float* avg) = 0;
+
     /// The add_file() call causes a file to be opened or added to the
     /// cache. There is no reason to use this method unless you are
     /// supplying a custom creator, or configuration, or both.
@@ -1001,6 +1294,13 @@ public:
     /// more and more esoteric information.
     virtual std::string getstats(int level = 1) const = 0;
 
+    /// Returns a JSON document giving, for every file used since the
+    /// `access_stats` attribute was enabled (or the stats were reset), the
+    /// hits, misses, bytes read, read time and wait time of each MIP
+    /// level, and a `mip_histogram` of tile lookups per MIP level over all
+    /// files.
+    virtual std::string access_stats_json() const = 0;
+
     /// Reset most statistics to be as they were with a fresh ImageCache.
     /// Caveat emptor: this does not flush the cache itelf, so the resulting
     /// statistics from the next set of texture requests will not match the
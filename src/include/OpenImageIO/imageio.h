@@ -2758,6 +2758,15 @@ OIIO_API std::string geterror(bool clear = true);
 ///    x 64k x 4 channel x half). In situations when images larger than this
 ///    are expected to be encountered, you should raise this limit.
 ///
+/// - `int resize:two_pass` (1)
+///
+///    When nonzero, `ImageBufAlgo::resize()` with a separable filter
+///    filters each row and then each column, in two passes, rather than
+///    weighting the full two-dimensional footprint of the filter for every
+///    output pixel, which is much faster for large reductions. Setting it
+///    to 0 selects the older single-pass method, which is mostly useful for
+///    comparison.
+///
 /// - `int log_times`
 ///
 ///    When the `"log_times"` attribute is nonzero, `ImageBufAlgo` functions
@@ -1039,6 +1039,11 @@ void OIIO_UTIL_API utf8_to_unicode (string_view str, std::vector<uint32_t> &uvec
 /// https://en.wikipedia.org/wiki/Base64
 std::string OIIO_UTIL_API base64_encode (string_view str);
 
+/// Decode a base64-encoded string (the reverse of `base64_encode()`).
+/// Decoding stops at the end of the string, the `=` padding, or the first
+/// character that is not part of the base64 alphabet.
+std::string OIIO_UTIL_API base64_decode (string_view str);
+
 
 enum class EditDistMetric { Levenshtein };
 
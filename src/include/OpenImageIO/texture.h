@@ -1747,6 +1747,24 @@ public:
                                 Perthread* thread_info,
                                 std::vector<ustring>& filenames,
                                 int& nutiles, int& nvtiles) = 0;
+
+    /// Resolve every concrete file of the UDIM set specified by UTF-8
+    /// encoded `udimpattern`, and open their headers, in parallel. Without
+    /// this, each tile file is found and opened by the first texture
+    /// lookup that lands on it, one at a time. After it, looking up any
+    /// tile of the set (as `texture()` does for each UDIM lookup) takes no
+    /// locks at all.
+    ///
+    /// This method was added in OpenImageIO 2.4.
+    virtual void prewarm_udim(ustring udimpattern) = 0;
+
+    /// A more efficient variety of `prewarm_udim()` for cases where you
+    /// have the `TextureHandle*` that corresponds to the "virtual" UDIM
+    /// file and optionally have a `Perthread*` for the calling thread.
+    ///
+    /// This method was added in OpenImageIO 2.4.
+    virtual void prewarm_udim(TextureHandle* udimfile,
+                              Perthread* thread_info) = 0;
     /// @}
 
     /// @{
@@ -131,6 +131,40 @@ test_IBA(ROI roi, int threads)
 
 
 
+static void
+test_IBA_eval(ROI roi, int threads)
+{
+    using ImageBufAlgo::Expr;
+    ImageBufAlgo::eval(imgR, Expr(imgA) * imgA + imgB, roi, threads);
+}
+
+
+
+// A longer chain, R = clamp((A*A + B) * 0.5 - 0.1, 0, 1), done as
+// separate IBA calls, each making a full pass...
+static void
+test_IBA_chain(ROI roi, int threads)
+{
+    ImageBufAlgo::mad(imgR, imgA, imgA, imgB, roi, threads);
+    ImageBufAlgo::mad(imgR, imgR, 0.5f, -0.1f, roi, threads);
+    ImageBufAlgo::clamp(imgR, imgR, 0.0f, 1.0f, false, roi, threads);
+}
+
+
+
+// ...and fused into one pass.
+static void
+test_IBA_eval_chain(ROI roi, int threads)
+{
+    using ImageBufAlgo::Expr;
+    ImageBufAlgo::eval(imgR,
+                       ((Expr(imgA) * imgA + imgB) * 0.5f - 0.1f)
+                           .clamp(0.0f, 1.0f),
+                       roi, threads);
+}
+
+
+
 void
 test_compute()
 {
@@ -217,6 +251,41 @@ test_compute()
                             0.001);
     OIIO_CHECK_EQUAL_THRESH(imgR.getchannel(xres / 2, yres / 2, 0, 2), 0.50,
                             0.001);
+
+    ImageBufAlgo::zero(imgR);
+    bench("IBA::eval 1 thread", test_IBA_eval, roi, 1);
+    OIIO_CHECK_EQUAL_THRESH(imgR.getchannel(xres / 2, yres / 2, 0, 0), 0.25,
+                            0.001);
+    OIIO_CHECK_EQUAL_THRESH(imgR.getchannel(xres / 2, yres / 2, 0, 1), 0.25,
+                            0.001);
+    OIIO_CHECK_EQUAL_THRESH(imgR.getchannel(xres / 2, yres / 2, 0, 2), 0.50,
+                            0.001);
+
+    ImageBufAlgo::zero(imgR);
+    bench("IBA::eval threaded", test_IBA_eval, roi, numthreads);
+    OIIO_CHECK_EQUAL_THRESH(imgR.getchannel(xres / 2, yres / 2, 0, 0), 0.25,
+                            0.001);
+    OIIO_CHECK_EQUAL_THRESH(imgR.getchannel(xres / 2, yres / 2, 0, 1), 0.25,
+                            0.001);
+    OIIO_CHECK_EQUAL_THRESH(imgR.getchannel(xres / 2, yres / 2, 0, 2), 0.50,
+                            0.001);
+
+    // clamp((0.25, 0.25, 0.5) * 0.5 - 0.1) = (0.025, 0.025, 0.15)
+    ImageBufAlgo::zero(imgR);
+    bench("IBA mad+mad+clamp chain threaded", test_IBA_chain, roi,
+          numthreads);
+    OIIO_CHECK_EQUAL_THRESH(imgR.getchannel(xres / 2, yres / 2, 0, 0), 0.025,
+                            0.001);
+    OIIO_CHECK_EQUAL_THRESH(imgR.getchannel(xres / 2, yres / 2, 0, 2), 0.15,
+                            0.001);
+
+    ImageBufAlgo::zero(imgR);
+    bench("IBA::eval fused chain threaded", test_IBA_eval_chain, roi,
+          numthreads);
+    OIIO_CHECK_EQUAL_THRESH(imgR.getchannel(xres / 2, yres / 2, 0, 0), 0.025,
+                            0.001);
+    OIIO_CHECK_EQUAL_THRESH(imgR.getchannel(xres / 2, yres / 2, 0, 2), 0.15,
+                            0.001);
 }
 
 
@@ -13,6 +13,7 @@
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
 #include <OpenImageIO/platform.h>
+#include <OpenImageIO/simd.h>
 #include <OpenImageIO/thread.h>
 
 #include "imageio_pvt.h"
@@ -353,6 +354,260 @@ ImageBufAlgo::type_merge(TypeDesc::BASETYPE a, TypeDesc::BASETYPE b)
 
 
 
+// If the 2D kernel is (to within rounding) the outer product of a column
+// and a row -- as are those that make_kernel makes from separable filters
+// -- return true and fill in `row` and `col`.
+static bool
+separable_kernel(const ImageBuf& kernel, std::vector<float>& row,
+                 std::vector<float>& col)
+{
+    const ImageSpec& kspec(kernel.spec());
+    int kw = kspec.width, kh = kspec.height, kchans = kspec.nchannels;
+    const float* k = (const float*)kernel.localpixels();
+    auto K = [&](int x, int y) { return k[(size_t(y) * kw + x) * kchans]; };
+    // Pivot on the element of largest magnitude
+    int px = 0, py = 0;
+    float big = 0.0f;
+    for (int y = 0; y < kh; ++y)
+        for (int x = 0; x < kw; ++x)
+            if (std::abs(K(x, y)) > big) {
+                big = std::abs(K(x, y));
+                px  = x;
+                py  = y;
+            }
+    if (big == 0.0f)
+        return false;
+    row.resize(kw);
+    col.resize(kh);
+    for (int x = 0; x < kw; ++x)
+        row[x] = K(x, py);
+    for (int y = 0; y < kh; ++y)
+        col[y] = K(px, y) / K(px, py);
+    float tolerance = 1.0e-5f * big;
+    for (int y = 0; y < kh; ++y)
+        for (int x = 0; x < kw; ++x)
+            if (std::abs(K(x, y) - col[y] * row[x]) > tolerance)
+                return false;
+    return true;
+}
+
+
+
+// Convolve with a separable kernel in two 1D passes: each source row that
+// the output needs is convolved with `krow` into a float intermediate, and
+// those rows are then combined with the weights of `kcol`. The source is
+// read with the same WrapClamp iterators as the direct method, so edges
+// come out the same.
+template<typename DSTTYPE, typename SRCTYPE>
+static bool
+convolve_separable_(ImageBuf& dst, const ImageBuf& src, const ImageBuf& kernel,
+                    cspan<float> krow, cspan<float> kcol, float scale, ROI roi,
+                    int nthreads)
+{
+    ROI kroi = kernel.roi();
+    int kw = kroi.width(), kh = kroi.height();
+    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        int nchannels   = roi.nchannels();
+        int width       = roi.width();
+        int padx0       = roi.xbegin + kroi.xbegin;
+        int padwidth    = width + kw - 1;
+        int z           = roi.zbegin + kroi.zbegin;
+        size_t nvalues  = size_t(width) * nchannels;
+        std::unique_ptr<float[]> padded(new float[padwidth * nchannels]);
+        // A ring of rows convolved horizontally, enough for all the
+        // vertical taps of one output row, remembering which source row
+        // each holds. Successive output rows reuse all but one of them.
+        std::unique_ptr<float[]> ring(new float[kh * nvalues]);
+        std::vector<int> ringrow(kh, std::numeric_limits<int>::min());
+        std::unique_ptr<float[]> acc(new float[nvalues]);
+
+        // Return source row sy convolved with krow.
+        auto hrow = [&](int sy) -> const float* {
+            int slot = ((sy % kh) + kh) % kh;
+            float* h = &ring[slot * nvalues];
+            if (ringrow[slot] == sy)
+                return h;
+            ringrow[slot] = sy;
+            float* p      = padded.get();
+            for (ImageBuf::ConstIterator<SRCTYPE> s(src,
+                                                    ROI(padx0, padx0 + padwidth,
+                                                        sy, sy + 1, z, z + 1),
+                                                    ImageBuf::WrapClamp);
+                 !s.done(); ++s, p += nchannels)
+                for (int c = 0; c < nchannels; ++c)
+                    p[c] = s[roi.chbegin + c];
+            for (int x = 0; x < width; ++x, h += nchannels) {
+                p = padded.get() + x * nchannels;
+                if (nchannels == 4) {
+                    simd::vfloat4 sum = simd::vfloat4::Zero();
+                    for (int k = 0; k < kw; ++k, p += 4)
+                        sum += simd::vfloat4(krow[k]) * simd::vfloat4(p);
+                    sum.store(h);
+                } else {
+                    for (int c = 0; c < nchannels; ++c)
+                        h[c] = 0.0f;
+                    for (int k = 0; k < kw; ++k, p += nchannels)
+                        for (int c = 0; c < nchannels; ++c)
+                            h[c] += krow[k] * p[c];
+                }
+            }
+            return &ring[slot * nvalues];
+        };
+
+        ImageBuf::Iterator<DSTTYPE> d(dst, roi);
+        for (int y = roi.ybegin; y < roi.yend; ++y) {
+            for (size_t v = 0; v < nvalues; ++v)
+                acc[v] = 0.0f;
+            for (int j = 0; j < kh; ++j) {
+                if (kcol[j] == 0.0f)
+                    continue;
+                float w        = kcol[j] * scale;
+                const float* h = hrow(y + kroi.ybegin + j);
+                // Contiguous, so this auto-vectorizes well.
+                for (size_t v = 0; v < nvalues; ++v)
+                    acc[v] += w * h[v];
+            }
+            for (size_t v = 0; v < nvalues; v += nchannels, ++d)
+                for (int c = 0; c < nchannels; ++c)
+                    d[roi.chbegin + c] = acc[v + c];
+        }
+    });
+    return true;
+}
+
+
+
+// In-place 2D FFT of an n x n complex array, rows then columns. `tmp`
+// must hold 2n values.
+static void
+fft2d_(std::complex<float>* data, int n, kissfft<float>& F,
+       std::complex<float>* tmp)
+{
+    for (int y = 0; y < n; ++y) {
+        F.transform(data + size_t(y) * n, tmp);
+        std::copy(tmp, tmp + n, data + size_t(y) * n);
+    }
+    for (int x = 0; x < n; ++x) {
+        for (int y = 0; y < n; ++y)
+            tmp[y] = data[size_t(y) * n + x];
+        F.transform(tmp, tmp + n);
+        for (int y = 0; y < n; ++y)
+            data[size_t(y) * n + x] = tmp[n + y];
+    }
+}
+
+
+
+// Estimated cost, in multiply-adds per channel, of convolving roi with a
+// kw x kh kernel by FFT over tiles that transform at size n x n.
+static double
+convolve_fft_cost(ROI roi, int kw, int kh, int n)
+{
+    int tw = n - kw + 1, th = n - kh + 1;
+    if (tw < 1 || th < 1)
+        return std::numeric_limits<double>::max();
+    double ntiles = double((roi.width() + tw - 1) / tw)
+                    * double((roi.height() + th - 1) / th);
+    double n2 = double(n) * n;
+    // A forward and an inverse transform, plus the complex multiply, for
+    // each tile, shared by two channels packed into one complex signal.
+    // The transforms' scattered memory access makes each of their
+    // operations dearer than one of the direct method's, by very roughly
+    // this much:
+    const double overhead = 4.0;
+    return ntiles * overhead * (5.0 * n2 * std::log2(n2) + 4.0 * n2) / 2.0;
+}
+
+
+
+// Convolve by FFT. The output is cut into tiles of (n-kw+1) x (n-kh+1)
+// pixels, each of which is computed from its n x n neighborhood of source
+// pixels (read through WrapClamp iterators, as for the direct method), by
+// multiplying its transform with that of the kernel. Pairs of channels go
+// through each transform together, as its real and imaginary parts.
+template<typename DSTTYPE, typename SRCTYPE>
+static bool
+convolve_fft_(ImageBuf& dst, const ImageBuf& src, const ImageBuf& kernel,
+              float scale, int n, ROI roi, int nthreads)
+{
+    typedef std::complex<float> cpx;
+    ROI kroi = kernel.roi();
+    int kw = kroi.width(), kh = kroi.height();
+    int kchans = kernel.nchannels();
+    int tw = n - kw + 1, th = n - kh + 1;
+    int ntx = (roi.width() + tw - 1) / tw;
+    int nty = (roi.height() + th - 1) / th;
+    int nchannels = roi.nchannels();
+    int z         = roi.zbegin + kroi.zbegin;
+
+    // Our convolve is really a correlation, which is the inverse transform
+    // of the product of the source's transform with the conjugate of the
+    // kernel's. Fold the inverse's 1/n^2 and the normalization in too.
+    std::vector<cpx> kfreq(size_t(n) * n, cpx(0.0f));
+    const float* k = (const float*)kernel.localpixels();
+    for (int y = 0; y < kh; ++y)
+        for (int x = 0; x < kw; ++x)
+            kfreq[size_t(y) * n + x] = k[(size_t(y) * kw + x) * kchans];
+    {
+        kissfft<float> F(n, false);
+        std::vector<cpx> tmp(2 * n);
+        fft2d_(kfreq.data(), n, F, tmp.data());
+        float rescale = scale / (float(n) * float(n));
+        for (auto& f : kfreq)
+            f = std::conj(f) * rescale;
+    }
+
+    parallel_options opt(nthreads, Split_Y, 1);
+    parallel_for(0, int64_t(ntx) * nty, [&](int64_t t) {
+        int x0 = roi.xbegin + int(t % ntx) * tw;
+        int y0 = roi.ybegin + int(t / ntx) * th;
+        ROI tile(x0, std::min(x0 + tw, roi.xend), y0,
+                 std::min(y0 + th, roi.yend), roi.zbegin, roi.zend,
+                 roi.chbegin, roi.chend);
+        // The source pixels that this tile's outputs need
+        ROI apron(x0 + kroi.xbegin, x0 + kroi.xbegin + n, y0 + kroi.ybegin,
+                  y0 + kroi.ybegin + n, z, z + 1);
+        std::vector<float> srcpels(size_t(n) * n * nchannels);
+        float* p = srcpels.data();
+        for (ImageBuf::ConstIterator<SRCTYPE> s(src, apron,
+                                                ImageBuf::WrapClamp);
+             !s.done(); ++s, p += nchannels)
+            for (int c = 0; c < nchannels; ++c)
+                p[c] = s[roi.chbegin + c];
+
+        kissfft<float> F(n, false), Finv(n, true);
+        std::vector<cpx> buf(size_t(n) * n), tmp(2 * n);
+        std::vector<float> result(size_t(tw) * th * nchannels);
+        for (int c = 0; c < nchannels; c += 2) {
+            bool pair = (c + 1 < nchannels);
+            for (size_t i = 0, e = size_t(n) * n; i < e; ++i)
+                buf[i] = cpx(srcpels[i * nchannels + c],
+                             pair ? srcpels[i * nchannels + c + 1] : 0.0f);
+            fft2d_(buf.data(), n, F, tmp.data());
+            for (size_t i = 0, e = size_t(n) * n; i < e; ++i)
+                buf[i] *= kfreq[i];
+            fft2d_(buf.data(), n, Finv, tmp.data());
+            for (int y = 0; y < th; ++y)
+                for (int x = 0; x < tw; ++x) {
+                    const cpx& r(buf[size_t(y) * n + x]);
+                    float* o = &result[(size_t(y) * tw + x) * nchannels];
+                    o[c]     = r.real();
+                    if (pair)
+                        o[c + 1] = r.imag();
+                }
+        }
+        for (ImageBuf::Iterator<DSTTYPE> d(dst, tile); !d.done(); ++d) {
+            const float* o = &result[(size_t(d.y() - y0) * tw + (d.x() - x0))
+                                     * nchannels];
+            for (int c = 0; c < nchannels; ++c)
+                d[roi.chbegin + c] = o[c];
+        }
+    }, opt);
+    return true;
+}
+
+
+
 template<typename DSTTYPE, typename SRCTYPE>
 static bool
 convolve_(ImageBuf& dst, const ImageBuf& src, const ImageBuf& kernel,
@@ -361,6 +616,40 @@ convolve_(ImageBuf& dst, const ImageBuf& src, const ImageBuf& kernel,
     using namespace ImageBufAlgo;
     OIIO_DASSERT(kernel.spec().format == TypeDesc::FLOAT && kernel.localpixels()
                  && "kernel should be float and in local memory");
+
+    // For 2D, pick whichever of the direct sum, two 1D passes (if the
+    // kernel is separable), or FFT we estimate to be cheapest.
+    const ImageSpec& kspec(kernel.spec());
+    if (kspec.depth == 1 && roi.depth() == 1) {
+        int kw = kspec.width, kh = kspec.height;
+        float scale = 1.0f;
+        if (normalize) {
+            scale = 0.0f;
+            for (ImageBuf::ConstIterator<float> k(kernel); !k.done(); ++k)
+                scale += k[0];
+            scale = 1.0f / scale;
+        }
+        double npixels = double(roi.width()) * roi.height();
+        double direct  = npixels * kw * kh;
+        std::vector<float> krow, kcol;
+        if (kw * kh > kw + kh && separable_kernel(kernel, krow, kcol))
+            return convolve_separable_<DSTTYPE, SRCTYPE>(dst, src, kernel,
+                                                         krow, kcol, scale,
+                                                         roi, nthreads);
+        int bestn      = 0;
+        double fftcost = direct;
+        for (int n = 16; n <= 2048; n *= 2) {
+            double cost = convolve_fft_cost(roi, kw, kh, n);
+            if (cost < fftcost) {
+                fftcost = cost;
+                bestn   = n;
+            }
+        }
+        if (bestn)
+            return convolve_fft_<DSTTYPE, SRCTYPE>(dst, src, kernel, scale,
+                                                   bestn, roi, nthreads);
+    }
+
     parallel_image(roi, nthreads, [&](ROI roi) {
         ROI kroi   = kernel.roi();
         int kchans = kernel.nchannels();
@@ -638,16 +927,151 @@ ImageBufAlgo::laplacian(const ImageBuf& src, ROI roi, int nthreads)
 
 
 
+// Median filter for 8- and 16-bit integer images, using histograms of the
+// pixel values in the window rather than sorting them. For 8 bits, we also
+// keep a histogram for each column of the window (Perreault & Hebert,
+// "Median Filtering in Constant Time"), so sliding the window one pixel
+// costs the same no matter its size. Histograms of every column would take
+// too much memory at 16 bits, so there we slide a single histogram along
+// each row (Huang's method), with a coarse level to find the median fast.
+// The window and the median chosen are the same as median_filter_impl's.
+template<class Rtype, class Atype>
+static bool
+median_filter_hist_(ImageBuf& R, const ImageBuf& A, int width, int height,
+                    ROI roi, int nthreads)
+{
+    const int bits  = sizeof(Atype) == 1 ? 8 : 16;
+    const int nbins = 1 << bits;
+    const int vmin  = int(std::numeric_limits<Atype>::min());
+    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        int w_2       = std::max(1, width / 2);
+        int h_2       = std::max(1, height / 2);
+        int nchannels = R.nchannels();
+        ROI data      = A.roi();
+        // Only these source pixels are in any of this chunk's windows
+        int sx0 = std::max(roi.xbegin - w_2, data.xbegin);
+        int sx1 = std::max(std::min(roi.xend - w_2 + width - 1, data.xend),
+                           sx0);
+        int sy0 = std::max(roi.ybegin - h_2, data.ybegin);
+        int sy1 = std::max(std::min(roi.yend - h_2 + height - 1, data.yend),
+                           sy0);
+        int sw  = sx1 - sx0;
+        std::vector<Atype> pels(size_t(sw) * (sy1 - sy0) * nchannels);
+        std::vector<float> result(size_t(roi.width()) * roi.height()
+                                  * nchannels);
+        std::vector<uint32_t> hist(nbins), coarse(256), colhist;
+        if (bits == 8)
+            colhist.resize(size_t(sw) * nbins);
+
+        for (int z = roi.zbegin; z < roi.zend; ++z) {
+            if (pels.size())
+                A.get_pixels(ROI(sx0, sx1, sy0, sy1, z, z + 1, 0, nchannels),
+                             TypeDescFromC<Atype>::value(), pels.data());
+            for (int c = 0; c < nchannels; ++c) {
+                auto bin = [&](int x, int y) {
+                    size_t i = (size_t(y - sy0) * sw + (x - sx0)) * nchannels;
+                    return int(pels[i + c]) - vmin;
+                };
+                // Update a histogram for removing (incr = -1) or adding
+                // (incr = 1) pixels [x0,x1) x [y0,y1).
+                auto update = [&](int x0, int x1, int y0, int y1, int incr) {
+                    for (int y = y0; y < y1; ++y)
+                        for (int x = x0; x < x1; ++x) {
+                            int b = bin(x, y);
+                            hist[b] += incr;
+                            coarse[b >> (bits - 8)] += incr;
+                        }
+                };
+                // Rows [ra,rb) are in the column histograms
+                int ra = sy0, rb = sy0;
+                std::fill(colhist.begin(), colhist.end(), 0);
+                float* out = result.data() + c;
+                for (int y = roi.ybegin; y < roi.yend; ++y) {
+                    int y0 = clamp(y - h_2, sy0, sy1);
+                    int y1 = clamp(y - h_2 + height, sy0, sy1);
+                    if (bits == 8) {
+                        for (int r = ra; r < std::min(y0, rb); ++r)
+                            for (int x = sx0; x < sx1; ++x)
+                                --colhist[size_t(x - sx0) * nbins + bin(x, r)];
+                        for (int r = std::max(rb, y0); r < y1; ++r)
+                            for (int x = sx0; x < sx1; ++x)
+                                ++colhist[size_t(x - sx0) * nbins + bin(x, r)];
+                        ra = y0;
+                        rb = y1;
+                    }
+                    // Columns [ca,cb) are in the window histogram
+                    int ca = sx0, cb = sx0;
+                    std::fill(hist.begin(), hist.end(), 0);
+                    std::fill(coarse.begin(), coarse.end(), 0);
+                    for (int x = roi.xbegin; x < roi.xend;
+                         ++x, out += nchannels) {
+                        int x0 = clamp(x - w_2, sx0, sx1);
+                        int x1 = clamp(x - w_2 + width, sx0, sx1);
+                        if (bits == 8) {
+                            for (int col = ca; col < std::min(x0, cb); ++col) {
+                                const uint32_t* h = &colhist[size_t(col - sx0)
+                                                             * nbins];
+                                for (int b = 0; b < nbins; ++b)
+                                    hist[b] -= h[b];
+                            }
+                            for (int col = std::max(cb, x0); col < x1; ++col) {
+                                const uint32_t* h = &colhist[size_t(col - sx0)
+                                                             * nbins];
+                                for (int b = 0; b < nbins; ++b)
+                                    hist[b] += h[b];
+                            }
+                        } else {
+                            update(ca, std::min(x0, cb), y0, y1, -1);
+                            update(std::max(cb, x0), x1, y0, y1, 1);
+                        }
+                        ca        = x0;
+                        cb        = x1;
+                        int64_t n = int64_t(x1 - x0) * (y1 - y0);
+                        if (n == 0) {
+                            *out = 0.0f;
+                            continue;
+                        }
+                        // Find the value of rank n/2
+                        int64_t rank = n / 2, below = 0;
+                        int b        = 0;
+                        if (bits == 16) {
+                            int cbin = 0;
+                            while (below + coarse[cbin] <= rank)
+                                below += coarse[cbin++];
+                            b = cbin << 8;
+                        }
+                        while (below + hist[b] <= rank)
+                            below += hist[b++];
+                        *out = convert_type<Atype, float>(Atype(b + vmin));
+                    }
+                }
+            }
+            const float* r = result.data();
+            for (ImageBuf::Iterator<Rtype> d(R, roi.xbegin, roi.xend,
+                                             roi.ybegin, roi.yend, z, z + 1);
+                 !d.done(); ++d, r += nchannels)
+                for (int c = 0; c < nchannels; ++c)
+                    d[c] = r[c];
+        }
+    });
+    return true;
+}
+
+
+
 template<class Rtype, class Atype>
 static bool
 median_filter_impl(ImageBuf& R, const ImageBuf& A, int width, int height,
                    ROI roi, int nthreads)
 {
+    if (width < 1)
+        width = 1;
+    if (height < 1)
+        height = width;
+    if (std::numeric_limits<Atype>::is_integer && sizeof(Atype) <= 2)
+        return median_filter_hist_<Rtype, Atype>(R, A, width, height, roi,
+                                                 nthreads);
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
-        if (width < 1)
-            width = 1;
-        if (height < 1)
-            height = width;
         int w_2        = std::max(1, width / 2);
         int h_2        = std::max(1, height / 2);
         int windowsize = width * height;
@@ -719,48 +1143,137 @@ ImageBufAlgo::median_filter(const ImageBuf& src, int width, int height, ROI roi,
 
 enum MorphOp { MorphDilate, MorphErode };
 
+// Running max (or min, or any other associative op) over each `window`
+// consecutive elements of `in`, by the method of van Herk and Gil & Werman,
+// which takes three applications of `op` per element whatever the window
+// size. Each element is `len` contiguous floats, to which `op` is applied
+// independently. `in` has nout+window-1 elements, and `g` and `h` must
+// have room for as many.
+template<class OP>
+static void
+running_extreme_(const float* in, float* out, int nout, int window,
+                 size_t len, float* g, float* h, OP op)
+{
+    int n = nout + window - 1;
+    // Within each block of `window` elements, g runs forward from the
+    // block's start, and h runs backward from its end.
+    for (int b = 0; b < n; b += window) {
+        int e = std::min(b + window, n);
+        std::copy(in + b * len, in + (b + 1) * len, g + b * len);
+        for (size_t i = (b + 1) * len; i < e * len; ++i)
+            g[i] = op(g[i - len], in[i]);
+        std::copy(in + (e - 1) * len, in + e * len, h + (e - 1) * len);
+        for (size_t i = (e - 1) * len; i-- > b * len;)
+            h[i] = op(h[i + len], in[i]);
+    }
+    // Each window is the tail of one block and the head of the next.
+    for (size_t i = 0, w = (window - 1) * len; i < nout * len; ++i)
+        out[i] = op(h[i], g[i + w]);
+}
+
+
+
+// Dilate or erode. The rectangular window is separable, so we take the
+// running extreme along each needed source row, then down the columns of
+// those results. Pixels outside the data window are left out of the
+// window, as if they were the identity of the operation.
 template<class Rtype, class Atype>
 static bool
 morph_impl(ImageBuf& R, const ImageBuf& A, int width, int height, MorphOp op,
            ROI roi, int nthreads)
 {
+    if (width < 1)
+        width = 1;
+    if (height < 1)
+        height = width;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
-        if (width < 1)
-            width = 1;
-        if (height < 1)
-            height = width;
         int w_2       = std::max(1, width / 2);
         int h_2       = std::max(1, height / 2);
-        int nchannels = R.nchannels();
-        float* vals   = OIIO_ALLOCA(float, nchannels);
-        ImageBuf::ConstIterator<Atype> a(A, roi);
-        for (ImageBuf::Iterator<Rtype> r(R, roi); !r.done(); ++r) {
-            a.rerange(r.x() - w_2, r.x() - w_2 + width, r.y() - h_2,
-                      r.y() - h_2 + height, r.z(), r.z() + 1,
-                      ImageBuf::WrapClamp);
-            if (op == MorphDilate) {
-                for (int c = 0; c < nchannels; ++c)
-                    vals[c] = -std::numeric_limits<float>::max();
-                for (; !a.done(); ++a) {
-                    if (a.exists()) {
-                        for (int c = 0; c < nchannels; ++c)
-                            vals[c] = std::max(vals[c], a[c]);
-                    }
+        int nchannels  = R.nchannels();
+        float identity = (op == MorphDilate)
+                             ? -std::numeric_limits<float>::max()
+                             : std::numeric_limits<float>::max();
+        ROI data = A.roi();
+        int ow   = roi.width();
+        // Source rows [py0, py0+ph) and columns [px0, px0+pw) contribute
+        int px0 = roi.xbegin - w_2, pw = ow + width - 1;
+        int py0 = roi.ybegin - h_2, ph = roi.height() + height - 1;
+        int sx0 = std::max(px0, data.xbegin);
+        int sx1 = std::min(px0 + pw, data.xend);
+        size_t rowlen = size_t(ow) * nchannels;
+        std::vector<float> row(size_t(pw) * nchannels);
+        std::vector<float> g(row.size()), h(row.size());
+        auto running = [&](const float* in, float* out) {
+            auto max = [](float a, float b) { return std::max(a, b); };
+            auto min = [](float a, float b) { return std::min(a, b); };
+            if (op == MorphDilate)
+                running_extreme_(in, out, ow, width, nchannels, g.data(),
+                                 h.data(), max);
+            else
+                running_extreme_(in, out, ow, width, nchannels, g.data(),
+                                 h.data(), min);
+        };
+        auto combine = [&](const float* a, const float* b, float* out) {
+            if (op == MorphDilate)
+                for (size_t i = 0; i < rowlen; ++i)
+                    out[i] = std::max(a[i], b[i]);
+            else
+                for (size_t i = 0; i < rowlen; ++i)
+                    out[i] = std::min(a[i], b[i]);
+        };
+
+        // The columns get the same van Herk/Gil-Werman treatment as the
+        // rows, but streamed down the image a block of `height` rows at a
+        // time, so that rather than the whole ROI, we only hold the rows
+        // of the block being read, the backward running extremes of the
+        // block before it, and the forward running extreme of this one.
+        std::vector<float> block(height * rowlen), hprev(height * rowlen);
+        std::vector<float> gcol(rowlen), out(rowlen);
+        for (int z = roi.zbegin; z < roi.zend; ++z) {
+            for (int j = 0; j < ph; ++j) {
+                int y     = py0 + j;
+                int t     = j % height;
+                float* in = &block[t * rowlen];
+                if (y < data.ybegin || y >= data.yend || sx0 >= sx1) {
+                    std::fill(in, in + rowlen, identity);
+                } else {
+                    std::fill(row.begin(), row.end(), identity);
+                    A.get_pixels(ROI(sx0, sx1, y, y + 1, z, z + 1, 0,
+                                     nchannels),
+                                 TypeFloat,
+                                 &row[size_t(sx0 - px0) * nchannels]);
+                    running(row.data(), in);
                 }
-            } else if (op == MorphErode) {
-                for (int c = 0; c < nchannels; ++c)
-                    vals[c] = std::numeric_limits<float>::max();
-                for (; !a.done(); ++a) {
-                    if (a.exists()) {
-                        for (int c = 0; c < nchannels; ++c)
-                            vals[c] = std::min(vals[c], a[c]);
+                if (t == 0)
+                    std::copy(in, in + rowlen, gcol.begin());
+                else
+                    combine(gcol.data(), in, gcol.data());
+                // Output row o's window ends at source row j. It's the tail
+                // of the previous block and the head of this one, or
+                // exactly this block when it's complete.
+                int o = j - height + 1;
+                if (o >= 0) {
+                    const float* r = gcol.data();
+                    if (t < height - 1) {
+                        combine(&hprev[(t + 1) * rowlen], gcol.data(),
+                                out.data());
+                        r = out.data();
                     }
+                    for (ImageBuf::Iterator<Rtype> d(R, roi.xbegin, roi.xend,
+                                                     roi.ybegin + o,
+                                                     roi.ybegin + o + 1, z,
+                                                     z + 1);
+                         !d.done(); ++d, r += nchannels)
+                        for (int c = 0; c < nchannels; ++c)
+                            d[c] = r[c];
+                }
+                if (t == height - 1) {
+                    for (int i = height - 2; i >= 0; --i)
+                        combine(&block[(i + 1) * rowlen], &block[i * rowlen],
+                                &block[i * rowlen]);
+                    std::swap(block, hprev);
                 }
-            } else {
-                OIIO_ASSERT(0 && "Unknown morphological operator");
             }
-            for (int c = 0; c < nchannels; ++c)
-                r[c] = vals[c];
         }
     });
     return true;
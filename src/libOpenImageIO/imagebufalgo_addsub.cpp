@@ -18,17 +18,39 @@
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
 
+#include "imagebufalgo_pvt.h"
 #include "imageio_pvt.h"
 
 
 OIIO_NAMESPACE_BEGIN
 
 
+// Whole-scanline kernels for when pvt::scanline_op can be used
+static void
+add_scanline(float* r, const float* a, const float* b, const float*, size_t n)
+{
+    using simd::vfloat8;
+    pvt::simd_map(r, a, b, n, [](vfloat8 a, vfloat8 b) { return a + b; });
+}
+
+
+static void
+sub_scanline(float* r, const float* a, const float* b, const float*, size_t n)
+{
+    using simd::vfloat8;
+    pvt::simd_map(r, a, b, n, [](vfloat8 a, vfloat8 b) { return a - b; });
+}
+
+
+
 template<class Rtype, class Atype, class Btype>
 static bool
 add_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, ROI roi,
          int nthreads)
 {
+    if (pvt::scanline_op<Rtype, Atype, Btype>(R, A, B, Image_or_Const::None(),
+                                              roi, nthreads, add_scanline))
+        return true;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
@@ -46,6 +68,9 @@ template<class Rtype, class Atype>
 static bool
 add_impl(ImageBuf& R, const ImageBuf& A, cspan<float> b, ROI roi, int nthreads)
 {
+    if (pvt::scanline_op<Rtype, Atype>(R, A, b, Image_or_Const::None(), roi,
+                                       nthreads, add_scanline))
+        return true;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
@@ -158,6 +183,9 @@ static bool
 sub_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, ROI roi,
          int nthreads)
 {
+    if (pvt::scanline_op<Rtype, Atype, Btype>(R, A, B, Image_or_Const::None(),
+                                              roi, nthreads, sub_scanline))
+        return true;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
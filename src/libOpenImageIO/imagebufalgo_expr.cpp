@@ -0,0 +1,573 @@
+// Copyright 2008-present Contributors to the OpenImageIO project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/OpenImageIO/oiio
+
+/// \file
+/// Deferred per-pixel expressions (ImageBufAlgo::Expr), evaluated in a
+/// single fused pass.
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <OpenImageIO/color.h>
+#include <OpenImageIO/dassert.h>
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+#include <OpenImageIO/imagebufalgo_util.h>
+
+#include "imageio_pvt.h"
+
+
+OIIO_NAMESPACE_BEGIN
+
+
+struct ImageBufAlgo::Expr::Node {
+    enum Op {
+        Image,
+        Const,
+        Neg,
+        Abs,
+        Invert,
+        Add,
+        Sub,
+        Mul,
+        Div,
+        Mad,
+        Pow,
+        Min,
+        Max,
+        Clamp,
+        Over,
+        ColorConvert
+    };
+    Op op;
+    const ImageBuf* img = nullptr;  // Image
+    std::vector<float> vals;        // Const, Clamp min
+    std::vector<float> vals2;       // Clamp max
+    int alpha_channel = -1;         // Over
+    const ColorProcessor* processor = nullptr;  // ColorConvert
+    bool unpremult                  = true;     // ColorConvert
+    std::shared_ptr<const Node> args[3];
+
+    Node(Op op) : op(op) {}
+};
+
+
+namespace ImageBufAlgo {
+
+using ExprNode    = Expr::Node;
+using ExprNodeRef = std::shared_ptr<const Expr::Node>;
+
+
+static ExprNodeRef
+make_node(ExprNode::Op op, const ExprNodeRef& a,
+          const ExprNodeRef& b = ExprNodeRef(),
+          const ExprNodeRef& c = ExprNodeRef())
+{
+    auto node     = std::make_shared<ExprNode>(op);
+    node->args[0] = a;
+    node->args[1] = b;
+    node->args[2] = c;
+    return node;
+}
+
+
+
+Expr::Expr(const ImageBuf& img)
+{
+    auto node = std::make_shared<Node>(Node::Image);
+    node->img = &img;
+    m_node    = node;
+}
+
+
+
+Expr::Expr(float val)
+{
+    auto node  = std::make_shared<Node>(Node::Const);
+    node->vals = { val };
+    m_node     = node;
+}
+
+
+
+Expr::Expr(cspan<float> vals)
+{
+    auto node = std::make_shared<Node>(Node::Const);
+    node->vals.assign(vals.begin(), vals.end());
+    if (node->vals.empty())
+        node->vals.push_back(0.0f);
+    m_node = node;
+}
+
+
+
+Expr
+Expr::operator-() const
+{
+    return Expr(make_node(Node::Neg, m_node));
+}
+
+
+
+Expr
+operator+(const Expr& A, const Expr& B)
+{
+    // Fold a product feeding a sum into a single multiply-add.
+    const ExprNode* a = A.node();
+    const ExprNode* b = B.node();
+    if (a->op == ExprNode::Mul)
+        return Expr(make_node(ExprNode::Mad, a->args[0], a->args[1],
+                              B.m_node));
+    if (b->op == ExprNode::Mul)
+        return Expr(make_node(ExprNode::Mad, b->args[0], b->args[1],
+                              A.m_node));
+    return Expr(make_node(ExprNode::Add, A.m_node, B.m_node));
+}
+
+
+
+Expr
+operator-(const Expr& A, const Expr& B)
+{
+    return Expr(make_node(ExprNode::Sub, A.m_node, B.m_node));
+}
+
+
+
+Expr
+operator*(const Expr& A, const Expr& B)
+{
+    return Expr(make_node(ExprNode::Mul, A.m_node, B.m_node));
+}
+
+
+
+Expr
+operator/(const Expr& A, const Expr& B)
+{
+    return Expr(make_node(ExprNode::Div, A.m_node, B.m_node));
+}
+
+
+
+Expr
+Expr::abs() const
+{
+    return Expr(make_node(Node::Abs, m_node));
+}
+
+
+
+Expr
+Expr::invert() const
+{
+    return Expr(make_node(Node::Invert, m_node));
+}
+
+
+
+Expr
+Expr::pow(const Expr& B) const
+{
+    return Expr(make_node(Node::Pow, m_node, B.m_node));
+}
+
+
+
+Expr
+Expr::min(const Expr& B) const
+{
+    return Expr(make_node(Node::Min, m_node, B.m_node));
+}
+
+
+
+Expr
+Expr::max(const Expr& B) const
+{
+    return Expr(make_node(Node::Max, m_node, B.m_node));
+}
+
+
+
+Expr
+Expr::clamp(cspan<float> min, cspan<float> max) const
+{
+    auto node     = std::make_shared<Node>(Node::Clamp);
+    node->args[0] = m_node;
+    node->vals.assign(min.begin(), min.end());
+    node->vals2.assign(max.begin(), max.end());
+    if (node->vals.empty())
+        node->vals.push_back(-std::numeric_limits<float>::max());
+    if (node->vals2.empty())
+        node->vals2.push_back(std::numeric_limits<float>::max());
+    return Expr(std::shared_ptr<const Node>(node));
+}
+
+
+
+Expr
+Expr::clamp(float min, float max) const
+{
+    return clamp(cspan<float>(min), cspan<float>(max));
+}
+
+
+
+Expr
+Expr::over(const Expr& B, int alpha_channel) const
+{
+    auto node           = std::make_shared<Node>(Node::Over);
+    node->args[0]       = m_node;
+    node->args[1]       = B.m_node;
+    node->alpha_channel = alpha_channel;
+    return Expr(std::shared_ptr<const Node>(node));
+}
+
+
+
+Expr
+Expr::colorconvert(const ColorProcessor* processor, bool unpremult) const
+{
+    auto node       = std::make_shared<Node>(Node::ColorConvert);
+    node->args[0]   = m_node;
+    node->processor = processor;
+    node->unpremult = unpremult;
+    return Expr(std::shared_ptr<const Node>(node));
+}
+
+
+
+namespace {
+
+// An expression flattened for evaluation: the nodes in an order where
+// each comes after its arguments, with per-channel constants expanded to
+// the channels being evaluated.
+struct ExprPlan {
+    struct Step {
+        const ExprNode* node;
+        int args[3] = { -1, -1, -1 };
+        std::vector<float> vals, vals2;  // expanded to the ROI's channels
+        int alpha_channel = -1;          // resolved, relative to the ROI
+                                         // (ColorConvert: -1 to not
+                                         // unpremultiply)
+    };
+    std::vector<Step> steps;
+    std::vector<const ImageBuf*> images;
+
+    int add(const ExprNode* node)
+    {
+        Step step;
+        step.node = node;
+        for (int i = 0; i < 3; ++i)
+            if (node->args[i])
+                step.args[i] = add(node->args[i].get());
+        if (node->op == ExprNode::Image)
+            images.push_back(node->img);
+        steps.push_back(std::move(step));
+        return int(steps.size()) - 1;
+    }
+
+    // Find the first image at or below step i, or nullptr.
+    const ImageBuf* first_image(int i) const
+    {
+        const Step& step(steps[i]);
+        if (step.node->op == ExprNode::Image)
+            return step.node->img;
+        for (int a : step.args)
+            if (a >= 0)
+                if (const ImageBuf* img = first_image(a))
+                    return img;
+        return nullptr;
+    }
+
+    // Expand the constants and find the alpha channels for the ROI.
+    // Return false, with an error message in err, if an over() has no
+    // alpha channel to use.
+    bool resolve(ROI roi, std::string& err)
+    {
+        int nchannels = roi.nchannels();
+        auto perchan  = [&](const std::vector<float>& v) {
+            std::vector<float> r(nchannels);
+            for (int c = 0; c < nchannels; ++c)
+                r[c] = v[std::min(size_t(roi.chbegin + c), v.size() - 1)];
+            return r;
+        };
+        for (int i = 0, e = int(steps.size()); i < e; ++i) {
+            Step& step(steps[i]);
+            if (step.node->vals.size())
+                step.vals = perchan(step.node->vals);
+            if (step.node->vals2.size())
+                step.vals2 = perchan(step.node->vals2);
+            if (step.node->op == ExprNode::Over) {
+                int a = step.node->alpha_channel;
+                if (a < 0) {
+                    const ImageBuf* img = first_image(step.args[0]);
+                    a = img ? img->spec().alpha_channel - roi.chbegin : -1;
+                }
+                if (a < 0 || a >= nchannels) {
+                    err = "over() requires an alpha channel";
+                    return false;
+                }
+                step.alpha_channel = a;
+            }
+            if (step.node->op == ExprNode::ColorConvert
+                && step.node->unpremult) {
+                // Like IBA::colorconvert, unpremultiply by the alpha of
+                // the first image, unless it's marked as unassociated.
+                const ImageBuf* img = first_image(step.args[0]);
+                int a = img ? img->spec().alpha_channel - roi.chbegin : -1;
+                if (a >= 0 && a < nchannels
+                    && !img->spec().get_int_attribute("oiio:UnassociatedAlpha"))
+                    step.alpha_channel = a;
+            }
+        }
+        return true;
+    }
+};
+
+
+
+// Return a pointer to the floats of one scanline (all of the ROI's
+// channels) of img, directly in its memory if we can, else copied into
+// buf.
+const float*
+image_row(const ImageBuf& img, ROI row, float* buf)
+{
+    if (img.localpixels() && img.spec().format == TypeFloat
+        && row.chbegin == 0 && row.chend == img.nchannels()
+        && img.contains_roi(row))
+        return (const float*)img.pixeladdr(row.xbegin, row.ybegin,
+                                           row.zbegin);
+    int nchannels = row.nchannels();
+    int chend     = std::min(row.chend, img.nchannels());
+    if (chend < row.chend || !img.contains_roi(row))
+        memset(buf, 0, sizeof(float) * row.width() * nchannels);
+    if (chend > row.chbegin) {
+        ROI r(row);
+        r.chend = chend;
+        img.get_pixels(r, TypeFloat, buf, nchannels * sizeof(float));
+    }
+    return buf;
+}
+
+}  // namespace
+
+
+
+bool
+eval(ImageBuf& dst, const Expr& expr, ROI roi, int nthreads)
+{
+    pvt::LoggedTimer logtime("IBA::eval");
+    ExprPlan plan;
+    int root = plan.add(expr.node());
+    for (const ImageBuf* img : plan.images) {
+        if (!img->initialized()) {
+            dst.errorfmt("Uninitialized input image");
+            return false;
+        }
+        if (img->deep()) {
+            dst.errorfmt("eval() does not support deep images");
+            return false;
+        }
+    }
+    // IBAprep only knows about three inputs; with more than that, start
+    // from the union of all their pixel windows.
+    if (!roi.defined() && plan.images.size() > 3 && !dst.initialized()) {
+        for (const ImageBuf* img : plan.images)
+            roi = roi_union(roi, img->roi());
+    }
+    size_t nimages = plan.images.size();
+    if (!IBAprep(roi, &dst, nimages > 0 ? plan.images[0] : nullptr,
+                 nimages > 1 ? plan.images[1] : nullptr,
+                 nimages > 2 ? plan.images[2] : nullptr))
+        return false;
+    std::string err;
+    if (!plan.resolve(roi, err)) {
+        dst.errorfmt("{}", err);
+        return false;
+    }
+
+    // Write the result straight into dst if it's in memory, float, and not
+    // also one of the inputs.
+    bool dst_is_input = std::find(plan.images.begin(), plan.images.end(),
+                                  &dst)
+                        != plan.images.end();
+    bool direct = !dst_is_input && dst.localpixels()
+                  && dst.spec().format == TypeFloat && roi.chbegin == 0
+                  && roi.chend == dst.nchannels();
+
+    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        int nchannels   = roi.nchannels();
+        int width       = roi.width();
+        size_t nvalues  = size_t(width) * nchannels;
+        size_t nsteps   = plan.steps.size();
+        stride_t xstride = nchannels * sizeof(float);
+        std::unique_ptr<float[]> scratch(new float[nvalues * nsteps]);
+        std::vector<const float*> vals(nsteps);
+        // Constants are the same on every scanline
+        for (size_t i = 0; i < nsteps; ++i) {
+            const ExprPlan::Step& step(plan.steps[i]);
+            if (step.node->op == ExprNode::Const) {
+                float* out = &scratch[i * nvalues];
+                for (int x = 0; x < width; ++x)
+                    for (int c = 0; c < nchannels; ++c)
+                        out[x * nchannels + c] = step.vals[c];
+                vals[i] = out;
+            }
+        }
+        for (int z = roi.zbegin; z < roi.zend; ++z) {
+            for (int y = roi.ybegin; y < roi.yend; ++y) {
+                ROI row(roi.xbegin, roi.xend, y, y + 1, z, z + 1,
+                        roi.chbegin, roi.chend);
+                for (size_t i = 0; i < nsteps; ++i) {
+                    const ExprPlan::Step& step(plan.steps[i]);
+                    float* out = (direct && int(i) == root)
+                                     ? (float*)dst.pixeladdr(roi.xbegin, y, z)
+                                     : &scratch[i * nvalues];
+                    const float* a = step.args[0] >= 0 ? vals[step.args[0]]
+                                                       : nullptr;
+                    const float* b = step.args[1] >= 0 ? vals[step.args[1]]
+                                                       : nullptr;
+                    const float* c = step.args[2] >= 0 ? vals[step.args[2]]
+                                                       : nullptr;
+                    vals[i] = out;
+                    // The straightforward loops auto-vectorize well.
+                    switch (step.node->op) {
+                    case ExprNode::Image:
+                        vals[i] = image_row(*step.node->img, row, out);
+                        break;
+                    case ExprNode::Const:
+                        vals[i] = &scratch[i * nvalues];
+                        break;
+                    case ExprNode::Neg:
+                        for (size_t v = 0; v < nvalues; ++v)
+                            out[v] = -a[v];
+                        break;
+                    case ExprNode::Abs:
+                        for (size_t v = 0; v < nvalues; ++v)
+                            out[v] = std::abs(a[v]);
+                        break;
+                    case ExprNode::Invert:
+                        for (size_t v = 0; v < nvalues; ++v)
+                            out[v] = 1.0f - a[v];
+                        break;
+                    case ExprNode::Add:
+                        for (size_t v = 0; v < nvalues; ++v)
+                            out[v] = a[v] + b[v];
+                        break;
+                    case ExprNode::Sub:
+                        for (size_t v = 0; v < nvalues; ++v)
+                            out[v] = a[v] - b[v];
+                        break;
+                    case ExprNode::Mul:
+                        for (size_t v = 0; v < nvalues; ++v)
+                            out[v] = a[v] * b[v];
+                        break;
+                    case ExprNode::Div:
+                        for (size_t v = 0; v < nvalues; ++v)
+                            out[v] = b[v] == 0.0f ? 0.0f : a[v] / b[v];
+                        break;
+                    case ExprNode::Mad:
+                        for (size_t v = 0; v < nvalues; ++v)
+                            out[v] = a[v] * b[v] + c[v];
+                        break;
+                    case ExprNode::Pow:
+                        for (size_t v = 0; v < nvalues; ++v)
+                            out[v] = std::pow(a[v], b[v]);
+                        break;
+                    case ExprNode::Min:
+                        for (size_t v = 0; v < nvalues; ++v)
+                            out[v] = std::min(a[v], b[v]);
+                        break;
+                    case ExprNode::Max:
+                        for (size_t v = 0; v < nvalues; ++v)
+                            out[v] = std::max(a[v], b[v]);
+                        break;
+                    case ExprNode::Clamp:
+                        for (int x = 0; x < width; ++x)
+                            for (int ch = 0; ch < nchannels; ++ch) {
+                                size_t v = size_t(x) * nchannels + ch;
+                                out[v]   = OIIO::clamp(a[v], step.vals[ch],
+                                                       step.vals2[ch]);
+                            }
+                        break;
+                    case ExprNode::Over:
+                        for (int x = 0; x < width; ++x) {
+                            size_t p      = size_t(x) * nchannels;
+                            float opacity = a[p + step.alpha_channel];
+                            for (int ch = 0; ch < nchannels; ++ch)
+                                out[p + ch] = a[p + ch]
+                                              + (1.0f - opacity) * b[p + ch];
+                        }
+                        break;
+                    case ExprNode::ColorConvert: {
+                        if (out != a)
+                            memcpy(out, a, nvalues * sizeof(float));
+                        if (!step.node->processor)
+                            break;
+                        int alpha = step.alpha_channel;
+                        if (alpha >= 0 && out != a) {
+                            // a keeps the original alpha for re-premultiplying
+                            for (int x = 0; x < width; ++x) {
+                                size_t p  = size_t(x) * nchannels;
+                                float inv = a[p + alpha] >= FLT_MIN
+                                                ? 1.0f / a[p + alpha]
+                                                : 1.0f;
+                                for (int ch = 0; ch < nchannels; ++ch)
+                                    if (ch != alpha)
+                                        out[p + ch] *= inv;
+                            }
+                        }
+                        step.node->processor->apply(out, width, 1, nchannels,
+                                                    sizeof(float), xstride,
+                                                    nvalues * sizeof(float));
+                        if (alpha >= 0 && out != a) {
+                            for (int x = 0; x < width; ++x) {
+                                size_t p      = size_t(x) * nchannels;
+                                float opacity = a[p + alpha];
+                                if (opacity < FLT_MIN)
+                                    continue;
+                                for (int ch = 0; ch < nchannels; ++ch)
+                                    if (ch != alpha)
+                                        out[p + ch] *= opacity;
+                                out[p + alpha] = opacity;
+                            }
+                        }
+                        break;
+                    }
+                    }
+                }
+                if (!direct)
+                    dst.set_pixels(row, TypeFloat, vals[root], xstride);
+                else if (vals[root]
+                         != (const float*)dst.pixeladdr(roi.xbegin, y, z))
+                    memcpy(dst.pixeladdr(roi.xbegin, y, z), vals[root],
+                           nvalues * sizeof(float));
+            }
+        }
+    });
+    return true;
+}
+
+
+
+ImageBuf
+eval(const Expr& expr, ROI roi, int nthreads)
+{
+    ImageBuf result;
+    bool ok = eval(result, expr, roi, nthreads);
+    if (!ok && !result.has_error())
+        result.errorfmt("eval error");
+    return result;
+}
+
+}  // namespace ImageBufAlgo
+
+OIIO_NAMESPACE_END
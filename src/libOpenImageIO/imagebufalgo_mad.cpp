@@ -11,7 +11,9 @@
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
+#include <OpenImageIO/simd.h>
 
+#include "imagebufalgo_pvt.h"
 #include "imageio_pvt.h"
 
 
@@ -19,62 +21,40 @@ OIIO_NAMESPACE_BEGIN
 
 
 
+// Whole-scanline kernel for when pvt::scanline_op can be used
+static void
+mad_scanline(float* r, const float* a, const float* b, const float* c,
+             size_t n)
+{
+    using simd::vfloat8;
+    // Not madd(), so that results match the iterator loops exactly.
+    pvt::simd_map(r, a, b, c, n,
+                  [](vfloat8 a, vfloat8 b, vfloat8 c) { return a * b + c; });
+}
+
+
+
 template<class Rtype, class ABCtype>
 static bool
 mad_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, const ImageBuf& C,
          ROI roi, int nthreads)
 {
+    // When all the images are in memory and contiguous, and we're operating
+    // on the full channel range, skip the iterators and operate on whole
+    // scanlines at a time. Otherwise, we will need the magic of the
+    // Iterators (and pay the price).
+    if (pvt::scanline_op<Rtype, ABCtype, ABCtype, ABCtype>(R, A, B, C, roi,
+                                                           nthreads,
+                                                           mad_scanline))
+        return true;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
-        if ((is_same<Rtype, float>::value || is_same<Rtype, half>::value)
-            && (is_same<ABCtype, float>::value || is_same<ABCtype, half>::value)
-            // && R.localpixels() // has to be, because it's writable
-            && A.localpixels() && B.localpixels()
-            && C.localpixels()
-            // && R.contains_roi(roi)  // has to be, because IBAPrep
-            && A.contains_roi(roi) && B.contains_roi(roi) && C.contains_roi(roi)
-            && roi.chbegin == 0 && roi.chend == R.nchannels()
-            && roi.chend == A.nchannels() && roi.chend == B.nchannels()
-            && roi.chend == C.nchannels()) {
-            // Special case when all inputs are either float or half, with in-
-            // memory contiguous data and we're operating on the full channel
-            // range: skip iterators: For these circumstances, we can operate on
-            // the raw memory very efficiently. Otherwise, we will need the
-            // magic of the the Iterators (and pay the price).
-            int nxvalues = roi.width() * R.nchannels();
-            for (int z = roi.zbegin; z < roi.zend; ++z)
-                for (int y = roi.ybegin; y < roi.yend; ++y) {
-                    Rtype* rraw = (Rtype*)R.pixeladdr(roi.xbegin, y, z);
-                    const ABCtype* araw
-                        = (const ABCtype*)A.pixeladdr(roi.xbegin, y, z);
-                    const ABCtype* braw
-                        = (const ABCtype*)B.pixeladdr(roi.xbegin, y, z);
-                    const ABCtype* craw
-                        = (const ABCtype*)C.pixeladdr(roi.xbegin, y, z);
-                    OIIO_DASSERT(araw && braw && craw);
-                    // The straightforward loop auto-vectorizes very well,
-                    // there's no benefit to using explicit SIMD here.
-                    for (int x = 0; x < nxvalues; ++x)
-                        rraw[x] = araw[x] * braw[x] + craw[x];
-                    // But if you did want to explicitly vectorize, this is
-                    // how it would look:
-                    // int simdend = nxvalues & (~3); // how many float4's?
-                    // for (int x = 0; x < simdend; x += 4) {
-                    //     simd::float4 a_simd(araw+x), b_simd(braw+x), c_simd(craw+x);
-                    //     simd::float4 r_simd = a_simd * b_simd + c_simd;
-                    //     r_simd.store (rraw+x);
-                    // }
-                    // for (int x = simdend; x < nxvalues; ++x)
-                    //     rraw[x] = araw[x] * braw[x] + craw[x];
-                }
-        } else {
-            ImageBuf::Iterator<Rtype> r(R, roi);
-            ImageBuf::ConstIterator<ABCtype> a(A, roi);
-            ImageBuf::ConstIterator<ABCtype> b(B, roi);
-            ImageBuf::ConstIterator<ABCtype> c(C, roi);
-            for (; !r.done(); ++r, ++a, ++b, ++c) {
-                for (int ch = roi.chbegin; ch < roi.chend; ++ch)
-                    r[ch] = a[ch] * b[ch] + c[ch];
-            }
+        ImageBuf::Iterator<Rtype> r(R, roi);
+        ImageBuf::ConstIterator<ABCtype> a(A, roi);
+        ImageBuf::ConstIterator<ABCtype> b(B, roi);
+        ImageBuf::ConstIterator<ABCtype> c(C, roi);
+        for (; !r.done(); ++r, ++a, ++b, ++c) {
+            for (int ch = roi.chbegin; ch < roi.chend; ++ch)
+                r[ch] = a[ch] * b[ch] + c[ch];
         }
     });
     return true;
@@ -87,6 +67,10 @@ static bool
 mad_impl_ici(ImageBuf& R, const ImageBuf& A, cspan<float> b, const ImageBuf& C,
              ROI roi, int nthreads)
 {
+    if (pvt::scanline_op<Rtype, ABCtype, float, ABCtype>(R, A, b, C, roi,
+                                                         nthreads,
+                                                         mad_scanline))
+        return true;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<ABCtype> a(A, roi);
@@ -106,6 +90,9 @@ static bool
 mad_impl_icc(ImageBuf& R, const ImageBuf& A, cspan<float> b, cspan<float> c,
              ROI roi, int nthreads)
 {
+    if (pvt::scanline_op<Rtype, Atype>(R, A, b, c, roi, nthreads,
+                                       mad_scanline))
+        return true;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
@@ -123,6 +110,9 @@ static bool
 mad_impl_iic(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, cspan<float> c,
              ROI roi, int nthreads)
 {
+    if (pvt::scanline_op<Rtype, Atype, Atype>(R, A, B, c, roi, nthreads,
+                                              mad_scanline))
+        return true;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
@@ -19,17 +19,41 @@
 #include <OpenImageIO/imagebufalgo_util.h>
 #include <OpenImageIO/simd.h>
 
+#include "imagebufalgo_pvt.h"
 #include "imageio_pvt.h"
 
 
 OIIO_NAMESPACE_BEGIN
 
 
+// Whole-scanline kernels for when pvt::scanline_op can be used
+static void
+mul_scanline(float* r, const float* a, const float* b, const float*, size_t n)
+{
+    using simd::vfloat8;
+    pvt::simd_map(r, a, b, n, [](vfloat8 a, vfloat8 b) { return a * b; });
+}
+
+
+static void
+div_scanline(float* r, const float* a, const float* b, const float*, size_t n)
+{
+    using simd::vfloat8;
+    // Like the iterator loop, x/0 is 0
+    pvt::simd_map(r, a, b, n,
+                  [](vfloat8 a, vfloat8 b) { return safe_div(a, b); });
+}
+
+
+
 template<class Rtype, class Atype, class Btype>
 static bool
 mul_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, ROI roi,
          int nthreads)
 {
+    if (pvt::scanline_op<Rtype, Atype, Btype>(R, A, B, Image_or_Const::None(),
+                                              roi, nthreads, mul_scanline))
+        return true;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
@@ -47,6 +71,9 @@ template<class Rtype, class Atype>
 static bool
 mul_impl(ImageBuf& R, const ImageBuf& A, cspan<float> b, ROI roi, int nthreads)
 {
+    if (pvt::scanline_op<Rtype, Atype>(R, A, b, Image_or_Const::None(), roi,
+                                       nthreads, mul_scanline))
+        return true;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::ConstIterator<Atype> a(A, roi);
         for (ImageBuf::Iterator<Rtype> r(R, roi); !r.done(); ++r, ++a)
@@ -142,6 +169,9 @@ static bool
 div_impl(ImageBuf& R, const ImageBuf& A, const ImageBuf& B, ROI roi,
          int nthreads)
 {
+    if (pvt::scanline_op<Rtype, Atype, Btype>(R, A, B, Image_or_Const::None(),
+                                              roi, nthreads, div_scanline))
+        return true;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::Iterator<Rtype> r(R, roi);
         ImageBuf::ConstIterator<Atype> a(A, roi);
@@ -19,6 +19,7 @@
 #include <OpenImageIO/imagebufalgo_util.h>
 #include <OpenImageIO/simd.h>
 
+#include "imagebufalgo_pvt.h"
 #include "imageio_pvt.h"
 
 
@@ -224,6 +225,24 @@ static bool
 clamp_(ImageBuf& dst, const ImageBuf& src, const float* min, const float* max,
        bool clampalpha01, ROI roi, int nthreads)
 {
+    int nchannels = dst.nchannels();
+    int alpha     = clampalpha01 ? src.spec().alpha_channel : -1;
+    auto clampop  = [&](float* r, const float* s, const float* lo,
+                       const float* hi, size_t n) {
+        using simd::vfloat8;
+        // max() first, so that a NaN is clamped to the low end, as by
+        // OIIO::clamp.
+        pvt::simd_map(r, s, lo, hi, n, [](vfloat8 s, vfloat8 lo, vfloat8 hi) {
+            return simd::min(simd::max(s, lo), hi);
+        });
+        if (alpha >= 0)
+            for (size_t i = alpha; i < n; i += nchannels)
+                r[i] = OIIO::clamp(r[i], 0.0f, 1.0f);
+    };
+    if (pvt::scanline_op<D, S>(dst, src, Image_or_Const(min, nchannels),
+                               Image_or_Const(max, nchannels), roi, nthreads,
+                               clampop))
+        return true;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::ConstIterator<S> s(src, roi);
         for (ImageBuf::Iterator<D> d(dst, roi); !d.done(); ++d, ++s) {
@@ -398,6 +417,16 @@ template<class Rtype, class Atype>
 static bool
 pow_impl(ImageBuf& R, const ImageBuf& A, cspan<float> b, ROI roi, int nthreads)
 {
+    // There's no SIMD pow, but a plain loop over whole scanlines still
+    // saves the per-channel iterator and conversion overhead.
+    auto powop = [](float* r, const float* a, const float* b, const float*,
+                    size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            r[i] = pow(a[i], b[i]);
+    };
+    if (pvt::scanline_op<Rtype, Atype>(R, A, b, Image_or_Const::None(), roi,
+                                       nthreads, powop))
+        return true;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         ImageBuf::ConstIterator<Atype> a(A, roi);
         for (ImageBuf::Iterator<Rtype> r(R, roi); !r.done(); ++r, ++a)
@@ -735,6 +764,37 @@ template<class Rtype, class Atype>
 static bool
 unpremult_(ImageBuf& R, const ImageBuf& A, ROI roi, int nthreads)
 {
+    int alpha_channel = A.spec().alpha_channel;
+    int z_channel     = A.spec().z_channel;
+    int nchannels     = A.nchannels();
+    auto unpremultop  = [&](float* r, const float* a, const float*,
+                           const float*, size_t n) {
+        using namespace simd;
+        // Alpha of 0 or 1 leaves the pixel alone, so divide by 1 instead.
+        auto divisor = [](float alpha) {
+            return (alpha == 0.0f || alpha == 1.0f) ? 1.0f : alpha;
+        };
+        size_t i = 0;
+        if (nchannels == 4 && alpha_channel == 3 && z_channel < 0) {
+            // RGBA: two pixels per vfloat8
+            for (; i + 8 <= n; i += 8) {
+                float d0 = divisor(a[i + 3]), d1 = divisor(a[i + 7]);
+                (vfloat8(a + i) / vfloat8(d0, d0, d0, 1.0f, d1, d1, d1, 1.0f))
+                    .store(r + i);
+            }
+        }
+        for (; i < n; i += nchannels) {
+            float d = divisor(a[i + alpha_channel]);
+            for (int c = 0; c < nchannels; ++c)
+                r[i + c] = (c == alpha_channel || c == z_channel)
+                               ? a[i + c]
+                               : a[i + c] / d;
+        }
+    };
+    if (pvt::scanline_op<Rtype, Atype>(R, A, Image_or_Const::None(),
+                                       Image_or_Const::None(), roi, nthreads,
+                                       unpremultop))
+        return true;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         int alpha_channel = A.spec().alpha_channel;
         int z_channel     = A.spec().z_channel;
@@ -813,6 +873,38 @@ static bool
 premult_(ImageBuf& R, const ImageBuf& A, bool preserve_alpha0, ROI roi,
          int nthreads)
 {
+    int alpha_channel = A.spec().alpha_channel;
+    int z_channel     = A.spec().z_channel;
+    int nchannels     = A.nchannels();
+    auto premultop    = [&](float* r, const float* a, const float*,
+                         const float*, size_t n) {
+        using namespace simd;
+        // Alpha of 1 (or 0, if preserving) leaves the pixel alone, as
+        // multiplying by 1 does.
+        auto factor = [=](float alpha) {
+            return (preserve_alpha0 && alpha == 0.0f) ? 1.0f : alpha;
+        };
+        size_t i = 0;
+        if (nchannels == 4 && alpha_channel == 3 && z_channel < 0) {
+            // RGBA: two pixels per vfloat8
+            for (; i + 8 <= n; i += 8) {
+                float f0 = factor(a[i + 3]), f1 = factor(a[i + 7]);
+                (vfloat8(a + i) * vfloat8(f0, f0, f0, 1.0f, f1, f1, f1, 1.0f))
+                    .store(r + i);
+            }
+        }
+        for (; i < n; i += nchannels) {
+            float f = factor(a[i + alpha_channel]);
+            for (int c = 0; c < nchannels; ++c)
+                r[i + c] = (c == alpha_channel || c == z_channel)
+                               ? a[i + c]
+                               : a[i + c] * f;
+        }
+    };
+    if (pvt::scanline_op<Rtype, Atype>(R, A, Image_or_Const::None(),
+                                       Image_or_Const::None(), roi, nthreads,
+                                       premultop))
+        return true;
     ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
         int alpha_channel = A.spec().alpha_channel;
         int z_channel     = A.spec().z_channel;
@@ -0,0 +1,202 @@
+// Copyright 2008-present Contributors to the OpenImageIO project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/OpenImageIO/oiio
+
+
+/// \file
+/// Non-public helpers shared by the ImageBufAlgo implementations.
+
+
+#pragma once
+
+#include <type_traits>
+#include <vector>
+
+#include <OpenImageIO/fmath.h>
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+#include <OpenImageIO/imagebufalgo_util.h>
+#include <OpenImageIO/simd.h>
+
+
+OIIO_NAMESPACE_BEGIN
+
+namespace pvt {
+
+
+/// Can `roi` of `R` and of each of the `inputs` that is an image be
+/// processed as a single contiguous run of values per scanline? That
+/// requires local, non-deep pixels with no padding between them, which
+/// contain the ROI, and an ROI that spans all of their channels.
+inline bool
+scanlines_contiguous(ROI roi, const ImageBuf& R,
+                     std::initializer_list<Image_or_Const> inputs)
+{
+    auto ok = [&](const ImageBuf& img) {
+        const ImageSpec& spec(img.spec());
+        return img.localpixels() && !img.deep() && img.contains_roi(roi)
+               && roi.chbegin == 0 && roi.chend == spec.nchannels
+               && img.pixel_stride() == stride_t(spec.pixel_bytes());
+    };
+    if (!ok(R))
+        return false;
+    for (auto& in : inputs)
+        if (in.is_img() && !ok(in.img()))
+            return false;
+    return true;
+}
+
+
+
+/// Supplies the values of one scanline of an operand as floats: for an
+/// image whose pixels are float, the pixels themselves; for other images,
+/// the pixels converted into a buffer; for a constant, a row of its
+/// per-channel values. An empty operand gives nullptr.
+template<class T> class ScanlineReader {
+public:
+    ScanlineReader(const Image_or_Const& src, ROI roi)
+        : m_img(src.is_img() ? src.imgptr() : nullptr)
+    {
+        size_t n = size_t(roi.width()) * roi.nchannels();
+        if (src.is_val()) {
+            cspan<float> val = src.val();
+            m_buf.resize(n);
+            for (size_t i = 0; i < n; ++i)
+                m_buf[i] = val[roi.chbegin + i % roi.nchannels()];
+        } else if (m_img && !std::is_same<T, float>::value) {
+            m_buf.resize(n);
+        }
+    }
+
+    const float* row(int x, int y, int z)
+    {
+        if (!m_img)
+            return m_buf.size() ? m_buf.data() : nullptr;
+        const T* p = (const T*)m_img->pixeladdr(x, y, z);
+        if (std::is_same<T, float>::value)
+            return (const float*)p;
+        convert_type<T, float>(p, m_buf.data(), m_buf.size());
+        return m_buf.data();
+    }
+
+private:
+    const ImageBuf* m_img;
+    std::vector<float> m_buf;
+};
+
+
+
+/// Provides float storage for the results of one scanline of an image:
+/// the pixels themselves if they are float, otherwise a buffer that
+/// finish() converts into them.
+template<class T> class ScanlineWriter {
+public:
+    ScanlineWriter(ImageBuf& img, size_t n)
+        : m_img(img)
+    {
+        if (!std::is_same<T, float>::value)
+            m_buf.resize(n);
+    }
+
+    float* row(int x, int y, int z)
+    {
+        m_dst = (T*)m_img.pixeladdr(x, y, z);
+        if (std::is_same<T, float>::value)
+            return (float*)m_dst;
+        return m_buf.data();
+    }
+
+    void finish()
+    {
+        if (!std::is_same<T, float>::value)
+            convert_type<float, T>(m_buf.data(), m_dst, m_buf.size());
+    }
+
+private:
+    ImageBuf& m_img;
+    T* m_dst = nullptr;
+    std::vector<float> m_buf;
+};
+
+
+
+/// If scanlines_contiguous(), call `op(r, a, b, c, n)` for each scanline
+/// of `roi`, where `r` receives the scanline's n float results and `a`,
+/// `b`, `c` hold the corresponding values of the operands (images or
+/// per-channel constants), and return true. Empty operands `b` or `c` get
+/// `a` passed in their place. Conversion to and from float is done for
+/// whole scanlines at a time, outside of `op`. Return false, doing
+/// nothing, if the images don't allow it.
+template<class Rtype, class Atype, class Btype = float, class Ctype = float,
+         class OP>
+inline bool
+scanline_op(ImageBuf& R, const Image_or_Const& A, const Image_or_Const& B,
+            const Image_or_Const& C, ROI roi, int nthreads, OP op)
+{
+    if (!scanlines_contiguous(roi, R, { A, B, C }))
+        return false;
+    ImageBufAlgo::parallel_image(roi, nthreads, [&](ROI roi) {
+        size_t n = size_t(roi.width()) * roi.nchannels();
+        ScanlineReader<Atype> a(A, roi);
+        ScanlineReader<Btype> b(B, roi);
+        ScanlineReader<Ctype> c(C, roi);
+        ScanlineWriter<Rtype> r(R, n);
+        for (int z = roi.zbegin; z < roi.zend; ++z) {
+            for (int y = roi.ybegin; y < roi.yend; ++y) {
+                const float* arow = a.row(roi.xbegin, y, z);
+                const float* brow = b.row(roi.xbegin, y, z);
+                const float* crow = c.row(roi.xbegin, y, z);
+                op(r.row(roi.xbegin, y, z), arow, brow ? brow : arow,
+                   crow ? crow : arow, n);
+                r.finish();
+            }
+        }
+    });
+    return true;
+}
+
+
+
+/// r[i] = f(a[i], b[i]) for i in [0,n), computing 8 at a time with
+/// vfloat8 arguments and results.
+template<class F>
+inline void
+simd_map(float* r, const float* a, const float* b, size_t n, F f)
+{
+    using simd::vfloat8;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        f(vfloat8(a + i), vfloat8(b + i)).store(r + i);
+    if (i < n) {
+        vfloat8 va, vb;
+        va.load(a + i, int(n - i));
+        vb.load(b + i, int(n - i));
+        f(va, vb).store(r + i, int(n - i));
+    }
+}
+
+
+/// r[i] = f(a[i], b[i], c[i]) for i in [0,n), computing 8 at a time with
+/// vfloat8 arguments and results.
+template<class F>
+inline void
+simd_map(float* r, const float* a, const float* b, const float* c, size_t n,
+         F f)
+{
+    using simd::vfloat8;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        f(vfloat8(a + i), vfloat8(b + i), vfloat8(c + i)).store(r + i);
+    if (i < n) {
+        vfloat8 va, vb, vc;
+        va.load(a + i, int(n - i));
+        vb.load(b + i, int(n - i));
+        vc.load(c + i, int(n - i));
+        f(va, vb, vc).store(r + i, int(n - i));
+    }
+}
+
+
+}  // namespace pvt
+
+OIIO_NAMESPACE_END
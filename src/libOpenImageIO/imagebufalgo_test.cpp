@@ -3,9 +3,12 @@
 // https://github.com/OpenImageIO/oiio
 
 
+#include <algorithm>
 #include <cstdio>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include <OpenImageIO/platform.h>
@@ -20,6 +23,7 @@
 
 #include <OpenImageIO/argparse.h>
 #include <OpenImageIO/benchmark.h>
+#include <OpenImageIO/color.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
@@ -493,6 +497,67 @@ test_mad()
 
 
 
+// Test that the whole-scanline fast paths of the pixel math operations
+// match their iterator loops, which we get by writing to an image whose
+// pixels aren't contiguous, and time both.
+void
+test_pixelmath_scanlines()
+{
+    std::cout << "test pixel math scanline fast paths\n";
+    Benchmarker bench;
+    bench.iterations(1).trials(3);
+    for (TypeDesc type : { TypeFloat, TypeHalf, TypeUInt8 }) {
+        ImageSpec spec(1024, 1024, 4, type);
+        ImageBuf A(spec), B(spec), C(spec);
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 2.0f);
+        ImageBufAlgo::noise(B, "uniform", 0.0f, 1.0f);
+        ImageBufAlgo::noise(C, "uniform", -1.0f, 1.0f);
+        // Some zeroes to divide by, and alphas of exactly 0 and 1
+        ImageBufAlgo::zero(B, ROI(0, 16, 0, 16));
+        ImageBufAlgo::fill(A, { 0.0f }, ROI(0, 8, 0, 8, 0, 1, 3, 4));
+        ImageBufAlgo::fill(A, { 1.0f }, ROI(8, 16, 0, 8, 0, 1, 3, 4));
+
+        using namespace ImageBufAlgo;
+        const float kvals[] = { 0.1f, 1.5f, 0.25f, 1.0f };
+        cspan<float> k(kvals);
+        std::pair<const char*, std::function<bool(ImageBuf&)>> ops[] = {
+            { "add", [&](ImageBuf& R) { return add(R, A, B); } },
+            { "add const", [&](ImageBuf& R) { return add(R, A, k); } },
+            { "sub", [&](ImageBuf& R) { return sub(R, A, B); } },
+            { "mul", [&](ImageBuf& R) { return mul(R, A, B); } },
+            { "mul const", [&](ImageBuf& R) { return mul(R, A, k); } },
+            { "div", [&](ImageBuf& R) { return div(R, A, B); } },
+            { "mad", [&](ImageBuf& R) { return mad(R, A, B, C); } },
+            { "mad const", [&](ImageBuf& R) { return mad(R, A, k, 0.25f); } },
+            { "clamp",
+              [&](ImageBuf& R) { return clamp(R, A, 0.2f, 1.7f, true); } },
+            { "pow", [&](ImageBuf& R) { return pow(R, A, 1.0f / 2.2f); } },
+            { "premult", [&](ImageBuf& R) { return premult(R, A); } },
+            { "unpremult", [&](ImageBuf& R) { return unpremult(R, A); } },
+        };
+
+        // Pixels padded with an extra channel's worth of space, which
+        // keeps the operations from using their fast paths
+        stride_t xstride = (spec.nchannels + 1) * type.size();
+        std::unique_ptr<char[]> strided(
+            new char[spec.image_pixels() * xstride]);
+        for (auto& op : ops) {
+            ImageBuf R(spec), S(spec, strided.get(), xstride);
+            OIIO_CHECK_ASSERT(op.second(R));
+            OIIO_CHECK_ASSERT(op.second(S));
+            float thresh = type == TypeUInt8 ? 1.01f / 255.0f : 1.0e-6f;
+            auto comp    = compare(R, S, thresh, thresh);
+            OIIO_CHECK_EQUAL(comp.nfail, 0);
+            std::string name = Strutil::fmt::format("  IBA::{} {}[4] ",
+                                                    op.first, type);
+            bench(name + "scanlines ", [&]() { op.second(R); });
+            bench(name + "iterators ", [&]() { op.second(S); });
+        }
+    }
+}
+
+
+
 // Test ImageBuf::over
 void
 test_over()
@@ -542,6 +607,238 @@ test_over()
 
 
 
+// Test ImageBufAlgo::Expr and eval
+void
+test_expr()
+{
+    std::cout << "test expr\n";
+    using namespace ImageBufAlgo;
+    const int WIDTH = 4, HEIGHT = 4, CHANNELS = 4;
+    ImageSpec spec(WIDTH, HEIGHT, CHANNELS, TypeDesc::FLOAT);
+    ImageBuf A(spec), B(spec), C(spec);
+    const float Aval[CHANNELS] = { 0.1f, 0.2f, 0.3f, 0.4f };
+    const float Bval[CHANNELS] = { 1, 2, 0, 4 };
+    const float Cval[CHANNELS] = { 0.01f, 0.02f, 0.03f, 0.04f };
+    ImageBufAlgo::fill(A, Aval);
+    ImageBufAlgo::fill(B, Bval);
+    ImageBufAlgo::fill(C, Cval);
+
+    // Fused results must match the individual operations
+    ImageBuf R = eval(Expr(A) * B + C);
+    OIIO_CHECK_EQUAL(R.spec().width, WIDTH);
+    OIIO_CHECK_ASSERT(compare(R, mad(A, B, C), 1e-6f, 1e-6f).maxerror < 1e-6f);
+    R = eval((Expr(A) / B - 0.5f).clamp(0.0f, 0.25f));
+    ImageBuf D = clamp(sub(div(A, B), 0.5f), 0.0f, 0.25f);
+    OIIO_CHECK_ASSERT(compare(R, D, 1e-6f, 1e-6f).maxerror < 1e-6f);
+    R = eval(Expr(A).pow({ 2.0f, 1.0f }).max(Expr(C) * 20.0f).abs());
+    D = ImageBufAlgo::abs(ImageBufAlgo::max(pow(A, { 2.0f, 1.0f }),
+                                            mul(C, 20.0f)));
+    OIIO_CHECK_ASSERT(compare(R, D, 1e-6f, 1e-6f).maxerror < 1e-6f);
+    R = eval(Expr(A).over(C));
+    OIIO_CHECK_ASSERT(compare(R, over(A, C), 1e-6f, 1e-6f).maxerror < 1e-6f);
+    auto proc = ColorConfig().createColorProcessor("linear", "sRGB");
+    R         = eval(Expr(A).colorconvert(proc.get()));
+    D         = colorconvert(A, proc.get(), true);
+    OIIO_CHECK_ASSERT(compare(R, D, 1e-6f, 1e-6f).maxerror < 1e-6f);
+
+    // over() needs an alpha channel
+    ImageBuf RGB(ImageSpec(WIDTH, HEIGHT, 3, TypeDesc::FLOAT));
+    ImageBufAlgo::zero(RGB);
+    R.clear();
+    OIIO_CHECK_ASSERT(!eval(R, Expr(RGB).over(RGB)));
+    OIIO_CHECK_ASSERT(R.has_error());
+    R.geterror();
+
+    // In place, into a half image, and over a sub-region
+    ImageBuf E;
+    E.copy(A);
+    OIIO_CHECK_ASSERT(eval(E, Expr(E) * E + C));
+    OIIO_CHECK_ASSERT(compare(E, mad(A, A, C), 1e-6f, 1e-6f).maxerror < 1e-6f);
+    ImageBuf H(ImageSpec(WIDTH, HEIGHT, CHANNELS, TypeHalf));
+    ImageBufAlgo::zero(H);
+    OIIO_CHECK_ASSERT(eval(H, -Expr(B).invert(), ROI(1, 3, 1, 3)));
+    OIIO_CHECK_EQUAL(H.getchannel(0, 0, 0, 1), 0.0f);
+    OIIO_CHECK_EQUAL(H.getchannel(2, 2, 0, 1), 1.0f);
+    OIIO_CHECK_EQUAL(H.getchannel(2, 2, 0, 3), 3.0f);
+
+    // Constants alone need a region
+    ImageBuf K;
+    OIIO_CHECK_ASSERT(!eval(K, Expr(1.0f)));
+    K = eval(Expr({ 1.0f, 2.0f }) + 1.0f, ROI(0, 2, 0, 2, 0, 1, 0, 3));
+    OIIO_CHECK_EQUAL(K.getchannel(1, 1, 0, 0), 2.0f);
+    OIIO_CHECK_EQUAL(K.getchannel(1, 1, 0, 2), 3.0f);
+
+    // Timing: the fused pass vs. separate passes
+    Benchmarker bench;
+    ImageSpec onekfloat(1000, 1000, 4, TypeFloat);
+    A.reset(onekfloat);
+    ImageBufAlgo::fill(A, Aval);
+    B.reset(onekfloat);
+    ImageBufAlgo::fill(B, Bval);
+    R.reset(onekfloat);
+    bench("  IBA mad+mul+clamp ", [&]() {
+        ImageBufAlgo::mad(R, A, A, B);
+        ImageBufAlgo::mul(R, R, 0.5f);
+        ImageBufAlgo::clamp(R, R, 0.0f, 1.0f);
+    });
+    bench("  IBA::eval fused ", [&]() {
+        eval(R, ((Expr(A) * A + B) * 0.5f).clamp(0.0f, 1.0f));
+    });
+}
+
+
+
+// Test that the two-pass separable resize matches the one-pass one
+void
+test_resize()
+{
+    std::cout << "test resize\n";
+    ImageSpec spec(256, 192, 4, TypeFloat);
+    spec.x = 16;  // data window inside the display window
+    spec.y = 8;
+    spec.width -= 40;
+    spec.height -= 24;
+    ImageBuf src(spec);
+    ImageBufAlgo::zero(src);
+    ImageBufAlgo::noise(src, "uniform", 0.0f, 1.0f);
+    ImageBuf src3 = ImageBufAlgo::channels(src, 3, {});
+    // The same pixels, in a wrapped buffer with padding between pixels
+    stride_t padstride = 5 * sizeof(float);
+    std::vector<float> padded(spec.image_pixels() * 5);
+    src.get_pixels(src.roi(), TypeFloat, padded.data(), padstride);
+    ImageBuf srcpad(spec, padded.data(), padstride);
+
+    struct Case {
+        const ImageBuf* src;
+        const char* filter;
+        ROI roi;
+    } cases[] = {
+        { &src, "lanczos3", ROI(0, 37, 0, 29) },
+        { &src, "blackman-harris", ROI(0, 512, 0, 400) },
+        { &src3, "triangle", ROI(0, 100, 0, 300) },
+        { &src3, "gaussian", ROI(0, 64, 0, 48) },
+        { &srcpad, "lanczos3", ROI(0, 37, 0, 29) },
+    };
+    for (auto& c : cases) {
+        ImageBuf onepass, twopass;
+        OIIO::attribute("resize:two_pass", 0);
+        OIIO_CHECK_ASSERT(
+            ImageBufAlgo::resize(onepass, *c.src, c.filter, 0.0f, c.roi));
+        OIIO::attribute("resize:two_pass", 1);
+        OIIO_CHECK_ASSERT(
+            ImageBufAlgo::resize(twopass, *c.src, c.filter, 0.0f, c.roi));
+        auto comp = ImageBufAlgo::compare(onepass, twopass, 1e-5f, 1e-5f);
+        OIIO_CHECK_EQUAL(comp.nfail, 0);
+        if (c.src == &srcpad) {
+            ImageBuf R = ImageBufAlgo::resize(src, c.filter, 0.0f, c.roi);
+            comp       = ImageBufAlgo::compare(R, twopass, 1e-5f, 1e-5f);
+            OIIO_CHECK_EQUAL(comp.nfail, 0);
+        }
+    }
+
+    // Timing: a large reduction, where the two-pass method helps most
+    Benchmarker bench;
+    bench.iterations(1).trials(3);
+    src.reset(ImageSpec(1024, 1024, 4, TypeFloat));
+    ImageBufAlgo::noise(src, "uniform", 0.0f, 1.0f);
+    ImageBuf R(ImageSpec(128, 128, 4, TypeFloat));
+    OIIO::attribute("resize:two_pass", 0);
+    bench("  IBA::resize 1k->128 lanczos3 one pass ",
+          [&]() { ImageBufAlgo::resize(R, src, "lanczos3"); });
+    OIIO::attribute("resize:two_pass", 1);
+    bench("  IBA::resize 1k->128 lanczos3 two pass ",
+          [&]() { ImageBufAlgo::resize(R, src, "lanczos3"); });
+}
+
+
+
+// Test that the separable and FFT methods of convolve match a direct sum
+void
+test_convolve()
+{
+    std::cout << "test convolve\n";
+    ImageSpec spec(160, 120, 3, TypeFloat);
+    spec.x = 10;  // data window inside the display window
+    spec.y = 6;
+    spec.width -= 24;
+    spec.height -= 16;
+    ImageBuf src(spec);
+    ImageBufAlgo::noise(src, "uniform", 0.0f, 1.0f);
+
+    // A gaussian is separable, so it takes two 1D passes; a disk is not,
+    // and one this big takes the FFT.
+    struct {
+        const char* name;
+        float width;
+    } kernels[] = { { "gaussian", 9.0f }, { "disk", 31.0f } };
+    for (auto& kern : kernels) {
+        ImageBuf K = ImageBufAlgo::make_kernel(kern.name, kern.width,
+                                               kern.width);
+        ImageBuf R     = ImageBufAlgo::convolve(src, K);
+        ROI kroi       = K.roi();
+        const int xs[] = { spec.x, spec.x + 1, spec.x + 57,
+                           spec.x + spec.width - 1 };
+        const int ys[] = { spec.y, spec.y + 40, spec.y + spec.height - 2 };
+        for (int y : ys) {
+            for (int x : xs) {
+                float ref[3] = { 0, 0, 0 }, ksum = 0.0f;
+                for (int j = kroi.ybegin; j < kroi.yend; ++j)
+                    for (int i = kroi.xbegin; i < kroi.xend; ++i) {
+                        float k = K.getchannel(i, j, 0, 0);
+                        float s[3];
+                        src.getpixel(x + i, y + j, 0, s, 3,
+                                     ImageBuf::WrapClamp);
+                        for (int c = 0; c < 3; ++c)
+                            ref[c] += k * s[c];
+                        ksum += k;
+                    }
+                for (int c = 0; c < 3; ++c)
+                    OIIO_CHECK_EQUAL_THRESH(R.getchannel(x, y, 0, c),
+                                            ref[c] / ksum, 1e-4f);
+            }
+        }
+    }
+}
+
+
+
+// Test the histogram median and the separable dilate and erode against
+// the windows they should be taking
+void
+test_median_morph()
+{
+    std::cout << "test median_filter, dilate, erode\n";
+    const int w = 7, h = 4;  // window size
+    for (TypeDesc type : { TypeUInt8, TypeUInt16, TypeFloat }) {
+        ImageSpec spec(48, 40, 2, type);
+        spec.x = 5;  // data window inside the display window
+        spec.y = 3;
+        ImageBuf src(spec);
+        ImageBufAlgo::noise(src, "uniform", 0.0f, 1.0f);
+        ImageBuf med = ImageBufAlgo::median_filter(src, w, h);
+        ImageBuf dil = ImageBufAlgo::dilate(src, w, h);
+        ImageBuf ero = ImageBufAlgo::erode(src, w, h);
+        for (ImageBuf::ConstIterator<float> p(med); !p.done(); ++p) {
+            for (int c = 0; c < spec.nchannels; ++c) {
+                std::vector<float> vals;
+                for (int y = p.y() - h / 2; y < p.y() - h / 2 + h; ++y)
+                    for (int x = p.x() - w / 2; x < p.x() - w / 2 + w; ++x)
+                        if (src.roi().contains(x, y))
+                            vals.push_back(src.getchannel(x, y, 0, c));
+                std::sort(vals.begin(), vals.end());
+                OIIO_CHECK_EQUAL(med.getchannel(p.x(), p.y(), 0, c),
+                                 vals[vals.size() / 2]);
+                OIIO_CHECK_EQUAL(dil.getchannel(p.x(), p.y(), 0, c),
+                                 vals.back());
+                OIIO_CHECK_EQUAL(ero.getchannel(p.x(), p.y(), 0, c),
+                                 vals.front());
+            }
+        }
+    }
+}
+
+
+
 // Tests ImageBufAlgo::compare
 void
 test_compare()
@@ -1017,6 +1314,11 @@ main(int argc, char** argv)
     test_mul();
     test_mad();
     test_over();
+    test_pixelmath_scanlines();
+    test_expr();
+    test_resize();
+    test_convolve();
+    test_median_morph();
     test_compare();
     test_isConstantColor();
     test_isConstantChannel();
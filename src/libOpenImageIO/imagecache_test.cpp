@@ -3,16 +3,63 @@
 // https://github.com/OpenImageIO/oiio
 
 
+#include <OpenImageIO/argparse.h>
+#include <OpenImageIO/benchmark.h>
+#include <OpenImageIO/filesystem.h>
 #include <OpenImageIO/imagebuf.h>
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagecache.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/sysutil.h>
 #include <OpenImageIO/unittest.h>
 
 #include <iostream>
 
+#ifndef _WIN32
+#    include <sys/mman.h>
+#    include <sys/wait.h>
+#    include <unistd.h>
+#endif
+
 using namespace OIIO;
 
+static int numthreads = Sysutil::hardware_concurrency();
+static int iterations = 200000;
+static int ntrials    = 1;
+static bool wedge     = false;
+static bool bench     = false;
+static std::string shmchild;
+static bool shmcrash = false;
+
+
+
+static void
+getargs(int argc, char* argv[])
+{
+    ArgParse ap;
+    // clang-format off
+    ap.intro("imagecache_test\n" OIIO_INTRO_STRING)
+      .usage("imagecache_test [options]");
+
+    ap.arg("--bench", &bench)
+      .help("Run the benchmarks (not just the unit tests)");
+    ap.arg("--threads %d", &numthreads)
+      .help(Strutil::sprintf("Number of threads for the contention benchmark (default: %d)", numthreads));
+    ap.arg("--iters %d", &iterations)
+      .help(Strutil::sprintf("Number of tile lookups (default: %d)", iterations));
+    ap.arg("--trials %d", &ntrials)
+      .help("Number of trials");
+    ap.arg("--wedge", &wedge)
+      .help("Do a wedge test of the contention benchmark");
+    ap.arg("--shmchild %s", &shmchild)
+      .hidden();  // Internal: be one of the shared tile store processes
+    ap.arg("--shmcrash", &shmcrash)
+      .hidden();  // Internal: ... that dies holding pins
+    // clang-format on
+
+    ap.parse(argc, (const char**)argv);
+}
+
 
 
 // Tests various ways for the subset of channels to be cached in a
@@ -133,10 +180,1014 @@ test_app_buffer()
 }
 
 
+// Test that prefetched tiles arrive in the cache with the right pixels,
+// and that lookups racing the prefetch threads still get correct answers.
+void
+test_prefetch()
+{
+    std::cout << "\nTesting prefetch\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+
+    ustring filename("prefetch.tif");
+    ImageSpec spec(256, 256, 3, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f },
+                       { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f });
+    A.write(filename);
+
+    // Just the top half of the image
+    OIIO_CHECK_ASSERT(imagecache->prefetch(filename, 0, 0,
+                                           ROI(0, 256, 0, 128, 0, 1)));
+    int prefetched = 0;
+    imagecache->getattribute("stat:tiles_prefetched", prefetched);
+    OIIO_CHECK_EQUAL(prefetched, 8);
+
+    // Asking again for what's already there or on its way does nothing
+    OIIO_CHECK_ASSERT(imagecache->prefetch(filename, 0, 0,
+                                           ROI(0, 128, 0, 128, 0, 1)));
+    imagecache->getattribute("stat:tiles_prefetched", prefetched);
+    OIIO_CHECK_EQUAL(prefetched, 8);
+
+    // Whether or not the prefetches have finished, we should read the
+    // right pixels.
+    std::vector<float> pixels(256 * 256 * 3);
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 256, 0, 256,
+                                             0, 1, TypeDesc::FLOAT,
+                                             pixels.data()));
+    for (int y = 0; y < 256; y += 37) {
+        for (int x = 0; x < 256; x += 41) {
+            float pixel[3];
+            A.getpixel(x, y, pixel);
+            for (int c = 0; c < 3; ++c)
+                OIIO_CHECK_EQUAL(pixels[(y * 256 + x) * 3 + c], pixel[c]);
+        }
+    }
+
+    // Nonexistent MIP level
+    OIIO_CHECK_ASSERT(!imagecache->prefetch(filename, 0, 4));
+    imagecache->geterror();
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// preload() should give the same handles get_image_handle() would, with
+// the headers already read, and a handle that's not good() for a file that
+// doesn't exist.
+void
+test_preload()
+{
+    std::cout << "\nTesting preload\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+
+    std::vector<ustring> filenames;
+    for (int i = 0; i < 16; ++i) {
+        filenames.emplace_back(Strutil::fmt::format("preload{}.tif", i));
+        ImageBuf A(ImageSpec(16 + i, 16, 1, TypeDesc::UINT8));
+        ImageBufAlgo::fill(A, { i / 16.0f });
+        A.write(filenames.back());
+    }
+    filenames.emplace_back("preload_nonexistent.tif");
+
+    auto handles = imagecache->preload(filenames);
+    OIIO_CHECK_EQUAL(handles.size(), filenames.size());
+    for (size_t i = 0; i < 16; ++i) {
+        OIIO_CHECK_ASSERT(imagecache->good(handles[i]));
+        OIIO_CHECK_EQUAL(handles[i],
+                         imagecache->get_image_handle(filenames[i]));
+        const ImageSpec* spec = imagecache->imagespec(handles[i], nullptr);
+        OIIO_CHECK_ASSERT(spec && spec->width == 16 + int(i));
+    }
+    OIIO_CHECK_ASSERT(!imagecache->good(handles.back()));
+    imagecache->geterror();
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// A get_pixels of a region spanning many tiles (and hanging off the
+// edges of the image) is done in parallel pieces, which should give the
+// same answer as doing it all on one thread.
+void
+test_get_pixels_parallel()
+{
+    std::cout << "\nTesting parallel get_pixels\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+
+    ustring filename("parallel.tif");
+    ImageSpec spec(500, 300, 3, TypeDesc::UINT16);
+    spec.tile_width  = 64;
+    spec.tile_height = 32;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f },
+                       { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f });
+    A.write(filename);
+
+    ROI roi(-7, 505, 13, 310, 0, 1, 0, 3);
+    std::vector<float> serial(roi.npixels() * 3), parallel(serial.size());
+    imagecache->attribute("get_pixels_threads", 1);
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, roi.xbegin,
+                                             roi.xend, roi.ybegin, roi.yend,
+                                             0, 1, TypeFloat, serial.data()));
+    imagecache->invalidate_all(true);
+    imagecache->attribute("get_pixels_threads", 0);
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, roi.xbegin,
+                                             roi.xend, roi.ybegin, roi.yend,
+                                             0, 1, TypeFloat,
+                                             parallel.data()));
+    OIIO_CHECK_ASSERT(serial == parallel);
+    float pixel[3];
+    A.getpixel(100, 100, pixel);
+    size_t offset = ((100 - roi.ybegin) * roi.width() + (100 - roi.xbegin))
+                    * 3;
+    OIIO_CHECK_EQUAL(parallel[offset], pixel[0]);
+    OIIO_CHECK_EQUAL(parallel[0], 0.0f);  // outside the data window
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// Read one file from many threads at once with several ImageInputs allowed
+// per file, and make sure the pixels are right and the spares stay within
+// the limit (and are closed along with the file).
+void
+test_max_inputs_per_file()
+{
+    std::cout << "\nTesting max_inputs_per_file\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("max_inputs_per_file", 3);
+
+    ustring filename("spareinputs.tif");
+    ImageSpec spec(512, 512, 3, TypeDesc::UINT8);
+    spec.tile_width  = 32;
+    spec.tile_height = 32;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f },
+                       { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f });
+    A.write(filename);
+
+    std::vector<float> pixels(spec.image_pixels() * 3);
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 512, 0, 512,
+                                             0, 1, TypeFloat, pixels.data()));
+    std::vector<float> expected(pixels.size());
+    A.get_pixels(A.roi(), TypeFloat, expected.data());
+    OIIO_CHECK_ASSERT(pixels == expected);
+
+    int open_files = -1;
+    imagecache->getattribute("stat:open_files_current", open_files);
+    OIIO_CHECK_ASSERT(open_files >= 1 && open_files <= 3);
+    imagecache->close_all();
+    imagecache->getattribute("stat:open_files_current", open_files);
+    OIIO_CHECK_EQUAL(open_files, 0);
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// Check the per-MIP-level access stats and their JSON summary.
+void
+test_access_stats()
+{
+    std::cout << "\nTesting access_stats\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("access_stats", 1);
+
+    ustring filename("accessstats.tif");
+    ImageSpec spec(128, 128, 1, TypeDesc::UINT8);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    A.write(filename);
+
+    std::vector<float> pixels(spec.image_pixels());
+    for (int i = 0; i < 2; ++i)
+        OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 128, 0,
+                                                 128, 0, 1, TypeFloat,
+                                                 pixels.data()));
+    long long lookups[2], misses[2], bytesread[2];
+    TypeDesc type(TypeDesc::INT64, 2);
+    OIIO_CHECK_ASSERT(imagecache->get_image_info(filename, 0, 0,
+                                                 ustring("stat:mip_lookups"),
+                                                 type, lookups));
+    OIIO_CHECK_ASSERT(imagecache->get_image_info(filename, 0, 0,
+                                                 ustring("stat:mip_misses"),
+                                                 type, misses));
+    OIIO_CHECK_ASSERT(imagecache->get_image_info(filename, 0, 0,
+                                                 ustring("stat:mip_bytesread"),
+                                                 type, bytesread));
+    OIIO_CHECK_ASSERT(lookups[0] >= 8);
+    OIIO_CHECK_EQUAL(misses[0], 4);
+    OIIO_CHECK_EQUAL(bytesread[0], 128 * 128);
+    OIIO_CHECK_EQUAL(lookups[1], 0);  // There is only one level
+
+    long long hist[4];
+    OIIO_CHECK_ASSERT(imagecache->getattribute("stat:mip_histogram",
+                                               TypeDesc(TypeDesc::INT64, 4),
+                                               hist));
+    OIIO_CHECK_EQUAL(hist[0], lookups[0]);
+    OIIO_CHECK_EQUAL(hist[1], 0);
+
+    std::string json = imagecache->access_stats_json();
+    OIIO_CHECK_ASSERT(Strutil::contains(json, "\"accessstats.tif\""));
+    OIIO_CHECK_ASSERT(Strutil::contains(json, "\"misses\": 4,"));
+    OIIO_CHECK_ASSERT(Strutil::contains(json, "\"mip_histogram\""));
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// Thrash a small cache by reading an image bigger than it twice, and make
+// sure the re-reads raise the MIP bias for degradable files.
+void
+test_degrade()
+{
+    std::cout << "\nTesting degrade under memory pressure\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("max_memory_MB", 1.0f);
+    imagecache->attribute("degrade_churn", 0.5f);
+    imagecache->attribute("degrade_max_bias", 2);
+    OIIO_CHECK_ASSERT(!imagecache->attribute("degrade_files", "[unclosed"));
+    OIIO_CHECK_ASSERT(imagecache->has_error());
+    imagecache->geterror();
+    OIIO_CHECK_ASSERT(imagecache->attribute("degrade_files", "thrash"));
+
+    ustring filename("thrash.tif");
+    ImageSpec spec(4096, 4096, 1, TypeDesc::UINT8);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    A.write(filename);
+
+    int bias = -1;
+    imagecache->getattribute("stat:mip_bias", bias);
+    OIIO_CHECK_EQUAL(bias, 0);
+    std::vector<unsigned char> pixels(spec.image_pixels());
+    for (int i = 0; i < 2; ++i)
+        OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 4096, 0,
+                                                 4096, 0, 1, TypeUInt8,
+                                                 pixels.data()));
+    imagecache->getattribute("stat:mip_bias", bias);
+    OIIO_CHECK_EQUAL(bias, 2);
+
+    // Turning it off drops the bias right away
+    imagecache->attribute("degrade_churn", 0.0f);
+    imagecache->getattribute("stat:mip_bias", bias);
+    OIIO_CHECK_EQUAL(bias, 0);
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// Make a texture with per-tile stats, half of it constant, and check that
+// the stats are reported and that the constant tiles are filled in (with
+// the right values) without reading them.
+void
+test_tile_stats()
+{
+    std::cout << "\nTesting maketx tile stats\n";
+    ImageSpec spec(256, 256, 2, TypeDesc::UINT8);
+    ImageBuf src(spec);
+    ImageBufAlgo::fill(src, { 0.25f, 0.0f }, ROI(0, 128, 0, 256));
+    ImageBufAlgo::fill(src, { 0.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f },
+                       { 1.0f, 0.0f }, ROI(128, 256, 0, 256));
+    ImageSpec config;
+    config.tile_width  = 64;
+    config.tile_height = 64;
+    config.attribute("maketx:tile_stats", 1);
+    ustring filename("tilestats.tx");
+    OIIO_CHECK_ASSERT(ImageBufAlgo::make_texture(ImageBufAlgo::MakeTxTexture,
+                                                 src, filename, config));
+
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    float min[2], max[2], avg[2];
+    OIIO_CHECK_ASSERT(imagecache->get_tile_stats(filename, 0, 0, 10, 10, 0, 0,
+                                                 2, min, max, avg));
+    OIIO_CHECK_EQUAL(min[0], 0.25f);
+    OIIO_CHECK_EQUAL(max[0], 0.25f);
+    OIIO_CHECK_EQUAL(max[1], 0.0f);
+    OIIO_CHECK_ASSERT(imagecache->get_tile_stats(filename, 0, 0, 200, 10, 0,
+                                                 0, -1, min, max, nullptr));
+    OIIO_CHECK_ASSERT(min[0] < max[0]);
+    OIIO_CHECK_ASSERT(imagecache->get_tile_stats(filename, 0, 1, 10, 10, 0, 0,
+                                                 2, min, max, avg));
+    OIIO_CHECK_ASSERT(!imagecache->get_tile_stats(filename, 0, 0, 300, 10, 0,
+                                                  0, 2, min, max, avg));
+
+    // The cache keeps its own compact copy of the summaries, counted as
+    // part of its memory, not the text of them in the spec.
+    ImageSpec cachedspec;
+    OIIO_CHECK_ASSERT(imagecache->get_imagespec(filename, cachedspec, 0, 0,
+                                                true /*native*/));
+    OIIO_CHECK_ASSERT(!cachedspec.find_attribute("oiio:TileStats"));
+    OIIO_CHECK_EQUAL(cachedspec.get_string_attribute("ImageDescription")
+                         .find("TileStats"),
+                     std::string::npos);
+    long long memused = 0;
+    imagecache->getattribute("stat:cache_memory_used", TypeInt64, &memused);
+    OIIO_CHECK_GT(memused, 0);
+
+    // Filling the constant tiles must give what reading them would
+    std::vector<float> expected(spec.image_pixels() * 2);
+    auto in = ImageInput::open(filename.string());
+    OIIO_CHECK_ASSERT(in && in->read_image(0, 0, 0, 2, TypeFloat,
+                                           expected.data()));
+    std::vector<float> pixels(expected.size());
+    imagecache->reset_stats();
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 256, 0, 256,
+                                             0, 1, TypeFloat, pixels.data()));
+    OIIO_CHECK_ASSERT(pixels == expected);
+    long long filled = 0;
+    imagecache->getattribute("stat:tiles_from_stats", TypeInt64, &filled);
+    OIIO_CHECK_EQUAL(filled, 8);  // the left half of the top level
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+void
+test_deduplicate_tiles()
+{
+    std::cout << "\nTesting tile deduplication\n";
+    // Two copies of a file whose left tiles are both one constant color
+    ImageSpec spec(128, 128, 1, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.5f }, ROI(0, 64, 0, 128));
+    ImageBufAlgo::fill(A, { 0.0f }, { 1.0f }, { 2.0f }, { 3.0f },
+                       ROI(64, 128, 0, 128));
+    ustring file1("dedup1.tif"), file2("dedup2.tif");
+    A.write(file1);
+    A.write(file2);
+
+    std::vector<float> pixels(spec.image_pixels());
+    long long memused[2], dups = 0, saved = 0;
+    for (int dedup : { 0, 1 }) {
+        ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+        imagecache->attribute("deduplicate_tiles", dedup);
+        for (ustring f : { file1, file2 }) {
+            OIIO_CHECK_ASSERT(imagecache->get_pixels(f, 0, 0, 0, 128, 0, 128,
+                                                     0, 1, TypeFloat,
+                                                     pixels.data()));
+            OIIO_CHECK_EQUAL(pixels[0], 0.5f);
+            OIIO_CHECK_EQUAL(pixels[64 * 128 + 63], 0.5f);
+            OIIO_CHECK_EQUAL(pixels[64], 0.0f);
+            OIIO_CHECK_EQUAL(pixels[128 * 128 - 1], 3.0f);
+        }
+        imagecache->getattribute("stat:cache_memory_used", TypeInt64,
+                                 &memused[dedup]);
+        imagecache->getattribute("stat:tiles_deduplicated", TypeInt64,
+                                 &dups);
+        imagecache->getattribute("stat:dedup_memory_saved", TypeInt64,
+                                 &saved);
+        ImageCache::destroy(imagecache);
+    }
+    // One left tile of the first file, and all of the second, were shared,
+    // so only the three distinct tiles of the eight are charged.
+    OIIO_CHECK_EQUAL(dups, 5);
+    OIIO_CHECK_EQUAL(memused[1], memused[0] - saved);
+    OIIO_CHECK_EQUAL(memused[1] * 8, memused[0] * 3);
+}
+
+
+
+// Cycle through the pixels around a corner shared by four tiles, which
+// defeats the two-tile microcache, and check that the set-associative one
+// catches them (and still returns the right pixels).
+void
+test_microcache()
+{
+    std::cout << "\nTesting set-associative microcache\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+
+    ustring filename("microcache.tif");
+    ImageSpec spec(128, 128, 1, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f }, { 1.0f }, { 2.0f }, { 3.0f });
+    A.write(filename);
+
+    for (int ntiles : { 0, 8 }) {
+        imagecache->attribute("microcache_tiles", ntiles);
+        imagecache->invalidate_all(true);
+        imagecache->reset_stats();
+        for (int i = 0; i < 100; ++i) {
+            for (int t = 0; t < 4; ++t) {
+                int x = (t & 1) ? 64 : 63, y = (t & 2) ? 64 : 63;
+                float pixel = -1.0f, expected = -2.0f;
+                OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, x,
+                                                         x + 1, y, y + 1, 0, 1,
+                                                         TypeFloat, &pixel));
+                A.getpixel(x, y, &expected, 1);
+                OIIO_CHECK_EQUAL(pixel, expected);
+            }
+        }
+        long long calls = 0, misses = 0, nwayhits = 0;
+        imagecache->getattribute("stat:find_tile_calls", TypeInt64, &calls);
+        imagecache->getattribute("stat:find_tile_microcache_misses",
+                                 TypeInt64, &misses);
+        imagecache->getattribute("stat:find_tile_microcache_nway_hits",
+                                 TypeInt64, &nwayhits);
+        std::cout << "  microcache_tiles " << ntiles << ": " << calls
+                  << " lookups, " << misses << " microcache misses, "
+                  << nwayhits << " set hits\n";
+        if (ntiles) {
+            OIIO_CHECK_EQUAL(nwayhits, 400 - 4);
+        } else {
+            OIIO_CHECK_EQUAL(nwayhits, 0);
+            OIIO_CHECK_EQUAL(misses, 400);
+        }
+    }
+
+    // It can't be made big, since the tiles in it can't be evicted
+    int ntiles = 0;
+    imagecache->attribute("microcache_tiles", 1000);
+    imagecache->getattribute("microcache_tiles", ntiles);
+    OIIO_CHECK_EQUAL(ntiles, 16);
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// Record a trace of a few tile requests and check that it was written
+// the way testtex --replay expects: magic, the file name, then one block
+// of 40 byte records.
+void
+test_tile_trace()
+{
+    std::cout << "\nTesting tile trace\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+
+    ustring filename("trace.tif");
+    ImageSpec spec(128, 128, 1, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.5f });
+    A.write(filename);
+
+    std::string tracename = "tiles.trace";
+    imagecache->attribute("tile_trace", tracename);
+    for (int t = 0; t < 4; ++t) {
+        int x = (t & 1) * 64, y = (t & 2) * 32;
+        float pixel = 0.0f;
+        OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, x, x + 1, y,
+                                                 y + 1, 0, 1, TypeFloat,
+                                                 &pixel));
+    }
+    imagecache->attribute("tile_trace", "");
+
+    OIIO_CHECK_EQUAL(Filesystem::file_size(tracename),
+                     8 + 8 + filename.size() + 8 + 4 * 40);
+    std::string header(16 + filename.size(), '\0');
+    Filesystem::read_bytes(tracename, &header[0], header.size());
+    OIIO_CHECK_EQUAL(header.substr(0, 8), "OIIOTRC1");
+    OIIO_CHECK_EQUAL(header.substr(16), filename.string());
+    Filesystem::remove(tracename);
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// Read an image bigger than the cache twice with the compressed tier
+// enabled: the second pass should find its tiles in the tier, and they
+// should decompress to the right pixels.
+void
+test_compressed_tier()
+{
+    std::cout << "\nTesting compressed tile tier\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("max_memory_MB", 10.0f);
+    imagecache->attribute("max_compressed_memory_MB", 100.0f);
+    imagecache->attribute("autotile", 0);
+
+    // 16 MB, with smooth ramps that compress well
+    ustring filename("tier.tif");
+    ImageSpec spec(1024, 1024, 4, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 0.0f, 0.0f, 1.0f },
+                       { 1.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f },
+                       { 1.0f, 1.0f, 1.0f, 1.0f });
+    A.write(filename);
+
+    std::vector<float> pixels(1024 * 1024 * 4);
+    for (int pass = 0; pass < 2; ++pass) {
+        OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 1024, 0,
+                                                 1024, 0, 1, TypeDesc::FLOAT,
+                                                 pixels.data()));
+        for (int y = 0; y < 1024; y += 37) {
+            for (int x = 0; x < 1024; x += 41) {
+                float pixel[4];
+                A.getpixel(x, y, pixel);
+                for (int c = 0; c < 4; ++c)
+                    OIIO_CHECK_EQUAL(pixels[(y * 1024 + x) * 4 + c], pixel[c]);
+            }
+        }
+    }
+    long long demotions = 0, hits = 0;
+    imagecache->getattribute("stat:tier_demotions", TypeInt64, &demotions);
+    imagecache->getattribute("stat:tier_hits", TypeInt64, &hits);
+    OIIO_CHECK_GT(demotions, 0);
+    OIIO_CHECK_GT(hits, 0);
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// Two independent caches sharing a disk tile cache directory: the second
+// should get every tile from the first's disk cache.
+void
+test_disk_tile_cache()
+{
+    std::cout << "\nTesting disk tile cache\n";
+    std::string dir = "disktilecache";
+    Filesystem::remove_all(dir);
+
+    ustring filename("disktiles.tif");
+    ImageSpec spec(256, 256, 3, TypeDesc::UINT16);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f },
+                       { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f });
+    A.write(filename);
+
+    std::vector<uint16_t> pixels(256 * 256 * 3), ref(256 * 256 * 3);
+    OIIO_CHECK_ASSERT(A.get_pixels(A.roi(), TypeDesc::UINT16, ref.data()));
+    for (int pass = 0; pass < 2; ++pass) {
+        ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+        imagecache->attribute("disk_tile_cache", dir);
+        OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 256, 0,
+                                                 256, 0, 1, TypeDesc::UINT16,
+                                                 pixels.data()));
+        OIIO_CHECK_ASSERT(pixels == ref);
+        long long hits = 0, misses = 0, writes = 0;
+        imagecache->getattribute("stat:disk_cache_hits", TypeInt64, &hits);
+        imagecache->getattribute("stat:disk_cache_misses", TypeInt64, &misses);
+        imagecache->getattribute("stat:disk_cache_writes", TypeInt64, &writes);
+        OIIO_CHECK_EQUAL(hits, pass ? 16 : 0);
+        OIIO_CHECK_EQUAL(misses, pass ? 0 : 16);
+        OIIO_CHECK_EQUAL(writes, pass ? 0 : 16);
+        ImageCache::destroy(imagecache);
+    }
+
+    // A cache that reads the pixels differently mustn't use those tiles
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("disk_tile_cache", dir);
+    imagecache->attribute("unassociatedalpha", 1);
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 256, 0, 256,
+                                             0, 1, TypeDesc::UINT16,
+                                             pixels.data()));
+    long long hits = -1;
+    imagecache->getattribute("stat:disk_cache_hits", TypeInt64, &hits);
+    OIIO_CHECK_EQUAL(hits, 0);
+    ImageCache::destroy(imagecache);
+    Filesystem::remove_all(dir);
+}
+
+
+
+// One of the processes of test_shared_tile_cache: read the whole image,
+// several times over, through a cache too small to hold it, checking the
+// pixels as we go.
+static void
+shared_tile_cache_child(ustring filename, string_view shmname)
+{
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("max_memory_MB", 10.0f);
+    imagecache->attribute("shared_tile_cache_MB", 64.0f);
+    imagecache->attribute("shared_tile_cache", shmname);
+    OIIO_CHECK_ASSERT(!imagecache->has_error());
+
+    ImageBuf ref(filename);
+    std::vector<float> pixels(1024 * 1024 * 4);
+    for (int pass = 0; pass < 3; ++pass) {
+        OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 1024, 0,
+                                                 1024, 0, 1, TypeDesc::FLOAT,
+                                                 pixels.data()));
+        for (int y = pass; y < 1024; y += 29) {
+            for (int x = pass; x < 1024; x += 31) {
+                float pixel[4];
+                ref.getpixel(x, y, pixel);
+                for (int c = 0; c < 4; ++c)
+                    OIIO_CHECK_EQUAL(pixels[(y * 1024 + x) * 4 + c], pixel[c]);
+            }
+        }
+    }
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// The process of test_shared_tile_crash: pin the top two rows of tiles
+// in the shared tile store, then die without detaching from it.
+static void
+shared_tile_cache_crasher(ustring filename, string_view shmname)
+{
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("shared_tile_cache", shmname);
+    std::vector<float> pixels(1024 * 128 * 4);
+    bool ok = imagecache->get_pixels(filename, 0, 0, 0, 1024, 0, 128, 0, 1,
+                                     TypeDesc::FLOAT, pixels.data());
+    _exit(ok && !imagecache->has_error() ? 0 : 1);
+}
+
+
+
+// Several processes reading the same image at once through one shared
+// tile store.
+void
+test_shared_tile_cache()
+{
+#ifndef _WIN32
+    std::cout << "\nTesting shared tile store across processes\n";
+    std::string shmname = Strutil::fmt::format("/oiio_imagecache_test_{}",
+                                               getpid());
+    shm_unlink(shmname.c_str());
+
+    // 16 MB, more than each process's cache can hold
+    ustring filename("sharedtiles.tif");
+    ImageSpec spec(1024, 1024, 4, TypeDesc::FLOAT);
+    spec.tile_width  = 64;
+    spec.tile_height = 64;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 0.0f, 0.0f, 1.0f },
+                       { 1.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f },
+                       { 1.0f, 1.0f, 1.0f, 1.0f });
+    A.write(filename);
+
+    const int nprocs = 4;
+    std::string program = Sysutil::this_program_path();
+    std::vector<pid_t> children;
+    for (int i = 0; i < nprocs; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            execl(program.c_str(), program.c_str(), "--shmchild",
+                  shmname.c_str(), (char*)nullptr);
+            _exit(127);
+        }
+        OIIO_CHECK_ASSERT(pid > 0);
+        if (pid > 0)
+            children.push_back(pid);
+    }
+    for (pid_t pid : children) {
+        int status = -1;
+        OIIO_CHECK_EQUAL(waitpid(pid, &status, 0), pid);
+        OIIO_CHECK_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    // The tiles the children left behind should still be there for us
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("shared_tile_cache", shmname);
+    std::vector<float> pixels(64 * 64 * 4);
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 64, 0, 64, 0,
+                                             1, TypeDesc::FLOAT,
+                                             pixels.data()));
+    long long hits = 0, used = 0;
+    imagecache->getattribute("stat:shared_hits", TypeInt64, &hits);
+    imagecache->getattribute("stat:shared_memory_used", TypeInt64, &used);
+    OIIO_CHECK_EQUAL(hits, 1);
+    OIIO_CHECK_GT(used, 0);
+    ImageCache::destroy(imagecache);
+    shm_unlink(shmname.c_str());
+#endif
+}
+
+
+
+// A process that dies with tiles pinned in a shared tile store mustn't
+// keep them pinned forever.  The store (one page, 51 slots of the size of
+// our tiles) can't hold both the 32 tiles it pins and the 48 more we then
+// read, unless its pins are released.
+void
+test_shared_tile_crash()
+{
+#ifndef _WIN32
+    std::cout << "\nTesting shared tile store after a process dies\n";
+    std::string shmname = Strutil::fmt::format("/oiio_imagecache_crash_{}",
+                                               getpid());
+    shm_unlink(shmname.c_str());
+    ustring filename("sharedtiles.tif");  // From test_shared_tile_cache
+
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("shared_tile_cache_MB", 8.0f);
+    imagecache->attribute("shared_tile_cache", shmname);
+
+    std::string program = Sysutil::this_program_path();
+    pid_t pid           = fork();
+    if (pid == 0) {
+        execl(program.c_str(), program.c_str(), "--shmchild", shmname.c_str(),
+              "--shmcrash", (char*)nullptr);
+        _exit(127);
+    }
+    int status = -1;
+    OIIO_CHECK_ASSERT(pid > 0 && waitpid(pid, &status, 0) == pid);
+    OIIO_CHECK_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // Read the next three rows of tiles, and keep them, then see that
+    // another cache finds them all in the store.
+    std::vector<float> pixels(1024 * 192 * 4);
+    OIIO_CHECK_ASSERT(imagecache->get_pixels(filename, 0, 0, 0, 1024, 128,
+                                             320, 0, 1, TypeDesc::FLOAT,
+                                             pixels.data()));
+    ImageCache* other = ImageCache::create(false /*not shared*/);
+    other->attribute("shared_tile_cache", shmname);
+    OIIO_CHECK_ASSERT(other->get_pixels(filename, 0, 0, 0, 1024, 128, 320, 0,
+                                        1, TypeDesc::FLOAT, pixels.data()));
+    long long hits = 0;
+    other->getattribute("stat:shared_hits", TypeInt64, &hits);
+    OIIO_CHECK_EQUAL(hits, 48);
+    ImageCache::destroy(other);
+    ImageCache::destroy(imagecache);
+    shm_unlink(shmname.c_str());
+#endif
+}
+
+
+
+// A 1024x1024 RGBA float image in 64x64 tiles, not backed by any file,
+// whose tiles each have a value of their own (so that no two of them are
+// alike) and take DelayUS microseconds apiece to read.
+template<int DelayUS> class SlowTileInput : public ImageInput {
+public:
+    const char* format_name(void) const override { return "slowtile"; }
+    bool open(const std::string& /*name*/, ImageSpec& newspec) override
+    {
+        m_spec             = ImageSpec(1024, 1024, 4, TypeDesc::FLOAT);
+        m_spec.tile_width  = 64;
+        m_spec.tile_height = 64;
+        newspec            = m_spec;
+        return true;
+    }
+    bool close() override { return true; }
+    bool read_native_scanline(int /*subimage*/, int /*miplevel*/, int /*y*/,
+                              int /*z*/, void* /*data*/) override
+    {
+        return false;
+    }
+    bool read_native_tile(int /*subimage*/, int /*miplevel*/, int x, int y,
+                          int /*z*/, void* data) override
+    {
+        if (DelayUS)
+            Sysutil::usleep(DelayUS);
+        float* p = (float*)data;
+        std::fill(p, p + m_spec.tile_pixels() * m_spec.nchannels,
+                  float(y * m_spec.width + x));
+        return true;
+    }
+
+    static ImageInput* create() { return new SlowTileInput; }
+};
+
+
+
+// Under the "cost" eviction policy, tiles of a file that is much slower
+// to read than the rest should outlive a stream of cheap tiles that is
+// enough to evict the tiles of equal cost that were read before it.
+void
+test_cost_eviction()
+{
+    std::cout << "\nTesting cost-weighted eviction\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("max_memory_MB", 10.0f);  // 160 of our tiles
+    imagecache->attribute("eviction_policy", "cost");
+    ustring cheap("cheaptiles"), costly("costlytiles");
+    imagecache->add_file(cheap, SlowTileInput<0>::create);
+    imagecache->add_file(costly, SlowTileInput<5000>::create);
+    ImageCache::Perthread* thread_info = imagecache->get_perthread_info();
+    ImageCache::ImageHandle* cheaphandle
+        = imagecache->get_image_handle(cheap, thread_info);
+    ImageCache::ImageHandle* costlyhandle
+        = imagecache->get_image_handle(costly, thread_info);
+    auto touch = [&](ImageCache::ImageHandle* handle, int tile) {
+        ImageCache::Tile* t = imagecache->get_tile(handle, thread_info, 0, 0,
+                                                   (tile % 16) * 64,
+                                                   (tile / 16) * 64, 0);
+        OIIO_CHECK_ASSERT(t);
+        if (t)
+            imagecache->release_tile(t);
+    };
+
+    // Enough cheap tiles to establish the average read time, then a couple
+    // of costly ones, then the rest of the cheap image, 256 tiles in all.
+    for (int i = 0; i < 64; ++i)
+        touch(cheaphandle, i);
+    for (int i = 0; i < 2; ++i)
+        touch(costlyhandle, i);
+    for (int i = 64; i < 256; ++i)
+        touch(cheaphandle, i);
+
+    // The costly tiles are still there, while early cheap ones are gone.
+    long long cheapreads = 0, costlyreads = 0;
+    for (int i = 0; i < 2; ++i)
+        touch(costlyhandle, i);
+    imagecache->get_image_info(costly, 0, 0, ustring("stat:tilesread"),
+                               TypeInt64, &costlyreads);
+    OIIO_CHECK_EQUAL(costlyreads, 2);
+    for (int i = 0; i < 32; ++i)
+        touch(cheaphandle, i);
+    imagecache->get_image_info(cheap, 0, 0, ustring("stat:tilesread"),
+                               TypeInt64, &cheapreads);
+    OIIO_CHECK_GT(cheapreads, 256);
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// With tile deduplication on, going over the memory limit should evict
+// only enough tiles to get back under it, not empty the cache.
+void
+test_deduplicate_eviction()
+{
+    std::cout << "\nTesting eviction of deduplicated tiles\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("max_memory_MB", 10.0f);  // 160 of our tiles
+    imagecache->attribute("deduplicate_tiles", 1);
+    ustring name("dedupevict");
+    imagecache->add_file(name, SlowTileInput<0>::create);
+    ImageCache::Perthread* thread_info = imagecache->get_perthread_info();
+    ImageCache::ImageHandle* handle
+        = imagecache->get_image_handle(name, thread_info);
+    int mintiles = 256;
+    for (int i = 0; i < 256; ++i) {
+        ImageCache::Tile* t = imagecache->get_tile(handle, thread_info, 0, 0,
+                                                   (i % 16) * 64,
+                                                   (i / 16) * 64, 0);
+        OIIO_CHECK_ASSERT(t);
+        if (t)
+            imagecache->release_tile(t);
+        int tiles = 0;
+        imagecache->getattribute("stat:tiles_current", tiles);
+        if (i >= 192)
+            mintiles = std::min(mintiles, tiles);
+    }
+    OIIO_CHECK_GT(mintiles, 80);
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// Time many threads hammering one shared cache with tile lookups at random
+// locations.  The image is bigger than the cache, so tiles are constantly
+// being evicted and re-read while the lookups are happening, and the
+// per-thread microcaches almost never hit, so nearly every lookup goes to
+// the main tile cache.
+void
+bench_tile_contention()
+{
+    std::cout << "\nTiming tile cache contention...\n";
+    ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+    imagecache->attribute("max_memory_MB", 10.0f);
+
+    // A 16 MB image in 16 KB tiles
+    ustring filename("contention.tif");
+    const int res = 2048, tilesize = 64, ntiles = res / tilesize;
+    ImageSpec spec(res, res, 4, TypeDesc::UINT8);
+    spec.tile_width  = tilesize;
+    spec.tile_height = tilesize;
+    ImageBuf A(spec);
+    ImageBufAlgo::fill(A, { 0.0f, 0.0f, 1.0f, 1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f },
+                       { 0.0f, 1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f });
+    A.write(filename);
+
+    atomic_int seeds(1);
+    atomic_int failures(0);
+    auto lookups = [&](int iterations) {
+        ImageCache::Perthread* thread_info = imagecache->get_perthread_info();
+        ImageCache::ImageHandle* handle
+            = imagecache->get_image_handle(filename, thread_info);
+        uint32_t seed = uint32_t(seeds++) * 2654435761u;
+        for (int i = 0; i < iterations; ++i) {
+            seed  = seed * 1664525u + 1013904223u;
+            int x = int((seed >> 8) % ntiles) * tilesize;
+            int y = int((seed >> 20) % ntiles) * tilesize;
+            ImageCache::Tile* tile = imagecache->get_tile(handle, thread_info,
+                                                          0, 0, x, y, 0);
+            if (tile)
+                imagecache->release_tile(tile);
+            else
+                ++failures;
+        }
+    };
+    if (wedge)
+        timed_thread_wedge(lookups, numthreads, iterations, ntrials);
+    else
+        timed_thread_wedge(lookups, numthreads, iterations, ntrials,
+                           numthreads);
+    OIIO_CHECK_EQUAL(failures, 0);
+
+    // The lookups kept evicting tiles, so we should not have strayed far
+    // over the limit.
+    long long memused = 0;
+    imagecache->getattribute("stat:cache_memory_used", TypeDesc::INT64,
+                             &memused);
+    OIIO_CHECK_LE(memused, 2 * 10LL * 1024 * 1024);
+
+    ImageCache::destroy(imagecache);
+}
+
+
+
+// Replay the same tile access trace against each eviction policy, and
+// report the hit rate and I/O time of each.  The trace mixes two images,
+// one uncompressed and cheap to re-read, one compressed and expensive,
+// with a combined working set well beyond the cache size.
+void
+bench_eviction_policies()
+{
+    std::cout << "\nReplaying a tile trace under each eviction policy...\n";
+    const int res = 1024, tilesize = 64, ntiles = res / tilesize;
+    const char* filenames[] = { "evict_cheap.tif", "evict_costly.tif" };
+    const char* compression[] = { "none", "zip" };
+    for (int f = 0; f < 2; ++f) {
+        ImageSpec spec(res, res, 4, TypeDesc::FLOAT);
+        spec.tile_width  = tilesize;
+        spec.tile_height = tilesize;
+        spec.attribute("compression", compression[f]);
+        ImageBuf A(spec);
+        ImageBufAlgo::noise(A, "uniform", 0.0f, 1.0f);
+        A.write(filenames[f]);
+    }
+
+    // 3/4 of the lookups are to the cheap image.  Within each image, a
+    // small hot region gets half the lookups and the rest are scattered.
+    struct Access {
+        int file, x, y;
+    };
+    std::vector<Access> trace(iterations);
+    uint32_t seed = 12345;
+    auto rand     = [&]() {
+        seed = seed * 1664525u + 1013904223u;
+        return seed >> 8;
+    };
+    for (auto& a : trace) {
+        a.file   = (rand() % 4 == 0) ? 1 : 0;
+        int span = (rand() % 2) ? ntiles : ntiles / 4;
+        a.x      = int(rand() % span) * tilesize;
+        a.y      = int(rand() % span) * tilesize;
+    }
+
+    for (const char* policy : { "clock", "cost" }) {
+        ImageCache* imagecache = ImageCache::create(false /*not shared*/);
+        imagecache->attribute("max_memory_MB", 10.0f);
+        imagecache->attribute("eviction_policy", policy);
+        ImageCache::Perthread* thread_info = imagecache->get_perthread_info();
+        ImageCache::ImageHandle* handles[2] = {
+            imagecache->get_image_handle(ustring(filenames[0]), thread_info),
+            imagecache->get_image_handle(ustring(filenames[1]), thread_info)
+        };
+        Timer timer;
+        for (const Access& a : trace) {
+            ImageCache::Tile* tile = imagecache->get_tile(handles[a.file],
+                                                          thread_info, 0, 0,
+                                                          a.x, a.y, 0);
+            OIIO_CHECK_ASSERT(tile);
+            imagecache->release_tile(tile);
+        }
+        double walltime = timer();
+        long long calls = 0;
+        int misses      = 0;
+        float iotime    = 0.0f;
+        imagecache->getattribute("stat:find_tile_calls", TypeInt64, &calls);
+        imagecache->getattribute("stat:find_tile_cache_misses", misses);
+        imagecache->getattribute("stat:fileio_time", iotime);
+        Strutil::print("  {:6} : hit rate {:5.1f}%, {} tiles read, "
+                       "I/O time {:.3f}s, total {:.3f}s\n",
+                       policy, 100.0 * (calls - misses) / std::max(calls, 1LL),
+                       misses, iotime, walltime);
+        ImageCache::destroy(imagecache);
+    }
+}
+
+
 
 int
-main(int /*argc*/, char* /*argv*/[])
+main(int argc, char* argv[])
 {
+    getargs(argc, argv);
+    if (shmchild.size()) {
+        if (shmcrash)
+            shared_tile_cache_crasher(ustring("sharedtiles.tif"), shmchild);
+        shared_tile_cache_child(ustring("sharedtiles.tif"), shmchild);
+        return unit_test_failures;
+    }
+
     test_get_pixels_cachechannels(0, 10);
     test_get_pixels_cachechannels(0, 4);
     test_get_pixels_cachechannels(0, 4, 0, 6);
@@ -145,6 +1196,27 @@ main(int /*argc*/, char* /*argv*/[])
     test_get_pixels_cachechannels(6, 9, 6, 9);
 
     test_app_buffer();
+    test_prefetch();
+    test_preload();
+    test_get_pixels_parallel();
+    test_max_inputs_per_file();
+    test_access_stats();
+    test_degrade();
+    test_tile_stats();
+    test_deduplicate_tiles();
+    test_microcache();
+    test_tile_trace();
+    test_compressed_tier();
+    test_disk_tile_cache();
+    test_shared_tile_cache();
+    test_shared_tile_crash();
+    test_cost_eviction();
+    test_deduplicate_eviction();
+
+    if (bench) {
+        bench_tile_contention();
+        bench_eviction_policies();
+    }
 
     return unit_test_failures;
 }
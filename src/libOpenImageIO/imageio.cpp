@@ -45,6 +45,7 @@ int tiff_half(0);
 int tiff_multithread(1);
 int limit_channels(1024);
 int limit_imagesize_MB(32 * 1024);
+int resize_two_pass(1);
 ustring font_searchpath;
 ustring plugin_searchpath(OIIO_DEFAULT_PLUGIN_SEARCHPATH);
 std::string format_list;         // comma-separated list of all formats
@@ -344,6 +345,10 @@ attribute(string_view name, TypeDesc type, const void* val)
         limit_imagesize_MB = *(const int*)val;
         return true;
     }
+    if (name == "resize:two_pass" && type == TypeInt) {
+        resize_two_pass = *(const int*)val;
+        return true;
+    }
     if (name == "debug" && type == TypeInt) {
         oiio_print_debug = *(const int*)val;
         return true;
@@ -443,6 +448,10 @@ getattribute(string_view name, TypeDesc type, void* val)
         *(int*)val = tiff_multithread;
         return true;
     }
+    if (name == "resize:two_pass" && type == TypeInt) {
+        *(int*)val = resize_two_pass;
+        return true;
+    }
     if (name == "debug" && type == TypeInt) {
         *(int*)val = oiio_print_debug;
         return true;
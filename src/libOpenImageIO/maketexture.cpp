@@ -22,6 +22,7 @@
 #include <OpenImageIO/imagebufalgo.h>
 #include <OpenImageIO/imagebufalgo_util.h>
 #include <OpenImageIO/imageio.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/strutil.h>
 #include <OpenImageIO/sysutil.h>
 #include <OpenImageIO/thread.h>
@@ -328,6 +329,54 @@ resize_block(ImageBuf& dst, const ImageBuf& src, ROI roi, bool envlatlmode,
 
 
 
+// Box filter the volume src into dst (no larger than src in any
+// dimension), for the voxels of dst in roi. Each dst voxel is the average
+// of the block of src voxels it covers.
+template<class SRCTYPE>
+static bool
+downsample_volume_block_(ImageBuf& dst, const ImageBuf& src, ROI roi)
+{
+    const ImageSpec& srcspec(src.spec());
+    const ImageSpec& dstspec(dst.spec());
+    int nchannels = dstspec.nchannels;
+    float* sum    = OIIO_ALLOCA(float, nchannels);
+    OIIO_DASSERT(dstspec.format == TypeFloat);
+    for (ImageBuf::Iterator<float> d(dst, roi); !d.done(); ++d) {
+        int x = d.x() - dstspec.x, y = d.y() - dstspec.y;
+        int z = d.z() - dstspec.z;
+        ROI sroi(srcspec.x + x * srcspec.width / dstspec.width,
+                 srcspec.x + (x + 1) * srcspec.width / dstspec.width,
+                 srcspec.y + y * srcspec.height / dstspec.height,
+                 srcspec.y + (y + 1) * srcspec.height / dstspec.height,
+                 srcspec.z + z * srcspec.depth / dstspec.depth,
+                 srcspec.z + (z + 1) * srcspec.depth / dstspec.depth);
+        for (int c = 0; c < nchannels; ++c)
+            sum[c] = 0.0f;
+        int n = 0;
+        for (ImageBuf::ConstIterator<SRCTYPE> s(src, sroi); !s.done(); ++s) {
+            for (int c = 0; c < nchannels; ++c)
+                sum[c] += s[c];
+            ++n;
+        }
+        float scale = n ? 1.0f / n : 0.0f;
+        for (int c = 0; c < nchannels; ++c)
+            d[c] = sum[c] * scale;
+    }
+    return true;
+}
+
+
+
+static bool
+downsample_volume_block(ImageBuf& dst, const ImageBuf& src, ROI roi)
+{
+    bool ok;
+    OIIO_DISPATCH_TYPES(ok, "downsample_volume_block", downsample_volume_block_,
+                        src.spec().format, dst, src, roi);
+    return ok;
+}
+
+
 // Copy src into dst, but only for the range [x0,x1) x [y0,y1).
 static void
 check_nan_block(const ImageBuf& src, ROI roi, int& found_nonfinite)
@@ -619,6 +668,80 @@ maketx_merge_spec(ImageSpec& dstspec, const ImageSpec& srcspec)
 
 
 
+// Compute the min, max, and average of each channel of each tile of img
+// (tiled as spec describes), and store them in spec as "oiio:TileStats"
+// (or as a hint in the ImageDescription, for formats that don't support
+// arbitrary metadata), so that the ImageCache can tell which tiles are a
+// constant color without reading them. The value is the level resolution
+// followed by a base64 blob, as in "WxHxD:blob". The blob has a bit for
+// each channel of each tile (in turn, lowest bit first) that is set if the
+// channel is constant over the tile, followed by that constant value, or
+// else the min, max, and average, for each of them, as little-endian
+// floats. Constant channels are what make this worthwhile, so they cost
+// only one value each.
+static void
+add_tile_stats(ImageSpec& spec, const ImageBuf& img, ImageOutput* out)
+{
+    if (!spec.tile_width || !spec.tile_height)
+        return;
+    int tw = spec.tile_width, th = spec.tile_height;
+    int td = std::max(spec.tile_depth, 1);
+    int nc = spec.nchannels;
+    int nx = (spec.width + tw - 1) / tw;
+    int ny = (spec.height + th - 1) / th;
+    int nz = (std::max(spec.depth, 1) + td - 1) / td;
+    std::vector<float> stats(size_t(nx) * ny * nz * nc * 3);
+    parallel_for(0, int64_t(nx) * ny * nz, [&](int64_t t) {
+        int x = spec.x + int(t % nx) * tw;
+        int y = spec.y + int((t / nx) % ny) * th;
+        int z = spec.z + int(t / (int64_t(nx) * ny)) * td;
+        ROI roi(x, std::min(x + tw, spec.x + spec.width), y,
+                std::min(y + th, spec.y + spec.height), z,
+                std::min(z + td, spec.z + std::max(spec.depth, 1)), 0, nc);
+        ImageBufAlgo::PixelStats ps;
+        ImageBufAlgo::computePixelStats(ps, img, roi, 1);
+        float* s = &stats[size_t(t) * nc * 3];
+        for (int c = 0; c < nc; ++c) {
+            s[3 * c + 0] = ps.min[c];
+            s[3 * c + 1] = ps.max[c];
+            s[3 * c + 2] = ps.avg[c];
+        }
+    });
+
+    size_t n = stats.size() / 3;
+    std::string blob((n + 7) / 8, '\0');
+    std::vector<float> values;
+    values.reserve(stats.size());
+    for (size_t i = 0; i < n; ++i) {
+        const float* s = &stats[3 * i];
+        if (s[0] == s[1]) {
+            blob[i / 8] |= char(1 << (i % 8));
+            values.push_back(s[0]);
+        } else {
+            values.insert(values.end(), s, s + 3);
+        }
+    }
+    if (bigendian())
+        swap_endian(values.data(), int(values.size()));
+    blob.append((const char*)values.data(), values.size() * sizeof(float));
+    std::string str = Strutil::fmt::format("{}x{}x{}:", spec.width,
+                                           spec.height,
+                                           std::max(spec.depth, 1))
+                      + Strutil::base64_encode(blob);
+    if (out->supports("arbitrary_metadata")) {
+        spec.attribute("oiio:TileStats", str);
+    } else {
+        std::string desc = spec.get_string_attribute("ImageDescription");
+        Strutil::excise_string_after_head(desc, "oiio:TileStats=");
+        if (desc.size())
+            desc += " ";
+        desc += "oiio:TileStats=" + str;
+        spec.attribute("ImageDescription", desc);
+    }
+}
+
+
+
 static bool
 write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
              const ImageSpec& outspec_template, std::string outputfilename,
@@ -650,6 +773,7 @@ write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
     }
 
     bool verbose = configspec.get_int_attribute("maketx:verbose") != 0;
+    bool tile_stats = configspec.get_int_attribute("maketx:tile_stats") != 0;
     bool src_samples_border = false;
 
     // Some special constraints for OpenEXR
@@ -696,6 +820,14 @@ write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
         filtername  = "lanczos3";
     }
 
+    if (clamp_half) {
+        std::shared_ptr<ImageBuf> tmp(new ImageBuf);
+        ImageBufAlgo::clamp(*tmp, *img, -HALF_MAX, HALF_MAX, true);
+        std::swap(tmp, img);
+    }
+    if (tile_stats)
+        add_tile_stats(outspec, *img, out);
+
     Timer writetimer;
     if (!out->open(outputfilename.c_str(), outspec)) {
         errorfmt("Could not open \"{}\" : {}", outputfilename, out->geterror());
@@ -708,12 +840,6 @@ write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
         outstream << "  Filter \"" << filtername << "\"\n";
         outstream << "  Top level is " << formatres(outspec) << std::endl;
     }
-
-    if (clamp_half) {
-        std::shared_ptr<ImageBuf> tmp(new ImageBuf);
-        ImageBufAlgo::clamp(*tmp, *img, -HALF_MAX, HALF_MAX, true);
-        std::swap(tmp, img);
-    }
     if (!img->write(out)) {
         // ImageBuf::write transfers any errors from the ImageOutput to
         // the ImageBuf.
@@ -735,12 +861,35 @@ write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
         bool allow_shift
             = configspec.get_int_attribute("maketx:allow_pixel_shift") != 0;
 
+        // Volumes are MIP-mapped in all three dimensions.
+        bool volume = (img->spec().depth > 1);
         std::shared_ptr<ImageBuf> small(new ImageBuf);
-        while (outspec.width > 1 || outspec.height > 1) {
+        while (outspec.width > 1 || outspec.height > 1
+               || (volume && outspec.depth > 1)) {
             Timer miptimer;
             ImageSpec smallspec;
 
-            if (mipimages.size()) {
+            if (volume) {
+                // Box filter a factor of two smaller in each dimension.
+                // The 2D filters don't apply to volumes.
+                smallspec        = outspec;
+                smallspec.width  = std::max(1, img->spec().width / 2);
+                smallspec.height = std::max(1, img->spec().height / 2);
+                smallspec.depth  = std::max(1, img->spec().depth / 2);
+                smallspec.full_width  = smallspec.width;
+                smallspec.full_height = smallspec.height;
+                smallspec.full_depth  = smallspec.depth;
+                smallspec.x = smallspec.y = smallspec.z = 0;
+                smallspec.full_x = smallspec.full_y = smallspec.full_z = 0;
+                smallspec.set_format(TypeDesc::FLOAT);
+                small->reset(smallspec);
+                if (verbose && filtername != "box")
+                    outstream << "  Downsampling volume with box filter\n";
+                ImageBufAlgo::parallel_image(get_roi(small->spec()),
+                                             std::bind(downsample_volume_block,
+                                                       std::ref(*small),
+                                                       std::cref(*img), _1));
+            } else if (mipimages.size()) {
                 // Special case -- the user specified a custom MIP level
                 small->reset(mipimages[0]);
                 small->read(0, 0, true, TypeFloat);
@@ -855,6 +1004,8 @@ write_mipmap(ImageBufAlgo::MakeTextureMode mode, std::shared_ptr<ImageBuf>& img,
             outspec.set_format(outputdatatype);
             if (envlatlmode && src_samples_border)
                 fix_latl_edges(*small);
+            if (tile_stats)
+                add_tile_stats(outspec, *small, out);
 
             Timer writetimer;
             // If the format explicitly supports MIP-maps, use that,
@@ -1470,7 +1621,9 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
     // Make the output tiled, regardless of input
     dstspec.tile_width  = configspec.tile_width ? configspec.tile_width : 64;
     dstspec.tile_height = configspec.tile_height ? configspec.tile_height : 64;
-    dstspec.tile_depth  = configspec.tile_depth ? configspec.tile_depth : 1;
+    dstspec.tile_depth  = (configspec.tile_depth && dstspec.depth > 1)
+                              ? configspec.tile_depth
+                              : 1;
 
     // Try to force zip (still can be overriden by configspec
     dstspec.attribute("compression", "zip");
@@ -1513,6 +1666,8 @@ make_texture_impl(ImageBufAlgo::MakeTextureMode mode, const ImageBuf* input,
         configspec.attribute("wrapmodes", "periodic,clamp");
         if (prman_metadata)
             dstspec.attribute("PixarTextureFormat", "LatLong Environment");
+    } else if (dstspec.depth > 1) {
+        dstspec.attribute("textureformat", "Volume Texture");
     } else {
         dstspec.attribute("textureformat", "Plain Texture");
         if (prman_metadata)
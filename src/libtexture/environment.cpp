@@ -281,6 +281,99 @@ vector_to_latlong(const Imath::V3f& R, bool y_is_up, float& s, float& t)
 
 
 
+/// Convert direction vectors to latlong st coordinates, for all lanes at
+/// once, using the SIMD fast_atan2 and fast_acos. These agree with the
+/// single-point version to within 2e-5 in s and t.
+inline void
+vector_to_latlong(const Tex::FloatWide* R, bool y_is_up, Tex::FloatWide& s,
+                  Tex::FloatWide& t)
+{
+    using Tex::FloatWide;
+    // The axis toward the poles, and the two around the equator
+    const FloatWide& up(y_is_up ? R[1] : R[2]);
+    FloatWide u = y_is_up ? R[2] : R[0];
+    FloatWide v = y_is_up ? -R[0] : R[1];
+    FloatWide len = sqrt(u * u + v * v + up * up);
+    FloatWide cosine = select(len > FloatWide::Zero(), up / len,
+                              FloatWide::Zero());
+    s = fast_atan2(v, u) * float(0.5 * M_1_PI) + 0.5f;
+    t = fast_acos(cosine) * float(M_1_PI);
+    // learned from experience, beware NaNs
+    s = select(s == s, s, FloatWide::Zero());
+    t = select(t == t, t, FloatWide::Zero());
+#ifndef NDEBUG
+    for (int i = 0; i < Tex::BatchWidth; ++i) {
+        float ss, tt;
+        vector_to_latlong(Imath::V3f(R[0][i], R[1][i], R[2][i]), y_is_up, ss,
+                          tt);
+        OIIO_DASSERT(!(std::abs(s[i] - ss) > 1.0e-4f)
+                     && !(std::abs(t[i] - tt) > 1.0e-4f));
+    }
+#endif
+}
+
+
+
+/// Determine the MIP-map level(s) we need for a latlong lookup with the
+/// given filter width (in radians): we will blend
+///  data(miplevel[0]) * levelweight[0] + data(miplevel[1]) * levelweight[1]
+inline void
+latlong_miplevels(const ImageCacheFile::SubimageInfo& subinfo, float filtwidth,
+                  TextureOpt::MipMode mipmode, int* miplevel,
+                  float* levelweight)
+{
+    int min_mip_level = subinfo.min_mip_level;
+    miplevel[0]       = -1;
+    miplevel[1]       = -1;
+    float levelblend  = 0;
+
+    int nmiplevels = (int)subinfo.levels.size();
+    for (int m = min_mip_level; m < nmiplevels; ++m) {
+        // Compute the filter size in raster space at this MIP level.
+        // Filters are in radians, and the vertical resolution of a
+        // latlong map is PI radians.  So to compute the raster size of
+        // our filter width...
+        float filtwidth_ras = subinfo.spec(m).full_height * filtwidth * M_1_PI;
+        // Once the filter width is smaller than one texel at this level,
+        // we've gone too far, so we know that we want to interpolate the
+        // previous level and the current level.  Note that filtwidth_ras
+        // is expected to be >= 0.5, or would have stopped one level ago.
+        if (filtwidth_ras <= 1) {
+            miplevel[0] = m - 1;
+            miplevel[1] = m;
+            levelblend  = OIIO::clamp(2.0f * filtwidth_ras - 1.0f, 0.0f, 1.0f);
+            break;
+        }
+    }
+    if (miplevel[1] < 0) {
+        // We'd like to blur even more, but make due with the coarsest
+        // MIP level.
+        miplevel[0] = nmiplevels - 1;
+        miplevel[1] = miplevel[0];
+        levelblend  = 0;
+    } else if (miplevel[0] < min_mip_level) {
+        // We wish we had even more resolution than the finest MIP level,
+        // but tough for us.
+        miplevel[0] = min_mip_level;
+        miplevel[1] = min_mip_level;
+        levelblend  = 0;
+    }
+    if (mipmode == TextureOpt::MipModeOneLevel) {
+        // Force use of just one mipmap level
+        miplevel[1] = miplevel[0];
+        levelblend  = 0;
+    } else if (mipmode == TextureOpt::MipModeNoMIP) {
+        // Just sample from lowest level
+        miplevel[0] = min_mip_level;
+        miplevel[1] = min_mip_level;
+        levelblend  = 0;
+    }
+    levelweight[0] = 1.0f - levelblend;
+    levelweight[1] = levelblend;
+}
+
+
+
 bool
 TextureSystemImpl::environment(ustring filename, TextureOpt& options,
                                V3fParam R, V3fParam dRdx, V3fParam dRdy,
@@ -462,7 +555,6 @@ TextureSystemImpl::environment(TextureHandle* texture_handle_,
 
     ImageCacheFile::SubimageInfo& subinfo(
         texturefile->subimageinfo(options.subimage));
-    int min_mip_level = subinfo.min_mip_level;
 
     // FIXME -- assuming latlong
     bool ok   = true;
@@ -472,56 +564,10 @@ TextureSystemImpl::environment(TextureHandle* texture_handle_,
         float s, t;
         vector_to_latlong(Rsamp, texturefile->m_y_up, s, t);
 
-        // Determine the MIP-map level(s) we need: we will blend
-        //  data(miplevel[0]) * (1-levelblend) + data(miplevel[1]) * levelblend
-        int miplevel[2]  = { -1, -1 };
-        float levelblend = 0;
-
-        int nmiplevels = (int)subinfo.levels.size();
-        for (int m = min_mip_level; m < nmiplevels; ++m) {
-            // Compute the filter size in raster space at this MIP level.
-            // Filters are in radians, and the vertical resolution of a
-            // latlong map is PI radians.  So to compute the raster size of
-            // our filter width...
-            float filtwidth_ras = subinfo.spec(m).full_height * filtwidth
-                                  * M_1_PI;
-            // Once the filter width is smaller than one texel at this level,
-            // we've gone too far, so we know that we want to interpolate the
-            // previous level and the current level.  Note that filtwidth_ras
-            // is expected to be >= 0.5, or would have stopped one level ago.
-            if (filtwidth_ras <= 1) {
-                miplevel[0] = m - 1;
-                miplevel[1] = m;
-                levelblend  = OIIO::clamp(2.0f * filtwidth_ras - 1.0f, 0.0f,
-                                         1.0f);
-                break;
-            }
-        }
-        if (miplevel[1] < 0) {
-            // We'd like to blur even more, but make due with the coarsest
-            // MIP level.
-            miplevel[0] = nmiplevels - 1;
-            miplevel[1] = miplevel[0];
-            levelblend  = 0;
-        } else if (miplevel[0] < min_mip_level) {
-            // We wish we had even more resolution than the finest MIP level,
-            // but tough for us.
-            miplevel[0] = min_mip_level;
-            miplevel[1] = min_mip_level;
-            levelblend  = 0;
-        }
-        if (options.mipmode == TextureOpt::MipModeOneLevel) {
-            // Force use of just one mipmap level
-            miplevel[1] = miplevel[0];
-            levelblend  = 0;
-        } else if (mipmode == TextureOpt::MipModeNoMIP) {
-            // Just sample from lowest level
-            miplevel[0] = min_mip_level;
-            miplevel[1] = min_mip_level;
-            levelblend  = 0;
-        }
-
-        float levelweight[2] = { 1.0f - levelblend, levelblend };
+        // Determine the MIP-map level(s) we need and their weights.
+        int miplevel[2];
+        float levelweight[2];
+        latlong_miplevels(subinfo, filtwidth, mipmode, miplevel, levelweight);
 
         int npointson = 0;
         for (int level = 0; level < 2; ++level) {
@@ -576,20 +622,51 @@ TextureSystemImpl::environment(TextureHandle* texture_handle_,
 
 
 bool
-TextureSystemImpl::environment(TextureHandle* texture_handle,
-                               Perthread* thread_info, TextureOptBatch& options,
-                               Tex::RunMask mask, const float* R,
-                               const float* dRdx, const float* dRdy,
-                               int nchannels, float* result, float* dresultds,
-                               float* dresultdt)
+TextureSystemImpl::environment(TextureHandle* texture_handle_,
+                               Perthread* thread_info_,
+                               TextureOptBatch& options, Tex::RunMask mask,
+                               const float* R_, const float* dRdx_,
+                               const float* dRdy_, int nchannels, float* result,
+                               float* dresultds, float* dresultdt)
 {
-    // (FIXME) CHEAT! Texture points individually
+    using namespace Tex;
+
+    // Handle >4 channel lookups by recursion.
+    if (nchannels > 4) {
+        int save_firstchannel = options.firstchannel;
+        bool ok               = true;
+        while (nchannels && ok) {
+            int n = std::min(nchannels, 4);
+            ok    = environment(texture_handle_, thread_info_, options, mask,
+                             R_, dRdx_, dRdy_, n, result, dresultds,
+                             dresultdt);
+            result += n * BatchWidth;
+            if (dresultds) {
+                dresultds += n * BatchWidth;
+                dresultdt += n * BatchWidth;
+            }
+            options.firstchannel += n;
+            nchannels -= n;
+        }
+        options.firstchannel = save_firstchannel;  // restore what we changed
+        return ok;
+    }
+
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
+        (PerThreadInfo*)thread_info_);
+    TextureFile* texturefile = verify_texturefile((TextureFile*)texture_handle_,
+                                                  thread_info);
+    int nlanes = 0;
+    for (RunMask m = mask; m; m >>= 1)
+        nlanes += int(m & 1);
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    ++stats.environment_batches;
+    stats.environment_queries += nlanes;
+
     TextureOpt opt;
     opt.firstchannel        = options.firstchannel;
     opt.subimage            = options.subimage;
     opt.subimagename        = options.subimagename;
-    opt.swrap               = (TextureOpt::Wrap)options.swrap;
-    opt.twrap               = (TextureOpt::Wrap)options.twrap;
     opt.mipmode             = (TextureOpt::MipMode)options.mipmode;
     opt.interpmode          = (TextureOpt::InterpMode)options.interpmode;
     opt.anisotropic         = options.anisotropic;
@@ -597,38 +674,255 @@ TextureSystemImpl::environment(TextureHandle* texture_handle,
     opt.fill                = options.fill;
     opt.missingcolor        = options.missingcolor;
 
-    bool ok          = true;
-    Tex::RunMask bit = 1;
-    for (int i = 0; i < Tex::BatchWidth; ++i, bit <<= 1) {
-        float r[4], drds[4], drdt[4];  // temp result
-        if (mask & bit) {
-            opt.sblur  = options.sblur[i];
-            opt.tblur  = options.tblur[i];
-            opt.swidth = options.swidth[i];
-            opt.twidth = options.twidth[i];
-            opt.rnd    = options.rnd[i];
-            Imath::V3f R_(R[i], R[i + Tex::BatchWidth],
-                          R[i + 2 * Tex::BatchWidth]);
-            Imath::V3f dRdx_(dRdx[i], dRdx[i + Tex::BatchWidth],
-                             dRdx[i + 2 * Tex::BatchWidth]);
-            Imath::V3f dRdy_(dRdy[i], dRdy[i + Tex::BatchWidth],
-                             dRdy[i + 2 * Tex::BatchWidth]);
+    // Store the same value (with zero derivatives) in all active lanes.
+    auto broadcast_result = [&](const float* r) {
+        for (int c = 0; c < nchannels; ++c) {
+            FloatWide(r[c]).store_mask(int(mask), result + c * BatchWidth);
             if (dresultds) {
-                ok &= environment(texture_handle, thread_info, opt, R_, dRdx_,
-                                  dRdy_, nchannels, r, drds, drdt);
-                for (int c = 0; c < nchannels; ++c) {
-                    result[c * Tex::BatchWidth + i]    = r[c];
-                    dresultds[c * Tex::BatchWidth + i] = drds[c];
-                    dresultdt[c * Tex::BatchWidth + i] = drdt[c];
+                FloatWide::Zero().store_mask(int(mask),
+                                             dresultds + c * BatchWidth);
+                FloatWide::Zero().store_mask(int(mask),
+                                             dresultdt + c * BatchWidth);
+            }
+        }
+    };
+
+    if (!texturefile || texturefile->broken()) {
+        float r[4];
+        bool ok = missing_texture(opt, nchannels, r, nullptr, nullptr);
+        broadcast_result(r);
+        return ok;
+    }
+
+    if (!opt.subimagename.empty()) {
+        // If subimage was specified by name, figure out its index.
+        int s = m_imagecache->subimage_from_name(texturefile,
+                                                 opt.subimagename);
+        if (s < 0) {
+            error("Unknown subimage \"{}\" in texture \"{}\"",
+                  opt.subimagename, texturefile->filename());
+            float r[4];
+            bool ok = missing_texture(opt, nchannels, r, nullptr, nullptr);
+            broadcast_result(r);
+            return ok;
+        }
+        opt.subimage = s;
+        opt.subimagename.clear();
+    }
+    if (opt.subimage < 0 || opt.subimage >= texturefile->subimages()) {
+        error("Unknown subimage \"{}\" in texture \"{}\"", opt.subimagename,
+              texturefile->filename());
+        float r[4];
+        bool ok = missing_texture(opt, nchannels, r, nullptr, nullptr);
+        broadcast_result(r);
+        return ok;
+    }
+    const ImageSpec& spec(texturefile->spec(opt.subimage, 0));
+
+    // Environment maps dictate particular wrap modes
+    opt.swrap = texturefile->m_sample_border
+                    ? TextureOpt::WrapPeriodicSharedBorder
+                    : TextureOpt::WrapPeriodic;
+    opt.twrap = TextureOpt::WrapClamp;
+
+    opt.envlayout      = LayoutLatLong;
+    int actualchannels = OIIO::clamp(spec.nchannels - opt.firstchannel, 0,
+                                     nchannels);
+
+    // Calculate unit-length vectors in the direction of R, R+dRdx, R+dRdy
+    // for all lanes at once. These define the ellipses we're filtering
+    // over.
+    FloatWide R[3], Rx[3], Ry[3];
+    for (int a = 0; a < 3; ++a) {
+        R[a].load(R_ + a * BatchWidth);
+        Rx[a] = R[a] + FloatWide(dRdx_ + a * BatchWidth);
+        Ry[a] = R[a] + FloatWide(dRdy_ + a * BatchWidth);
+    }
+    auto normalize = [](FloatWide* v) {
+        FloatWide len = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        for (int a = 0; a < 3; ++a)
+            v[a] = safe_div(v[a], len);
+    };
+    normalize(R);   // center
+    normalize(Rx);  // x axis of the ellipse
+    normalize(Ry);  // y axis of the ellipse
+    FloatWide Rdotx = R[0] * Rx[0] + R[1] * Rx[1] + R[2] * Rx[2];
+    FloatWide Rdoty = R[0] * Ry[0] + R[1] * Ry[1] + R[2] * Ry[2];
+
+    // Account for width and blur, and figure out major versus minor.
+    FloatWide xfilt, yfilt;
+    alignas(BatchAlign) float xfilt_noblur[BatchWidth];
+    alignas(BatchAlign) float yfilt_noblur[BatchWidth];
+    for (int i = 0; i < BatchWidth; ++i) {
+        // angles formed by the ellipse axes.
+        xfilt_noblur[i] = std::max(safe_acos(Rdotx[i]), 1e-8f);
+        yfilt_noblur[i] = std::max(safe_acos(Rdoty[i]), 1e-8f);
+    }
+    xfilt = FloatWide(xfilt_noblur) * FloatWide(options.swidth)
+            + FloatWide(options.sblur);
+    yfilt = FloatWide(yfilt_noblur) * FloatWide(options.twidth)
+            + FloatWide(options.tblur);
+    auto x_is_majoraxis = xfilt >= yfilt;
+    FloatWide Rmajor[3];
+    for (int a = 0; a < 3; ++a)
+        Rmajor[a] = select(x_is_majoraxis, Rx[a], Ry[a]);
+    FloatWide majorlength = select(x_is_majoraxis, xfilt, yfilt);
+    FloatWide minorlength = select(x_is_majoraxis, yfilt, xfilt);
+
+    TextureOpt::MipMode mipmode = opt.mipmode;
+    bool aniso                  = (mipmode == TextureOpt::MipModeDefault
+                  || mipmode == TextureOpt::MipModeAniso
+                  || mipmode == TextureOpt::MipModeStochasticAniso);
+
+    // Sample counts and filter widths, per lane.
+    alignas(BatchAlign) float filtwidth[BatchWidth];
+    alignas(BatchAlign) float invsamples[BatchWidth];
+    int nsamples[BatchWidth];
+    int naturalres[BatchWidth];
+    int maxsamples = 1;
+    for (int i = 0; i < BatchWidth; ++i) {
+        nsamples[i]   = 0;
+        invsamples[i] = 1.0f;
+        filtwidth[i]  = 0.0f;
+        if (!(mask & (RunMask(1) << i)))
+            continue;
+        // N.B. naturalres formulated for latlong
+        naturalres[i] = int((float)M_PI
+                            / std::min(xfilt_noblur[i], yfilt_noblur[i]));
+        float major = majorlength[i], minor = minorlength[i];
+        if (aniso) {
+            float trueaspect;
+            float aspect = anisotropic_aspect(major, minor, opt, trueaspect);
+            filtwidth[i] = minor;
+            if (trueaspect > stats.max_aniso)
+                stats.max_aniso = trueaspect;
+            nsamples[i]   = std::max(1, (int)ceilf(aspect - 0.25f));
+            invsamples[i] = 1.0f / nsamples[i];
+        } else {
+            filtwidth[i] = opt.conservative_filter ? major : minor;
+            nsamples[i]  = 1;
+        }
+        maxsamples = std::max(maxsamples, nsamples[i]);
+        stats.aniso_probes += nsamples[i];
+    }
+    stats.aniso_queries += nlanes;
+
+    ImageCacheFile::SubimageInfo& subinfo(
+        texturefile->subimageinfo(opt.subimage));
+
+    FloatWide accum[4], daccumds[4], daccumdt[4];
+    for (int c = 0; c < 4; ++c) {
+        accum[c]    = FloatWide::Zero();
+        daccumds[c] = FloatWide::Zero();
+        daccumdt[c] = FloatWide::Zero();
+    }
+
+    // FIXME -- assuming latlong
+    bool ok = true;
+    FloatWide invsamples_w(invsamples);
+    // The MIP levels depend only on the filter width, not on the sample.
+    alignas(BatchAlign) int lanelev[BatchWidth][2];
+    alignas(BatchAlign) float lanelevweight[BatchWidth][2];
+    for (int i = 0; i < BatchWidth; ++i)
+        if (mask & (RunMask(1) << i))
+            latlong_miplevels(subinfo, filtwidth[i], mipmode, lanelev[i],
+                              lanelevweight[i]);
+    // Step the sample positions the same way as the single-point lookup.
+    FloatWide pos = FloatWide(-0.5f) + 0.5f * invsamples_w;
+    for (int sample = 0; sample < maxsamples;
+         ++sample, pos += invsamples_w) {
+        // Map the sample positions of all lanes to latlong st at once.
+        FloatWide Rsamp[3];
+        for (int a = 0; a < 3; ++a)
+            Rsamp[a] = R[a] + pos * Rmajor[a];
+        alignas(BatchAlign) float sval[BatchWidth], tval[BatchWidth];
+        FloatWide s, t;
+        vector_to_latlong(Rsamp, texturefile->m_y_up, s, t);
+        s.store(sval);
+        t.store(tval);
+
+        alignas(BatchAlign) int miplevel[2][BatchWidth];
+        alignas(BatchAlign) float weight[2][BatchWidth];
+        RunMask bilinear_lanes[2] = { 0, 0 };
+        for (int i = 0; i < BatchWidth; ++i) {
+            miplevel[0][i] = miplevel[1][i] = 0;
+            weight[0][i] = weight[1][i] = 0.0f;
+            if (!(mask & (RunMask(1) << i)) || sample >= nsamples[i])
+                continue;
+            const int* lev           = lanelev[i];
+            const float* levelweight = lanelevweight[i];
+            for (int level = 0; level < 2; ++level) {
+                if (!levelweight[level])
+                    continue;
+                miplevel[level][i] = lev[level];
+                weight[level][i]   = levelweight[level] * invsamples[i];
+                bool bicubic       = false;
+                if (opt.interpmode == TextureOpt::InterpSmartBicubic) {
+                    bicubic = (lev[level] == 0
+                               || (texturefile->spec(opt.subimage, lev[level])
+                                       .full_height
+                                   < naturalres[i] / 2));
+                    ++(bicubic ? stats.cubic_interps : stats.bilinear_interps);
+                } else if (opt.interpmode == TextureOpt::InterpBilinear) {
+                    ++stats.bilinear_interps;
                 }
-            } else {
-                ok &= environment(texture_handle, thread_info, opt, R_, dRdx_,
-                                  dRdy_, nchannels, r);
+                if (opt.interpmode == TextureOpt::InterpBilinear
+                    || (opt.interpmode == TextureOpt::InterpSmartBicubic
+                        && !bicubic)) {
+                    bilinear_lanes[level] |= RunMask(1) << i;
+                    continue;
+                }
+
+                // Closest and bicubic samples go one lane at a time.
+                sampler_prototype sampler = &TextureSystemImpl::sample_bicubic;
+                if (opt.interpmode == TextureOpt::InterpClosest) {
+                    sampler = &TextureSystemImpl::sample_closest;
+                    ++stats.closest_interps;
+                } else if (opt.interpmode == TextureOpt::InterpBicubic) {
+                    ++stats.cubic_interps;
+                }
+                OIIO_SIMD4_ALIGN float s1[4] = { sval[i], 0.0f, 0.0f, 0.0f };
+                OIIO_SIMD4_ALIGN float t1[4] = { tval[i], 0.0f, 0.0f, 0.0f };
+                OIIO_SIMD4_ALIGN float w1[4] = { weight[level][i], 0.0f, 0.0f,
+                                                 0.0f };
+                vfloat4 r, drds, drdt;
+                ok &= (this->*sampler)(1, s1, t1, lev[level], *texturefile,
+                                       thread_info, opt, nchannels,
+                                       actualchannels, w1, &r,
+                                       dresultds ? &drds : NULL,
+                                       dresultds ? &drdt : NULL);
                 for (int c = 0; c < nchannels; ++c) {
-                    result[c * Tex::BatchWidth + i] = r[c];
+                    accum[c][i] += r[c];
+                    if (dresultds) {
+                        daccumds[c][i] += drds[c];
+                        daccumdt[c][i] += drdt[c];
+                    }
                 }
             }
         }
+
+        // All the bilinear samples, grouped by MIP level and tile.
+        for (int level = 0; level < 2; ++level)
+            if (bilinear_lanes[level])
+                ok &= sample_bilinear_batch(bilinear_lanes[level], sval, tval,
+                                            miplevel[level], weight[level],
+                                            *texturefile, thread_info, opt,
+                                            nchannels, actualchannels, accum,
+                                            dresultds ? daccumds : nullptr,
+                                            dresultds ? daccumdt : nullptr);
+    }
+
+    if (actualchannels < nchannels && opt.firstchannel == 0 && m_gray_to_rgb)
+        fill_gray_channels(spec, nchannels, accum,
+                           dresultds ? daccumds : nullptr,
+                           dresultds ? daccumdt : nullptr);
+
+    for (int c = 0; c < nchannels; ++c) {
+        accum[c].store_mask(int(mask), result + c * BatchWidth);
+        if (dresultds) {
+            daccumds[c].store_mask(int(mask), dresultds + c * BatchWidth);
+            daccumdt[c].store_mask(int(mask), dresultdt + c * BatchWidth);
+        }
     }
     return ok;
 }
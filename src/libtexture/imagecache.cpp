@@ -10,6 +10,8 @@
 #include <string>
 #include <vector>
 
+#include <zlib.h>
+
 #include <OpenImageIO/Imath.h>
 #include <OpenImageIO/dassert.h>
 #include <OpenImageIO/filesystem.h>
@@ -18,6 +20,7 @@
 #include <OpenImageIO/imagecache.h>
 #include <OpenImageIO/imageio.h>
 #include <OpenImageIO/optparser.h>
+#include <OpenImageIO/parallel.h>
 #include <OpenImageIO/simd.h>
 #include <OpenImageIO/strutil.h>
 #include <OpenImageIO/sysutil.h>
@@ -120,9 +123,20 @@ void
 ImageCacheStatistics::init()
 {
     // ImageCache stats:
-    find_tile_calls             = 0;
-    find_tile_microcache_misses = 0;
-    find_tile_cache_misses      = 0;
+    find_tile_calls                = 0;
+    find_tile_microcache_misses    = 0;
+    find_tile_microcache_nway_hits = 0;
+    find_tile_cache_misses         = 0;
+    tiles_from_stats               = 0;
+    tiles_prefetched               = 0;
+    tier_demotions                 = 0;
+    tier_hits                      = 0;
+    tier_misses                    = 0;
+    disk_cache_hits                = 0;
+    disk_cache_misses              = 0;
+    disk_cache_writes              = 0;
+    shared_hits                    = 0;
+    shared_misses                  = 0;
     //    tiles_created = 0;
     //    tiles_current = 0;
     //    tiles_peak = 0;
@@ -158,6 +172,7 @@ ImageCacheStatistics::init()
     cubic_interps       = 0;
     file_retry_success  = 0;
     tile_retry_success  = 0;
+    spare_inputs_opened = 0;
 }
 
 
@@ -168,7 +183,18 @@ ImageCacheStatistics::merge(const ImageCacheStatistics& s)
     // ImageCache stats:
     find_tile_calls += s.find_tile_calls;
     find_tile_microcache_misses += s.find_tile_microcache_misses;
+    find_tile_microcache_nway_hits += s.find_tile_microcache_nway_hits;
     find_tile_cache_misses += s.find_tile_cache_misses;
+    tiles_from_stats += s.tiles_from_stats;
+    tiles_prefetched += s.tiles_prefetched;
+    tier_demotions += s.tier_demotions;
+    tier_hits += s.tier_hits;
+    tier_misses += s.tier_misses;
+    disk_cache_hits += s.disk_cache_hits;
+    disk_cache_misses += s.disk_cache_misses;
+    disk_cache_writes += s.disk_cache_writes;
+    shared_hits += s.shared_hits;
+    shared_misses += s.shared_misses;
     //    tiles_created += s.tiles_created;
     //    tiles_current += s.tiles_current;
     //    tiles_peak += s.tiles_peak;
@@ -204,6 +230,7 @@ ImageCacheStatistics::merge(const ImageCacheStatistics& s)
     cubic_interps += s.cubic_interps;
     file_retry_success += s.file_retry_success;
     tile_retry_success += s.tile_retry_success;
+    spare_inputs_opened += s.spare_inputs_opened;
 }
 
 
@@ -237,6 +264,49 @@ ImageCacheFile::LevelInfo::LevelInfo(const ImageSpec& spec_,
     tiles_read   = new atomic_ll[sz];
     for (int i = 0; i < sz; i++)
         tiles_read[i] = 0;
+
+    // Tile summaries from "maketx --tilestats" look like "WxHxD:blob",
+    // where the base64 blob has a bit for each channel of each tile that
+    // says whether it's constant, then the values (see add_tile_stats() in
+    // maketexture.cpp). Formats that can't store metadata for each MIP
+    // level repeat the top level's, so check that they're for this
+    // resolution and add up to just the right number of values.
+    string_view ts = nativespec.get_string_attribute("oiio:TileStats");
+    int w = 0, h = 0, d = 0;
+    if (ts.size() && Strutil::parse_int(ts, w) && Strutil::parse_char(ts, 'x')
+        && Strutil::parse_int(ts, h) && Strutil::parse_char(ts, 'x')
+        && Strutil::parse_int(ts, d) && Strutil::parse_char(ts, ':')
+        && w == spec.width && h == spec.height && d == std::max(spec.depth, 1)
+        && spec.tile_width == nativespec.tile_width
+        && spec.tile_height == nativespec.tile_height) {
+        std::string blob = Strutil::base64_decode(ts);
+        size_t n         = size_t(total_tiles) * spec.nchannels;
+        size_t masksize  = (n + 7) / 8;
+        size_t nvalues   = 0;
+        if (blob.size() >= masksize) {
+            tileconst.assign(blob.begin(), blob.begin() + masksize);
+            tilestart.resize(total_tiles);
+            for (size_t i = 0; i < n; ++i) {
+                if (i % spec.nchannels == 0)
+                    tilestart[i / spec.nchannels] = uint32_t(nvalues);
+                nvalues += (tileconst[i / 8] & (1 << (i % 8))) ? 1 : 3;
+            }
+        }
+        if (blob.size() == masksize + nvalues * sizeof(float)) {
+            tilestats.resize(nvalues);
+            memcpy(tilestats.data(), blob.data() + masksize,
+                   nvalues * sizeof(float));
+            if (bigendian())
+                swap_endian(tilestats.data(), int(nvalues));
+        } else {
+            std::vector<unsigned char>().swap(tileconst);
+            std::vector<uint32_t>().swap(tilestart);
+        }
+    }
+    // Now that we have them in a more compact form, don't hold on to a
+    // copy of the summaries' text for as long as the file is known.
+    spec.erase_attribute("oiio:TileStats");
+    nativespec.erase_attribute("oiio:TileStats");
 }
 
 
@@ -251,6 +321,9 @@ ImageCacheFile::LevelInfo::LevelInfo(const LevelInfo& src)
     , nxtiles(src.nxtiles)
     , nytiles(src.nytiles)
     , nztiles(src.nztiles)
+    , tileconst(src.tileconst)
+    , tilestart(src.tilestart)
+    , tilestats(src.tilestats)
 {
     int nwords = round_to_multiple(nxtiles * nytiles * nztiles, 64) / 64;
     tiles_read = new atomic_ll[nwords];
@@ -260,6 +333,38 @@ ImageCacheFile::LevelInfo::LevelInfo(const LevelInfo& src)
 
 
 
+bool
+ImageCacheFile::LevelInfo::tile_stats(int x, int y, int z, int chbegin,
+                                      int chend, float* min, float* max,
+                                      float* avg) const
+{
+    if (tilestart.empty() || x < spec.x || y < spec.y || z < spec.z)
+        return false;
+    int tx = (x - spec.x) / spec.tile_width;
+    int ty = (y - spec.y) / spec.tile_height;
+    int tz = (z - spec.z) / std::max(spec.tile_depth, 1);
+    if (tx >= nxtiles || ty >= nytiles || tz >= nztiles)
+        return false;
+    size_t tile    = (size_t(tz) * nytiles + ty) * nxtiles + tx;
+    size_t bit     = tile * spec.nchannels;
+    const float* s = &tilestats[tilestart[tile]];
+    for (int c = 0; c < chend; ++c, ++bit) {
+        bool constant = tileconst[bit / 8] & (1 << (bit % 8));
+        if (c >= chbegin) {
+            if (min)
+                *min++ = s[0];
+            if (max)
+                *max++ = constant ? s[0] : s[1];
+            if (avg)
+                *avg++ = constant ? s[0] : s[2];
+        }
+        s += constant ? 1 : 3;
+    }
+    return true;
+}
+
+
+
 ImageCacheFile::ImageCacheFile(ImageCacheImpl& imagecache,
                                ImageCachePerThreadInfo* /*thread_info*/,
                                ustring filename, ImageInput::Creator creator,
@@ -313,6 +418,17 @@ ImageCacheFile::~ImageCacheFile() { close(); }
 
 
 
+void
+ImageCacheFile::invalidate_spec()
+{
+    m_validspec = false;
+    m_subimages.clear();
+    imagecache().decr_mem(m_tile_stats_mem);
+    m_tile_stats_mem = 0;
+}
+
+
+
 void
 ImageCacheFile::reset(ImageInput::Creator creator, const ImageSpec* config)
 {
@@ -443,6 +559,36 @@ ImageCacheFile::SubimageInfo::init(ImageCacheFile& icfile,
 
 
 
+std::shared_ptr<ImageInput>
+ImageCacheFile::create_imageinput(ImageSpec& configspec)
+{
+    configspec = ImageSpec();
+    if (m_configspec)
+        configspec = *m_configspec;
+    if (imagecache().unassociatedalpha())
+        configspec.attribute("oiio:UnassociatedAlpha", 1);
+
+    std::shared_ptr<ImageInput> inp;
+    if (m_inputcreator)
+        inp.reset(m_inputcreator());
+    else {
+        // If we are trusting extensions and this isn't a special "REST-ful"
+        // name construction, just open with the extension in order to skip
+        // an unnecessary file open.
+        std::string fmt;
+        if (m_imagecache.trust_file_extensions()
+            && m_filename.find('?') != m_filename.npos)
+            fmt = OIIO::Filesystem::extension(fmt, false);
+        else
+            fmt = m_filename.string();
+        inp = ImageInput::create(fmt, false, &configspec,
+                                 m_imagecache.plugin_searchpath());
+    }
+    return inp;
+}
+
+
+
 std::shared_ptr<ImageInput>
 ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
 {
@@ -479,26 +625,7 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
         return inp;
 
     ImageSpec configspec;
-    if (m_configspec)
-        configspec = *m_configspec;
-    if (imagecache().unassociatedalpha())
-        configspec.attribute("oiio:UnassociatedAlpha", 1);
-
-    if (m_inputcreator)
-        inp.reset(m_inputcreator());
-    else {
-        // If we are trusting extensions and this isn't a special "REST-ful"
-        // name construction, just open with the extension in order to skip
-        // an unnecessary file open.
-        std::string fmt;
-        if (m_imagecache.trust_file_extensions()
-            && m_filename.find('?') != m_filename.npos)
-            fmt = OIIO::Filesystem::extension(fmt, false);
-        else
-            fmt = m_filename.string();
-        inp = ImageInput::create(fmt, false, &configspec,
-                                 m_imagecache.plugin_searchpath());
-    }
+    inp = create_imageinput(configspec);
     if (!inp) {
         mark_broken(OIIO::geterror());
         invalidate_spec();
@@ -541,7 +668,7 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
     // From here on, we know that we've opened this file for the very
     // first time.  So read all the subimages, fill out all the fields
     // of the ImageCacheFile.
-    m_subimages.clear();
+    invalidate_spec();
     int nsubimages = 0;
 
     // Since each subimage can potentially have its own mipmap levels,
@@ -685,6 +812,13 @@ ImageCacheFile::open(ImageCachePerThreadInfo* thread_info)
     thread_info->m_stats.files_totalsize_ondisk -= old_total_imagesize_ondisk;
     thread_info->m_stats.files_totalsize_ondisk += m_total_imagesize_ondisk;
 
+    // The tile summaries stay in memory for as long as the spec does, so
+    // count them against the cache's memory limit like tiles are.
+    for (const SubimageInfo& si : m_subimages)
+        for (const LevelInfo& lev : si.levels)
+            m_tile_stats_mem += lev.tile_stats_memsize();
+    imagecache().incr_mem(m_tile_stats_mem);
+
     init_from_spec();  // Fill in the rest of the fields
     set_imageinput(inp);
     return inp;
@@ -776,6 +910,9 @@ ImageCacheFile::init_from_spec()
         maxmip = std::max(maxmip, miplevels(s));
     m_mipreadcount.clear();
     m_mipreadcount.resize(maxmip, 0);
+    m_levelstats.clear();
+    m_levelstats.resize(maxmip);
+    m_degradable = imagecache().degradable(m_filename);
 
     OIIO_DASSERT(!m_broken);
     m_validspec = true;
@@ -804,6 +941,13 @@ ImageCacheFile::read_tile(ImageCachePerThreadInfo* thread_info, int subimage,
         return read_unmipped(thread_info, subimage, miplevel, x, y, z, chbegin,
                              chend, format, data);
 
+    // If maketx recorded that this tile is all one color, fill it in
+    // without reading (or even opening) the file.
+    if (!subinfo.untiled && imagecache().use_tile_stats()
+        && fill_constant_tile(thread_info, subimage, miplevel, x, y, z,
+                              chbegin, chend, format, data))
+        return true;
+
     std::shared_ptr<ImageInput> inp = open(thread_info);
     if (!inp)
         return false;
@@ -813,17 +957,37 @@ ImageCacheFile::read_tile(ImageCachePerThreadInfo* thread_info, int subimage,
         return read_untiled(thread_info, inp.get(), subimage, miplevel, x, y, z,
                             chbegin, chend, format, data);
 
-    // Ordinary tiled
+    // Ordinary tiled. If another thread is in the middle of reading from
+    // the shared ImageInput, read through a spare one (if allowed) rather
+    // than queueing behind it. Holding the shared one's lock when we get it
+    // is harmless, since it's recursive and read_tiles will take it anyway.
+    std::shared_ptr<ImageInput> spare;
+    int spare_generation = 0;
+    bool locked          = false;
+    if (imagecache().max_inputs_per_file() > 1 && !(locked = inp->try_lock()))
+        spare = borrow_spare_input(thread_info, spare_generation);
+    if (!locked && !spare) {
+        // Take the lock ourselves, just to find out how long we wait for it
+        Timer timer;
+        inp->lock();
+        locked      = true;
+        double wait = timer();
+        thread_info->m_stats.file_locking_time += wait;
+        if (imagecache().access_stats())
+            m_levelstats[miplevel].wait_ns += (long long)(wait * 1.0e9);
+    }
+    ImageInput* reader = spare ? spare.get() : inp.get();
+
     bool ok = true;
     const ImageSpec& spec(this->spec(subimage, miplevel));
     for (int tries = 0; tries <= imagecache().failure_retries(); ++tries) {
-        ok = inp->read_tiles(subimage, miplevel, x, x + spec.tile_width, y,
-                             y + spec.tile_height, z, z + spec.tile_depth,
-                             chbegin, chend, format, data);
+        ok = reader->read_tiles(subimage, miplevel, x, x + spec.tile_width, y,
+                                y + spec.tile_height, z, z + spec.tile_depth,
+                                chbegin, chend, format, data);
         if (ok) {
             if (tries)  // succeeded, but only after a failure!
                 ++thread_info->m_stats.tile_retry_success;
-            (void)inp->geterror();  // Eat the errors
+            (void)reader->geterror();  // Eat the errors
             break;
         }
         if (tries < imagecache().failure_retries()) {
@@ -833,24 +997,62 @@ ImageCacheFile::read_tile(ImageCachePerThreadInfo* thread_info, int subimage,
         }
     }
     if (!ok) {
-        std::string err = inp->geterror();
+        std::string err = reader->geterror();
         if (errors_should_issue()) {
             imagecache().error("{}",
                                err.size() ? err : std::string("unknown error"));
         }
     }
+    if (locked)
+        inp->unlock();
+    if (spare)
+        return_spare_input(std::move(spare), spare_generation);
 
     if (ok) {
         size_t b = spec.tile_bytes();
         thread_info->m_stats.bytes_read += b;
         m_bytesread += b;
         ++m_tilesread;
+        if (imagecache().access_stats())
+            m_levelstats[miplevel].bytesread += b;
     }
     return ok;
 }
 
 
 
+bool
+ImageCacheFile::fill_constant_tile(ImageCachePerThreadInfo* thread_info,
+                                   int subimage, int miplevel, int x, int y,
+                                   int z, int chbegin, int chend,
+                                   TypeDesc format, void* data)
+{
+    const LevelInfo& lev(levelinfo(subimage, miplevel));
+    int nchans   = chend - chbegin;
+    float* value = OIIO_ALLOCA(float, nchans);
+    float* max   = OIIO_ALLOCA(float, nchans);
+    if (!lev.tile_stats(x, y, z, chbegin, chend, value, max, nullptr))
+        return false;
+    for (int c = 0; c < nchans; ++c)
+        if (value[c] != max[c])
+            return false;  // min != max, so it's not constant
+    // maketx summarized the float pixels before they were converted to the
+    // file's data type, so make the same conversion, then to the cache's
+    // type, to end up with exactly what reading the tile would give.
+    TypeDesc nativeformat = lev.nativespec.format;
+    char* native = OIIO_ALLOCA(char, nativeformat.size() * nchans);
+    size_t pixelsize = format.size() * nchans;
+    char* pixel      = OIIO_ALLOCA(char, pixelsize);
+    convert_pixel_values(TypeFloat, value, nativeformat, native, nchans);
+    convert_pixel_values(nativeformat, native, format, pixel, nchans);
+    for (imagesize_t p = 0, n = lev.spec.tile_pixels(); p < n; ++p)
+        memcpy((char*)data + p * pixelsize, pixel, pixelsize);
+    ++thread_info->m_stats.tiles_from_stats;
+    return true;
+}
+
+
+
 bool
 ImageCacheFile::read_unmipped(ImageCachePerThreadInfo* thread_info,
                               int subimage, int miplevel, int x, int y, int z,
@@ -1057,6 +1259,85 @@ ImageCacheFile::close()
     // are still hanging onto it.
     std::shared_ptr<ImageInput> empty;
     set_imageinput(empty);
+    close_spare_inputs();
+}
+
+
+
+std::shared_ptr<ImageInput>
+ImageCacheFile::borrow_spare_input(ImageCachePerThreadInfo* thread_info,
+                                   int& generation)
+{
+    {
+        spin_lock lock(m_spare_mutex);
+        generation = m_spare_generation;
+        if (m_spare_inputs.size()) {
+            std::shared_ptr<ImageInput> inp = std::move(m_spare_inputs.back());
+            m_spare_inputs.pop_back();
+            return inp;
+        }
+        // The shared m_input counts as one of the file's inputs
+        if (m_nspare_inputs + 1 >= imagecache().max_inputs_per_file())
+            return {};
+        ++m_nspare_inputs;  // Claim the slot before the slow open
+    }
+
+    // Spares count against max_open_files just like any other open file,
+    // so make room first if needed.
+    imagecache().check_max_files(thread_info);
+    Timer timer;
+    ImageSpec configspec, nativespec;
+    std::shared_ptr<ImageInput> inp = create_imageinput(configspec);
+    bool ok = inp && inp->open(m_filename.c_str(), nativespec, configspec);
+    thread_info->m_stats.fileopen_time += timer();
+    if (ok) {
+        imagecache().incr_open_files();
+        ++thread_info->m_stats.spare_inputs_opened;
+        return inp;
+    }
+    // No matter, the caller will use the shared ImageInput after all
+    if (inp)
+        (void)inp->geterror();
+    spin_lock lock(m_spare_mutex);
+    --m_nspare_inputs;
+    return {};
+}
+
+
+
+void
+ImageCacheFile::return_spare_input(std::shared_ptr<ImageInput>&& inp,
+                                   int generation)
+{
+    {
+        spin_lock lock(m_spare_mutex);
+        if (generation == m_spare_generation) {
+            m_spare_inputs.push_back(std::move(inp));
+            return;
+        }
+        --m_nspare_inputs;
+    }
+    // The file was closed or invalidated while this one was lent out
+    inp.reset();
+    imagecache().decr_open_files();
+}
+
+
+
+void
+ImageCacheFile::close_spare_inputs()
+{
+    std::vector<std::shared_ptr<ImageInput>> idle;
+    {
+        spin_lock lock(m_spare_mutex);
+        idle.swap(m_spare_inputs);
+        m_nspare_inputs -= int(idle.size());
+        ++m_spare_generation;
+    }
+    for (auto& inp : idle) {
+        inp.reset();
+        imagecache().decr_open_files();
+    }
 }
 
 
@@ -1500,9 +1781,15 @@ ImageCacheTile::ImageCacheTile(const TileID& id, const void* pels,
 
 ImageCacheTile::~ImageCacheTile()
 {
-    m_id.file().imagecache().decr_tiles(memsize());
+    ImageCacheImpl& imagecache(m_id.file().imagecache());
+    imagecache.decr_tiles(memcharged());
+    // Pooled pixels are charged to the cache until their last tile is gone.
+    if (m_pooled && imagecache.tilepool().release(m_pooled))
+        imagecache.decr_mem(memsize());
     if (m_nofree)
         m_pixels.release();  // release without freeing
+    if (m_shared_store)
+        m_shared_store->unpin(m_shared_slot);
 }
 
 
@@ -1511,7 +1798,9 @@ size_t
 ImageCacheTile::memsize_needed() const
 {
     const ImageSpec& spec(file().spec(m_id.subimage(), m_id.miplevel()));
-    size_t s = spec.tile_pixels() * pixelsize();
+    // N.B. Don't rely on m_pixelsize, it isn't set until the pixels are.
+    size_t s = spec.tile_pixels() * m_id.nchannels()
+               * file().datatype(m_id.subimage()).size();
     // N.B. Round up so we can use a SIMD fetch for the last pixel and
     // channel without running off the end.
     s += OIIO_SIMD_MAX_SIZE_BYTES;
@@ -1521,14 +1810,20 @@ ImageCacheTile::memsize_needed() const
 
 
 bool
-ImageCacheTile::read(ImageCachePerThreadInfo* thread_info)
+ImageCacheTile::read(ImageCachePerThreadInfo* thread_info, char* pixels)
 {
     ImageCacheFile& file(m_id.file());
     m_channelsize = file.datatype(id().subimage()).size();
     m_pixelsize   = m_id.nchannels() * m_channelsize;
     size_t size   = memsize_needed();
     OIIO_ASSERT(memsize() == 0 && size > OIIO_SIMD_MAX_SIZE_BYTES);
-    m_pixels.reset(new char[m_pixels_size = size]);
+    if (pixels) {
+        m_nofree = true;  // Somebody else's memory
+        m_pixels.reset(pixels);
+        m_pixels_size = size;
+    } else {
+        m_pixels.reset(new char[m_pixels_size = size]);
+    }
     // Clear the end pad values so there aren't NaNs sucked up by simd loads
     memset(m_pixels.get() + size - OIIO_SIMD_MAX_SIZE_BYTES, 0,
            OIIO_SIMD_MAX_SIZE_BYTES);
@@ -1542,16 +1837,12 @@ ImageCacheTile::read(ImageCachePerThreadInfo* thread_info)
             file.levelinfo(m_id.subimage(), m_id.miplevel()));
         m_tile_width = lev.spec.tile_width;
         OIIO_DASSERT(m_tile_width > 0);
-        int whichtile = ((m_id.x() - lev.spec.x) / lev.spec.tile_width)
-                        + ((m_id.y() - lev.spec.y) / lev.spec.tile_height)
-                              * lev.nxtiles
-                        + ((m_id.z() - lev.spec.z) / lev.spec.tile_depth)
-                              * (lev.nxtiles * lev.nytiles);
-        int index       = whichtile / 64;
-        int64_t bitmask = int64_t(1ULL << (whichtile & 63));
-        int64_t oldval  = lev.tiles_read[index].fetch_or(bitmask);
-        if (oldval & bitmask)  // Was it previously read?
+        bool reread = mark_read();
+        if (reread)
             file.register_redundant_tile(lev.spec.tile_bytes());
+        file.imagecache().note_tile_read(reread);
+        if (!m_nofree && file.imagecache().deduplicate_tiles())
+            pool_pixels();
     } else {
         // (! m_valid)
         m_used = false;  // Don't let it hold mem if invalid
@@ -1578,6 +1869,70 @@ ImageCacheTile::read(ImageCachePerThreadInfo* thread_info)
 
 
 
+void
+ImageCacheTile::adopt_pixels(std::unique_ptr<char[]>&& pixels, size_t size)
+{
+    ImageCacheFile& file(m_id.file());
+    m_channelsize = file.datatype(id().subimage()).size();
+    m_pixelsize   = m_id.nchannels() * m_channelsize;
+    OIIO_ASSERT(memsize() == 0 && size == memsize_needed());
+    m_pixels      = std::move(pixels);
+    m_pixels_size = size;
+    m_tile_width  = file.spec(m_id.subimage(), m_id.miplevel()).tile_width;
+    m_valid       = true;
+    file.imagecache().incr_mem(size);
+    // It's not a read from the file, so not a redundant one, but restoring
+    // a tile that was evicted is as much a sign of thrashing as reading it
+    // again.
+    file.imagecache().note_tile_read(mark_read());
+    if (!m_nofree && file.imagecache().deduplicate_tiles())
+        pool_pixels();
+    m_pixels_ready = true;
+}
+
+
+
+bool
+ImageCacheTile::mark_read()
+{
+    ImageCacheFile::LevelInfo& lev(
+        m_id.file().levelinfo(m_id.subimage(), m_id.miplevel()));
+    int whichtile = ((m_id.x() - lev.spec.x) / lev.spec.tile_width)
+                    + ((m_id.y() - lev.spec.y) / lev.spec.tile_height)
+                          * lev.nxtiles
+                    + ((m_id.z() - lev.spec.z) / lev.spec.tile_depth)
+                          * (lev.nxtiles * lev.nytiles);
+    int index       = whichtile / 64;
+    int64_t bitmask = int64_t(1ULL << (whichtile & 63));
+    int64_t oldval  = lev.tiles_read[index].fetch_or(bitmask);
+    return (oldval & bitmask) != 0;
+}
+
+
+
+void
+ImageCacheTile::pool_pixels()
+{
+    ImageCacheImpl& imagecache(m_id.file().imagecache());
+    bool found = false;
+    m_pooled   = imagecache.tilepool().acquire(m_pixels, m_pixels_size, found);
+    if (found)
+        imagecache.decr_mem(m_pixels_size);  // We had a duplicate, now freed
+    m_pixels.reset(m_pooled->data.get());
+    m_nofree = true;  // The pool owns them
+}
+
+
+
+void
+ImageCacheTile::adopt_pixels(char* pixels, size_t size)
+{
+    m_nofree = true;  // Somebody else's memory
+    adopt_pixels(std::unique_ptr<char[]>(pixels), size);
+}
+
+
+
 void
 ImageCacheTile::wait_pixels_ready() const
 {
@@ -1610,6 +1965,797 @@ ImageCacheTile::data(int x, int y, int z, int c) const
 
 
 
+TileCache::Table::Table(size_t capacity)
+    : mask(capacity - 1)
+    , slots(new std::atomic<ImageCacheTile*>[capacity])
+{
+    for (size_t i = 0; i < capacity; ++i)
+        slots[i].store(nullptr, std::memory_order_relaxed);
+}
+
+
+
+TileCache::~TileCache()
+{
+    // Nobody can be reading any more, so everything can go at once.
+    for (Shard& shard : m_shards) {
+        if (Table* table = shard.table.load()) {
+            for (size_t i = 0; i <= table->mask; ++i) {
+                ImageCacheTile* t = table->slots[i].load();
+                if (t && t != tombstone())
+                    intrusive_ptr_release(t);
+            }
+            delete table;
+        }
+        for (auto& r : shard.retired_tiles)
+            intrusive_ptr_release(r.ptr);
+        for (auto& r : shard.retired_tables)
+            delete r.ptr;
+    }
+    for (Reader* r = m_readers.load(); r;) {
+        Reader* next = r->next;
+        aligned_delete(r);
+        r = next;
+    }
+}
+
+
+
+TileCache::Reader*
+TileCache::acquire_reader()
+{
+    // Recycle a Reader given back by a thread that has gone away...
+    for (Reader* r = m_readers.load(); r; r = r->next) {
+        bool expected = false;
+        if (!r->in_use.load(std::memory_order_relaxed)
+            && r->in_use.compare_exchange_strong(expected, true))
+            return r;
+    }
+    // ...or make a new one and push it on the front of the list.
+    Reader* r = aligned_new<Reader>();
+    r->in_use = true;
+    r->next   = m_readers.load();
+    while (!m_readers.compare_exchange_weak(r->next, r))
+        ;
+    return r;
+}
+
+
+
+bool
+TileCache::retrieve_locked(const TileID& id, ImageCacheTileRef& tile)
+{
+    size_t hash = id.hash();
+    Shard& shard(m_shards[whichshard(hash)]);
+    spin_lock lock(shard.mutex);
+    Table* table      = shard.table.load(std::memory_order_relaxed);
+    ImageCacheTile* t = table ? lookup(*table, id, hash) : nullptr;
+    if (t)
+        tile = t;
+    return t != nullptr;
+}
+
+
+
+bool
+TileCache::contains(const TileID& id)
+{
+    ImageCacheTileRef tile;
+    return retrieve_locked(id, tile);
+}
+
+
+
+bool
+TileCache::insert_retrieve(ImageCacheTileRef& tile)
+{
+    const TileID& id(tile->id());
+    size_t hash = id.hash();
+    Shard& shard(m_shards[whichshard(hash)]);
+    spin_lock lock(shard.mutex);
+    Table* table = shard.table.load(std::memory_order_relaxed);
+    if (!table || 2 * (shard.used + shard.tombstones + 1) > table->mask + 1)
+        table = rehash(shard);
+
+    // Look for an existing entry, remembering the first slot we could
+    // put a new one in (preferably a tombstone, to keep probes short).
+    const size_t none = ~size_t(0);
+    size_t slot       = none;
+    for (size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+        ImageCacheTile* t = table->slots[i].load(std::memory_order_relaxed);
+        if (!t) {
+            if (slot == none)
+                slot = i;
+            else
+                --shard.tombstones;  // we're reusing one
+            break;
+        }
+        if (t == tombstone()) {
+            if (slot == none)
+                slot = i;
+        } else if (t->id() == id) {
+            // Replace caller's value with the one already in the table.
+            tile = t;
+            return false;
+        }
+    }
+
+    // The table holds its own reference to the tile.
+    intrusive_ptr_add_ref(tile.get());
+    table->slots[slot].store(tile.get(), std::memory_order_release);
+    ++shard.used;
+    ++m_size;
+    return true;
+}
+
+
+
+TileCache::Table*
+TileCache::rehash(Shard& shard)
+{
+    // Size the new table so the live tiles fill at most a quarter of it.
+    // Rehashing also discards all the tombstones.
+    size_t capacity = 16;
+    while (capacity < 4 * (shard.used + 1))
+        capacity *= 2;
+    Table* old   = shard.table.load(std::memory_order_relaxed);
+    Table* table = new Table(capacity);
+    if (old) {
+        // The tiles move to the new table along with the table's
+        // references to them.
+        for (size_t i = 0; i <= old->mask; ++i) {
+            ImageCacheTile* t = old->slots[i].load(std::memory_order_relaxed);
+            if (t && t != tombstone()) {
+                size_t j = t->id().hash() & table->mask;
+                while (table->slots[j].load(std::memory_order_relaxed))
+                    j = (j + 1) & table->mask;
+                table->slots[j].store(t, std::memory_order_relaxed);
+            }
+        }
+    }
+    shard.table.store(table);
+    shard.tombstones = 0;
+    shard.clock_hand = 0;
+    if (old) {
+        // Readers may still be probing the old table.
+        shard.retired_tables.push_back({ m_epoch.load(), old });
+        reclaim(shard);
+    }
+    return table;
+}
+
+
+
+void
+TileCache::remove(Shard& shard, Table& table, size_t i)
+{
+    ImageCacheTile* t = table.slots[i].load(std::memory_order_relaxed);
+    OIIO_DASSERT(t && t != tombstone());
+    // N.B. The unlink must be ordered before we read the epoch that the
+    // tile is retired in, hence the default (seq_cst) store.
+    table.slots[i].store(tombstone());
+    --shard.used;
+    ++shard.tombstones;
+    --m_size;
+    shard.retired_tiles.push_back({ m_epoch.load(), t });
+}
+
+
+
+void
+TileCache::reclaim(Shard& shard)
+{
+    if (shard.retired_tiles.empty() && shard.retired_tables.empty())
+        return;
+
+    // Advance the epoch, so that readers who start after this point are
+    // known not to have seen anything retired so far, then find the
+    // oldest epoch that any reader might still be in.  Everything retired
+    // before that epoch is unreachable.
+    uint64_t oldest = m_epoch.fetch_add(1) + 1;
+    for (Reader* r = m_readers.load(); r; r = r->next) {
+        uint64_t e = r->epoch.load();
+        if (e && e < oldest)
+            oldest = e;
+    }
+
+    // Anything a reader might still see waits for the next reclaim of
+    // this shard.
+    size_t n = 0;
+    for (auto& r : shard.retired_tiles) {
+        if (r.epoch < oldest)
+            intrusive_ptr_release(r.ptr);
+        else
+            shard.retired_tiles[n++] = r;
+    }
+    shard.retired_tiles.resize(n);
+    n = 0;
+    for (auto& r : shard.retired_tables) {
+        if (r.epoch < oldest)
+            delete r.ptr;
+        else
+            shard.retired_tables[n++] = r;
+    }
+    shard.retired_tables.resize(n);
+}
+
+
+
+void
+TileCache::evict(long long excess, std::vector<ImageCacheTileRef>* evicted)
+{
+    // Several threads may notice at about the same time that we're over
+    // the limit.  Each one takes on only the part of the excess that
+    // nobody else is already working on.
+    long long mine = excess - m_evicting.load();
+    if (mine <= 0)
+        return;
+    m_evicting += mine;
+
+    // Visit the shards round-robin, advancing each one's clock hand at
+    // most one revolution per visit, so that taken together the shards
+    // behave much like a single clock.  Tiles used since the hand last
+    // passed get their 'used' flag cleared; tiles not used since then are
+    // removed.  Shards that another thread is modifying are skipped.
+    long long freed = 0;
+    for (int visits = 0; visits < 4 * TILE_CACHE_SHARDS; ++visits) {
+        if (freed >= mine || empty())
+            break;
+        Shard& shard(m_shards[m_evict_shard++ % TILE_CACHE_SHARDS]);
+        if (!shard.mutex.try_lock())
+            continue;
+        if (Table* table = shard.table.load(std::memory_order_relaxed)) {
+            for (size_t n = 0; n <= table->mask && freed < mine; ++n) {
+                size_t i         = shard.clock_hand;
+                shard.clock_hand = (i + 1) & table->mask;
+                ImageCacheTile* t = table->slots[i].load(
+                    std::memory_order_relaxed);
+                if (t && t != tombstone() && !t->release()) {
+                    // Count pooled pixels too, even though they're only
+                    // freed with the pool's last reference, or else with
+                    // deduplication on we'd never think we had freed
+                    // anything and would sweep out the whole cache.
+                    freed += t->memsize();
+                    if (evicted)
+                        evicted->emplace_back(t);
+                    remove(shard, *table, i);
+                }
+            }
+        }
+        reclaim(shard);
+        shard.mutex.unlock();
+    }
+    m_evicting -= mine;
+}
+
+
+
+// Byte shuffle: gather byte b of every n-byte value into the b'th plane
+// of dst.  Multi-byte pixel values tend to have similar high bytes and
+// noisy low bytes, and separating them helps the compressor a lot.
+static void
+shuffle_bytes(const char* src, char* dst, size_t size, int n)
+{
+    size_t nvals = size / n;
+    for (int b = 0; b < n; ++b)
+        for (size_t i = 0; i < nvals; ++i)
+            dst[b * nvals + i] = src[i * n + b];
+    memcpy(dst + nvals * n, src + nvals * n, size - nvals * n);
+}
+
+
+
+static void
+unshuffle_bytes(const char* src, char* dst, size_t size, int n)
+{
+    size_t nvals = size / n;
+    for (int b = 0; b < n; ++b)
+        for (size_t i = 0; i < nvals; ++i)
+            dst[i * n + b] = src[b * nvals + i];
+    memcpy(dst + nvals * n, src + nvals * n, size - nvals * n);
+}
+
+
+
+void
+CompressedTileTier::set_max_memory(long long bytes)
+{
+    m_max_memory = std::max(0LL, bytes);
+    if (m_max_memory == 0)
+        erase_if([](const TileID&) { return true; });
+    else
+        trim();
+}
+
+
+
+bool
+CompressedTileTier::demote(const ImageCacheTile& tile)
+{
+    // Tiles that aren't fully read, failed to read, or whose pixels belong
+    // to the application (memsize 0) or are shared with other processes
+    // aren't worth keeping.
+    size_t rawsize = tile.memsize();
+    if (!enabled() || !tile.pixels_ready() || !tile.valid() || !rawsize
+        || tile.shared())
+        return false;
+
+    // Deflate at its fastest setting: we're trading a little CPU at
+    // eviction time for not having to go back to the file later.
+    std::unique_ptr<char[]> shuffled(new char[rawsize]);
+    shuffle_bytes((const char*)tile.data(), shuffled.get(), rawsize,
+                  tile.channelsize());
+    uLongf csize = compressBound(uLong(rawsize));
+    std::unique_ptr<char[]> cbuf(new char[csize]);
+    if (compress2((Bytef*)cbuf.get(), &csize, (const Bytef*)shuffled.get(),
+                  uLong(rawsize), Z_BEST_SPEED)
+            != Z_OK
+        || csize >= rawsize)
+        return false;
+
+    Entry entry;
+    entry.data.reset(new char[csize]);
+    memcpy(entry.data.get(), cbuf.get(), csize);
+    entry.size    = csize;
+    entry.rawsize = rawsize;
+    entry.serial  = m_serial++;
+    {
+        Shard& sh(shard(tile.id()));
+        spin_lock lock(sh.mutex);
+        // Drop stale fifo entries at the front as we go, so tiles that
+        // cycle through here repeatedly don't grow it without bound.
+        while (!sh.fifo.empty()) {
+            auto found = sh.map.find(sh.fifo.front().second);
+            if (found != sh.map.end()
+                && found->second.serial == sh.fifo.front().first)
+                break;
+            sh.fifo.pop_front();
+        }
+        sh.fifo.emplace_back(entry.serial, tile.id());
+        auto found = sh.map.find(tile.id());
+        if (found != sh.map.end()) {
+            // Shouldn't happen (it's restored before being re-read), but
+            // if it does, the newer copy wins.
+            m_mem_used -= found->second.size;
+            m_raw_used -= found->second.rawsize;
+            sh.map.erase(found);
+        }
+        m_mem_used += entry.size;
+        m_raw_used += entry.rawsize;
+        sh.map.emplace(tile.id(), std::move(entry));
+    }
+    trim();
+    return true;
+}
+
+
+
+bool
+CompressedTileTier::restore(ImageCacheTile& tile)
+{
+    Entry entry;
+    {
+        Shard& sh(shard(tile.id()));
+        spin_lock lock(sh.mutex);
+        auto found = sh.map.find(tile.id());
+        if (found == sh.map.end())
+            return false;
+        entry = std::move(found.value());
+        sh.map.erase(found);
+    }
+    m_mem_used -= entry.size;
+    m_raw_used -= entry.rawsize;
+    if (entry.rawsize != tile.memsize_needed())
+        return false;  // Can't happen unless the file changed underneath
+
+    std::unique_ptr<char[]> shuffled(new char[entry.rawsize]);
+    uLongf rawsize = uLongf(entry.rawsize);
+    if (uncompress((Bytef*)shuffled.get(), &rawsize,
+                   (const Bytef*)entry.data.get(), uLong(entry.size))
+            != Z_OK
+        || rawsize != entry.rawsize)
+        return false;
+    std::unique_ptr<char[]> pixels(new char[entry.rawsize]);
+    unshuffle_bytes(shuffled.get(), pixels.get(), entry.rawsize,
+                    (int)tile.file().datatype(tile.id().subimage()).size());
+    tile.adopt_pixels(std::move(pixels), entry.rawsize);
+    return true;
+}
+
+
+
+void
+CompressedTileTier::trim()
+{
+    // Discard the longest-demoted tiles of each shard in turn until we're
+    // back within budget.  Shards somebody else is using are skipped.
+    for (int visits = 0; visits < 2 * TILE_TIER_SHARDS; ++visits) {
+        if (m_mem_used <= m_max_memory)
+            break;
+        Shard& sh(m_shards[m_trim_shard++ % TILE_TIER_SHARDS]);
+        if (!sh.mutex.try_lock())
+            continue;
+        while (m_mem_used > m_max_memory && !sh.fifo.empty()) {
+            auto oldest = sh.fifo.front();
+            sh.fifo.pop_front();
+            auto found = sh.map.find(oldest.second);
+            if (found != sh.map.end() && found->second.serial == oldest.first) {
+                m_mem_used -= found->second.size;
+                m_raw_used -= found->second.rawsize;
+                sh.map.erase(found);
+            }
+        }
+        sh.mutex.unlock();
+    }
+}
+
+
+
+TileContentPool::~TileContentPool()
+{
+    // Every tile should have released its pixels by now, but don't leak
+    // any that remain.
+    for (Shard& sh : m_shards)
+        for (auto& entry : sh.map)
+            delete entry.second;
+}
+
+
+
+PooledTilePixels*
+TileContentPool::acquire(std::unique_ptr<char[]>& pixels, size_t size,
+                         bool& found)
+{
+    uint64_t hash = fasthash::fasthash64(pixels.get(), size);
+    Shard& sh(shard(hash));
+    spin_lock lock(sh.mutex);
+    auto range = sh.map.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        PooledTilePixels* pooled = it->second;
+        if (pooled->size == size
+            && !memcmp(pooled->data.get(), pixels.get(), size)) {
+            ++pooled->refcnt;
+            pixels.reset();
+            found = true;
+            ++m_duplicates;
+            m_mem_saved += size;
+            return pooled;
+        }
+    }
+    PooledTilePixels* pooled = new PooledTilePixels;
+    pooled->data             = std::move(pixels);
+    pooled->size             = size;
+    pooled->hash             = hash;
+    pooled->refcnt           = 1;
+    sh.map.emplace(hash, pooled);
+    found = false;
+    return pooled;
+}
+
+
+
+bool
+TileContentPool::release(PooledTilePixels* pooled)
+{
+    Shard& sh(shard(pooled->hash));
+    spin_lock lock(sh.mutex);
+    if (--pooled->refcnt > 0) {
+        m_mem_saved -= pooled->size;
+        return false;
+    }
+    auto range = sh.map.equal_range(pooled->hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == pooled) {
+            sh.map.erase(it);
+            break;
+        }
+    }
+    delete pooled;
+    return true;
+}
+
+
+
+// Tile files begin with this (which includes a format version), then
+// the uint32 length and characters of the file key, then the uint64 size
+// of the pixels, then the pixels themselves.
+static const char disktile_magic[8] = { 'O', 'I', 'I', 'O',
+                                        'T', 'I', 'L', '1' };
+
+
+
+std::string
+DiskTileCache::filekey(const ImageCacheTile& tile)
+{
+    const ImageCacheFile& file(tile.file());
+    // A fingerprint identifies the pixels no matter where the file lives,
+    // so copies of a texture on different paths share cache entries.
+    // Otherwise, a changed modification time means a changed file.
+    std::string key
+        = file.fingerprint().size()
+              ? Strutil::fmt::format("fp:{}", file.fingerprint())
+              : Strutil::fmt::format("fn:{}:{}", file.filename(),
+                                     (long long)file.mod_time());
+    // The pixels, and how the cache lays them out, also depend on every
+    // cache setting that changes what is read or how: the data type
+    // (forcefloat) and tile size (autotile, autoscanline) they end up
+    // with, unassociatedalpha, which MIP levels there are (automip,
+    // max_mip_res), and any configuration hints the file was added with.
+    const ImageCacheImpl& ic(file.imagecache());
+    const ImageSpec& spec(
+        file.spec(tile.id().subimage(), tile.id().miplevel()));
+    key += Strutil::fmt::format(":{}:{}x{}x{}:ua{}:am{}:mr{}",
+                                file.datatype(tile.id().subimage()),
+                                spec.tile_width, spec.tile_height,
+                                spec.tile_depth, int(ic.unassociatedalpha()),
+                                int(ic.automip()), ic.max_mip_res());
+    if (const ImageSpec* config = file.configspec())
+        key += Strutil::fmt::format(
+            ":cfg{:016x}",
+            (unsigned long long)Strutil::strhash(
+                config->serialize(ImageSpec::SerialText)));
+    return key;
+}
+
+
+
+std::string
+DiskTileCache::filedir(string_view key) const
+{
+    return Strutil::fmt::format("{}/{:016x}", m_dir,
+                                (unsigned long long)Strutil::strhash(key));
+}
+
+
+
+std::string
+DiskTileCache::tilename(const ImageCacheTile& tile)
+{
+    const TileID& id(tile.id());
+    return Strutil::fmt::format("s{}m{}_{}_{}_{}_c{}-{}.tile", id.subimage(),
+                                id.miplevel(), id.x(), id.y(), id.z(),
+                                id.chbegin(), id.chend());
+}
+
+
+
+bool
+DiskTileCache::restore(ImageCacheTile& tile, char* pixels) const
+{
+    if (!enabled())
+        return false;
+    std::string key  = filekey(tile);
+    std::string path = filedir(key) + "/" + tilename(tile);
+    FILE* f          = Filesystem::fopen(path, "rb");
+    if (!f)
+        return false;
+
+    size_t rawsize  = tile.memsize_needed();
+    char magic[8]   = {};
+    uint32_t keylen = 0;
+    uint64_t size   = 0;
+    std::string filekey;
+    bool ok = (fread(magic, sizeof(magic), 1, f) == 1
+               && !memcmp(magic, disktile_magic, sizeof(magic))
+               && fread(&keylen, sizeof(keylen), 1, f) == 1
+               && keylen == key.size());
+    if (ok) {
+        filekey.resize(keylen);
+        ok = (fread(&filekey[0], 1, keylen, f) == keylen && filekey == key
+              && fread(&size, sizeof(size), 1, f) == 1 && size == rawsize);
+    }
+    std::unique_ptr<char[]> ownpixels;
+    if (ok) {
+        if (!pixels)
+            ownpixels.reset(pixels = new char[rawsize]);
+        ok = (fread(pixels, 1, rawsize, f) == rawsize);
+    }
+    fclose(f);
+    if (!ok)
+        return false;  // Missing, truncated, or not what we're looking for
+    if (ownpixels)
+        tile.adopt_pixels(std::move(ownpixels), rawsize);
+    else
+        tile.adopt_pixels(pixels, rawsize);
+    return true;
+}
+
+
+
+bool
+DiskTileCache::store(const ImageCacheTile& tile) const
+{
+    if (!enabled() || !tile.valid() || !tile.memsize())
+        return false;
+    std::string key = filekey(tile);
+    std::string dir = filedir(key);
+    if (!Filesystem::is_directory(dir)) {
+        // Another process may be making it at the same time; that's fine.
+        Filesystem::create_directory(m_dir);
+        Filesystem::create_directory(dir);
+    }
+
+    // Write to a unique temporary name and rename it into place when
+    // complete, so that other processes never see a partial tile.
+    std::string tmppath = dir + "/" + Filesystem::unique_path() + ".tmp";
+    FILE* f             = Filesystem::fopen(tmppath, "wb");
+    if (!f)
+        return false;
+    uint32_t keylen = uint32_t(key.size());
+    uint64_t size   = tile.memsize();
+    bool ok = (fwrite(disktile_magic, sizeof(disktile_magic), 1, f) == 1
+               && fwrite(&keylen, sizeof(keylen), 1, f) == 1
+               && fwrite(key.data(), 1, keylen, f) == keylen
+               && fwrite(&size, sizeof(size), 1, f) == 1
+               && fwrite(tile.data(), 1, size, f) == size);
+    ok &= (fclose(f) == 0);
+    if (ok)
+        ok = Filesystem::rename(tmppath, dir + "/" + tilename(tile));
+    if (!ok)
+        Filesystem::remove(tmppath);
+    return ok;
+}
+
+
+
+static const char tiletrace_magic[8] = { 'O', 'I', 'I', 'O',
+                                         'T', 'R', 'C', '1' };
+
+enum TileTraceBlock : uint32_t { TraceFileName = 1, TraceTiles = 2 };
+
+
+
+bool
+TileTrace::open(const std::string& filename)
+{
+    close();
+    lock_guard lock(m_mutex);
+    m_file = Filesystem::fopen(filename, "wb");
+    if (!m_file)
+        return false;
+    if (fwrite(tiletrace_magic, sizeof(tiletrace_magic), 1, m_file) != 1) {
+        fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+    m_filename = filename;
+    m_fileindex.clear();
+    m_nthreads = 0;
+    ++m_generation;  // Anything still buffered belongs to an old trace
+    m_start_ns = uint64_t(m_timer() * 1.0e9);
+    m_enabled  = true;
+    return true;
+}
+
+
+
+void
+TileTrace::close()
+{
+    lock_guard lock(m_mutex);
+    m_enabled = false;
+    if (m_file)
+        fclose(m_file);
+    m_file = nullptr;
+    m_filename.clear();
+    m_fileindex.clear();
+}
+
+
+
+void
+TileTrace::record(ImageCachePerThreadInfo* thread_info, const TileID& id)
+{
+    uint64_t now = uint64_t(m_timer() * 1.0e9);
+    spin_lock lock(thread_info->trace_mutex);
+    int generation = m_generation.load();
+    if (thread_info->trace_generation != generation) {
+        // First request of this thread in this trace
+        thread_info->trace_pending.clear();
+        thread_info->trace_generation = generation;
+        thread_info->trace_thread     = m_nthreads++;
+    }
+    uint64_t start = m_start_ns.load();
+    thread_info->trace_pending.emplace_back(id, now > start ? now - start : 0);
+    if (thread_info->trace_pending.size() >= 4096)
+        flush_locked(thread_info);
+}
+
+
+
+void
+TileTrace::flush(ImageCachePerThreadInfo* thread_info)
+{
+    spin_lock lock(thread_info->trace_mutex);
+    flush_locked(thread_info);
+}
+
+
+
+void
+TileTrace::flush_locked(ImageCachePerThreadInfo* thread_info)
+{
+    auto& pending(thread_info->trace_pending);
+    if (pending.empty())
+        return;
+    lock_guard lock(m_mutex);
+    if (!m_file || thread_info->trace_generation != m_generation) {
+        pending.clear();
+        return;
+    }
+    std::vector<TileTraceRecord> records(pending.size());
+    for (size_t i = 0, n = pending.size(); i < n; ++i) {
+        const TileID& id(pending[i].first);
+        auto found = m_fileindex.find(id.file_ptr());
+        if (found == m_fileindex.end()) {
+            // The first time we've seen this file, so name it
+            ustring name = id.file().filename();
+            uint32_t block[2] = { TraceFileName, uint32_t(name.size()) };
+            fwrite(block, sizeof(block), 1, m_file);
+            fwrite(name.data(), 1, name.size(), m_file);
+            found = m_fileindex.emplace(id.file_ptr(), m_fileindex.size())
+                        .first;
+        }
+        TileTraceRecord& r(records[i]);
+        r.time     = pending[i].second;
+        r.file     = found->second;
+        r.thread   = thread_info->trace_thread;
+        r.x        = id.x();
+        r.y        = id.y();
+        r.z        = id.z();
+        r.subimage = id.subimage();
+        r.miplevel = int16_t(id.miplevel());
+        r.chbegin  = int16_t(id.chbegin());
+        r.chend    = int16_t(id.chend());
+    }
+    uint32_t block[2] = { TraceTiles, uint32_t(records.size()) };
+    fwrite(block, sizeof(block), 1, m_file);
+    fwrite(records.data(), sizeof(TileTraceRecord), records.size(), m_file);
+    pending.clear();
+}
+
+
+
+bool
+TileTrace::read(const std::string& filename, std::vector<ustring>& files,
+                std::vector<TileTraceRecord>& records, std::string& err)
+{
+    files.clear();
+    records.clear();
+    FILE* f = Filesystem::fopen(filename, "rb");
+    if (!f) {
+        err = Strutil::fmt::format("Could not open \"{}\"", filename);
+        return false;
+    }
+    char magic[sizeof(tiletrace_magic)];
+    bool ok = (fread(magic, sizeof(magic), 1, f) == 1
+               && !memcmp(magic, tiletrace_magic, sizeof(magic)));
+    uint32_t block[2];
+    while (ok && fread(block, sizeof(block), 1, f) == 1) {
+        if (block[0] == TraceFileName) {
+            std::string name(block[1], '\0');
+            ok = (fread(&name[0], 1, name.size(), f) == name.size());
+            files.emplace_back(name);
+        } else if (block[0] == TraceTiles) {
+            size_t n = records.size();
+            records.resize(n + block[1]);
+            ok = (fread(&records[n], sizeof(TileTraceRecord), block[1], f)
+                  == block[1]);
+            for (size_t i = n; ok && i < records.size(); ++i)
+                ok = (records[i].file < files.size());
+        } else {
+            ok = false;
+        }
+    }
+    fclose(f);
+    if (!ok)
+        err = Strutil::fmt::format("\"{}\" is not a valid tile trace",
+                                   filename);
+    return ok;
+}
+
+
+
 ImageCacheImpl::ImageCacheImpl()
     : m_perthread_info(&cleanup_perthread_info)
 {
@@ -1668,7 +2814,14 @@ ImageCacheImpl::init()
 
 ImageCacheImpl::~ImageCacheImpl()
 {
+    // Let any prefetches still in flight finish before we tear down the
+    // cache they're reading into.
+    m_prefetch_pool.reset();
     printstats();
+    if (m_trace.enabled()) {
+        flush_tile_trace();
+        m_trace.close();
+    }
     erase_perthread_info();
 }
 
@@ -1843,7 +2996,20 @@ ImageCacheImpl::getstats(int level) const
     opt += Strutil::fmt::format(#name "=\"{}\" ", m_##name)
         opt += Strutil::fmt::format("max_memory_MB={:0.1f} ",
                                     m_max_memory_bytes / (1024.0 * 1024.0));
+        if (m_tiletier.enabled())
+            opt += Strutil::fmt::format("max_compressed_memory_MB={:0.1f} ",
+                                        m_tiletier.max_memory()
+                                            / (1024.0 * 1024.0));
         INTOPT(max_open_files);
+        BOOLOPT(access_stats);
+        if (m_degrade_churn > 0.0f) {
+            opt += Strutil::fmt::format("degrade_churn={} ", m_degrade_churn);
+            INTOPT(degrade_max_bias);
+            INTOPT(degrade_max_res);
+            STROPT(degrade_files);
+        }
+        if (m_max_inputs_per_file > 1)
+            INTOPT(max_inputs_per_file);
         INTOPT(autotile);
         INTOPT(autoscanline);
         INTOPT(automip);
@@ -1851,8 +3017,20 @@ ImageCacheImpl::getstats(int level) const
         INTOPT(accept_untiled);
         INTOPT(accept_unmipped);
         INTOPT(deduplicate);
+        BOOLOPT(deduplicate_tiles);
         INTOPT(unassociatedalpha);
         INTOPT(failure_retries);
+        if (m_disktiles.enabled())
+            opt += Strutil::fmt::format("disk_tile_cache=\"{}\" ",
+                                        m_disktiles.directory());
+        if (m_sharedtiles.enabled())
+            opt += Strutil::fmt::format("shared_tile_cache=\"{}\" ",
+                                        m_sharedtiles.name());
+        if (m_cost_eviction)
+            opt += "eviction_policy=\"cost\" ";
+        if (m_trace.enabled())
+            opt += Strutil::fmt::format("tile_trace=\"{}\" ",
+                                        m_trace.filename());
         opt += Strutil::fmt::format("openexr:core={} ",
                                     OIIO::get_int_attribute("openexr:core"));
 #undef BOOLOPT
@@ -1910,22 +3088,100 @@ ImageCacheImpl::getstats(int level) const
                   stats.find_tile_microcache_misses,
                   100.0 * stats.find_tile_microcache_misses
                       / (double)stats.find_tile_calls);
+            if (m_microcache_tiles)
+                print(out, "    micro-cache {}-tile set hits : {} ({:.1f}%)\n",
+                      m_microcache_tiles, stats.find_tile_microcache_nway_hits,
+                      100.0 * stats.find_tile_microcache_nway_hits
+                          / (double)stats.find_tile_calls);
+            if (level >= 2) {
+                // The spread of micro-cache hit rates across threads
+                std::vector<double> rates;
+                {
+                    spin_lock lock(m_perthread_info_mutex);
+                    for (auto p : m_all_perthread_info)
+                        if (p && p->m_stats.find_tile_calls)
+                            rates.push_back(
+                                1.0
+                                - p->m_stats.find_tile_microcache_misses
+                                      / (double)p->m_stats.find_tile_calls);
+                }
+                if (rates.size() > 1) {
+                    std::sort(rates.begin(), rates.end());
+                    print(out,
+                          "    micro-cache hit rate per thread : "
+                          "min {:.1f}%, median {:.1f}%, max {:.1f}% "
+                          "({} threads)\n",
+                          100.0 * rates.front(),
+                          100.0 * rates[rates.size() / 2],
+                          100.0 * rates.back(), rates.size());
+                }
+            }
             print(out, "    main cache misses : {} ({:.1f}%)\n",
                   stats.find_tile_cache_misses,
                   100.0 * stats.find_tile_cache_misses
                       / (double)stats.find_tile_calls);
+            if (stats.tiles_prefetched)
+                print(out, "    tiles prefetched : {}\n",
+                      stats.tiles_prefetched);
+            if (stats.tiles_from_stats)
+                print(out, "    constant tiles filled without reading : {}\n",
+                      stats.tiles_from_stats);
             print(out, "    redundant reads: {} tiles, {}\n",
                   total_redundant_tiles,
                   Strutil::memformat(total_redundant_bytes));
         }
-        print(out, "    Peak cache memory : {}\n",
-              Strutil::memformat(m_mem_used));
+        print(out, "    Peak cache memory : {}\n",
+              Strutil::memformat(m_mem_used));
+        if (m_tilepool.duplicates())
+            print(out, "    Duplicate tiles shared : {} ({} now saved)\n",
+                  m_tilepool.duplicates(),
+                  Strutil::memformat(m_tilepool.memory_saved()));
+        if (m_tiletier.enabled()) {
+            long long tierlookups = stats.tier_hits + stats.tier_misses;
+            print(out,
+                  "    Compressed tier : {} demoted, {} restored ({:.1f}%)\n",
+                  stats.tier_demotions, stats.tier_hits,
+                  tierlookups ? 100.0 * stats.tier_hits / tierlookups : 0.0);
+            print(out, "    Compressed tier memory : {} (ratio {:.2f}:1)\n",
+                  Strutil::memformat(m_tiletier.memory_used()),
+                  m_tiletier.memory_used()
+                      ? double(m_tiletier.raw_memory())
+                            / m_tiletier.memory_used()
+                      : 0.0);
+        }
+        if (m_disktiles.enabled()) {
+            long long disklookups = stats.disk_cache_hits
+                                    + stats.disk_cache_misses;
+            print(out,
+                  "    Disk tile cache : {} hits ({:.1f}%), {} misses, "
+                  "{} tiles written\n",
+                  stats.disk_cache_hits,
+                  disklookups ? 100.0 * stats.disk_cache_hits / disklookups
+                              : 0.0,
+                  stats.disk_cache_misses, stats.disk_cache_writes);
+        }
+        if (m_sharedtiles.enabled()) {
+            long long sharedlookups = stats.shared_hits + stats.shared_misses;
+            print(out, "    Shared tile store \"{}\" : {} hits ({:.1f}%), "
+                       "{} misses\n",
+                  m_sharedtiles.name(), stats.shared_hits,
+                  sharedlookups ? 100.0 * stats.shared_hits / sharedlookups
+                                : 0.0,
+                  stats.shared_misses);
+            print(out, "    Shared tile store memory : {} of {}, {} tiles\n",
+                  Strutil::memformat(m_sharedtiles.memory_used()),
+                  Strutil::memformat(m_sharedtiles.capacity()),
+                  m_sharedtiles.tiles());
+        }
         if (stats.tile_locking_time > 0.001)
             print(out, "    Tile mutex locking time : {}\n",
                   Strutil::timeintervalformat(stats.tile_locking_time));
         if (stats.find_tile_time > 0.001)
             print(out, "    Find tile time : {}\n",
                   Strutil::timeintervalformat(stats.find_tile_time));
+        if (stats.spare_inputs_opened)
+            print(out, "    Spare inputs opened for concurrent reads : {}\n",
+                  stats.spare_inputs_opened);
         if (stats.file_retry_success || stats.tile_retry_success)
             print(out,
                   "    Failure reads followed by unexplained success:"
@@ -2094,8 +3350,92 @@ ImageCacheImpl::reset_stats()
             file->m_tilesread   = 0;
             file->m_bytesread   = 0;
             file->m_iotime      = 0;
+            for (auto& level : file->m_levelstats)
+                level.clear();
+        }
+    }
+}
+
+
+
+bool
+ImageCacheImpl::degradable(ustring filename) const
+{
+    // No pattern means any file may be degraded
+    return m_degrade_files.empty()
+           || std::regex_search(filename.string(), m_degrade_regex);
+}
+
+
+
+void
+ImageCacheImpl::update_mip_bias(bool reread)
+{
+    // Re-reading tiles that we have read before means they were evicted
+    // while still in use, i.e., the cache is thrashing. When too many of a
+    // window's reads are re-reads, bias degradable files' lookups one more
+    // level coarser; when few are, step back toward full resolution. The
+    // gap between the two thresholds keeps the bias from flapping.
+    const int window = 256;
+    if (reread)
+        ++m_churn_rereads;
+    if (++m_churn_reads % window)
+        return;
+    float churn = float(m_churn_rereads.exchange(0)) / window;
+    int bias    = m_mip_bias;
+    if (churn > m_degrade_churn)
+        bias = std::min(bias + 1, m_degrade_max_bias);
+    else if (churn < 0.5f * m_degrade_churn)
+        bias = std::max(bias - 1, 0);
+    m_mip_bias = bias;
+}
+
+
+
+std::string
+ImageCacheImpl::access_stats_json() const
+{
+    using Strutil::fmt::format;
+    std::vector<ImageCacheFileRef> files;
+    for (auto& f : m_files)
+        files.push_back(f.second);
+    std::sort(files.begin(), files.end(), filename_compare);
+
+    std::string out = "{\n  \"files\": [";
+    std::vector<long long> histogram;
+    bool firstfile = true;
+    for (const ImageCacheFileRef& file : files) {
+        const auto& levels(file->levelstats());
+        long long lookups = 0;
+        for (auto& level : levels)
+            lookups += level.lookups;
+        if (!lookups)
+            continue;  // Not used since the stats were enabled or reset
+        out += format("{}\n    {{ \"name\": \"{}\", \"levels\": [",
+                      firstfile ? "" : ",",
+                      Strutil::escape_chars(file->filename()));
+        firstfile = false;
+        if (histogram.size() < levels.size())
+            histogram.resize(levels.size(), 0);
+        for (size_t m = 0; m < levels.size(); ++m) {
+            const auto& level(levels[m]);
+            long long misses = level.misses;
+            histogram[m] += level.lookups;
+            out += format("{}\n      {{ \"level\": {}, \"hits\": {}, "
+                          "\"misses\": {}, \"bytes_read\": {}, "
+                          "\"read_time\": {:.6f}, \"wait_time\": {:.6f} }}",
+                          m ? "," : "", m,
+                          std::max(0LL, level.lookups - misses), misses,
+                          (long long)level.bytesread, level.read_ns * 1.0e-9,
+                          level.wait_ns * 1.0e-9);
         }
+        out += " ] }";
     }
+    out += "\n  ],\n  \"mip_histogram\": [";
+    for (size_t m = 0; m < histogram.size(); ++m)
+        out += format("{}{}", m ? ", " : " ", histogram[m]);
+    out += " ]\n}\n";
+    return out;
 }
 
 
@@ -2211,6 +3551,107 @@ ImageCacheImpl::attribute(string_view name, TypeDesc type, const void* val)
     } else if (name == "max_mip_res" && type == TypeInt) {
         m_max_mip_res = *(const int*)val;
         do_invalidate = true;
+    } else if (name == "prefetch_threads" && type == TypeInt) {
+        int n = std::max(0, *(const int*)val);
+        if (n != m_prefetch_threads) {
+            // Retire the old pool (finishing its queued reads); a new one
+            // of the requested size will be started on demand.
+            std::unique_ptr<thread_pool> oldpool;
+            {
+                spin_lock lock(m_prefetch_pool_mutex);
+                m_prefetch_threads = n;
+                oldpool.swap(m_prefetch_pool);
+            }
+        }
+    } else if (name == "readahead" && type == TypeInt) {
+        m_readahead = std::max(0, *(const int*)val);
+    } else if (name == "get_pixels_threads" && type == TypeInt) {
+        m_get_pixels_threads = std::max(0, *(const int*)val);
+    } else if (name == "tile_stats" && type == TypeInt) {
+        m_use_tile_stats = (*(const int*)val != 0);
+    } else if (name == "deduplicate_tiles" && type == TypeInt) {
+        // Only tiles read from now on are pooled; that's fine.
+        m_deduplicate_tiles = (*(const int*)val != 0);
+    } else if (name == "access_stats" && type == TypeInt) {
+        m_access_stats = (*(const int*)val != 0);
+    } else if (name == "degrade_churn" && type == TypeFloat) {
+        m_degrade_churn = clamp(*(const float*)val, 0.0f, 1.0f);
+        if (m_degrade_churn == 0.0f)
+            m_mip_bias = 0;
+    } else if (name == "degrade_max_bias" && type == TypeInt) {
+        m_degrade_max_bias = clamp(*(const int*)val, 0, 16);
+        if (m_mip_bias > m_degrade_max_bias)
+            m_mip_bias = m_degrade_max_bias;
+    } else if (name == "degrade_max_res" && type == TypeInt) {
+        m_degrade_max_res = std::max(0, *(const int*)val);
+    } else if (name == "degrade_files" && type == TypeDesc::STRING) {
+        std::string pattern(*(const char**)val);
+        try {
+            m_degrade_regex = std::regex(pattern);
+        } catch (const std::regex_error& e) {
+            error("Invalid degrade_files pattern \"{}\": {}", pattern,
+                  e.what());
+            return false;
+        }
+        m_degrade_files = pattern;
+        for (auto& f : m_files)
+            f.second->m_degradable = degradable(f.second->filename());
+    } else if (name == "max_inputs_per_file" && type == TypeInt) {
+        // Existing spares are closed as files are released or invalidated
+        m_max_inputs_per_file = clamp(*(const int*)val, 1, 64);
+    } else if (name == "microcache_tiles" && type == TypeInt) {
+        // Microcached tiles can't be evicted, so keep it small
+        int n = clamp(*(const int*)val, 0, 16);
+        if (n != m_microcache_tiles) {
+            m_microcache_tiles = n;
+            // Each thread resizes its own the next time it looks for a tile
+            purge_perthread_microcaches();
+        }
+    } else if (name == "eviction_policy" && type == TypeDesc::STRING) {
+        string_view policy(*(const char**)val);
+        if (policy == "cost")
+            m_cost_eviction = true;
+        else if (policy == "clock" || policy.empty())
+            m_cost_eviction = false;
+        else
+            error("Unknown eviction_policy \"{}\"", policy);
+    } else if (name == "disk_tile_cache" && type == TypeDesc::STRING) {
+        m_disktiles.set_directory(ustring(*(const char**)val));
+    } else if (name == "tile_trace" && type == TypeDesc::STRING) {
+        string_view tracename(*(const char**)val);
+        if (m_trace.enabled())  // finish the one we were writing
+            flush_tile_trace();
+        if (tracename.empty())
+            m_trace.close();
+        else if (!m_trace.open(tracename))
+            error("Could not open tile trace \"{}\"", tracename);
+    } else if (name == "shared_tile_cache_MB" && type == TypeDesc::FLOAT) {
+        m_shared_tile_cache_MB = std::max(0.0f, *(const float*)val);
+    } else if (name == "shared_tile_cache_MB" && type == TypeDesc::INT) {
+        m_shared_tile_cache_MB = std::max(0, *(const int*)val);
+    } else if (name == "shared_tile_cache_mode" && type == TypeDesc::INT) {
+        m_shared_tile_cache_mode = *(const int*)val & 0777;
+    } else if (name == "shared_tile_cache" && type == TypeDesc::STRING) {
+        string_view shmname(*(const char**)val);
+        if (m_sharedtiles.enabled()) {
+            // Tiles hold pins in the store, so it can't be swapped out.
+            if (shmname != m_sharedtiles.name()
+                && "/" + std::string(shmname) != m_sharedtiles.name())
+                error("shared_tile_cache can't be changed once set");
+        } else if (shmname.size()) {
+            std::string err;
+            if (!m_sharedtiles.open(shmname,
+                                    (long long)(m_shared_tile_cache_MB
+                                                * (1024 * 1024)),
+                                    m_shared_tile_cache_mode, err))
+                error("shared_tile_cache: {}", err);
+        }
+    } else if (name == "max_compressed_memory_MB" && type == TypeDesc::FLOAT) {
+        float size = std::max(0.0f, *(const float*)val);
+        m_tiletier.set_max_memory((long long)(size * (1024 * 1024)));
+    } else if (name == "max_compressed_memory_MB" && type == TypeDesc::INT) {
+        int size = std::max(0, *(const int*)val);
+        m_tiletier.set_max_memory((long long)size * (1024 * 1024));
     } else {
         // Otherwise, unknown name
         return false;
@@ -2249,6 +3690,24 @@ ImageCacheImpl::getattribute(string_view name, TypeDesc type, void* val) const
     ATTR_DECODE("failure_retries", int, m_failure_retries);
     ATTR_DECODE("total_files", int, m_files.size());
     ATTR_DECODE("max_mip_res", int, m_max_mip_res);
+    ATTR_DECODE("prefetch_threads", int, m_prefetch_threads);
+    ATTR_DECODE("readahead", int, m_readahead);
+    ATTR_DECODE("microcache_tiles", int, m_microcache_tiles);
+    ATTR_DECODE("get_pixels_threads", int, m_get_pixels_threads);
+    ATTR_DECODE("max_inputs_per_file", int, m_max_inputs_per_file);
+    ATTR_DECODE("access_stats", int, m_access_stats);
+    ATTR_DECODE("tile_stats", int, m_use_tile_stats);
+    ATTR_DECODE("deduplicate_tiles", int, m_deduplicate_tiles);
+    ATTR_DECODE("degrade_churn", float, m_degrade_churn);
+    ATTR_DECODE("degrade_max_bias", int, m_degrade_max_bias);
+    ATTR_DECODE("degrade_max_res", int, m_degrade_max_res);
+    ATTR_DECODE("shared_tile_cache_MB", float, m_shared_tile_cache_MB);
+    ATTR_DECODE("shared_tile_cache_MB", int, m_shared_tile_cache_MB);
+    ATTR_DECODE("shared_tile_cache_mode", int, m_shared_tile_cache_mode);
+    ATTR_DECODE("max_compressed_memory_MB", float,
+                m_tiletier.max_memory() / (1024.0 * 1024.0));
+    ATTR_DECODE("max_compressed_memory_MB", int,
+                m_tiletier.max_memory() / (1024 * 1024));
 
     // The cases that don't fit in the simple ATTR_DECODE scheme
     if (name == "searchpath" && type == TypeDesc::STRING) {
@@ -2277,6 +3736,40 @@ ImageCacheImpl::getattribute(string_view name, TypeDesc type, void* val) const
         *(const char**)val = m_substitute_image.c_str();
         return true;
     }
+    if (name == "disk_tile_cache" && type == TypeDesc::STRING) {
+        *(const char**)val = m_disktiles.directory().c_str();
+        return true;
+    }
+    if (name == "tile_trace" && type == TypeDesc::STRING) {
+        *(const char**)val = ustring(m_trace.filename()).c_str();
+        return true;
+    }
+    if (name == "degrade_files" && type == TypeDesc::STRING) {
+        *(const char**)val = ustring(m_degrade_files).c_str();
+        return true;
+    }
+    if (name == "stat:mip_histogram" && type.basetype == TypeDesc::INT64
+        && type.is_sized_array()) {
+        // Tile lookups per MIP level, summed over all files
+        long long* hist = (long long*)val;
+        std::fill(hist, hist + type.arraylen, 0LL);
+        for (auto& f : m_files) {
+            const auto& levels(f.second->levelstats());
+            for (int m = 0, e = std::min(int(levels.size()), type.arraylen);
+                 m < e; ++m)
+                hist[m] += levels[m].lookups;
+        }
+        return true;
+    }
+    if (name == "eviction_policy" && type == TypeDesc::STRING) {
+        *(const char**)val
+            = ustring(m_cost_eviction ? "cost" : "clock").c_str();
+        return true;
+    }
+    if (name == "shared_tile_cache" && type == TypeDesc::STRING) {
+        *(const char**)val = m_sharedtiles.name().c_str();
+        return true;
+    }
     if (name == "all_filenames" && type.basetype == TypeDesc::STRING
         && type.is_sized_array()) {
         ustring* names = (ustring*)val;
@@ -2297,6 +3790,11 @@ ImageCacheImpl::getattribute(string_view name, TypeDesc type, void* val) const
         ATTR_DECODE("stat:open_files_created", int, m_stat_open_files_created);
         ATTR_DECODE("stat:open_files_current", int, m_stat_open_files_current);
         ATTR_DECODE("stat:open_files_peak", int, m_stat_open_files_peak);
+        ATTR_DECODE("stat:mip_bias", int, m_mip_bias);
+        ATTR_DECODE("stat:tiles_deduplicated", long long,
+                    m_tilepool.duplicates());
+        ATTR_DECODE("stat:dedup_memory_saved", long long,
+                    m_tilepool.memory_saved());
 
         // All the other stats are those that need to be summed from all
         // the threads.
@@ -2305,14 +3803,35 @@ ImageCacheImpl::getattribute(string_view name, TypeDesc type, void* val) const
         ATTR_DECODE("stat:find_tile_calls", long long, stats.find_tile_calls);
         ATTR_DECODE("stat:find_tile_microcache_misses", long long,
                     stats.find_tile_microcache_misses);
+        ATTR_DECODE("stat:find_tile_microcache_nway_hits", long long,
+                    stats.find_tile_microcache_nway_hits);
         ATTR_DECODE("stat:find_tile_cache_misses", int,
                     stats.find_tile_cache_misses);
+        ATTR_DECODE("stat:tiles_from_stats", long long,
+                    stats.tiles_from_stats);
+        ATTR_DECODE("stat:tiles_prefetched", int, stats.tiles_prefetched);
+        ATTR_DECODE("stat:tier_demotions", long long, stats.tier_demotions);
+        ATTR_DECODE("stat:tier_hits", long long, stats.tier_hits);
+        ATTR_DECODE("stat:tier_misses", long long, stats.tier_misses);
+        ATTR_DECODE("stat:tier_memory_used", long long,
+                    m_tiletier.memory_used());
+        ATTR_DECODE("stat:disk_cache_hits", long long, stats.disk_cache_hits);
+        ATTR_DECODE("stat:disk_cache_misses", long long,
+                    stats.disk_cache_misses);
+        ATTR_DECODE("stat:disk_cache_writes", long long,
+                    stats.disk_cache_writes);
+        ATTR_DECODE("stat:shared_hits", long long, stats.shared_hits);
+        ATTR_DECODE("stat:shared_misses", long long, stats.shared_misses);
+        ATTR_DECODE("stat:shared_memory_used", long long,
+                    m_sharedtiles.memory_used());
         ATTR_DECODE("stat:files_totalsize", long long,
                     stats.files_totalsize);  // Old name
         ATTR_DECODE("stat:image_size", long long, stats.files_totalsize);
         ATTR_DECODE("stat:file_size", long long, stats.files_totalsize_ondisk);
         ATTR_DECODE("stat:bytes_read", long long, stats.bytes_read);
         ATTR_DECODE("stat:unique_files", int, stats.unique_files);
+        ATTR_DECODE("stat:spare_inputs_opened", int,
+                    stats.spare_inputs_opened);
         ATTR_DECODE("stat:fileio_time", float, stats.fileio_time);
         ATTR_DECODE("stat:fileopen_time", float, stats.fileopen_time);
         ATTR_DECODE("stat:file_locking_time", float, stats.file_locking_time);
@@ -2349,27 +3868,33 @@ ImageCacheImpl::find_tile_main_cache(const TileID& id, ImageCacheTileRef& tile,
 #if IMAGECACHE_TIME_STATS
         Timer timer1;
 #endif
-        bool found = m_tilecache.retrieve(id, tile);
+        if (!thread_info->tilecache_reader)
+            thread_info->tilecache_reader = m_tilecache.acquire_reader();
+        bool found = m_tilecache.retrieve(id, tile,
+                                          thread_info->tilecache_reader);
 #if IMAGECACHE_TIME_STATS
         stats.find_tile_time += timer1();
 #endif
         if (found) {
             // We found the tile in the cache, but we need to make sure we
-            // wait until the pixels are ready to read.  We purposely have
-            // released the lock (above) before calling wait_pixels_ready,
-            // otherwise we could deadlock if another thread reading the
-            // pixels needs to lock the cache because it's doing automip.
-            tile->wait_pixels_ready();
+            // wait until the pixels are ready to read.  The lookup itself
+            // holds no locks, so there is no danger of deadlock here if
+            // another thread reading the pixels needs to modify the cache
+            // because it's doing automip.  If it's a prefetched tile that
+            // nobody has started reading yet, we'll just read it now.
+            bool ok = finish_tile_read(tile.get(), thread_info);
             tile->use();
             OIIO_DASSERT(id == tile->id());
             OIIO_DASSERT(tile);
-            return true;
+            return ok;
         }
     }
 
     // The tile was not found in cache.
 
     ++stats.find_tile_cache_misses;
+    if (m_access_stats)
+        ++id.file().levelstats(id.miplevel()).misses;
 
     // Yes, we're creating and reading a tile with no lock -- this is to
     // prevent all the other threads from blocking because of our
@@ -2392,34 +3917,136 @@ bool
 ImageCacheImpl::add_tile_to_cache(ImageCacheTileRef& tile,
                                   ImageCachePerThreadInfo* thread_info)
 {
-    bool ourtile = m_tilecache.insert_retrieve(tile->id(), tile, tile);
+    bool ourtile = m_tilecache.insert_retrieve(tile);
 
     // If we added a new tile to the cache, we may still need to read the
     // pixels; and if we found the tile in cache, we may need to wait for
-    // somebody else to read the pixels.
-    bool ok = true;
-    if (ourtile) {
-        if (!tile->pixels_ready()) {
-            Timer timer;
-            ok              = tile->read(thread_info);
-            double readtime = timer();
-            thread_info->m_stats.fileio_time += readtime;
-            tile->id().file().iotime() += readtime;
-        }
+    // somebody else to read the pixels (or read them ourselves, if it was
+    // prefetched but the read hasn't started yet).
+    bool ok = finish_tile_read(tile.get(), thread_info);
+    if (ourtile)
         check_max_mem(thread_info);
-    } else {
-        // Somebody else already added the tile to the cache before we
-        // could, so we'll use their reference, but we need to wait until it
-        // has read in the pixels.
+    return ok;
+}
+
+
+
+bool
+ImageCacheImpl::finish_tile_read(ImageCacheTile* tile,
+                                 ImageCachePerThreadInfo* thread_info)
+{
+    if (tile->pixels_ready())
+        return true;
+    if (!tile->claim_read()) {
+        // Somebody else is already reading it.
+        Timer timer;
         tile->wait_pixels_ready();
+        double wait = timer();
+        thread_info->m_stats.tile_locking_time += wait;
+        if (m_access_stats)
+            tile->id().file().levelstats(tile->id().miplevel()).wait_ns
+                += (long long)(wait * 1.0e9);
+        return true;
+    }
+    return load_tile_pixels(tile, thread_info);
+}
+
+
+
+bool
+ImageCacheImpl::load_tile_pixels(ImageCacheTile* tile,
+                                 ImageCachePerThreadInfo* thread_info)
+{
+    bool ok = fetch_tile_pixels(tile, thread_info);
+    if (m_cost_eviction)
+        tile->set_cost(tile_cost(tile->file()));
+    return ok;
+}
+
+
+
+int
+ImageCacheImpl::tile_cost(const ImageCacheFile& file) const
+{
+    // Each doubling of the cost of reading a tile over the average buys
+    // another pass of the clock, up to a limit so that even expensive
+    // tiles that are never used again do eventually go.
+    const int max_cost = 8;
+    // Both averages are of decode time alone, so that opening files and
+    // tiles restored from a cache tier don't skew them.
+    long long count = m_tileread_count;
+    double fileavg  = file.decode_time_per_tile();
+    if (count < 16 || !fileavg)
+        return 1;  // Not enough to go on yet
+    double avg = m_tileread_ns * 1.0e-9 / count;
+    if (!(fileavg > avg))
+        return 1;
+    return std::min(1 + int(std::log2(fileavg / avg) + 0.5), max_cost);
+}
+
+
+
+bool
+ImageCacheImpl::fetch_tile_pixels(ImageCacheTile* tile,
+                                  ImageCachePerThreadInfo* thread_info)
+{
+    if (m_tiletier.enabled()) {
+        if (m_tiletier.restore(*tile)) {
+            ++thread_info->m_stats.tier_hits;
+            return true;
+        }
+        ++thread_info->m_stats.tier_misses;
+    }
+    // With a shared tile store, the pixels either are already there (put
+    // there by this or another process), or they go there as we read them.
+    SharedTilePin pin;
+    if (m_sharedtiles.enabled()) {
+        pin = m_sharedtiles.acquire(*tile);
+        if (pin.pixels)
+            tile->set_shared_slot(&m_sharedtiles, pin.slot);
+        if (pin.ready) {
+            tile->adopt_pixels(pin.pixels, tile->memsize_needed());
+            ++thread_info->m_stats.shared_hits;
+            return true;
+        }
+        ++thread_info->m_stats.shared_misses;
+    }
+    Timer timer;
+    bool ok = false, fromdisk = false;
+    if (m_disktiles.enabled()) {
+        fromdisk = ok = m_disktiles.restore(*tile, pin.pixels);
+        if (fromdisk)
+            ++thread_info->m_stats.disk_cache_hits;
+        else
+            ++thread_info->m_stats.disk_cache_misses;
     }
+    if (!fromdisk) {
+        Timer decodetimer;
+        ok = tile->read(thread_info, pin.pixels);
+        if (ok) {
+            double decodetime = decodetimer();
+            tile->id().file().note_decode(decodetime);
+            m_tileread_ns += (long long)(decodetime * 1.0e9);
+            ++m_tileread_count;
+        }
+        if (ok && m_disktiles.enabled() && m_disktiles.store(*tile))
+            ++thread_info->m_stats.disk_cache_writes;
+    }
+    if (pin.pixels)
+        m_sharedtiles.finish_fill(pin, ok);
+    double readtime = timer();
+    thread_info->m_stats.fileio_time += readtime;
+    tile->id().file().iotime() += readtime;
+    if (m_access_stats)
+        tile->id().file().levelstats(tile->id().miplevel()).read_ns
+            += (long long)(readtime * 1.0e9);
     return ok;
 }
 
 
 
 void
-ImageCacheImpl::check_max_mem(ImageCachePerThreadInfo* /*thread_info*/)
+ImageCacheImpl::check_max_mem(ImageCachePerThreadInfo* thread_info)
 {
     OIIO_DASSERT(m_mem_used < (long long)m_max_memory_bytes * 10);  // sanity
 #if 0
@@ -2434,83 +4061,24 @@ ImageCacheImpl::check_max_mem(ImageCachePerThreadInfo* /*thread_info*/)
     if (m_mem_used < (long long)m_max_memory_bytes)
         return;
 
-    // Try to grab the tile_sweep_mutex lock. If somebody else holds it,
-    // just return -- leave the memory limit enforcement to whomever is
-    // already in this function, no need for two threads to do it at
-    // once.  If this means we may ephemerally be over the memory limit
-    // (because another thread adds a tile before we have freed enough
-    // here), so be it.
-    if (!m_tile_sweep_mutex.try_lock())
+    // Release tiles until we're back under the limit.  The tile cache
+    // does this one shard at a time, so other threads are only ever held
+    // up if they need the very shard being swept, and threads that find
+    // the limit exceeded at the same time share the work.
+    long long excess = m_mem_used - (long long)m_max_memory_bytes;
+    if (!m_tiletier.enabled()) {
+        m_tilecache.evict(excess);
         return;
-
-    // Now, what we want to do is have a "clock hand" that sweeps across
-    // the cache, releasing tiles that haven't been used for a long
-    // time.  Because of multi-thread, rather than keep an iterator
-    // around for this (which could be invalidated since the last time
-    // we used it), we just remember the tileID of the next tile to
-    // check, then look it up fresh.  That is m_tile_sweep_id.
-
-    // Get a (locked) iterator for the next tile to be examined.
-    TileCache::iterator sweep;
-    if (!m_tile_sweep_id.empty()) {
-        // We saved the sweep_id. Find the iterator corresponding to it.
-        sweep = m_tilecache.find(m_tile_sweep_id);
-        // Note: if the sweep_id is no longer in the table, sweep will be an
-        // empty iterator. That's ok, it will be fixed early in the main
-        // loop below.
-    }
-
-    // Loop while we still use too much tile memory.  Also, be careful
-    // of looping for too long, exit the loop if we just keep spinning
-    // uncontrollably.
-    int full_loops = 0;
-    while (m_mem_used >= (long long)m_max_memory_bytes && full_loops < 100) {
-        // If we have fallen off the end of the cache, loop back to the
-        // beginning and increment our full_loops count.
-        if (!sweep) {
-            sweep = m_tilecache.begin();
-            ++full_loops;
-        }
-        // If we're STILL at the end, it must be that somehow the entire
-        // cache is empty.  So just declare ourselves done.
-        if (!sweep)
-            break;
-        OIIO_DASSERT(sweep->second);
-
-        if (!sweep->second->release()) {
-            // This is a tile we should delete.  To keep iterating
-            // safely, we have a good trick:
-            // 1. remember the TileID of the tile to delete
-            TileID todelete = sweep->first;
-            size_t size     = sweep->second->memsize();
-            OIIO_DASSERT(m_mem_used >= (long long)size);
-            // 2. Find the TileID of the NEXT item. We do this by
-            // incrementing the sweep iterator and grabbing its id.
-            ++sweep;
-            m_tile_sweep_id = (sweep ? sweep->first : TileID());
-            // 3. Release the bin lock and erase the tile we wish to delete.
-            sweep.unlock();
-            m_tilecache.erase(todelete);
-            // 4. Re-establish a locked iterator for the next item, since
-            // the old iterator may have been invalidated by the erasure.
-            if (!m_tile_sweep_id.empty())
-                sweep = m_tilecache.find(m_tile_sweep_id);
-        } else {
-            ++sweep;
-        }
     }
 
-    // OK, by this point we have either freed enough tiles to be below
-    // the limit again, or the cache is empty, or we've looped over the
-    // cache too many times and are giving up.
-
-    // Now we must save the tileid for next time.  Just set it to an
-    // empty ID if we don't have a valid iterator at this point.
-    m_tile_sweep_id = (sweep ? sweep->first : TileID());
-    m_tile_sweep_mutex.unlock();
-
-    // N.B. As we exit, the iterators will go out of scope and we will
-    // retain no locks on the cache.
+    // With a compressed tier, the evicted tiles are demoted into it
+    // (after the cache has let go of its locks) rather than simply
+    // dropped.
+    std::vector<ImageCacheTileRef> evicted;
+    m_tilecache.evict(excess, &evicted);
+    for (const ImageCacheTileRef& tile : evicted)
+        if (m_tiletier.demote(*tile))
+            ++thread_info->m_stats.tier_demotions;
 }
 
 
@@ -2597,6 +4165,39 @@ ImageCacheImpl::get_image_info(ImageCacheFile* file,
         ATTR_DECODE("stat:image_size", long long, file->m_total_imagesize);
         ATTR_DECODE("stat:file_size", long long,
                     file->m_total_imagesize_ondisk);
+        if (datatype.is_sized_array()
+            && (datatype.basetype == TypeDesc::INT64
+                || datatype.basetype == TypeDesc::FLOAT)) {
+            // Per-MIP-level access stats, one array element per level
+            using Level = ImageCacheFile::LevelAccessStats;
+            const atomic_ll Level::*field = nullptr;
+            if (datatype.basetype == TypeDesc::INT64) {
+                if (dataname == "stat:mip_lookups")
+                    field = &Level::lookups;
+                else if (dataname == "stat:mip_misses")
+                    field = &Level::misses;
+                else if (dataname == "stat:mip_bytesread")
+                    field = &Level::bytesread;
+            } else {
+                if (dataname == "stat:mip_readtime")
+                    field = &Level::read_ns;
+                else if (dataname == "stat:mip_waittime")
+                    field = &Level::wait_ns;
+            }
+            if (field) {
+                const auto& levels(file->levelstats());
+                for (int m = 0; m < datatype.arraylen; ++m) {
+                    long long v = 0;
+                    if (m < int(levels.size()))
+                        v = (levels[m].*field).load();
+                    if (datatype.basetype == TypeDesc::INT64)
+                        ((long long*)data)[m] = v;
+                    else
+                        ((float*)data)[m] = float(v * 1.0e-9);
+                }
+                return true;
+            }
+        }
     }
 
     if (file->broken()) {
@@ -3037,7 +4638,6 @@ ImageCacheImpl::get_pixels(ImageCacheFile* file,
     if (!thread_info)
         thread_info = get_perthread_info();
     const ImageSpec& spec(file->spec(subimage, miplevel));
-    bool ok = true;
 
     // Compute channels and stride if not given (assume all channels,
     // contiguous data layout for strides).
@@ -3051,10 +4651,87 @@ ImageCacheImpl::get_pixels(ImageCacheFile* file,
         cache_chbegin = 0;
         cache_chend   = spec.nchannels;
     }
-    int cache_nchans = cache_chend - cache_chbegin;
+    if (m_readahead > 0)
+        readahead(file, thread_info, subimage, miplevel, xbegin, xend, ybegin,
+                  yend, zbegin, zend, cache_chbegin, cache_chend);
     ImageSpec::auto_stride(xstride, ystride, zstride, format, result_nchans,
                            xend - xbegin, yend - ybegin);
 
+    // A request spanning many tiles is split at tile boundaries into
+    // pieces that are read (if need be) and copied in parallel, each by
+    // whichever thread takes it, using that thread's own per-thread info.
+    auto tilebegin = [](int v, int origin, int size) {
+        int d = v - origin;
+        return origin + (d >= 0 ? d / size : (d - size + 1) / size) * size;
+    };
+    const int tw = spec.tile_width, th = spec.tile_height;
+    const int td = spec.tile_depth;
+    const int x0 = tilebegin(xbegin, spec.x, tw);
+    const int y0 = tilebegin(ybegin, spec.y, th);
+    const int z0 = tilebegin(zbegin, spec.z, td);
+    const int64_t ntx     = (xend - x0 + tw - 1) / tw;
+    const int64_t nty     = (yend - y0 + th - 1) / th;
+    const int64_t ntz     = (zend - z0 + td - 1) / td;
+    const int64_t npixels = int64_t(xend - xbegin) * (yend - ybegin)
+                            * (zend - zbegin);
+    if (m_get_pixels_threads == 1 || xend <= xbegin || yend <= ybegin
+        || zend <= zbegin || ntx * nty * ntz < 4 || npixels < 16384)
+        return get_pixels_tiles(file, thread_info, subimage, miplevel, xbegin,
+                                xend, ybegin, yend, zbegin, zend, chbegin,
+                                chend, format, result, xstride, ystride,
+                                zstride, cache_chbegin, cache_chend);
+
+    std::atomic<bool> ok(true);
+    spin_mutex errmutex;
+    std::string errors;
+    parallel_options opt(m_get_pixels_threads, Split_Y, 1);
+    parallel_for(
+        0, ntx * nty * ntz,
+        [&](int64_t t) {
+            int xb = std::max(xbegin, x0 + int(t % ntx) * tw);
+            int yb = std::max(ybegin, y0 + int((t / ntx) % nty) * th);
+            int zb = std::max(zbegin, z0 + int(t / (ntx * nty)) * td);
+            int xe = std::min(xend, tilebegin(xb, spec.x, tw) + tw);
+            int ye = std::min(yend, tilebegin(yb, spec.y, th) + th);
+            int ze = std::min(zend, tilebegin(zb, spec.z, td) + td);
+            char* ptr = (char*)result + (xb - xbegin) * xstride
+                        + (yb - ybegin) * ystride + (zb - zbegin) * zstride;
+            if (!get_pixels_tiles(file, get_perthread_info(), subimage,
+                                  miplevel, xb, xe, yb, ye, zb, ze, chbegin,
+                                  chend, format, ptr, xstride, ystride,
+                                  zstride, cache_chbegin, cache_chend)) {
+                // Errors are per-thread, so pass them on to the caller's.
+                std::string err = geterror();
+                spin_lock lock(errmutex);
+                if (err.size() && errors.find(err) == std::string::npos)
+                    errors += (errors.size() ? "\n" : "") + err;
+                ok = false;
+            }
+        },
+        opt);
+    if (errors.size())
+        append_error(errors);
+    return ok;
+}
+
+
+
+bool
+ImageCacheImpl::get_pixels_tiles(ImageCacheFile* file,
+                                 ImageCachePerThreadInfo* thread_info,
+                                 int subimage, int miplevel, int xbegin,
+                                 int xend, int ybegin, int yend, int zbegin,
+                                 int zend, int chbegin, int chend,
+                                 TypeDesc format, void* result,
+                                 stride_t xstride, stride_t ystride,
+                                 stride_t zstride, int cache_chbegin,
+                                 int cache_chend)
+{
+    const ImageSpec& spec(file->spec(subimage, miplevel));
+    bool ok           = true;
+    int result_nchans = chend - chbegin;
+    int cache_nchans  = cache_chend - cache_chbegin;
+
     // result_pixelsize, scanlinesize, and zplanesize assume contiguous
     // layout.  This may or may not be the same as the strides passed by
     // the caller.
@@ -3164,6 +4841,212 @@ ImageCacheImpl::get_pixels(ImageCacheFile* file,
 
 
 
+bool
+ImageCacheImpl::prefetch(ustring filename, int subimage, int miplevel, ROI roi,
+                         int chbegin, int chend)
+{
+    ImageCachePerThreadInfo* thread_info = get_perthread_info();
+    ImageCacheFile* file                 = find_file(filename, thread_info);
+    if (!file) {
+        error("Image file \"{}\" not found", filename);
+        return false;
+    }
+    return prefetch(file, thread_info, subimage, miplevel, roi, chbegin,
+                    chend);
+}
+
+
+
+bool
+ImageCacheImpl::prefetch(ImageHandle* file, Perthread* thread_info,
+                         int subimage, int miplevel, ROI roi, int chbegin,
+                         int chend)
+{
+    if (!thread_info)
+        thread_info = get_perthread_info();
+    file = verify_file(file, thread_info);
+    if (!file || file->broken() || file->is_udim())
+        return false;
+    if (subimage < 0 || subimage >= file->subimages() || miplevel < 0
+        || miplevel >= file->miplevels(subimage)) {
+        if (file->errors_should_issue())
+            error("prefetch asked for nonexistent subimage {} MIP level {}"
+                  " of \"{}\"",
+                  subimage, miplevel, file->filename());
+        return false;
+    }
+    if (m_prefetch_threads < 1)
+        return true;  // Prefetching is turned off
+
+    const ImageSpec& spec(file->spec(subimage, miplevel));
+    ROI dataroi = get_roi(spec);
+    roi         = roi.defined() ? roi_intersection(roi, dataroi) : dataroi;
+    if (chend < chbegin) {  // chend < chbegin means "all channels."
+        chbegin = 0;
+        chend   = spec.nchannels;
+    }
+    // Snap the region to the tile grid and queue each tile in it.
+    int x0 = roi.xbegin - (roi.xbegin - spec.x) % spec.tile_width;
+    int y0 = roi.ybegin - (roi.ybegin - spec.y) % spec.tile_height;
+    int z0 = roi.zbegin - (roi.zbegin - spec.z) % spec.tile_depth;
+    for (int z = z0; z < roi.zend; z += spec.tile_depth)
+        for (int y = y0; y < roi.yend; y += spec.tile_height)
+            for (int x = x0; x < roi.xend; x += spec.tile_width)
+                prefetch_tile(TileID(*file, subimage, miplevel, x, y, z,
+                                     chbegin, chend),
+                              thread_info);
+    return true;
+}
+
+
+
+std::vector<ImageCacheFile*>
+ImageCacheImpl::preload(cspan<ustring> filenames)
+{
+    std::vector<ImageCacheFile*> handles(filenames.size(), nullptr);
+    // Every file we open counts against max_open_files, and a thread may
+    // be holding more than one of them (or several ImageInputs for one,
+    // up to max_inputs_per_file), so use no more than half that many
+    // threads to avoid sweeping out files that were just opened.
+    parallel_options opt(std::max(1, m_max_open_files / 2), Split_Y, 1);
+    parallel_for(
+        0, int64_t(filenames.size()),
+        [&](int64_t i) {
+            ImageCachePerThreadInfo* thread_info = get_perthread_info();
+            ImageCacheFile* file = find_file(filenames[i], thread_info);
+            if (file && file->is_udim())
+                prewarm_udim(file, thread_info);
+            handles[i] = verify_file(file, thread_info);
+        },
+        opt);
+    return handles;
+}
+
+
+
+thread_pool*
+ImageCacheImpl::prefetch_pool()
+{
+    spin_lock lock(m_prefetch_pool_mutex);
+    if (!m_prefetch_pool)
+        m_prefetch_pool.reset(new thread_pool(m_prefetch_threads));
+    return m_prefetch_pool.get();
+}
+
+
+
+void
+ImageCacheImpl::prefetch_tile(const TileID& id,
+                              ImageCachePerThreadInfo* thread_info)
+{
+    if (!thread_info->tilecache_reader)
+        thread_info->tilecache_reader = m_tilecache.acquire_reader();
+    ImageCacheTileRef tile;
+    if (m_tilecache.retrieve(id, tile, thread_info->tilecache_reader))
+        return;  // Already in the cache, or on its way
+
+    // Put the tile in the cache now, before its pixels are read, so that
+    // anybody who needs it in the meantime will find it there and wait
+    // for (or take over) the read rather than start another one.
+    tile = new ImageCacheTile(id);
+    if (!m_tilecache.insert_retrieve(tile))
+        return;  // Somebody else beat us to it
+    ++thread_info->m_stats.tiles_prefetched;
+
+    // N.B. The task holds a reference to the tile, so it remains valid
+    // even if it is invalidated out of the cache before it is read.
+    prefetch_pool()->push([this, tile](int /*id*/) {
+        if (!tile->claim_read())
+            return;  // A thread that needed it sooner got to it first
+        ImageCachePerThreadInfo* thread_info = get_perthread_info();
+        // N.B. A failed read leaves the tile marked invalid, which is what
+        // the lookups that eventually use it will see.
+        (void)load_tile_pixels(tile.get(), thread_info);
+        check_max_mem(thread_info);
+    });
+}
+
+
+
+void
+ImageCacheImpl::readahead(ImageCacheFile* file,
+                          ImageCachePerThreadInfo* thread_info, int subimage,
+                          int miplevel, int xbegin, int xend, int ybegin,
+                          int yend, int zbegin, int zend, int chbegin,
+                          int chend)
+{
+    // A request that starts where this thread's previous request of the
+    // same image left off is taken to be part of a sweep down the image.
+    ImageCachePerThreadInfo::Readahead& ra(thread_info->readahead);
+    bool sweeping = (file == ra.file && subimage == ra.subimage
+                     && miplevel == ra.miplevel && ybegin == ra.ynext);
+    if (!sweeping) {
+        ra.file     = file;
+        ra.subimage = subimage;
+        ra.miplevel = miplevel;
+        ra.yqueued  = yend;
+    }
+    ra.ynext = yend;
+    if (!sweeping)
+        return;
+
+    // Keep the next m_readahead rows of tiles past the end of this
+    // request on their way, asking only for the rows not yet requested.
+    const ImageSpec& spec(file->spec(subimage, miplevel));
+    int ylast = spec.y + spec.height;
+    if (yend < spec.y || yend >= ylast)
+        return;
+    int ty     = yend - (yend - spec.y) % spec.tile_height;
+    int yahead = std::min(ty + m_readahead * spec.tile_height, ylast);
+    if (yahead <= ra.yqueued)
+        return;
+    ROI roi(xbegin, xend, std::max(ty, ra.yqueued), yahead, zbegin, zend);
+    ra.yqueued = yahead;
+    prefetch(file, thread_info, subimage, miplevel, roi, chbegin, chend);
+}
+
+
+
+bool
+ImageCacheImpl::get_tile_stats(ustring filename, int subimage, int miplevel,
+                               int x, int y, int z, int chbegin, int chend,
+                               float* min, float* max, float* avg)
+{
+    ImageCachePerThreadInfo* thread_info = get_perthread_info();
+    ImageCacheFile* file                 = find_file(filename, thread_info);
+    return get_tile_stats(file, thread_info, subimage, miplevel, x, y, z,
+                          chbegin, chend, min, max, avg);
+}
+
+
+
+bool
+ImageCacheImpl::get_tile_stats(ImageHandle* file, Perthread* thread_info,
+                               int subimage, int miplevel, int x, int y,
+                               int z, int chbegin, int chend, float* min,
+                               float* max, float* avg)
+{
+    if (!thread_info)
+        thread_info = get_perthread_info();
+    file = verify_file(file, thread_info, true);
+    if (!file || file->broken() || file->is_udim())
+        return false;
+    if (subimage < 0 || subimage >= file->subimages() || miplevel < 0
+        || miplevel >= file->miplevels(subimage))
+        return false;
+    const ImageCacheFile::LevelInfo& lev(
+        file->levelinfo(subimage, miplevel));
+    if (chend < chbegin) {  // chend < chbegin means "all channels."
+        chbegin = 0;
+        chend   = lev.spec.nchannels;
+    }
+    chbegin = clamp(chbegin, 0, lev.spec.nchannels);
+    chend   = clamp(chend, chbegin, lev.spec.nchannels);
+    return lev.tile_stats(x, y, z, chbegin, chend, min, max, avg);
+}
+
+
+
 ImageCache::Tile*
 ImageCacheImpl::get_tile(ustring filename, int subimage, int miplevel, int x,
                          int y, int z, int chbegin, int chend)
@@ -3337,19 +5220,10 @@ ImageCacheImpl::invalidate(ImageHandle* handle, bool force)
             return;
     }
 
-    // Iterate over the entire tilecache, record the TileID's of all
-    // tiles that are from the file we are invalidating.
-    std::vector<TileID> tiles_to_delete;
-    for (TileCache::iterator tci = m_tilecache.begin(), e = m_tilecache.end();
-         tci != e; ++tci) {
-        if (&(*tci).second->file() == file)
-            tiles_to_delete.push_back((*tci).second->id());
-    }
-    // N.B. at this point, we hold no locks!
-
-    // Safely erase all the tiles we found
-    for (const TileID& id : tiles_to_delete)
-        m_tilecache.erase(id);
+    // Remove all the tiles that are from the file we are invalidating.
+    m_tilecache.erase_if(
+        [&](const ImageCacheTile& tile) { return &tile.file() == file; });
+    m_tiletier.erase_if([&](const TileID& id) { return &id.file() == file; });
 
     const ustring fingerprint = file->fingerprint();
 
@@ -3374,13 +5248,8 @@ ImageCacheImpl::invalidate_all(bool force)
     // to do it all in one shot.
     if (force) {
         // Clear the whole tile cache
-        std::vector<TileID> tiles_to_delete;
-        for (TileCache::iterator t = m_tilecache.begin(), e = m_tilecache.end();
-             t != e; ++t) {
-            tiles_to_delete.push_back(t->second->id());
-        }
-        for (const TileID& id : tiles_to_delete)
-            m_tilecache.erase(id);
+        m_tilecache.erase_if([](const ImageCacheTile&) { return true; });
+        m_tiletier.erase_if([](const TileID&) { return true; });
         // Invalidate (close and clear spec) all individual files
         for (FilenameMap::iterator fileit = m_files.begin(), e = m_files.end();
              fileit != e; ++fileit) {
@@ -3474,15 +5343,6 @@ ImageCacheImpl::close_all()
 
 
 
-namespace {
-    // Mutex to protect all the UDIM table access.
-    static mutex_pool<spin_rw_mutex, ustring, ustringHash, 8>
-        udim_lookup_mutex_pool;
-    // static spin_rw_mutex udim_lookup_mutex;
-}  // namespace
-
-
-
 void
 ImageCacheFile::udim_setup()
 {
@@ -3649,7 +5509,8 @@ ImageCacheImpl::resolve_udim(ImageCacheFile* udimfile, Perthread* thread_info,
     // If udimfile exists, then we've already inventoried the matching
     // files and filled in udimfile->udim_lookup. That vector, and the
     // filename fields, are set and can be accessed without locks. The
-    // `ImageCacheFile*` within it, however, should use rw lock access.
+    // `ImageCacheFile*` within it is atomic, and only ever changes from
+    // null to the file, so it needs no lock either.
     int index = utile + vtile * udimfile->m_udim_nutiles;
     OIIO_DASSERT(index >= 0 && size_t(index) < udimfile->m_udim_lookup.size());
     UdimInfo& udiminfo(udimfile->m_udim_lookup[index]);
@@ -3658,29 +5519,40 @@ ImageCacheImpl::resolve_udim(ImageCacheFile* udimfile, Perthread* thread_info,
     if (udiminfo.filename.empty())
         return nullptr;
 
-    // Which is our mutex from the pool? Use a hash baseed on the filename.
-    spin_rw_mutex& udim_lookup_mutex(
-        udim_lookup_mutex_pool[udimfile->filename()]);
-
-    // First, try a read lock and see if we already have an entry
-    ImageCacheFile* realfile = nullptr;
-    {
-        spin_rw_mutex::read_lock_guard rlock(udim_lookup_mutex);
-        realfile = udiminfo.icfile;
-    }
-    // If that didn't work, get a write lock and we'll make the entry for
-    // the first time.
+    ImageCacheFile* realfile = udiminfo.icfile.load(std::memory_order_acquire);
+    // If we haven't resolved this tile yet, do so now. Threads racing to
+    // do it will all get the same answer from find_file, so whichever
+    // stores it last changes nothing.
     if (!realfile) {
         realfile = find_file(udiminfo.filename, thread_info);
-        // Grab the actual write lock to change the `ImageCacheFile*`.
-        spin_rw_mutex::write_lock_guard rlock(udim_lookup_mutex);
-        udiminfo.icfile = realfile;
+        udiminfo.icfile.store(realfile, std::memory_order_release);
     }
     return realfile;
 }
 
 
 
+void
+ImageCacheImpl::prewarm_udim(ImageCacheFile* udimfile,
+                             Perthread* /*thread_info*/)
+{
+    if (!udimfile || !udimfile->is_udim())
+        return;
+    // The table of tiles is fixed once the udim file exists, so it's safe
+    // to iterate over without locking.
+    std::vector<UdimInfo>& lookup(udimfile->m_udim_lookup);
+    parallel_for(0, int64_t(lookup.size()), [&](int64_t i) {
+        if (lookup[i].filename.empty())
+            return;  // unpopulated tile
+        ImageCachePerThreadInfo* ti = get_perthread_info();
+        ImageCacheFile* file = resolve_udim(udimfile, ti, lookup[i].u,
+                                            lookup[i].v);
+        verify_file(file, ti, true /*header_only*/);
+    });
+}
+
+
+
 void
 ImageCacheImpl::inventory_udim(ImageCacheFile* udimfile, Perthread* thread_info,
                                std::vector<ustring>& filenames, int& nutiles,
@@ -3728,6 +5600,7 @@ ImageCacheImpl::destroy_thread_info(ImageCachePerThreadInfo* thread_info)
             break;
         }
     }
+    TileCache::release_reader(thread_info->tilecache_reader);
     delete thread_info;
 }
 
@@ -3740,6 +5613,7 @@ ImageCacheImpl::get_perthread_info(ImageCachePerThreadInfo* p)
         p = m_perthread_info.get();
     if (!p) {
         p = new ImageCachePerThreadInfo;
+        p->reset_microcache(m_microcache_tiles);
         m_perthread_info.reset(p);
         // printf ("New perthread %p\n", (void *)p);
         spin_lock lock(m_perthread_info_mutex);
@@ -3749,9 +5623,8 @@ ImageCacheImpl::get_perthread_info(ImageCachePerThreadInfo* p)
     if (p->purge) {  // has somebody requested a tile purge?
         // This is safe, because it's our thread.
         spin_lock lock(m_perthread_info_mutex);
-        p->tile     = NULL;
-        p->lasttile = NULL;
-        p->purge    = 0;
+        p->reset_microcache(m_microcache_tiles);
+        p->purge = 0;
         p->m_thread_files.clear();
     }
     return p;
@@ -3767,8 +5640,10 @@ ImageCacheImpl::erase_perthread_info()
         ImageCachePerThreadInfo* p = m_all_perthread_info[i];
         if (p) {
             // Clear the microcache.
-            p->tile     = NULL;
-            p->lasttile = NULL;
+            p->reset_microcache(0);
+            // The readers belong to our tile cache, which is going away.
+            TileCache::release_reader(p->tilecache_reader);
+            p->tilecache_reader = nullptr;
             if (p->shared) {
                 // Pointed to by both thread-specific-ptr and our list.
                 // Just remove from out list, then ownership is only
@@ -3791,8 +5666,9 @@ ImageCacheImpl::cleanup_perthread_info(ImageCachePerThreadInfo* p)
     spin_lock lock(m_perthread_info_mutex);
     if (p) {
         // Clear the microcache.
-        p->tile     = NULL;
-        p->lasttile = NULL;
+        p->reset_microcache(0);
+        TileCache::release_reader(p->tilecache_reader);
+        p->tilecache_reader = nullptr;
         if (!p->shared)  // If we own it, delete it
             delete p;
         else
@@ -3802,6 +5678,17 @@ ImageCacheImpl::cleanup_perthread_info(ImageCachePerThreadInfo* p)
 
 
 
+void
+ImageCacheImpl::flush_tile_trace()
+{
+    spin_lock lock(m_perthread_info_mutex);
+    for (auto p : m_all_perthread_info)
+        if (p)
+            m_trace.flush(p);
+}
+
+
+
 void
 ImageCacheImpl::purge_perthread_microcaches()
 {
@@ -10,6 +10,10 @@
 #ifndef OPENIMAGEIO_IMAGECACHE_PVT_H
 #define OPENIMAGEIO_IMAGECACHE_PVT_H
 
+#include <deque>
+#include <regex>
+#include <unordered_map>
+
 #include <tsl/robin_map.h>
 
 #include <boost/container/flat_map.hpp>
@@ -41,11 +45,15 @@ namespace pvt {
 
 #define FILE_CACHE_SHARDS 64
 #define TILE_CACHE_SHARDS 128
+#define TILE_TIER_SHARDS 32
+#define TILE_POOL_SHARDS 32
 
 using boost::thread_specific_ptr;
 
 class ImageCacheImpl;
 class ImageCachePerThreadInfo;
+class SharedTileStore;
+struct PooledTilePixels;
 
 const char*
 texture_format_name(TexFormat f);
@@ -63,7 +71,18 @@ struct ImageCacheStatistics {
     // First, the ImageCache-specific fields:
     long long find_tile_calls;
     long long find_tile_microcache_misses;
+    long long find_tile_microcache_nway_hits;
     int find_tile_cache_misses;
+    long long tiles_from_stats;
+    long long tiles_prefetched;
+    long long tier_demotions;
+    long long tier_hits;
+    long long tier_misses;
+    long long disk_cache_hits;
+    long long disk_cache_misses;
+    long long disk_cache_writes;
+    long long shared_hits;
+    long long shared_misses;
     long long files_totalsize;
     long long files_totalsize_ondisk;
     long long bytes_read;
@@ -101,6 +120,7 @@ struct ImageCacheStatistics {
     long long cubic_interps;
     int file_retry_success;
     int tile_retry_success;
+    int spare_inputs_opened;
 
     ImageCacheStatistics() { init(); }
     void init();
@@ -111,13 +131,12 @@ struct ImageCacheStatistics {
 
 struct UdimInfo {
     ustring filename;
-    ImageCacheFile* icfile = nullptr;
+    // Null until the tile is first resolved, then never changes again, so
+    // it may be read without locking.
+    std::atomic<ImageCacheFile*> icfile { nullptr };
     int u, v;
 
-    UdimInfo()
-        : icfile(nullptr)
-    {
-    }
+    UdimInfo() {}
     UdimInfo(ustring filename, ImageCacheFile* icfile, int u, int v)
         : filename(filename)
         , icfile(icfile)
@@ -125,6 +144,22 @@ struct UdimInfo {
         , v(v)
     {
     }
+    // Copyable (for building the table), despite the atomic.
+    UdimInfo(const UdimInfo& other)
+        : filename(other.filename)
+        , icfile(other.icfile.load())
+        , u(other.u)
+        , v(other.v)
+    {
+    }
+    UdimInfo& operator=(const UdimInfo& other)
+    {
+        filename = other.filename;
+        icfile   = other.icfile.load();
+        u        = other.u;
+        v        = other.v;
+        return *this;
+    }
 };
 
 
@@ -178,6 +213,7 @@ public:
     }
     ImageCacheImpl& imagecache() const { return m_imagecache; }
     ImageInput::Creator creator() const { return m_inputcreator; }
+    const ImageSpec* configspec() const { return m_configspec.get(); }
 
     /// Load new data tile
     ///
@@ -214,12 +250,68 @@ public:
         return m_mipreadcount;
     }
 
+    /// Access statistics for one MIP level (over all subimages), gathered
+    /// only while the ImageCache "access_stats" attribute is enabled.
+    struct LevelAccessStats {
+        atomic_ll lookups { 0 };    ///< Tile lookups, hits and misses
+        atomic_ll misses { 0 };     ///< Lookups not satisfied by the cache
+        atomic_ll bytesread { 0 };  ///< Bytes read from the file
+        atomic_ll read_ns { 0 };    ///< Time fetching and decoding tiles
+        atomic_ll wait_ns { 0 };    ///< Time blocked on other readers
+
+        LevelAccessStats() {}
+        LevelAccessStats(const LevelAccessStats& s)
+            : lookups(s.lookups.load())
+            , misses(s.misses.load())
+            , bytesread(s.bytesread.load())
+            , read_ns(s.read_ns.load())
+            , wait_ns(s.wait_ns.load())
+        {
+        }
+        void clear()
+        {
+            lookups   = 0;
+            misses    = 0;
+            bytesread = 0;
+            read_ns   = 0;
+            wait_ns   = 0;
+        }
+    };
+    LevelAccessStats& levelstats(int miplevel)
+    {
+        return m_levelstats[miplevel];
+    }
+    const std::vector<LevelAccessStats>& levelstats() const
+    {
+        return m_levelstats;
+    }
+
+    /// How many MIP levels coarser than ideal texture lookups should use
+    /// right now: nonzero only while the cache is thrashing, and only for
+    /// files designated by the ImageCache "degrade_files" attribute.
+    int mip_bias() const;
+
     void invalidate();
 
     size_t timesopened() const { return m_timesopened; }
     size_t tilesread() const { return m_tilesread; }
     imagesize_t bytesread() const { return m_bytesread; }
     double& iotime() { return m_iotime; }
+    double iotime() const { return m_iotime; }
+
+    /// Record that decoding one tile from the file (not counting time
+    /// spent opening the file or in any cache tier) took `seconds`.
+    void note_decode(double seconds)
+    {
+        m_decode_ns += (long long)(seconds * 1.0e9);
+        ++m_decoded_tiles;
+    }
+    /// Average time to decode one tile of this file, or 0 if unknown.
+    double decode_time_per_tile() const
+    {
+        long long n = m_decoded_tiles;
+        return n ? m_decode_ns * 1.0e-9 / n : 0.0;
+    }
     size_t redundant_tiles() const { return (size_t)m_redundant_tiles.load(); }
     imagesize_t redundant_bytesread() const
     {
@@ -251,10 +343,29 @@ public:
         mutable std::vector<float> polecolor;  ///< Pole colors
         int nxtiles, nytiles, nztiles;  ///< Number of tiles in each dimension
         atomic_ll* tiles_read;  ///< Bitfield for tiles read at least once
+        // Per-tile summaries recorded by maketx: a bit for each channel of
+        // each tile telling if it's constant, where each tile's values
+        // start, and the values (one for a constant channel, otherwise the
+        // min, max, and average).
+        std::vector<unsigned char> tileconst;
+        std::vector<uint32_t> tilestart;
+        std::vector<float> tilestats;
         LevelInfo(const ImageSpec& spec,
                   const ImageSpec& nativespec);  ///< Initialize based on spec
         LevelInfo(const LevelInfo& src);         // needed for vector<LevelInfo>
         ~LevelInfo() { delete[] tiles_read; }
+        /// Retrieve the min, max, and average of channels [chbegin,chend)
+        /// of the tile containing pixel x,y,z, as recorded by maketx (any
+        /// of them may be nullptr). Return false if there are no such
+        /// records.
+        bool tile_stats(int x, int y, int z, int chbegin, int chend,
+                        float* min, float* max, float* avg) const;
+        /// Memory held by the tile summaries.
+        size_t tile_stats_memsize() const
+        {
+            return tileconst.size() + tilestart.size() * sizeof(uint32_t)
+                   + tilestats.size() * sizeof(float);
+        }
     };
 
     /// Info for each subimage
@@ -324,11 +435,7 @@ public:
     }
 
     /// Forget the specs we know
-    void invalidate_spec()
-    {
-        m_validspec = false;
-        m_subimages.clear();
-    }
+    void invalidate_spec();
 
     /// Should we print an error message? Keeps track of whether the
     /// number of errors so far, including this one, is a above the limit
@@ -364,6 +471,17 @@ private:
         // access directly. ALWAYS retrieve its value with get_imageinput
         // (it's thread-safe to use that result) and set its value with
         // get_imageinput -- those are guaranteed thread-safe.
+
+    // Additional ImageInputs on the same file, letting concurrent tile
+    // reads proceed in parallel rather than queueing on m_input's lock.
+    spin_mutex m_spare_mutex;  ///< Protects the three fields below
+    std::vector<std::shared_ptr<ImageInput>> m_spare_inputs;  ///< Idle ones
+    int m_nspare_inputs    = 0;  ///< Spares open, whether idle or lent out
+    int m_spare_generation = 0;  ///< Bumped whenever the spares are closed
+
+    std::vector<LevelAccessStats> m_levelstats;  ///< Per-MIP access stats
+    bool m_degradable = false;  ///< May lookups be biased to coarser MIPs?
+
     std::vector<SubimageInfo> m_subimages;  ///< Info on each subimage
     TexFormat m_texformat;                  ///< Which texture format
     TextureOpt::Wrap m_swrap;               ///< Default wrap modes
@@ -381,6 +499,8 @@ private:
     atomic_ll m_redundant_bytesread;     ///< Redundant bytes read
     size_t m_timesopened;                ///< Separate times we opened this file
     double m_iotime;                     ///< I/O time for this file
+    atomic_ll m_decode_ns { 0 };         ///< Time decoding tiles (ns)
+    atomic_ll m_decoded_tiles { 0 };     ///< ... and how many were decoded
     double m_mutex_wait_time;            ///< Wait time for m_input_mutex
     bool m_mipused;                      ///< MIP level >0 accessed
     volatile bool m_validspec;           ///< If false, reread spec upon open
@@ -393,6 +513,7 @@ private:
     ImageCacheFile* m_duplicate;    ///< Is this a duplicate?
     imagesize_t m_total_imagesize;  ///< Total size, uncompressed
     imagesize_t m_total_imagesize_ondisk;  ///< Total size, compressed on disk
+    size_t m_tile_stats_mem = 0;  ///< Cache memory held by tile summaries
     ImageInput::Creator m_inputcreator;    ///< Custom ImageInput-creator
     std::unique_ptr<ImageSpec> m_configspec;  // Optional configuration hints
     std::vector<UdimInfo> m_udim_lookup;      ///< Used for decoding udim tiles
@@ -415,6 +536,28 @@ private:
     /// requires no external lock.
     std::shared_ptr<ImageInput> open(ImageCachePerThreadInfo* thread_info);
 
+    /// Create (but don't open) an ImageInput suitable for this file, and
+    /// fill in configspec with the hints it should be opened with. Return
+    /// an empty pointer if no reader could be found.
+    std::shared_ptr<ImageInput> create_imageinput(ImageSpec& configspec);
+
+    /// Lend out an ImageInput for a tile read that would otherwise wait for
+    /// another thread to finish with the shared one: an idle spare if there
+    /// is one, else a newly opened one if the file is still under the
+    /// max_inputs_per_file limit. Return an empty pointer if the caller
+    /// should just wait its turn. The token stored in `generation` must be
+    /// passed back to return_spare_input along with the ImageInput.
+    std::shared_ptr<ImageInput>
+    borrow_spare_input(ImageCachePerThreadInfo* thread_info, int& generation);
+
+    /// Give back an ImageInput obtained from borrow_spare_input. If the
+    /// spares were closed in the meantime, it is closed now instead.
+    void return_spare_input(std::shared_ptr<ImageInput>&& inp, int generation);
+
+    /// Close all the idle spare ImageInputs. Ones currently lent out will
+    /// be closed when they are returned.
+    void close_spare_inputs();
+
     /// Release the ImageInput, if currently open. It will close and destroy
     /// when the last thread holding it is done with its shared ptr. This
     /// is thread-safe, no need to hold a lock to call it. It will close the
@@ -429,6 +572,13 @@ private:
                       int subimage, int miplevel, int x, int y, int z,
                       int chbegin, int chend, TypeDesc format, void* data);
 
+    /// If the tile is known (from maketx's tile stats) to be one constant
+    /// color, fill it in without reading the file and return true.
+    bool fill_constant_tile(ImageCachePerThreadInfo* thread_info,
+                            int subimage, int miplevel, int x, int y, int z,
+                            int chbegin, int chend, TypeDesc format,
+                            void* data);
+
     /// Load the requested tile, from a file that's not really MIPmapped.
     /// Preconditions: the ImageInput is already opened, and we already did
     /// a seek_subimage to the right subimage.
@@ -597,8 +747,48 @@ public:
     ~ImageCacheTile();
 
     /// Actually read the pixels.  The caller had better be the thread that
-    /// constructed the tile.  Return true for success, false for failure.
-    OIIO_NODISCARD bool read(ImageCachePerThreadInfo* thread_info);
+    /// constructed the tile, or the one that won claim_read().  Return true
+    /// for success, false for failure.  If `pixels` is not null, read into
+    /// that memory (of memsize_needed() bytes, which the tile will neither
+    /// own nor free) rather than allocating it.
+    OIIO_NODISCARD bool read(ImageCachePerThreadInfo* thread_info,
+                             char* pixels = nullptr);
+
+    /// Instead of read(), take ownership of a buffer of memsize_needed()
+    /// bytes that already holds the tile's pixels (for example, restored
+    /// from the compressed tier).
+    void adopt_pixels(std::unique_ptr<char[]>&& pixels, size_t size);
+
+    /// Instead of read(), use memsize_needed() bytes of pixels that the
+    /// tile does not own (for example, in the shared tile store).
+    void adopt_pixels(char* pixels, size_t size);
+
+    /// Record in its level's bitmap of tiles read that this tile has been
+    /// read (or restored), and return true if it had been already.
+    bool mark_read();
+
+    /// The tile's pixels live in this slot of a shared tile store, which
+    /// the tile keeps pinned for as long as it lives.
+    void set_shared_slot(SharedTileStore* store, uint64_t slot)
+    {
+        m_shared_store = store;
+        m_shared_slot  = slot;
+    }
+
+    /// Are the pixels in a shared tile store?
+    bool shared() const { return m_shared_store != nullptr; }
+
+    /// Are the pixels shared with other tiles through the TileContentPool?
+    bool pooled() const { return m_pooled != nullptr; }
+
+    /// Claim the job of reading the pixels.  Exactly one caller (over the
+    /// life of the tile) gets true and must then call read(); everybody
+    /// else should wait_pixels_ready().
+    bool claim_read()
+    {
+        int zero = 0;
+        return m_read_claimed.compare_exchange_strong(zero, 1);
+    }
 
     /// Return pointer to the raw pixel data
     const void* data(void) const { return &m_pixels[0]; }
@@ -635,24 +825,41 @@ public:
     ///
     size_t memsize() const { return m_pixels_size; }
 
+    /// Return how much of the cache's memory this tile accounts for.
+    /// Pooled pixels are charged once, to the pool, not to each tile.
+    size_t memcharged() const { return m_pooled ? 0 : m_pixels_size; }
+
     /// Return the space that will be needed for this tile's pixels.
     ///
     size_t memsize_needed() const;
 
     /// Mark the tile as recently used.
     ///
-    void use() { m_used = 1; }
+    void use() { m_used = m_cost.load(std::memory_order_relaxed); }
 
-    /// Mark the tile as not recently used, return its previous value.
+    /// Set how many passes of the eviction clock a use of this tile buys
+    /// it (1 for plain clock replacement, more for tiles that are more
+    /// expensive than usual to read again).
+    void set_cost(int cost)
+    {
+        m_cost = cost;
+        m_used = cost;
+    }
+
+    /// Mark the tile as less recently used, return true if it had been
+    /// used recently enough to survive this pass of the eviction clock.
     ///
     bool release()
     {
         if (!pixels_ready() || !valid())
             return true;  // Don't really release invalid or unready tiles
-        // If m_used is 1, set it to zero and return true.  If it was already
-        // zero, it's fine and return false.
-        int one = 1;
-        return m_used.compare_exchange_strong(one, 0);
+        // If m_used is nonzero, decrement it and return true.  If it was
+        // already zero, it's fine and return false.
+        int used = m_used.load(std::memory_order_relaxed);
+        while (used > 0)
+            if (m_used.compare_exchange_weak(used, used - 1))
+                return true;
+        return false;
     }
 
     /// Has this tile been recently used?
@@ -697,7 +904,16 @@ private:
     volatile bool m_pixels_ready {
         false
     };                        ///< The pixels have been read from disk
-    atomic_int m_used { 1 };  ///< Used recently
+    atomic_int m_used { 1 };  ///< Used recently (clock passes remaining)
+    atomic_int m_cost { 1 };  ///< Clock passes bought by each use
+    atomic_int m_read_claimed { 0 };  ///< Somebody is reading the pixels
+    SharedTileStore* m_shared_store { nullptr };  ///< Store holding pixels
+    uint64_t m_shared_slot { 0 };                 ///< Our pinned slot there
+    PooledTilePixels* m_pooled { nullptr };       ///< Pooled pixels we use
+
+    // Swap our freshly read pixels for the TileContentPool's copy of the
+    // same bytes, if it has one, or else give them to the pool.
+    void pool_pixels();
 };
 
 
@@ -708,12 +924,541 @@ typedef intrusive_ptr<ImageCacheTile> ImageCacheTileRef;
 
 
 
-/// Hash table that maps TileID to ImageCacheTileRef -- this is the type of the
-/// main tile cache.
-typedef unordered_map_concurrent<
-    TileID, ImageCacheTileRef, TileID::Hasher, std::equal_to<TileID>,
-    TILE_CACHE_SHARDS, tsl::robin_map<TileID, ImageCacheTileRef, TileID::Hasher>>
-    TileCache;
+/// Hash table that maps TileID to ImageCacheTileRef -- this is the type of
+/// the main tile cache.
+///
+/// The table is split into TILE_CACHE_SHARDS shards (selected by the high
+/// bits of the TileID hash), each of which is an open-addressing table of
+/// atomic tile pointers.  Lookups are lock-free: rather than locking a
+/// shard, a reader publishes the current epoch in its own Reader record
+/// for the duration of the probe.  Insertions, removals, and eviction lock
+/// only the shard they modify.  Tiles removed from a shard (and tables
+/// that were outgrown) are retired rather than released, and are only let
+/// go once no reader could still be looking at them (epoch-based
+/// reclamation).  Each shard has its own "clock" hand for eviction, so
+/// enforcing the memory limit never involves more than one shard at a
+/// time, and threads that find a shard busy simply move on to another.
+class TileCache {
+public:
+    /// Per-thread record used by lock-free lookups.  `epoch` is nonzero
+    /// only while its thread is inside retrieve().  Readers are owned by
+    /// the TileCache and recycled (never freed) until it is destroyed.
+    struct Reader {
+        OIIO_CACHE_ALIGN std::atomic<uint64_t> epoch { 0 };
+        std::atomic<bool> in_use { false };
+        Reader* next = nullptr;
+    };
+
+    TileCache() = default;
+    ~TileCache();
+    TileCache(const TileCache&) = delete;
+    const TileCache& operator=(const TileCache&) = delete;
+
+    /// Get a Reader for the calling thread to pass to retrieve().
+    Reader* acquire_reader();
+
+    /// Give back a Reader obtained from acquire_reader().
+    static void release_reader(Reader* reader)
+    {
+        if (reader) {
+            reader->epoch.store(0);
+            reader->in_use.store(false, std::memory_order_release);
+        }
+    }
+
+    /// Search for id.  If found, store a reference to the tile in `tile`
+    /// and return true.  With a Reader, no locks are taken; without one,
+    /// the shard is locked for the duration of the search.
+    bool retrieve(const TileID& id, ImageCacheTileRef& tile, Reader* reader)
+    {
+        if (!reader)
+            return retrieve_locked(id, tile);
+        size_t hash = id.hash();
+        const Shard& shard(m_shards[whichshard(hash)]);
+        // The epoch must be visible to writers before we look at the
+        // table, so that anything we find can't be reclaimed under us.
+        reader->epoch.store(m_epoch.load(), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool found         = false;
+        const Table* table = shard.table.load(std::memory_order_acquire);
+        if (table) {
+            if (ImageCacheTile* t = lookup(*table, id, hash)) {
+                tile  = t;  // Take our reference while still protected
+                found = true;
+            }
+        }
+        reader->epoch.store(0, std::memory_order_release);
+        return found;
+    }
+
+    /// Insert `tile` if no tile with its id is already present and return
+    /// true.  If one was already present, replace `tile` with the one in
+    /// the cache and return false.
+    bool insert_retrieve(ImageCacheTileRef& tile);
+
+    /// Is a tile with this id in the cache?
+    bool contains(const TileID& id);
+
+    /// Remove every tile for which pred(const ImageCacheTile&) is true.
+    /// Return the number of tiles removed.
+    template<class Pred> size_t erase_if(const Pred& pred)
+    {
+        size_t n = 0;
+        for (Shard& shard : m_shards) {
+            spin_lock lock(shard.mutex);
+            Table* table = shard.table.load(std::memory_order_relaxed);
+            if (!table)
+                continue;
+            for (size_t i = 0; i <= table->mask; ++i) {
+                ImageCacheTile* t = table->slots[i].load(
+                    std::memory_order_relaxed);
+                if (t && t != tombstone() && pred(*t)) {
+                    remove(shard, *table, i);
+                    ++n;
+                }
+            }
+            reclaim(shard);
+        }
+        return n;
+    }
+
+    /// Release tiles that have not been used recently, using a clock
+    /// sweep within each shard, until roughly `excess` bytes of tiles have
+    /// been removed from the cache.  Busy shards are skipped rather than
+    /// waited for.  If `evicted` is not null, the removed tiles are also
+    /// appended to it.
+    void evict(long long excess,
+               std::vector<ImageCacheTileRef>* evicted = nullptr);
+
+    /// Return true if the entire map is empty.
+    bool empty() const { return m_size.load(std::memory_order_relaxed) == 0; }
+
+    /// Return the total number of tiles in the map.
+    size_t size() const { return size_t(m_size); }
+
+private:
+    struct Table {
+        size_t mask;  // capacity - 1 (capacity is a power of 2)
+        std::unique_ptr<std::atomic<ImageCacheTile*>[]> slots;
+        Table(size_t capacity);
+    };
+    template<class T> struct Retired {
+        uint64_t epoch;  // m_epoch at the time it was unlinked
+        T* ptr;
+    };
+    struct Shard {
+        OIIO_CACHE_ALIGN std::atomic<Table*> table { nullptr };
+        spin_mutex mutex;       // held by writers, never by lock-free readers
+        size_t used       = 0;  // live tiles in the table
+        size_t tombstones = 0;  // erased slots not yet reused
+        size_t clock_hand = 0;  // next slot for evict() to examine
+        std::vector<Retired<ImageCacheTile>> retired_tiles;
+        std::vector<Retired<Table>> retired_tables;
+    };
+
+    Shard m_shards[TILE_CACHE_SHARDS];
+    std::atomic<uint64_t> m_epoch { 1 };    // global epoch, 0 means "idle"
+    std::atomic<Reader*> m_readers { nullptr };  // list of all Readers
+    std::atomic<size_t> m_size { 0 };       // total tiles in all shards
+    std::atomic<size_t> m_evict_shard { 0 };  // where the next evict() starts
+    atomic_ll m_evicting { 0 };  // bytes currently claimed by evict() calls
+
+    // Marker for an erased slot: probes continue past it, inserts reuse it.
+    static ImageCacheTile* tombstone()
+    {
+        return reinterpret_cast<ImageCacheTile*>(uintptr_t(1));
+    }
+
+    static constexpr int log2(unsigned n)
+    {
+        return n < 2 ? 0 : 1 + log2(n / 2);
+    }
+
+    // Which shard will this hash always appear in?  Use the high bits,
+    // since the low bits index the slots within the shard's table.
+    static size_t whichshard(size_t hash)
+    {
+        constexpr int SHARD_SHIFT = 8 * sizeof(size_t)
+                                    - log2(TILE_CACHE_SHARDS);
+        static_assert(1 << log2(TILE_CACHE_SHARDS) == TILE_CACHE_SHARDS,
+                      "Number of shards must be a power of two");
+        return hash >> SHARD_SHIFT;
+    }
+
+    // Return the tile with the given id, or nullptr if it's not in the
+    // table.  Tables are never more than half full (counting tombstones),
+    // so the probe always ends at an empty slot.
+    static ImageCacheTile* lookup(const Table& table, const TileID& id,
+                                  size_t hash)
+    {
+        for (size_t i = hash & table.mask;; i = (i + 1) & table.mask) {
+            ImageCacheTile* t = table.slots[i].load(std::memory_order_acquire);
+            if (!t)
+                return nullptr;
+            if (t != tombstone() && t->id() == id)
+                return t;
+        }
+    }
+
+    bool retrieve_locked(const TileID& id, ImageCacheTileRef& tile);
+    // Replace the shard's table by one sized for its current contents
+    // (the caller holds the shard lock).
+    Table* rehash(Shard& shard);
+    // Unlink slot i of the shard's table (the caller holds the lock).
+    void remove(Shard& shard, Table& table, size_t i);
+    // Release whatever the shard has retired that no reader can still
+    // see (the caller holds the shard lock).
+    void reclaim(Shard& shard);
+};
+
+
+/// Second tier of the tile cache: tiles evicted from the main TileCache
+/// are kept here, compressed, so that a later miss can decompress them
+/// rather than read (and decode) them from the file again.  The tier has
+/// its own memory budget, and when that is exceeded the tiles that were
+/// demoted longest ago are discarded.  A tile found here is removed from
+/// the tier as it goes back into the main cache.
+class CompressedTileTier {
+public:
+    CompressedTileTier() = default;
+    CompressedTileTier(const CompressedTileTier&) = delete;
+    const CompressedTileTier& operator=(const CompressedTileTier&) = delete;
+
+    /// Set the memory budget in bytes.  Zero disables the tier (and
+    /// discards anything in it).
+    void set_max_memory(long long bytes);
+    long long max_memory() const { return m_max_memory; }
+    bool enabled() const { return m_max_memory > 0; }
+
+    /// Total bytes of compressed pixels held.
+    long long memory_used() const { return m_mem_used; }
+    /// Total uncompressed bytes of the tiles held.
+    long long raw_memory() const { return m_raw_used; }
+
+    /// Compress the pixels of a tile that is leaving the main cache and
+    /// keep them.  Return true if the tile was kept, false if it was not
+    /// eligible (not read from a file, or not valid) or did not compress.
+    bool demote(const ImageCacheTile& tile);
+
+    /// If the pixels for this (not yet read) tile are held here, remove
+    /// them from the tier, decompress them into the tile, and return true.
+    bool restore(ImageCacheTile& tile);
+
+    /// Discard every tile for which pred(const TileID&) is true.
+    template<class Pred> void erase_if(const Pred& pred)
+    {
+        for (Shard& shard : m_shards) {
+            spin_lock lock(shard.mutex);
+            for (auto it = shard.map.begin(); it != shard.map.end();) {
+                if (pred(it->first)) {
+                    m_mem_used -= it->second.size;
+                    m_raw_used -= it->second.rawsize;
+                    it = shard.map.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            // Stale entries left in the fifo are skipped by trim().
+            if (shard.map.empty())
+                shard.fifo.clear();
+        }
+    }
+
+private:
+    struct Entry {
+        std::unique_ptr<char[]> data;  // compressed, byte-shuffled pixels
+        size_t size    = 0;            // compressed size
+        size_t rawsize = 0;            // tile's memsize()
+        uint64_t serial = 0;           // when it was demoted
+    };
+    struct Shard {
+        OIIO_CACHE_ALIGN spin_mutex mutex;
+        tsl::robin_map<TileID, Entry, TileID::Hasher> map;
+        // Demotion order.  Entries whose serial no longer matches the map
+        // (because they were since restored or erased) are stale.
+        std::deque<std::pair<uint64_t, TileID>> fifo;
+    };
+
+    Shard m_shards[TILE_TIER_SHARDS];
+    atomic_ll m_max_memory { 0 };
+    atomic_ll m_mem_used { 0 };
+    atomic_ll m_raw_used { 0 };
+    std::atomic<uint64_t> m_serial { 0 };
+    std::atomic<size_t> m_trim_shard { 0 };
+
+    Shard& shard(const TileID& id)
+    {
+        return m_shards[(id.hash() >> 7) % TILE_TIER_SHARDS];
+    }
+
+    // Discard the oldest tiles until we're within budget.
+    void trim();
+};
+
+
+
+/// Pixels held by the TileContentPool on behalf of every tile whose pixels
+/// are exactly these bytes.
+struct PooledTilePixels {
+    std::unique_ptr<char[]> data;
+    size_t size   = 0;
+    uint64_t hash = 0;
+    int refcnt    = 0;  // Tiles using it (guarded by its pool shard's lock)
+};
+
+
+
+/// Tiles whose pixels are identical -- constant regions of a texture, or
+/// the same tile repeated across the files of a texture set -- share one
+/// copy of those pixels, kept here and found by a hash of their contents.
+class TileContentPool {
+public:
+    TileContentPool() = default;
+    TileContentPool(const TileContentPool&) = delete;
+    const TileContentPool& operator=(const TileContentPool&) = delete;
+    ~TileContentPool();
+
+    /// Find pooled pixels that are the same `size` bytes as `pixels`, or
+    /// else move `pixels` into the pool.  Either way, return the pooled
+    /// pixels with a reference added for the caller.  If they were found
+    /// (and `pixels` was therefore a duplicate, now freed), set `found`.
+    PooledTilePixels* acquire(std::unique_ptr<char[]>& pixels, size_t size,
+                              bool& found);
+
+    /// Drop a reference to pooled pixels.  Return true if it was the last
+    /// one, and the pixels have been freed.
+    bool release(PooledTilePixels* pooled);
+
+    /// Total tiles that were found to duplicate pooled pixels.
+    long long duplicates() const { return m_duplicates; }
+    /// Bytes currently saved by tiles sharing pooled pixels.
+    long long memory_saved() const { return m_mem_saved; }
+
+private:
+    struct Shard {
+        OIIO_CACHE_ALIGN spin_mutex mutex;
+        std::unordered_multimap<uint64_t, PooledTilePixels*> map;
+    };
+
+    Shard m_shards[TILE_POOL_SHARDS];
+    atomic_ll m_duplicates { 0 };
+    atomic_ll m_mem_saved { 0 };
+
+    Shard& shard(uint64_t hash)
+    {
+        return m_shards[(hash >> 7) % TILE_POOL_SHARDS];
+    }
+};
+
+
+
+/// A persistent cache of decoded tiles in a directory on local disk,
+/// shared by every process that points at the same directory.  Each tile
+/// is a small file holding its raw pixels in the cache's native layout,
+/// so a hit costs one local read and no decompression.  Entries are keyed
+/// by the image's fingerprint if it has one, or else its name and
+/// modification time, so edited images never match stale entries, and by
+/// the settings that affect the pixels read from it.
+class DiskTileCache {
+public:
+    /// Set the directory to use; empty disables the cache.
+    void set_directory(ustring dir) { m_dir = dir; }
+    ustring directory() const { return m_dir; }
+    bool enabled() const { return !m_dir.empty(); }
+
+    /// If this (not yet read) tile is in the cache, read its pixels into
+    /// the tile and return true.  If `pixels` is not null, they are read
+    /// into that memory (which the tile won't own) rather than allocated.
+    bool restore(ImageCacheTile& tile, char* pixels = nullptr) const;
+
+    /// Write the pixels of a tile that was just read from its file into
+    /// the cache.  Return true if it was written.
+    bool store(const ImageCacheTile& tile) const;
+
+private:
+    ustring m_dir;
+
+    // The string identifying the image that the tile came from, and every
+    // cache setting that affects its pixels.  Stored in each tile file and
+    // checked upon reading, so hash collisions in the names are harmless.
+    static std::string filekey(const ImageCacheTile& tile);
+    // Directory for all the tiles of the image with the given key.
+    std::string filedir(string_view key) const;
+    // Name of a tile's file within its filedir.
+    static std::string tilename(const ImageCacheTile& tile);
+
+    friend class SharedTileStore;  // Keys its tiles the same way
+};
+
+
+
+/// A slot of a SharedTileStore that this process has pinned, so that it
+/// won't be evicted until unpinned.
+struct SharedTilePin {
+    char* pixels  = nullptr;  ///< The tile's pixels (null: no slot)
+    uint64_t slot = 0;        ///< Identifies the slot to unpin()
+    bool ready    = false;    ///< Pixels are there (else we must fill it)
+};
+
+
+
+/// Tile store in a POSIX shared memory segment, which any number of
+/// processes on a machine may attach to so that they share one copy (and
+/// one memory budget) of the tiles they have in common.  Tiles are keyed
+/// the same way as the DiskTileCache, so they match across processes.
+///
+/// The segment holds a header, a hash table mapping tile keys to slots,
+/// and fixed-size pages, each of which is carved into slots of one size
+/// class.  Each slot starts with a little header holding its state and a
+/// mask of the attached processes ("clients") that have it pinned; each
+/// client counts its own pins on each slot privately, and sets or clears
+/// its bit as its count leaves or returns to zero.  That, and anything
+/// that modifies the table or the allocator, happens under a lock in the
+/// segment.  Eviction is by a clock sweep over the table, and only ever
+/// frees unpinned slots of the size class needed.
+///
+/// Clients are identified by pid and process start time, so a reused pid
+/// isn't mistaken for a live one.  When a client is found to have died
+/// (holding the lock, filling a slot, or when every slot is pinned), its
+/// pins are dropped and the slots it was filling fail.  Every critical
+/// section leaves the segment usable wherever its process dies, at worst
+/// leaking a slot; in particular, the table is rehashed into a second one
+/// that only replaces it once complete.
+class SharedTileStore {
+public:
+    SharedTileStore() = default;
+    SharedTileStore(const SharedTileStore&) = delete;
+    const SharedTileStore& operator=(const SharedTileStore&) = delete;
+    ~SharedTileStore();
+
+    /// Attach to the named shared memory segment, creating it with the
+    /// given size and permissions (e.g. 0600) if it doesn't exist yet.
+    /// Return false and set err upon failure.
+    bool open(string_view name, long long bytes, int mode, std::string& err);
+    bool enabled() const { return m_header != nullptr; }
+    ustring name() const { return m_name; }
+
+    /// Pin the slot holding the given tile, if it's in the store (waiting
+    /// for any other process that is reading it).  Otherwise, allocate and
+    /// pin a slot for it that isn't ready, which the caller must fill and
+    /// then call finish_fill().  The returned pin has null pixels if the
+    /// tile can't be stored (too big, or everything is pinned).
+    SharedTilePin acquire(const ImageCacheTile& tile);
+
+    /// Report that the caller has filled (or failed to fill) the pixels
+    /// of a slot from acquire().  The slot remains pinned.
+    void finish_fill(const SharedTilePin& pin, bool ok);
+
+    /// Release one pin on the slot.  Safe from any thread; only releasing
+    /// this process's last pin on a slot takes the lock.
+    void unpin(uint64_t slot);
+
+    /// Total bytes of slots in the segment, in use, and tiles held.
+    long long capacity() const;
+    long long memory_used() const;
+    long long tiles() const;
+
+    struct Client;
+    struct Header;
+    struct Entry;
+    struct Slot;
+
+private:
+    ustring m_name;
+    Header* m_header = nullptr;
+    size_t m_mapsize = 0;
+    int m_client     = -1;  ///< Our index among the store's clients
+    uint64_t m_start = 0;   ///< When this process started (0: unknown)
+    std::unique_ptr<std::atomic<int32_t>[]> m_pins;  ///< Ours, per slot
+
+    Slot* slot(uint64_t offset) const;
+    Entry* entries(uint32_t table) const;
+    Entry* entries() const;  // The current table
+    void lock();
+    void unlock();
+    bool client_alive(int client) const;
+    // Release everything a client that is gone holds, and free its record.
+    void reap(int client);
+    void reap_dead();
+    size_t pinindex(uint64_t offset) const;
+    void add_pin(uint64_t offset);  // With the lock held
+    Entry* find(uint64_t keylo, uint64_t keyhi);
+    void insert(uint64_t keylo, uint64_t keyhi, uint64_t offset);
+    void rehash();
+    uint64_t allocate(int sclass);
+    void release_slot(Entry* entry);
+    void wait_ready(Slot* s);
+};
+
+
+
+/// One tile request in a TileTrace file.
+struct TileTraceRecord {
+    uint64_t time;                     ///< Nanoseconds since the trace began
+    uint32_t file;                     ///< Index into the trace's file names
+    uint32_t thread;                   ///< Which thread made the request
+    int32_t x, y, z;                   ///< Tile origin
+    int32_t subimage;                  ///< Subimage
+    int16_t miplevel;                  ///< MIP level
+    int16_t chbegin, chend;            ///< Channel range
+    int16_t reserved = 0;              ///< (Padding, always 0)
+};
+static_assert(sizeof(TileTraceRecord) == 40, "TileTraceRecord must be packed");
+
+
+
+/// Recorder of every tile request made of an ImageCache, written to a
+/// compact binary file that may be replayed later (e.g., by testtex
+/// --replay) to study cache behavior outside of the application.
+///
+/// Each thread appends its requests to a buffer in its per-thread info,
+/// which is written out in blocks, so recording costs the requesting
+/// thread little more than a timer read.  The file is the 8 byte magic
+/// "OIIOTRC1" followed by blocks, each a uint32 kind and uint32 count
+/// (native byte order): kind 1 is a file name of count bytes (files are
+/// numbered in the order they appear), kind 2 is count TileTraceRecords.
+class OIIO_API TileTrace {
+public:
+    ~TileTrace() { close(); }
+
+    /// Begin a new trace written to the named file, ending any current
+    /// one.  Return false if the file could not be opened.
+    bool open(const std::string& filename);
+
+    /// Finish the trace.  Requests still pending in per-thread buffers
+    /// should be flush()ed first, or they will be lost.
+    void close();
+
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    const std::string& filename() const { return m_filename; }
+
+    /// Record a request for the tile by the thread.
+    void record(ImageCachePerThreadInfo* thread_info, const TileID& id);
+
+    /// Write out the thread's pending requests.  This is safe to call
+    /// from another thread while the thread is making requests.
+    void flush(ImageCachePerThreadInfo* thread_info);
+
+    /// Read a whole trace file.  Return false (and set err) if it can't
+    /// be read or is not a valid trace.
+    static bool read(const std::string& filename, std::vector<ustring>& files,
+                     std::vector<TileTraceRecord>& records, std::string& err);
+
+private:
+    std::atomic<bool> m_enabled { false };
+    atomic_int m_generation { 0 };  ///< Which trace the buffers belong to
+    atomic_int m_nthreads { 0 };    ///< Threads seen by this trace
+    const Timer m_timer;            ///< Never reset, so safe to read anytime
+    std::atomic<uint64_t> m_start_ns { 0 };  ///< m_timer when trace began
+    mutex m_mutex;                  ///< Protects the members below
+    FILE* m_file = nullptr;
+    std::string m_filename;
+    tsl::robin_map<const ImageCacheFile*, uint32_t> m_fileindex;
+
+    // flush(), with the thread's trace_mutex already held.
+    void flush_locked(ImageCachePerThreadInfo* thread_info);
+};
+
 
 
 /// A very small amount of per-thread data that saves us from locking
@@ -733,10 +1478,33 @@ public:
 
     // We have a two-tile "microcache", storing the last two tiles needed.
     ImageCacheTileRef tile, lasttile;
+    // Optionally backed by a bigger set-associative one, for access
+    // patterns (like filters straddling tile corners) that cycle through
+    // more than two tiles.  Each set is kept in most-recently-used order.
+    std::vector<ImageCacheTileRef> microcache;
+    int microcache_ways       = 0;
+    size_t microcache_setmask = 0;
     atomic_int purge;  // If set, tile ptrs need purging!
+    TileCache::Reader* tilecache_reader = nullptr;  // For main cache lookups
+
+    // Where this thread's last get_pixels left off, for read-ahead.
+    struct Readahead {
+        ImageCacheFile* file = nullptr;
+        int subimage = -1, miplevel = -1;
+        int ynext   = 0;  // y where the last request ended
+        int yqueued = 0;  // rows before this are already prefetched
+    } readahead;
     ImageCacheStatistics m_stats;
     bool shared = false;  // Pointed to by the IC and thread_specific_ptr
 
+    // Tile requests (and their times) not yet written to the TileTrace,
+    // and this thread's number within the trace they belong to, guarded
+    // by trace_mutex so that other threads may flush them.
+    spin_mutex trace_mutex;
+    std::vector<std::pair<TileID, uint64_t>> trace_pending;
+    int trace_generation  = 0;
+    uint32_t trace_thread = 0;
+
     ImageCachePerThreadInfo()
     {
         // std::cout << "Creating PerThreadInfo " << (void*)this << "\n";
@@ -748,6 +1516,50 @@ public:
         // std::cout << "Destroying PerThreadInfo " << (void*)this << "\n";
     }
 
+    // Empty the tile microcache (including the set-associative part), and
+    // make the latter big enough for ntiles (0 to disable it).
+    void reset_microcache(int ntiles)
+    {
+        tile     = NULL;
+        lasttile = NULL;
+        microcache.clear();
+        microcache_ways = std::min(ntiles, 4);
+        size_t nsets    = 1;
+        while (nsets * microcache_ways < size_t(ntiles))
+            nsets *= 2;
+        microcache_setmask = nsets - 1;
+        microcache.resize(nsets * microcache_ways);
+    }
+
+    // Index of the first entry of the set where the tile would be
+    size_t microcache_set(const TileID& id) const
+    {
+        return (id.hash() & microcache_setmask) * microcache_ways;
+    }
+
+    // Look for the tile in the given set; if found, make it the set's
+    // most recently used, place it in t, and return true.
+    bool microcache_find(const TileID& id, size_t set, ImageCacheTileRef& t)
+    {
+        for (int w = 0; w < microcache_ways; ++w) {
+            if (microcache[set + w] && microcache[set + w]->id() == id) {
+                for (; w > 0; --w)
+                    microcache[set + w].swap(microcache[set + w - 1]);
+                t = microcache[set];
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Add a tile to the given set, in place of its least recently used.
+    void microcache_insert(size_t set, const ImageCacheTileRef& t)
+    {
+        for (int w = microcache_ways - 1; w > 0; --w)
+            microcache[set + w].swap(microcache[set + w - 1]);
+        microcache[set] = t;
+    }
+
     // Add a new filename/fileptr pair to our microcache
     void remember_filename(ustring n, ImageCacheFile* f)
     {
@@ -828,6 +1640,27 @@ public:
 
     // Retrieve options
     int max_open_files() const { return m_max_open_files; }
+    int max_inputs_per_file() const { return m_max_inputs_per_file; }
+    bool access_stats() const { return m_access_stats; }
+    bool use_tile_stats() const { return m_use_tile_stats; }
+    bool deduplicate_tiles() const { return m_deduplicate_tiles; }
+    TileContentPool& tilepool() { return m_tilepool; }
+    int mip_bias() const { return m_mip_bias; }
+    int degrade_max_res() const { return m_degrade_max_res; }
+
+    /// Is the named file one whose lookups may be biased toward coarser
+    /// MIP levels under memory pressure (per "degrade_files")?
+    bool degradable(ustring filename) const;
+
+    /// Note that a tile was read from a file (or restored from a tier or
+    /// the shared store), and whether it had been before (and since been
+    /// evicted). This is how we measure thrashing, to decide the MIP bias
+    /// for degradable files.
+    void note_tile_read(bool reread)
+    {
+        if (m_degrade_churn > 0.0f)
+            update_mip_bias(reread);
+    }
     const std::string& searchpath() const { return m_searchpath; }
     const std::string& plugin_searchpath() const { return m_plugin_searchpath; }
     int autotile() const { return m_autotile; }
@@ -884,6 +1717,10 @@ public:
                                 Perthread* thread_info,
                                 std::vector<ustring>& filenames, int& nutiles,
                                 int& nvtiles);
+    /// Resolve all the tiles of a UDIM set and open their headers, in
+    /// parallel, ahead of the texture lookups that would otherwise do
+    /// it one tile at a time.
+    void prewarm_udim(ImageCacheFile* udimfile, Perthread* thread_info);
 
     virtual bool get_thumbnail(ustring filename, ImageBuf& thumbnail,
                                int subimage = 0);
@@ -916,6 +1753,12 @@ public:
                stride_t ystride = AutoStride, stride_t zstride = AutoStride,
                int cache_chbegin = 0, int cache_chend = -1);
 
+    virtual bool prefetch(ustring filename, int subimage, int miplevel,
+                          ROI roi, int chbegin, int chend);
+    virtual bool prefetch(ImageHandle* file, Perthread* thread_info,
+                          int subimage, int miplevel, ROI roi, int chbegin,
+                          int chend);
+
     // Find the ImageCacheFile record for the named image, adding an entry
     // if it is not already in the cache. This returns a plain old pointer,
     // which is ok because the file hash table has ref-counted pointers and
@@ -954,6 +1797,8 @@ public:
         return verify_file(file, thread_info);
     }
 
+    virtual std::vector<ImageCacheFile*> preload(cspan<ustring> filenames);
+
     virtual bool good(ImageCacheFile* handle)
     {
         return handle && !handle->broken();
@@ -968,8 +1813,7 @@ public:
     bool tile_in_cache(const TileID& id,
                        ImageCachePerThreadInfo* /*thread_info*/)
     {
-        TileCache::iterator found = m_tilecache.find(id);
-        return (found != m_tilecache.end());
+        return m_tilecache.contains(id);
     }
 
     /// Add the tile to the cache.  This will also enforce cache memory
@@ -977,6 +1821,28 @@ public:
     OIIO_NODISCARD bool add_tile_to_cache(ImageCacheTileRef& tile,
                                           ImageCachePerThreadInfo* thread_info);
 
+    /// Make sure the pixels of a tile in the cache are ready to use: read
+    /// them ourselves if nobody else has started to (as for a prefetched
+    /// tile still waiting in the I/O queue), otherwise wait for whoever
+    /// is reading them.  Return false only if we read them and failed.
+    bool finish_tile_read(ImageCacheTile* tile,
+                          ImageCachePerThreadInfo* thread_info);
+
+    /// Fill in the pixels of a tile whose read we have claimed, and set
+    /// its eviction cost.
+    bool load_tile_pixels(ImageCacheTile* tile,
+                          ImageCachePerThreadInfo* thread_info);
+
+    /// Fill in the pixels of a tile from the compressed tier, shared tile
+    /// store, or disk tile cache if possible, otherwise from the file.
+    bool fetch_tile_pixels(ImageCacheTile* tile,
+                           ImageCachePerThreadInfo* thread_info);
+
+    /// With cost-aware eviction, the number of eviction clock passes a
+    /// use of a tile from this file buys it, which grows with how much
+    /// more the file's tiles have cost to read than the average tile.
+    int tile_cost(const ImageCacheFile& file) const;
+
     /// Find the tile specified by id.  If found, return true and place
     /// the tile ref in thread_info->tile; if not found, return false.
     /// Try to avoid looking to the big cache (and locking) most of the
@@ -989,6 +1855,10 @@ public:
                    bool mark_same_tile_used)
     {
         ++thread_info->m_stats.find_tile_calls;
+        if (m_trace.enabled())
+            m_trace.record(thread_info, id);
+        if (m_access_stats)
+            ++id.file().levelstats(id.miplevel()).lookups;
         ImageCacheTileRef& tile(thread_info->tile);
         if (tile) {
             if (tile->id() == id) {
@@ -1005,6 +1875,18 @@ public:
                 return true;
             }
         }
+        if (thread_info->microcache_ways) {
+            size_t set = thread_info->microcache_set(id);
+            if (thread_info->microcache_find(id, set, tile)) {
+                ++thread_info->m_stats.find_tile_microcache_nway_hits;
+                tile->use();
+                return true;
+            }
+            bool found = find_tile_main_cache(id, tile, thread_info);
+            if (tile)
+                thread_info->microcache_insert(set, tile);
+            return found;
+        }
         return find_tile_main_cache(id, tile, thread_info);
         // N.B. find_tile_main_cache marks the tile as used
     }
@@ -1018,6 +1900,13 @@ public:
     virtual TypeDesc tile_format(const Tile* tile) const;
     virtual ROI tile_roi(const Tile* tile) const;
     virtual const void* tile_pixels(Tile* tile, TypeDesc& format) const;
+    virtual bool get_tile_stats(ustring filename, int subimage, int miplevel,
+                                int x, int y, int z, int chbegin, int chend,
+                                float* min, float* max, float* avg);
+    virtual bool get_tile_stats(ImageHandle* file, Perthread* thread_info,
+                                int subimage, int miplevel, int x, int y,
+                                int z, int chbegin, int chend, float* min,
+                                float* max, float* avg);
     virtual bool add_file(ustring filename, ImageInput::Creator creator,
                           const ImageSpec* config, bool replace);
     virtual bool add_tile(ustring filename, int subimage, int miplevel, int x,
@@ -1033,6 +1922,7 @@ public:
     virtual bool has_error() const;
     virtual std::string geterror(bool clear = true) const;
     virtual std::string getstats(int level = 1) const;
+    virtual std::string access_stats_json() const;
     virtual void reset_stats();
     virtual void invalidate(ustring filename, bool force);
     virtual void invalidate(ImageHandle* file, bool force);
@@ -1044,6 +1934,11 @@ public:
     ///
     void mergestats(ImageCacheStatistics& merged) const;
 
+    // Count a tile read toward the current window and, at the end of each
+    // window, raise or lower m_mip_bias depending on how many of its reads
+    // were re-reads of tiles that had been evicted.
+    void update_mip_bias(bool reread);
+
     void operator delete(void* todel) { ::delete ((char*)todel); }
 
     /// Called when a new file is opened, so that the system can track
@@ -1071,6 +1966,14 @@ public:
     /// is not created.
     void incr_mem(size_t size) { m_mem_used += size; }
 
+    /// Called when a tile's pixel memory is freed, but the tile is not
+    /// destroyed (or is destroyed without accounting for that memory).
+    void decr_mem(size_t size)
+    {
+        m_mem_used -= size;
+        OIIO_DASSERT(m_mem_used >= 0);
+    }
+
     /// Called when a tile is destroyed, to update all the stats.
     ///
     void decr_tiles(size_t size)
@@ -1149,9 +2052,39 @@ private:
     /// Clear all the per-thread microcaches.
     void purge_perthread_microcaches();
 
+    /// Write out every thread's pending tile trace records.  Only safe
+    /// when no other threads are using the cache.
+    void flush_tile_trace();
+
     /// Clear the fingerprint list, thread-safe.
     void clear_fingerprints();
 
+    /// Return the pool of I/O threads that service prefetch requests,
+    /// starting it if necessary.
+    thread_pool* prefetch_pool();
+
+    /// Queue the tile for reading by the prefetch threads, unless it's
+    /// already in the cache.
+    void prefetch_tile(const TileID& id, ImageCachePerThreadInfo* thread_info);
+
+    /// The guts of get_pixels, for a region of pixels copied by one thread,
+    /// after the request is validated and its channels and strides are
+    /// filled in.
+    bool get_pixels_tiles(ImageCacheFile* file,
+                          ImageCachePerThreadInfo* thread_info, int subimage,
+                          int miplevel, int xbegin, int xend, int ybegin,
+                          int yend, int zbegin, int zend, int chbegin,
+                          int chend, TypeDesc format, void* result,
+                          stride_t xstride, stride_t ystride, stride_t zstride,
+                          int cache_chbegin, int cache_chend);
+
+    /// Called by get_pixels: if this request continues the thread's sweep
+    /// down the image, prefetch the rows of tiles that come next.
+    void readahead(ImageCacheFile* file, ImageCachePerThreadInfo* thread_info,
+                   int subimage, int miplevel, int xbegin, int xend,
+                   int ybegin, int yend, int zbegin, int zend, int chbegin,
+                   int chend);
+
     thread_specific_ptr<ImageCachePerThreadInfo> m_perthread_info;
     std::vector<ImageCachePerThreadInfo*> m_all_perthread_info;
     static spin_mutex m_perthread_info_mutex;  ///< Thread safety for perthread
@@ -1172,6 +2105,27 @@ private:
     bool m_trust_file_extensions = false;  ///< Assume file extensions don't lie?
     int m_failure_retries;                 ///< Times to re-try disk failures
     int m_max_mip_res = 1 << 30;  ///< Don't use MIP levels higher than this
+
+    int m_prefetch_threads       = 4;      ///< Prefetch I/O thread pool size
+    int m_readahead              = 0;      ///< Tile rows get_pixels reads ahead
+    float m_shared_tile_cache_MB = 1024;   ///< Size of a new shared store
+    int m_shared_tile_cache_mode = 0600;   ///< Permissions of a new one
+    bool m_cost_eviction         = false;  ///< Weight eviction by read cost?
+    int m_microcache_tiles       = 0;      ///< Per-thread N-way microcache size
+    int m_get_pixels_threads     = 0;      ///< get_pixels threads (0 = all)
+    int m_max_inputs_per_file    = 1;      ///< ImageInputs open per file
+    bool m_access_stats          = false;  ///< Gather per-MIP access stats?
+    bool m_use_tile_stats        = true;   ///< Fill constant tiles w/o I/O?
+    bool m_deduplicate_tiles     = false;  ///< Share identical tile pixels?
+    float m_degrade_churn        = 0.0f;   ///< Re-read fraction to degrade at
+    int m_degrade_max_bias       = 2;      ///< Most MIP levels to bias by
+    int m_degrade_max_res        = 0;      ///< Finest res while degraded
+    std::string m_degrade_files;           ///< Which files may be degraded
+    std::regex m_degrade_regex;            ///< ... compiled
+    atomic_int m_mip_bias { 0 };           ///< Current bias for those files
+    atomic_ll m_churn_reads { 0 };         ///< Tile reads in this window
+    atomic_int m_churn_rereads { 0 };      ///< ... that were re-reads
+
     Imath::M44f m_Mw2c;           ///< world-to-"common" matrix
     Imath::M44f m_Mc2w;           ///< common-to-world matrix
     ustring m_substitute_image;   ///< Substitute this image for all others
@@ -1183,11 +2137,19 @@ private:
     spin_mutex m_fingerprints_mutex;  ///< Protect m_fingerprints
     FingerprintMap m_fingerprints;    ///< Map fingerprints to files
 
+    TileContentPool m_tilepool;     ///< Pixels shared by identical tiles
+    SharedTileStore m_sharedtiles;  ///< Tiles shared across processes
     TileCache m_tilecache;          ///< Our in-memory tile cache
-    TileID m_tile_sweep_id;         ///< Sweeper for "clock" paging algorithm
-    spin_mutex m_tile_sweep_mutex;  ///< Ensure only one in check_max_mem
+    CompressedTileTier m_tiletier;  ///< Compressed tiles evicted from cache
+    DiskTileCache m_disktiles;      ///< Persistent tile cache on local disk
+    TileTrace m_trace;              ///< Recorder of tile requests
+
+    std::unique_ptr<thread_pool> m_prefetch_pool;  ///< Prefetch I/O threads
+    spin_mutex m_prefetch_pool_mutex;  ///< Protect creation of the pool
 
-    atomic_ll m_mem_used;       ///< Memory being used for tiles
+    atomic_ll m_mem_used;       ///< Memory used for tiles & tile summaries
+    atomic_ll m_tileread_count { 0 };  ///< Tiles decoded from files
+    atomic_ll m_tileread_ns { 0 };     ///< ... and the total time it took
     int m_statslevel;           ///< Statistics level
     int m_max_errors_per_file;  ///< Max errors to print for each file.
 
@@ -1230,6 +2192,14 @@ private:
 
 
 
+inline int
+ImageCacheFile::mip_bias() const
+{
+    return m_degradable ? m_imagecache.mip_bias() : 0;
+}
+
+
+
 }  // end namespace pvt
 
 OIIO_NAMESPACE_END
@@ -0,0 +1,764 @@
+// Copyright 2008-present Contributors to the OpenImageIO project.
+// SPDX-License-Identifier: BSD-3-Clause
+// https://github.com/OpenImageIO/oiio
+
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#    include <fcntl.h>
+#    include <signal.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/fmath.h>
+#include <OpenImageIO/hash.h>
+#include <OpenImageIO/imagecache.h>
+#include <OpenImageIO/strutil.h>
+#include <OpenImageIO/timer.h>
+
+#include "imagecache_pvt.h"
+
+
+OIIO_NAMESPACE_BEGIN
+
+namespace pvt {
+
+namespace {
+
+// The segment is shared by processes that may not be running the same
+// build of the library, so bump the version in the magic number whenever
+// the layout below changes.
+static const uint64_t shm_magic = 0x324d48534f49494fULL;  // "OIIOSHM2"
+
+// Pages are carved into slots of one size class.  The classes go up from
+// 4 KB to the whole page in steps of a quarter of a power of two (4, 5,
+// 6, 7, 8, 10, 12, ... KB), so that power-of-two tiles plus their padding
+// and the Slot header at the start of each slot don't waste half a slot.
+static const size_t page_size        = size_t(4) << 20;
+static const int min_class_log2      = 12;
+static const int nclasses            = 41;
+static const size_t slot_header_size = 64;
+
+// How many attachments to the store (normally one per process) there may
+// be at once; each has a bit in the mask of who has a slot pinned.
+static const int max_clients = 64;
+
+// Entry offsets that aren't slots
+static const uint64_t empty_entry = 0;
+static const uint64_t tombstone   = 1;
+
+enum SlotState : uint32_t { Filling = 0, Ready = 1, Failed = 2 };
+
+// The atomics below live in memory shared between processes, which is
+// only safe if they are lock-free (and therefore address-free).
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LONG_LOCK_FREE == 2
+                  && ATOMIC_LLONG_LOCK_FREE == 2,
+              "need lock-free atomic ints");
+
+inline size_t
+class_size(int sclass)
+{
+    return size_t(4 + (sclass & 3)) << (min_class_log2 - 2 + (sclass >> 2));
+}
+
+
+
+// When the process started (in clock ticks since boot), which along with
+// its pid identifies it even once the pid has been reused, or 0 if that
+// can't be found out.
+inline uint64_t
+process_start_time(int32_t pid)
+{
+#ifdef __linux__
+    std::string stat;
+    if (!Filesystem::read_text_file(Strutil::fmt::format("/proc/{}/stat",
+                                                         pid),
+                                    stat))
+        return 0;
+    // It's field 22. Field 2, the command name in parentheses, may hold
+    // spaces, so count from the end of it (field 3 on).
+    size_t paren = stat.rfind(')');
+    if (paren == std::string::npos)
+        return 0;
+    auto fields = Strutil::splitsv(string_view(stat).substr(paren + 1));
+    return fields.size() > 19 ? Strutil::from_string<uint64_t>(fields[19])
+                              : 0;
+#else
+    (void)pid;
+    return 0;
+#endif
+}
+
+
+
+// Is the process with this pid, which started at time `start` (0 if not
+// known), still running?
+inline bool
+process_alive(int32_t pid, uint64_t start)
+{
+#ifndef _WIN32
+    if (kill(pid_t(pid), 0) != 0 && errno == ESRCH)
+        return false;
+    uint64_t now = start ? process_start_time(pid) : 0;
+    return !now || now == start;
+#else
+    return true;
+#endif
+}
+
+
+
+inline int32_t
+this_process()
+{
+#ifndef _WIN32
+    return int32_t(getpid());
+#else
+    return 1;
+#endif
+}
+
+}  // namespace
+
+
+
+struct SharedTileStore::Client {
+    std::atomic<int32_t> pid;     // Its process (0 if this record is free)
+    std::atomic<uint64_t> start;  // When that process started
+};
+
+
+
+struct SharedTileStore::Header {
+    uint64_t magic;
+    uint64_t mapsize;
+    std::atomic<uint32_t> initialized;
+    std::atomic<int32_t> lock_pid;     // Process holding the lock (0: none)
+    std::atomic<uint64_t> lock_start;  // ... and when it started
+    // Everything below is only modified with the lock held, in an order
+    // that leaves it usable (at worst leaking a slot) wherever a process
+    // dies.  The atomics are also read without the lock.
+    std::atomic<uint32_t> table;     // Which of two hash tables is current
+    uint32_t nentries;               // Size of each table (a power of 2)
+    std::atomic<uint32_t> nlive[2];  // Entries in use in each table
+    uint32_t ntombstones[2];
+    uint32_t clock_hand;  // Eviction sweep position in the table
+    uint64_t pages_begin;
+    uint32_t npages;
+    uint32_t next_page;  // Pages below this have been carved into slots
+    uint64_t freelist[nclasses];       // Free slots of each class (0: none)
+    std::atomic<uint64_t> memory_used;  // Bytes of slots allocated
+    Client clients[max_clients];        // Who is attached to the store
+};
+
+
+
+struct SharedTileStore::Entry {
+    uint64_t keylo, keyhi;  // 128 bit fingerprint of the tile's key
+    uint64_t offset;        // Offset of its slot, or empty_entry/tombstone
+};
+
+
+
+struct SharedTileStore::Slot {
+    std::atomic<uint32_t> state;
+    std::atomic<uint32_t> used;
+    std::atomic<uint64_t> pinners;  // Bit c: client c has it pinned
+    int32_t filler;                 // Client that is filling it
+    uint32_t sclass;                // Size class
+    uint64_t next_free;             // Free list link, while it's free
+};
+
+static_assert(sizeof(SharedTileStore::Slot) <= slot_header_size,
+              "slot header too big");
+
+
+
+SharedTileStore::~SharedTileStore()
+{
+#ifndef _WIN32
+    // N.B. We never unlink the segment, other processes may be using it,
+    // or may come along later and use what we left in it.
+    if (m_header) {
+        lock();
+        reap(m_client);
+        unlock();
+        munmap(m_header, m_mapsize);
+    }
+#endif
+}
+
+
+
+bool
+SharedTileStore::open(string_view name, long long bytes, int mode,
+                      std::string& err)
+{
+#ifdef _WIN32
+    err = "shared tile stores are not supported on this platform";
+    return false;
+#else
+    OIIO_ASSERT(!m_header);
+    std::string shmname = Strutil::starts_with(name, "/")
+                              ? std::string(name)
+                              : Strutil::fmt::format("/{}", name);
+
+    // Lay out the segment: header, two hash tables (each big enough for
+    // every slot to be the smallest size, at half occupancy), then the
+    // pages.
+    size_t nentries = 1024;
+    while ((long long)nentries < 2 * bytes / (long long)class_size(0))
+        nentries *= 2;
+    uint64_t pages_begin = round_to_multiple(sizeof(Header), 64)
+                           + 2 * nentries * sizeof(Entry);
+    pages_begin          = round_to_multiple(pages_begin, uint64_t(4096));
+    long long npages = (bytes - (long long)pages_begin) / (long long)page_size;
+    if (npages < 1) {
+        err = Strutil::fmt::format(
+            "shared tile store needs at least {} MB",
+            (pages_begin + page_size + (1 << 20) - 1) >> 20);
+        return false;
+    }
+    uint64_t mapsize = pages_begin + uint64_t(npages) * page_size;
+
+    bool creator = true;
+    int fd = shm_open(shmname.c_str(), O_RDWR | O_CREAT | O_EXCL,
+                      mode_t(mode));
+    if (fd < 0 && errno == EEXIST) {
+        // Somebody else made it; use whatever size they chose.
+        creator = false;
+        fd      = shm_open(shmname.c_str(), O_RDWR, 0);
+    }
+    if (fd < 0) {
+        err = Strutil::fmt::format("could not open shared memory \"{}\": {}",
+                                   shmname, strerror(errno));
+        return false;
+    }
+    if (creator) {
+        // N.B. The new memory is zero-filled, which is the initial state
+        // of nearly everything in it.
+        if (ftruncate(fd, off_t(mapsize)) != 0) {
+            err = Strutil::fmt::format("could not size shared memory \"{}\": "
+                                       "{}",
+                                       shmname, strerror(errno));
+            close(fd);
+            shm_unlink(shmname.c_str());
+            return false;
+        }
+    } else {
+        // Wait (briefly) for the creator to have sized it.
+        struct stat st;
+        Timer timer;
+        while (fstat(fd, &st) == 0 && size_t(st.st_size) < sizeof(Header)
+               && timer() < 10.0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        mapsize = uint64_t(st.st_size);
+    }
+    void* mem = mapsize >= sizeof(Header)
+                    ? mmap(nullptr, mapsize, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, fd, 0)
+                    : MAP_FAILED;
+    close(fd);
+    if (mem == MAP_FAILED) {
+        err = Strutil::fmt::format("could not map shared memory \"{}\"",
+                                   shmname);
+        return false;
+    }
+
+    Header* h = (Header*)mem;
+    if (creator) {
+        h->magic       = shm_magic;
+        h->mapsize     = mapsize;
+        h->nentries    = uint32_t(nentries);
+        h->pages_begin = pages_begin;
+        h->npages      = uint32_t(npages);
+        h->initialized.store(1, std::memory_order_release);
+    } else {
+        Timer timer;
+        while (!h->initialized.load(std::memory_order_acquire)
+               && timer() < 10.0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (!h->initialized.load(std::memory_order_acquire)
+            || h->magic != shm_magic || h->mapsize > mapsize) {
+            err = Strutil::fmt::format(
+                "shared memory \"{}\" is not a compatible tile store",
+                shmname);
+            munmap(mem, mapsize);
+            return false;
+        }
+        mapsize = h->mapsize;
+    }
+    m_header  = h;
+    m_mapsize = mapsize;
+    m_start   = process_start_time(this_process());
+
+    // Sign up as one of the store's clients, making room if need be by
+    // clearing out after any that died without detaching.
+    lock();
+    m_client = -1;
+    for (int pass = 0; pass < 2 && m_client < 0; ++pass) {
+        if (pass)
+            reap_dead();
+        for (int c = 0; c < max_clients && m_client < 0; ++c)
+            if (!h->clients[c].pid.load())
+                m_client = c;
+    }
+    if (m_client >= 0) {
+        h->clients[m_client].start.store(m_start);
+        h->clients[m_client].pid.store(this_process());
+    }
+    unlock();
+    if (m_client < 0) {
+        err = Strutil::fmt::format(
+            "shared memory \"{}\" already has {} processes attached",
+            shmname, max_clients);
+        munmap(mem, mapsize);
+        m_header = nullptr;
+        return false;
+    }
+    m_pins.reset(new std::atomic<int32_t>[size_t(h->npages) * page_size
+                                         / class_size(0)]());
+    m_name = ustring(shmname);
+    return true;
+#endif
+}
+
+
+
+SharedTileStore::Slot*
+SharedTileStore::slot(uint64_t offset) const
+{
+    return (Slot*)((char*)m_header + offset);
+}
+
+
+
+SharedTileStore::Entry*
+SharedTileStore::entries(uint32_t table) const
+{
+    return (Entry*)((char*)m_header + round_to_multiple(sizeof(Header), 64)
+                    + table * m_header->nentries * sizeof(Entry));
+}
+
+
+
+SharedTileStore::Entry*
+SharedTileStore::entries() const
+{
+    return entries(m_header->table.load(std::memory_order_relaxed));
+}
+
+
+
+void
+SharedTileStore::lock()
+{
+    Header& h(*m_header);
+    int32_t me = this_process();
+    for (int spins = 1;; ++spins) {
+        int32_t holder = 0;
+        if (h.lock_pid.compare_exchange_weak(holder, me,
+                                             std::memory_order_acquire)) {
+            h.lock_start.store(m_start, std::memory_order_relaxed);
+            return;
+        }
+        // If the holder died with the lock, take it over, and release
+        // everything it (or any other dead client) held.  The holder may
+        // have been anywhere in a critical section, but they all leave
+        // the store usable at every step.
+        if ((spins & 1023) == 0 && holder
+            && !process_alive(holder, h.lock_start.load())
+            && h.lock_pid.compare_exchange_strong(holder, me,
+                                                  std::memory_order_acquire)) {
+            h.lock_start.store(m_start, std::memory_order_relaxed);
+            reap_dead();
+            return;
+        }
+        if (spins > 64)
+            std::this_thread::yield();
+    }
+}
+
+
+
+void
+SharedTileStore::unlock()
+{
+    m_header->lock_start.store(0, std::memory_order_relaxed);
+    m_header->lock_pid.store(0, std::memory_order_release);
+}
+
+
+
+bool
+SharedTileStore::client_alive(int client) const
+{
+    const Client& c(m_header->clients[client]);
+    int32_t pid = c.pid.load();
+    return pid && process_alive(pid, c.start.load());
+}
+
+
+
+void
+SharedTileStore::reap(int client)
+{
+    // Drop the client's pins, and fail the slots it was filling.
+    Header& h(*m_header);
+    Entry* table  = entries();
+    uint64_t mine = uint64_t(1) << client;
+    for (uint32_t i = 0; i < h.nentries; ++i) {
+        uint64_t offset = table[i].offset;
+        if (offset == empty_entry || offset == tombstone)
+            continue;
+        Slot* s = slot(offset);
+        s->pinners.fetch_and(~mine);
+        if (s->state.load() == Filling && s->filler == client)
+            s->state.store(Failed, std::memory_order_release);
+    }
+    h.clients[client].pid.store(0);
+    h.clients[client].start.store(0);
+}
+
+
+
+void
+SharedTileStore::reap_dead()
+{
+    for (int c = 0; c < max_clients; ++c)
+        if (m_header->clients[c].pid.load() && !client_alive(c))
+            reap(c);
+}
+
+
+
+size_t
+SharedTileStore::pinindex(uint64_t offset) const
+{
+    // Slots are at least class_size(0) apart, so this is unique to each.
+    return (offset - m_header->pages_begin) / class_size(0);
+}
+
+
+
+void
+SharedTileStore::add_pin(uint64_t offset)
+{
+    if (m_pins[pinindex(offset)]++ == 0)
+        slot(offset)->pinners.fetch_or(uint64_t(1) << m_client);
+}
+
+
+
+SharedTileStore::Entry*
+SharedTileStore::find(uint64_t keylo, uint64_t keyhi)
+{
+    Entry* table  = entries();
+    uint32_t mask = m_header->nentries - 1;
+    for (uint32_t i = uint32_t(keylo) & mask, n = 0; n <= mask;
+         i = (i + 1) & mask, ++n) {
+        Entry& e(table[i]);
+        if (e.offset == empty_entry)
+            return nullptr;
+        if (e.offset != tombstone && e.keylo == keylo && e.keyhi == keyhi)
+            return &e;
+    }
+    return nullptr;
+}
+
+
+
+void
+SharedTileStore::insert(uint64_t keylo, uint64_t keyhi, uint64_t offset)
+{
+    Header& h(*m_header);
+    uint32_t t = h.table.load(std::memory_order_relaxed);
+    if (4 * uint64_t(h.nlive[t] + h.ntombstones[t] + 1)
+        > 3 * uint64_t(h.nentries)) {
+        rehash();
+        t = h.table.load(std::memory_order_relaxed);
+    }
+    Entry* table  = entries(t);
+    uint32_t mask = h.nentries - 1;
+    for (uint32_t i = uint32_t(keylo) & mask;; i = (i + 1) & mask) {
+        Entry& e(table[i]);
+        if (e.offset == empty_entry || e.offset == tombstone) {
+            // The offset goes last: until then, it's still free.
+            bool reused = (e.offset == tombstone);
+            e.keylo     = keylo;
+            e.keyhi     = keyhi;
+            e.offset    = offset;
+            if (reused)
+                --h.ntombstones[t];
+            ++h.nlive[t];
+            return;
+        }
+    }
+}
+
+
+
+void
+SharedTileStore::rehash()
+{
+    // Rebuild the table without its tombstones, into the other table, and
+    // switch to that only once it's complete, so that dying partway leaves
+    // the current one intact.  Nobody outside the lock refers to entries,
+    // only to slots, so this is safe.  The counts are taken afresh, which
+    // also corrects any that were left off by a process that died.
+    Header& h(*m_header);
+    uint32_t from = h.table.load(std::memory_order_relaxed), to = 1 - from;
+    Entry* oldtable = entries(from);
+    Entry* newtable = entries(to);
+    uint32_t mask   = h.nentries - 1;
+    uint32_t nlive  = 0;
+    memset((void*)newtable, 0, h.nentries * sizeof(Entry));
+    for (uint32_t i = 0; i < h.nentries; ++i) {
+        const Entry& old(oldtable[i]);
+        if (old.offset == empty_entry || old.offset == tombstone)
+            continue;
+        uint32_t j = uint32_t(old.keylo) & mask;
+        while (newtable[j].offset != empty_entry)
+            j = (j + 1) & mask;
+        newtable[j] = old;
+        ++nlive;
+    }
+    h.nlive[to]       = nlive;
+    h.ntombstones[to] = 0;
+    h.table.store(to, std::memory_order_release);
+}
+
+
+
+void
+SharedTileStore::release_slot(Entry* entry)
+{
+    // Take it out of the table before putting it on the free list, so that
+    // dying in between only leaks it.
+    Header& h(*m_header);
+    uint32_t t      = h.table.load(std::memory_order_relaxed);
+    uint64_t offset = entry->offset;
+    Slot* s         = slot(offset);
+    entry->offset   = tombstone;
+    --h.nlive[t];
+    ++h.ntombstones[t];
+    h.memory_used -= class_size(s->sclass);
+    s->next_free          = h.freelist[s->sclass];
+    h.freelist[s->sclass] = offset;
+}
+
+
+
+uint64_t
+SharedTileStore::allocate(int sclass)
+{
+    Header& h(*m_header);
+    if (!h.freelist[sclass] && h.next_page < h.npages) {
+        // Carve a fresh page into slots of this class
+        uint64_t page = h.pages_begin + uint64_t(h.next_page++) * page_size;
+        size_t size   = class_size(sclass);
+        for (size_t i = page_size / size; i-- > 0;) {
+            slot(page + i * size)->next_free = h.freelist[sclass];
+            h.freelist[sclass]               = page + i * size;
+        }
+    }
+    // Clock sweep for an unpinned slot of this class that hasn't been
+    // used since the hand last passed it.  If they are all pinned, some of
+    // the pins may belong to processes that died, so release theirs and
+    // try once more.
+    for (int pass = 0; pass < 2 && !h.freelist[sclass]; ++pass) {
+        if (pass)
+            reap_dead();
+        Entry* table  = entries();
+        uint32_t mask = h.nentries - 1;
+        for (uint32_t n = 0; n < 2 * h.nentries; ++n) {
+            Entry& e(table[h.clock_hand++ & mask]);
+            if (e.offset == empty_entry || e.offset == tombstone)
+                continue;
+            Slot* s = slot(e.offset);
+            if (s->sclass != uint32_t(sclass) || s->pinners.load() != 0)
+                continue;
+            if (s->state.load() == Ready && s->used.exchange(0))
+                continue;
+            release_slot(&e);
+            break;
+        }
+    }
+    uint64_t offset = h.freelist[sclass];
+    if (offset) {
+        h.freelist[sclass] = slot(offset)->next_free;
+        h.memory_used += class_size(sclass);
+    }
+    return offset;
+}
+
+
+
+void
+SharedTileStore::wait_ready(Slot* s)
+{
+    for (int spins = 1; s->state.load(std::memory_order_acquire) == Filling;
+         ++spins) {
+        if (spins < 64) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        // If the client filling it died, release everything it held,
+        // which fails this slot.
+        int32_t filler = s->filler;
+        if ((spins & 255) == 0 && !client_alive(filler)) {
+            lock();
+            if (s->state.load() == Filling && s->filler == filler
+                && !client_alive(filler)) {
+                if (m_header->clients[filler].pid.load())
+                    reap(filler);
+                s->state.store(Failed, std::memory_order_release);
+            }
+            unlock();
+        }
+    }
+}
+
+
+
+SharedTilePin
+SharedTileStore::acquire(const ImageCacheTile& tile)
+{
+    SharedTilePin pin;
+    size_t size = tile.memsize_needed();
+    int sclass  = 0;
+    while (sclass < nclasses && class_size(sclass) < size + slot_header_size)
+        ++sclass;
+    if (!enabled() || sclass == nclasses)
+        return pin;  // Too big to share
+    std::string key = DiskTileCache::filekey(tile) + "/"
+                      + DiskTileCache::tilename(tile);
+    farmhash::uint128_t fp = farmhash::Fingerprint128(key);
+    uint64_t keylo         = farmhash::Uint128Low64(fp);
+    uint64_t keyhi         = farmhash::Uint128High64(fp);
+
+    lock();
+    Entry* e = find(keylo, keyhi);
+    if (e) {
+        uint64_t offset = e->offset;
+        Slot* s         = slot(offset);
+        uint32_t state  = s->state.load(std::memory_order_acquire);
+        if (state == Failed && s->pinners.load() == 0) {
+            // Nobody is still looking at a failed attempt to fill it, so
+            // we may as well try again.
+            s->state.store(Filling);
+            s->filler = m_client;
+            s->used.store(1);
+            add_pin(offset);
+            unlock();
+            pin.pixels = (char*)s + slot_header_size;
+            pin.slot   = offset;
+            return pin;
+        }
+        if (state == Failed) {
+            unlock();
+            return pin;
+        }
+        add_pin(offset);
+        s->used.store(1);
+        unlock();
+        if (state == Filling)
+            wait_ready(s);
+        if (s->state.load(std::memory_order_acquire) != Ready) {
+            unpin(offset);
+            return pin;
+        }
+        pin.pixels = (char*)s + slot_header_size;
+        pin.slot   = offset;
+        pin.ready  = true;
+        return pin;
+    }
+
+    // It's not there: allocate a slot for it, which we will fill
+    uint64_t offset = allocate(sclass);
+    if (!offset) {
+        unlock();
+        return pin;  // Everything of this size is pinned
+    }
+    Slot* s   = slot(offset);
+    s->sclass = uint32_t(sclass);
+    s->filler = m_client;
+    s->used.store(1);
+    s->pinners.store(0);
+    s->state.store(Filling);
+    add_pin(offset);
+    insert(keylo, keyhi, offset);
+    unlock();
+    pin.pixels = (char*)s + slot_header_size;
+    pin.slot   = offset;
+    return pin;
+}
+
+
+
+void
+SharedTileStore::finish_fill(const SharedTilePin& pin, bool ok)
+{
+    slot(pin.slot)->state.store(ok ? Ready : Failed,
+                                std::memory_order_release);
+}
+
+
+
+void
+SharedTileStore::unpin(uint64_t offset)
+{
+    std::atomic<int32_t>& pins(m_pins[pinindex(offset)]);
+    if (pins.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // That was our last pin on it, so unless we've pinned it again
+        // since, let it be evicted.
+        lock();
+        if (pins.load() == 0)
+            slot(offset)->pinners.fetch_and(~(uint64_t(1) << m_client));
+        unlock();
+    }
+}
+
+
+
+long long
+SharedTileStore::capacity() const
+{
+    return enabled() ? (long long)m_header->npages * page_size : 0;
+}
+
+
+
+long long
+SharedTileStore::memory_used() const
+{
+    if (!enabled())
+        return 0;
+    return (long long)m_header->memory_used.load(std::memory_order_relaxed);
+}
+
+
+
+long long
+SharedTileStore::tiles() const
+{
+    if (!enabled())
+        return 0;
+    uint32_t t = m_header->table.load(std::memory_order_relaxed);
+    return (long long)m_header->nlive[t].load(std::memory_order_relaxed);
+}
+
+}  // namespace pvt
+
+OIIO_NAMESPACE_END
@@ -87,24 +87,6 @@ TextureSystemImpl::texture3d(TextureHandle* texture_handle_,
         return true;
     }
 
-#if 0
-    // FIXME: currently, no support of actual MIPmapping.
-    static const texture3d_lookup_prototype lookup_functions[] = {
-        // Must be in the same order as Mipmode enum
-        &TextureSystemImpl::texture3d_lookup,
-        &TextureSystemImpl::texture3d_lookup_nomip,
-        &TextureSystemImpl::texture3d_lookup_trilinear_mipmap,
-        &TextureSystemImpl::texture3d_lookup_trilinear_mipmap,
-        &TextureSystemImpl::texture3d_lookup,
-        &TextureSystemImpl::texture3d_lookup_trilinear_mipmap,
-        &TextureSystemImpl::texture3d_lookup
-    };
-    texture3d_lookup_prototype lookup = lookup_functions[(int)options.mipmode];
-#else
-    texture3d_lookup_prototype lookup
-        = &TextureSystemImpl::texture3d_lookup_nomip;
-#endif
-
     PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
         (PerThreadInfo*)thread_info_);
     TextureFile* texturefile = verify_texturefile((TextureFile*)texture_handle_,
@@ -157,26 +139,37 @@ TextureSystemImpl::texture3d(TextureHandle* texture_handle_,
                                      nchannels);
 
     // Do the volume lookup in local space.
-    Imath::V3f Plocal;
+    Imath::V3f Plocal, dPdxlocal, dPdylocal, dPdzlocal;
     const auto& si(texturefile->subimageinfo(options.subimage));
     if (si.Mlocal) {
         // See if there is a world-to-local transform stored in the cache
-        // entry. If so, use it to transform the input point.
+        // entry. If so, use it to transform the input point and its
+        // derivatives.
         si.Mlocal->multVecMatrix(P.cast<Imath::V3f>(), Plocal);
+        si.Mlocal->multDirMatrix(dPdx.cast<Imath::V3f>(), dPdxlocal);
+        si.Mlocal->multDirMatrix(dPdy.cast<Imath::V3f>(), dPdylocal);
+        si.Mlocal->multDirMatrix(dPdz.cast<Imath::V3f>(), dPdzlocal);
     } else {
         // If no world-to-local matrix could be discerned, just use the
         // input point directly.
-        Plocal = P.cast<Imath::V3f>();
+        Plocal    = P.cast<Imath::V3f>();
+        dPdxlocal = dPdx.cast<Imath::V3f>();
+        dPdylocal = dPdy.cast<Imath::V3f>();
+        dPdzlocal = dPdz.cast<Imath::V3f>();
     }
 
-    // FIXME: we don't bother with this for dPdx, dPdy, and dPdz only
-    // because we know that we don't currently filter volume lookups and
-    // therefore don't actually use the derivs.  If/when we do, we'll
-    // need to transform them into local space as well.
+    // Volumes without MIP levels are looked up at the one level they have
+    // rather than filtered, since the samples along the filter footprint
+    // would all come from the same level anyway.
+    texture3d_lookup_prototype lookup
+        = (options.mipmode == TextureOpt::MipModeNoMIP || si.levels.size() <= 1)
+              ? &TextureSystemImpl::texture3d_lookup_nomip
+              : &TextureSystemImpl::texture3d_lookup;
 
     bool ok = (this->*lookup)(*texturefile, thread_info, options, nchannels,
-                              actualchannels, Plocal, dPdx, dPdy, dPdz, result,
-                              dresultds, dresultdt, dresultdr);
+                              actualchannels, Plocal, dPdxlocal, dPdylocal,
+                              dPdzlocal, result, dresultds, dresultdt,
+                              dresultdr);
 
     if (actualchannels < nchannels && options.firstchannel == 0
         && m_gray_to_rgb)
@@ -292,6 +285,192 @@ TextureSystemImpl::texture3d_lookup_nomip(
 
 
 
+int
+TextureSystemImpl::texture3d_footprint(TextureFile& texturefile,
+                                       TextureOpt& options, bool aniso,
+                                       const Imath::V3f& dPdx,
+                                       const Imath::V3f& dPdy,
+                                       const Imath::V3f& dPdz, int* miplevel,
+                                       float* levelweight,
+                                       Imath::V3f& majoraxis, float& trueaspect)
+{
+    // The filter axes in local texture space, accounting for width
+    Imath::V3f width(options.swidth, options.twidth, options.rwidth);
+    Imath::V3f axis[3] = { dPdx * width, dPdy * width, dPdz * width };
+    float blur   = std::max(std::max(options.sblur, options.tblur),
+                            options.rblur);
+    float aspect = 1.0f;
+    float majorlength, minorlength;
+    trueaspect = 1.0f;
+    majoraxis  = Imath::V3f(0.0f);
+    if (aniso) {
+        // Place the samples along the longest axis, and size the filter of
+        // each sample by the next longest (the footprint may be flat, so
+        // the shortest axis would alias).
+        float len[3] = { axis[0].length(), axis[1].length(),
+                         axis[2].length() };
+        int major    = len[0] >= len[1] ? 0 : 1;
+        major        = len[major] >= len[2] ? major : 2;
+        int a = (major + 1) % 3, b = (major + 2) % 3;
+        int mid      = len[a] >= len[b] ? a : b;
+        majorlength  = len[major] + blur;
+        minorlength  = std::max(len[mid] + blur, 1e-8f);
+        aspect = anisotropic_aspect(majorlength, minorlength, options,
+                                    trueaspect);
+        if (len[major] > 0.0f)
+            majoraxis = axis[major] * (majorlength / len[major]);
+    } else {
+        float sfilt = std::max(std::max(fabsf(axis[0].x), fabsf(axis[1].x)),
+                               fabsf(axis[2].x));
+        float tfilt = std::max(std::max(fabsf(axis[0].y), fabsf(axis[1].y)),
+                               fabsf(axis[2].y));
+        float rfilt = std::max(std::max(fabsf(axis[0].z), fabsf(axis[1].z)),
+                               fabsf(axis[2].z));
+        float filtwidth = options.conservative_filter
+                              ? std::max(std::max(sfilt, tfilt), rfilt)
+                              : std::min(std::min(sfilt, tfilt), rfilt);
+        majorlength = minorlength = std::max(filtwidth + blur, 1e-8f);
+    }
+
+    // Determine the MIP-map level(s) we need, the same way that
+    // compute_miplevels does for 2D textures.
+    ImageCacheFile::SubimageInfo& subinfo(
+        texturefile.subimageinfo(options.subimage));
+    float levelblend  = 0.0f;
+    int nmiplevels    = (int)subinfo.levels.size();
+    int min_mip_level = subinfo.min_mip_level;
+    miplevel[0] = miplevel[1] = -1;
+    for (int m = min_mip_level; m < nmiplevels; ++m) {
+        const ImageSpec& spec(subinfo.spec(m));
+        float filtwidth_ras
+            = minorlength
+              * std::min(std::min(spec.width, spec.height), spec.depth);
+        if (filtwidth_ras <= 1.0f) {
+            miplevel[0] = m - 1;
+            miplevel[1] = m;
+            levelblend  = OIIO::clamp(2.0f * filtwidth_ras - 1.0f, 0.0f, 1.0f);
+            break;
+        }
+    }
+    if (miplevel[1] < 0) {
+        // We'd like to blur even more, but make due with the coarsest
+        // MIP level.
+        miplevel[0] = nmiplevels - 1;
+        miplevel[1] = miplevel[0];
+        levelblend  = 0;
+    } else if (miplevel[0] < min_mip_level) {
+        // We wish we had even more resolution than the finest MIP level,
+        // but tough for us. Don't take more samples along the major axis
+        // than are more than half a texel apart at the finest level we
+        // actually sample.
+        miplevel[0] = min_mip_level;
+        miplevel[1] = min_mip_level;
+        levelblend  = 0;
+        const ImageSpec& spec(subinfo.spec(min_mip_level));
+        int r = std::max(std::max(spec.full_width, spec.full_height),
+                         spec.full_depth);
+        if (minorlength * r < 0.5f)
+            aspect = OIIO::clamp(majorlength * r * 2.0f, 1.0f,
+                                 float(options.anisotropic));
+    }
+    if (options.mipmode == TextureOpt::MipModeOneLevel) {
+        miplevel[0] = miplevel[1];
+        levelblend  = 0;
+    }
+    if (options.mipmode == TextureOpt::MipModeStochasticTrilinear
+        || options.mipmode == TextureOpt::MipModeStochasticAniso) {
+        // The random deviate picks ONE of the two MIP levels.
+        if (options.rnd > levelblend)
+            miplevel[1] = miplevel[0];
+        else
+            miplevel[0] = miplevel[1];
+        levelblend = 0;
+    }
+    levelweight[0] = 1.0f - levelblend;
+    levelweight[1] = levelblend;
+    return aniso ? std::max(1, (int)ceilf(aspect - 0.25f)) : 1;
+}
+
+
+
+bool
+TextureSystemImpl::texture3d_lookup(
+    TextureFile& texturefile, PerThreadInfo* thread_info, TextureOpt& options,
+    int nchannels_result, int actualchannels, const Imath::V3f& P,
+    const Imath::V3f& dPdx, const Imath::V3f& dPdy, const Imath::V3f& dPdz,
+    float* result, float* dresultds, float* dresultdt, float* dresultdr)
+{
+    // Initialize results to 0.  We'll add from here on as we sample.
+    for (int c = 0; c < nchannels_result; ++c)
+        result[c] = 0;
+    if (dresultds) {
+        OIIO_DASSERT(dresultdt && dresultdr);
+        for (int c = 0; c < nchannels_result; ++c)
+            dresultds[c] = 0;
+        for (int c = 0; c < nchannels_result; ++c)
+            dresultdt[c] = 0;
+        for (int c = 0; c < nchannels_result; ++c)
+            dresultdr[c] = 0;
+    }
+    if (!(dresultds && dresultdt && dresultdr))
+        dresultds = dresultdt = dresultdr = NULL;
+
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    bool aniso = (options.mipmode == TextureOpt::MipModeDefault
+                  || options.mipmode == TextureOpt::MipModeAniso
+                  || options.mipmode == TextureOpt::MipModeStochasticAniso);
+    int miplevel[2];
+    float levelweight[2], trueaspect;
+    Imath::V3f majoraxis;
+    int nsamples = texture3d_footprint(texturefile, options, aniso, dPdx, dPdy,
+                                       dPdz, miplevel, levelweight, majoraxis,
+                                       trueaspect);
+    if (trueaspect > stats.max_aniso)
+        stats.max_aniso = trueaspect;  // FIXME?
+    float invsamples = 1.0f / nsamples;
+
+    static const accum3d_prototype accum_functions[] = {
+        // Must be in the same order as InterpMode enum
+        &TextureSystemImpl::accum3d_sample_closest,
+        &TextureSystemImpl::accum3d_sample_bilinear,
+        &TextureSystemImpl::accum3d_sample_bilinear,  // FIXME: bicubic,
+        &TextureSystemImpl::accum3d_sample_bilinear,
+    };
+    accum3d_prototype accumer = accum_functions[(int)options.interpmode];
+
+    // Samples are evenly spaced along the major axis, centered on P.
+    bool ok       = true;
+    int npointson = 0;
+    float pos     = -0.5f + 0.5f * invsamples;
+    for (int sample = 0; sample < nsamples; ++sample, pos += invsamples) {
+        Imath::V3f Psamp = P + pos * majoraxis;
+        for (int level = 0; level < 2; ++level) {
+            if (!levelweight[level])  // No contribution from this level
+                continue;
+            ++npointson;
+            ok &= (this->*accumer)(Psamp, miplevel[level], texturefile,
+                                   thread_info, options, nchannels_result,
+                                   actualchannels,
+                                   levelweight[level] * invsamples, result,
+                                   dresultds, dresultdt, dresultdr);
+        }
+    }
+
+    // Update stats
+    stats.aniso_queries += npointson / nsamples;
+    stats.aniso_probes += npointson;
+    switch (options.interpmode) {
+    case TextureOpt::InterpClosest: stats.closest_interps += npointson; break;
+    case TextureOpt::InterpBilinear: stats.bilinear_interps += npointson; break;
+    case TextureOpt::InterpBicubic: stats.cubic_interps += npointson; break;
+    case TextureOpt::InterpSmartBicubic:
+        stats.bilinear_interps += npointson;
+        break;
+    }
+    return ok;
+}
+
+
 bool
 TextureSystemImpl::accum3d_sample_closest(
     const Imath::V3f& P, int miplevel, TextureFile& texturefile,
@@ -598,14 +777,14 @@ TextureSystemImpl::accum3d_sample_bilinear(
                                             - uchar2float(texel[1][0][1][c]),
                                         sfrac, rfrac);
                 daccumdr[c] += scalez
-                               * bilerp(uchar2float(texel[0][1][0][c])
-                                            - uchar2float(texel[1][1][0][c]),
-                                        uchar2float(texel[0][1][1][c])
-                                            - uchar2float(texel[1][1][1][c]),
-                                        uchar2float(texel[0][0][1][c])
-                                            - uchar2float(texel[1][0][0][c]),
-                                        uchar2float(texel[0][1][1][c])
-                                            - uchar2float(texel[1][1][1][c]),
+                               * bilerp(uchar2float(texel[1][0][0][c])
+                                            - uchar2float(texel[0][0][0][c]),
+                                        uchar2float(texel[1][0][1][c])
+                                            - uchar2float(texel[0][0][1][c]),
+                                        uchar2float(texel[1][1][0][c])
+                                            - uchar2float(texel[0][1][0][c]),
+                                        uchar2float(texel[1][1][1][c])
+                                            - uchar2float(texel[0][1][1][c]),
                                         sfrac, tfrac);
             }
         }
@@ -656,18 +835,18 @@ TextureSystemImpl::accum3d_sample_bilinear(
                                        ((const uint16_t*)texel[1][0][1])[c]),
                              sfrac, rfrac);
                 daccumdr[c] += scalez * bilerp(
-                             ushort2float(((const uint16_t*)texel[0][1][0])[c])
+                             ushort2float(((const uint16_t*)texel[1][0][0])[c])
                                  - ushort2float(
-                                       ((const uint16_t*)texel[1][1][0])[c]),
-                             ushort2float(((const uint16_t*)texel[0][1][1])[c])
+                                       ((const uint16_t*)texel[0][0][0])[c]),
+                             ushort2float(((const uint16_t*)texel[1][0][1])[c])
                                  - ushort2float(
-                                       ((const uint16_t*)texel[1][1][1])[c]),
-                             ushort2float(((const uint16_t*)texel[0][0][1])[c])
+                                       ((const uint16_t*)texel[0][0][1])[c]),
+                             ushort2float(((const uint16_t*)texel[1][1][0])[c])
                                  - ushort2float(
-                                       ((const uint16_t*)texel[1][0][0])[c]),
-                             ushort2float(((const uint16_t*)texel[0][1][1])[c])
+                                       ((const uint16_t*)texel[0][1][0])[c]),
+                             ushort2float(((const uint16_t*)texel[1][1][1])[c])
                                  - ushort2float(
-                                       ((const uint16_t*)texel[1][1][1])[c]),
+                                       ((const uint16_t*)texel[0][1][1])[c]),
                              sfrac, tfrac);
             }
         }
@@ -709,14 +888,14 @@ TextureSystemImpl::accum3d_sample_bilinear(
                                  - float(((const half*)texel[1][0][1])[c]),
                              sfrac, rfrac);
                 daccumdr[c] += scalez * bilerp(
-                             float(((const half*)texel[0][1][0])[c])
-                                 - float(((const half*)texel[1][1][0])[c]),
-                             float(((const half*)texel[0][1][1])[c])
-                                 - float(((const half*)texel[1][1][1])[c]),
-                             float(((const half*)texel[0][0][1])[c])
-                                 - float(((const half*)texel[1][0][0])[c]),
-                             float(((const half*)texel[0][1][1])[c])
-                                 - float(((const half*)texel[1][1][1])[c]),
+                             float(((const half*)texel[1][0][0])[c])
+                                 - float(((const half*)texel[0][0][0])[c]),
+                             float(((const half*)texel[1][0][1])[c])
+                                 - float(((const half*)texel[0][0][1])[c]),
+                             float(((const half*)texel[1][1][0])[c])
+                                 - float(((const half*)texel[0][1][0])[c]),
+                             float(((const half*)texel[1][1][1])[c])
+                                 - float(((const half*)texel[0][1][1])[c]),
                              sfrac, tfrac);
             }
         }
@@ -753,14 +932,14 @@ TextureSystemImpl::accum3d_sample_bilinear(
                                             - ((const float*)texel[1][0][1])[c],
                                         sfrac, rfrac);
                 daccumdr[c] += scalez
-                               * bilerp(((const float*)texel[0][1][0])[c]
-                                            - ((const float*)texel[1][1][0])[c],
-                                        ((const float*)texel[0][1][1])[c]
-                                            - ((const float*)texel[1][1][1])[c],
-                                        ((const float*)texel[0][0][1])[c]
-                                            - ((const float*)texel[1][0][0])[c],
-                                        ((const float*)texel[0][1][1])[c]
-                                            - ((const float*)texel[1][1][1])[c],
+                               * bilerp(((const float*)texel[1][0][0])[c]
+                                            - ((const float*)texel[0][0][0])[c],
+                                        ((const float*)texel[1][0][1])[c]
+                                            - ((const float*)texel[0][0][1])[c],
+                                        ((const float*)texel[1][1][0])[c]
+                                            - ((const float*)texel[0][1][0])[c],
+                                        ((const float*)texel[1][1][1])[c]
+                                            - ((const float*)texel[0][1][1])[c],
                                         sfrac, tfrac);
             }
         }
@@ -789,66 +968,514 @@ TextureSystemImpl::accum3d_sample_bilinear(
 
 
 bool
-TextureSystemImpl::texture3d(TextureHandle* texture_handle,
-                             Perthread* thread_info, TextureOptBatch& options,
-                             Tex::RunMask mask, const float* P,
+TextureSystemImpl::accum3d_sample_bilinear(
+    Tex::RunMask mask, const Tex::FloatWide* P, const int* miplevel_,
+    const float* weight_, TextureFile& texturefile, PerThreadInfo* thread_info,
+    TextureOpt& options, int nchannels_result, int actualchannels,
+    Tex::FloatWide* accum, Tex::FloatWide* daccumds, Tex::FloatWide* daccumdt,
+    Tex::FloatWide* daccumdr)
+{
+    using namespace Tex;
+    typedef IntWide::vbool_t BoolWide;
+    bool allok                   = true;
+    TypeDesc::BASETYPE pixeltype = texturefile.pixeltype(options.subimage);
+    size_t channelsize           = texturefile.channelsize(options.subimage);
+    wrap_impl_wide swrap_func    = wrap_functions_wide[(int)options.swrap];
+    wrap_impl_wide twrap_func    = wrap_functions_wide[(int)options.twrap];
+    wrap_impl_wide rwrap_func    = wrap_functions_wide[(int)options.rwrap];
+    bool use_fill = (nchannels_result > actualchannels && options.fill);
+    FloatWide weight(weight_);
+    IntWide levels(miplevel_);
+
+    while (mask) {
+        // Take all the lanes that use the same MIP level as the first
+        // remaining lane.
+        int miplevel       = miplevel_[first_lane(mask)];
+        RunMask levellanes = mask
+                             & RunMask((levels == IntWide(miplevel)).bitmask());
+        mask &= ~levellanes;
+
+        const ImageSpec& spec(texturefile.spec(options.subimage, miplevel));
+        const ImageCacheFile::LevelInfo& levelinfo(
+            texturefile.levelinfo(options.subimage, miplevel));
+        int tile_chbegin = 0, tile_chend = spec.nchannels;
+        if (spec.nchannels > m_max_tile_channels) {
+            // For files with many channels, narrow the range we cache
+            tile_chbegin = options.firstchannel;
+            tile_chend   = options.firstchannel + actualchannels;
+        }
+        TileID id(texturefile, options.subimage, miplevel, 0, 0, 0,
+                  tile_chbegin, tile_chend);
+        int startchan_in_tile = options.firstchannel - id.chbegin();
+
+        // Remap to texel coords and wrap, for all lanes at once, the same
+        // way that the single-point accum3d_sample_bilinear does.
+        IntWide sint, tint, rint;
+        FloatWide sfrac = floorfrac(P[0] * float(spec.full_width)
+                                        + (spec.full_x - 0.5f),
+                                    &sint);
+        FloatWide tfrac = floorfrac(P[1] * float(spec.full_height)
+                                        + (spec.full_y - 0.5f),
+                                    &tint);
+        FloatWide rfrac = floorfrac(P[2] * float(spec.full_depth)
+                                        + (spec.full_z - 0.5f),
+                                    &rint);
+        IntWide s0 = sint, s1 = sint + IntWide(1);
+        IntWide t0 = tint, t1 = tint + IntWide(1);
+        IntWide r0 = rint, r1 = rint + IntWide(1);
+        IntWide xorigin(spec.x), yorigin(spec.y), zorigin(spec.z);
+        IntWide width(spec.width), height(spec.height), depth(spec.depth);
+        BoolWide s0valid = swrap_func(s0, xorigin, width);
+        BoolWide s1valid = swrap_func(s1, xorigin, width);
+        BoolWide t0valid = twrap_func(t0, yorigin, height);
+        BoolWide t1valid = twrap_func(t1, yorigin, height);
+        BoolWide r0valid = rwrap_func(r0, zorigin, depth);
+        BoolWide r1valid = rwrap_func(r1, zorigin, depth);
+        if (!levelinfo.full_pixel_range) {  // Account for crop windows
+            s0valid = s0valid & (s0 >= xorigin) & (s0 < (xorigin + width));
+            s1valid = s1valid & (s1 >= xorigin) & (s1 < (xorigin + width));
+            t0valid = t0valid & (t0 >= yorigin) & (t0 < (yorigin + height));
+            t1valid = t1valid & (t1 >= yorigin) & (t1 < (yorigin + height));
+            r0valid = r0valid & (r0 >= zorigin) & (r0 < (zorigin + depth));
+            r1valid = r1valid & (r1 >= zorigin) & (r1 < (zorigin + depth));
+        }
+
+        IntWide tilew(spec.tile_width), tileh(spec.tile_height);
+        IntWide tiled(spec.tile_depth);
+        IntWide tile_s = (s0 - xorigin) % tilew;
+        IntWide tile_t = (t0 - yorigin) % tileh;
+        IntWide tile_r = (r0 - zorigin) % tiled;
+        IntWide tile_x = s0 - tile_s, tile_y = t0 - tile_t;
+        IntWide tile_z = r0 - tile_r;
+
+        // The fast lanes have all eight texels valid and on one tile.
+        // Lanes straddling tiles or the black wrap region go one at a
+        // time, and lanes entirely in the black wrap region contribute
+        // nothing.
+        BoolWide onetile = (tile_s != (tilew - IntWide(1)))
+                           & (s1 == (s0 + IntWide(1)))
+                           & (tile_t != (tileh - IntWide(1)))
+                           & (t1 == (t0 + IntWide(1)))
+                           & (tile_r != (tiled - IntWide(1)))
+                           & (r1 == (r0 + IntWide(1)));
+        BoolWide allvalid = s0valid & s1valid & t0valid & t1valid & r0valid
+                            & r1valid;
+        BoolWide anyvalid = s0valid | s1valid | t0valid | t1valid | r0valid
+                            | r1valid;
+        RunMask fastlanes = levellanes
+                            & RunMask((onetile & allvalid).bitmask());
+        RunMask slowlanes = levellanes & ~fastlanes
+                            & RunMask(anyvalid.bitmask());
+
+        if (fastlanes) {
+            // Gather the texels into SOA layout, [corner][channel][lane],
+            // with corners ordered (r,t,s), with one tile lookup for each
+            // set of lanes on the same tile.
+            alignas(BatchAlign) float texel[8][4][BatchWidth];
+            std::memset(texel, 0, sizeof(texel));
+            for (RunMask remaining = fastlanes; remaining;) {
+                int lane          = first_lane(remaining);
+                RunMask tilelanes = remaining
+                                    & RunMask(((tile_x == IntWide(tile_x[lane]))
+                                               & (tile_y
+                                                  == IntWide(tile_y[lane]))
+                                               & (tile_z
+                                                  == IntWide(tile_z[lane])))
+                                                  .bitmask());
+                remaining &= ~tilelanes;
+                id.xyz(tile_x[lane], tile_y[lane], tile_z[lane]);
+                bool ok = find_tile(id, thread_info, true);
+                if (!ok)
+                    error("{}", m_imagecache->geterror());
+                TileRef& tile(thread_info->tile);
+                if (!tile || !tile->valid())
+                    return false;
+                size_t pixelsize = tile->pixelsize();
+                size_t rowsize   = pixelsize * spec.tile_width;
+                size_t slicesize = rowsize * spec.tile_height;
+                for (int i = lane; i < BatchWidth; ++i) {
+                    if (!(tilelanes & (RunMask(1) << i)))
+                        continue;
+                    imagesize_t tilepel
+                        = (tile_r[i] * spec.tile_height + imagesize_t(tile_t[i]))
+                              * spec.tile_width
+                          + tile_s[i];
+                    const unsigned char* p = tile->bytedata()
+                                             + tilepel * pixelsize
+                                             + startchan_in_tile * channelsize;
+                    for (int corner = 0; corner < 8; ++corner) {
+                        simd::vfloat4 v = texel_to_float4(
+                            p + ((corner & 4) ? slicesize : 0)
+                                + ((corner & 2) ? rowsize : 0)
+                                + ((corner & 1) ? pixelsize : 0),
+                            pixeltype);
+                        for (int c = 0; c < 4; ++c)
+                            texel[corner][c][i] = v[c];
+                    }
+                }
+            }
+
+            // Filter all the fast lanes at once, one channel at a time.
+            FloatWide w = select(BoolWide::from_bitmask(int(fastlanes)),
+                                 weight, FloatWide::Zero());
+            for (int c = 0; c < actualchannels; ++c) {
+                FloatWide t000(texel[0][c]), t001(texel[1][c]);
+                FloatWide t010(texel[2][c]), t011(texel[3][c]);
+                FloatWide t100(texel[4][c]), t101(texel[5][c]);
+                FloatWide t110(texel[6][c]), t111(texel[7][c]);
+                accum[c] += w
+                            * trilerp(t000, t001, t010, t011, t100, t101, t110,
+                                      t111, sfrac, tfrac, rfrac);
+                if (daccumds) {
+                    daccumds[c] += (w * float(spec.full_width))
+                                   * bilerp(t001 - t000, t011 - t010,
+                                            t101 - t100, t111 - t110, tfrac,
+                                            rfrac);
+                    daccumdt[c] += (w * float(spec.full_height))
+                                   * bilerp(t010 - t000, t011 - t001,
+                                            t110 - t100, t111 - t101, sfrac,
+                                            rfrac);
+                    daccumdr[c] += (w * float(spec.full_depth))
+                                   * bilerp(t100 - t000, t101 - t001,
+                                            t110 - t010, t111 - t011, sfrac,
+                                            tfrac);
+                }
+            }
+            if (use_fill) {
+                // All texels were valid, so these lanes get the full
+                // weighted fill color in the extra channels.
+                for (int c = actualchannels; c < nchannels_result; ++c)
+                    accum[c] += w * options.fill;
+            }
+        }
+
+        for (int i = 0; slowlanes && i < BatchWidth; ++i) {
+            if (!(slowlanes & (RunMask(1) << i)))
+                continue;
+            float r[4] = { 0, 0, 0, 0 }, drds[4] = { 0, 0, 0, 0 };
+            float drdt[4] = { 0, 0, 0, 0 }, drdr[4] = { 0, 0, 0, 0 };
+            Imath::V3f Pi(P[0][i], P[1][i], P[2][i]);
+            allok &= accum3d_sample_bilinear(Pi, miplevel, texturefile,
+                                             thread_info, options,
+                                             nchannels_result, actualchannels,
+                                             weight_[i], r,
+                                             daccumds ? drds : nullptr,
+                                             daccumds ? drdt : nullptr,
+                                             daccumds ? drdr : nullptr);
+            for (int c = 0; c < nchannels_result; ++c) {
+                accum[c][i] += r[c];
+                if (daccumds) {
+                    daccumds[c][i] += drds[c];
+                    daccumdt[c][i] += drdt[c];
+                    daccumdr[c][i] += drdr[c];
+                }
+            }
+        }
+    }
+    return allok;
+}
+
+
+
+bool
+TextureSystemImpl::texture3d(TextureHandle* texture_handle_,
+                             Perthread* thread_info_, TextureOptBatch& options,
+                             Tex::RunMask mask, const float* P_,
                              const float* dPdx, const float* dPdy,
                              const float* dPdz, int nchannels, float* result,
                              float* dresultds, float* dresultdt,
                              float* dresultdr)
 {
-    // (FIXME) CHEAT! Texture points individually
+    using namespace Tex;
+
+    // Handle >4 channel lookups by recursion.
+    if (nchannels > 4) {
+        int save_firstchannel = options.firstchannel;
+        bool ok               = true;
+        while (nchannels && ok) {
+            int n = std::min(nchannels, 4);
+            ok    = texture3d(texture_handle_, thread_info_, options, mask, P_,
+                           dPdx, dPdy, dPdz, n, result, dresultds, dresultdt,
+                           dresultdr);
+            result += n * BatchWidth;
+            if (dresultds) {
+                dresultds += n * BatchWidth;
+                dresultdt += n * BatchWidth;
+                dresultdr += n * BatchWidth;
+            }
+            options.firstchannel += n;
+            nchannels -= n;
+        }
+        options.firstchannel = save_firstchannel;  // restore what we changed
+        return ok;
+    }
+
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
+        (PerThreadInfo*)thread_info_);
+    TextureFile* texturefile = verify_texturefile((TextureFile*)texture_handle_,
+                                                  thread_info);
+    int nlanes = 0;
+    for (RunMask m = mask; m; m >>= 1)
+        nlanes += int(m & 1);
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    ++stats.texture3d_batches;
+    stats.texture3d_queries += nlanes;
+
     TextureOpt opt;
     opt.firstchannel        = options.firstchannel;
     opt.subimage            = options.subimage;
     opt.subimagename        = options.subimagename;
     opt.swrap               = (TextureOpt::Wrap)options.swrap;
     opt.twrap               = (TextureOpt::Wrap)options.twrap;
+    opt.rwrap               = (TextureOpt::Wrap)options.rwrap;
     opt.mipmode             = (TextureOpt::MipMode)options.mipmode;
     opt.interpmode          = (TextureOpt::InterpMode)options.interpmode;
     opt.anisotropic         = options.anisotropic;
     opt.conservative_filter = options.conservative_filter;
     opt.fill                = options.fill;
     opt.missingcolor        = options.missingcolor;
-    opt.rwrap               = (TextureOpt::Wrap)options.rwrap;
 
-    bool ok          = true;
-    Tex::RunMask bit = 1;
-    for (int i = 0; i < Tex::BatchWidth; ++i, bit <<= 1) {
-        float r[4], drds[4], drdt[4], drdr[4];  // temp result
-        if (mask & bit) {
+    // Store the same value (with zero derivatives) in all active lanes.
+    auto broadcast_result = [&](const float* r) {
+        for (int c = 0; c < nchannels; ++c) {
+            FloatWide(r[c]).store_mask(int(mask), result + c * BatchWidth);
+            if (dresultds) {
+                FloatWide::Zero().store_mask(int(mask),
+                                             dresultds + c * BatchWidth);
+                FloatWide::Zero().store_mask(int(mask),
+                                             dresultdt + c * BatchWidth);
+                FloatWide::Zero().store_mask(int(mask),
+                                             dresultdr + c * BatchWidth);
+            }
+        }
+    };
+
+    if (!texturefile || texturefile->broken()) {
+        float r[4];
+        bool ok = missing_texture(opt, nchannels, r, nullptr, nullptr);
+        broadcast_result(r);
+        return ok;
+    }
+
+    if (!opt.subimagename.empty()) {
+        // If subimage was specified by name, figure out its index.
+        int s = m_imagecache->subimage_from_name(texturefile,
+                                                 opt.subimagename);
+        if (s < 0) {
+            error("Unknown subimage \"{}\" in texture \"{}\"",
+                  opt.subimagename, texturefile->filename());
+            float r[4];
+            bool ok = missing_texture(opt, nchannels, r, nullptr, nullptr);
+            broadcast_result(r);
+            return ok;
+        }
+        opt.subimage = s;
+        opt.subimagename.clear();
+    }
+    if (opt.subimage < 0 || opt.subimage >= texturefile->subimages()) {
+        error("Unknown subimage \"{}\" in texture \"{}\"", opt.subimagename,
+              texturefile->filename());
+        float r[4];
+        bool ok = missing_texture(opt, nchannels, r, nullptr, nullptr);
+        broadcast_result(r);
+        return ok;
+    }
+
+    const ImageSpec& spec(texturefile->spec(opt.subimage, 0));
+
+    // Figure out the wrap functions
+    if (opt.swrap == TextureOpt::WrapDefault)
+        opt.swrap = (TextureOpt::Wrap)texturefile->swrap();
+    if (opt.swrap == TextureOpt::WrapPeriodic && ispow2(spec.width))
+        opt.swrap = TextureOpt::WrapPeriodicPow2;
+    if (opt.twrap == TextureOpt::WrapDefault)
+        opt.twrap = (TextureOpt::Wrap)texturefile->twrap();
+    if (opt.twrap == TextureOpt::WrapPeriodic && ispow2(spec.height))
+        opt.twrap = TextureOpt::WrapPeriodicPow2;
+    if (opt.rwrap == TextureOpt::WrapDefault)
+        opt.rwrap = (TextureOpt::Wrap)texturefile->rwrap();
+    if (opt.rwrap == TextureOpt::WrapPeriodic && ispow2(spec.depth))
+        opt.rwrap = TextureOpt::WrapPeriodicPow2;
+
+    int actualchannels = OIIO::clamp(spec.nchannels - opt.firstchannel, 0,
+                                     nchannels);
+
+    // Transform all the lanes to local space at once.
+    FloatWide P[3] = { FloatWide(P_), FloatWide(P_ + BatchWidth),
+                       FloatWide(P_ + 2 * BatchWidth) };
+    const auto& si(texturefile->subimageinfo(opt.subimage));
+    if (si.Mlocal) {
+        const Imath::M44f& M(*si.Mlocal);
+        FloatWide x = P[0], y = P[1], z = P[2];
+        FloatWide w = x * M[0][3] + y * M[1][3] + z * M[2][3] + M[3][3];
+        FloatWide invw = select(w != FloatWide::Zero(), FloatWide(1.0f) / w,
+                                FloatWide(1.0f));
+        P[0] = (x * M[0][0] + y * M[1][0] + z * M[2][0] + M[3][0]) * invw;
+        P[1] = (x * M[0][1] + y * M[1][1] + z * M[2][1] + M[3][1]) * invw;
+        P[2] = (x * M[0][2] + y * M[1][2] + z * M[2][2] + M[3][2]) * invw;
+    }
+
+    // For each lane: the MIP level(s) and their weights, and the line of
+    // samples along the major axis of the filter footprint. Volumes with
+    // no MIP levels are not filtered, as in the single-point lookup.
+    alignas(BatchAlign) int miplevel[2][BatchWidth];
+    alignas(BatchAlign) float levelweight[2][BatchWidth];
+    alignas(BatchAlign) float majoraxis[3][BatchWidth];
+    alignas(BatchAlign) float invsamples[BatchWidth];
+    int nsamples[BatchWidth];
+    int maxsamples = 1;
+    for (int i = 0; i < BatchWidth; ++i) {
+        miplevel[0][i] = miplevel[1][i] = 0;
+        levelweight[0][i] = 1.0f;
+        levelweight[1][i] = 0.0f;
+        for (int a = 0; a < 3; ++a)
+            majoraxis[a][i] = 0.0f;
+        invsamples[i] = 1.0f;
+        nsamples[i]   = 1;
+    }
+    if (opt.mipmode != TextureOpt::MipModeNoMIP && si.levels.size() > 1) {
+        bool aniso = (opt.mipmode == TextureOpt::MipModeDefault
+                      || opt.mipmode == TextureOpt::MipModeAniso
+                      || opt.mipmode == TextureOpt::MipModeStochasticAniso);
+        for (int i = 0; i < BatchWidth; ++i) {
+            if (!(mask & (RunMask(1) << i)))
+                continue;
             opt.sblur  = options.sblur[i];
             opt.tblur  = options.tblur[i];
             opt.rblur  = options.rblur[i];
             opt.swidth = options.swidth[i];
             opt.twidth = options.twidth[i];
             opt.rwidth = options.rwidth[i];
-            Imath::V3f P_(P[i], P[i + Tex::BatchWidth],
-                          P[i + 2 * Tex::BatchWidth]);
-            Imath::V3f dPdx_(dPdx[i], dPdx[i + Tex::BatchWidth],
-                             dPdx[i + 2 * Tex::BatchWidth]);
-            Imath::V3f dPdy_(dPdy[i], dPdy[i + Tex::BatchWidth],
-                             dPdy[i + 2 * Tex::BatchWidth]);
-            Imath::V3f dPdz_(dPdz[i], dPdz[i + Tex::BatchWidth],
-                             dPdz[i + 2 * Tex::BatchWidth]);
-            if (dresultds) {
-                ok &= texture3d(texture_handle, thread_info, opt, P_, dPdx_,
-                                dPdy_, dPdz_, nchannels, r, drds, drdt, drdr);
-                for (int c = 0; c < nchannels; ++c) {
-                    result[c * Tex::BatchWidth + i]    = r[c];
-                    dresultds[c * Tex::BatchWidth + i] = drds[c];
-                    dresultdt[c * Tex::BatchWidth + i] = drdt[c];
-                    dresultdr[c * Tex::BatchWidth + i] = drdr[c];
+            opt.rnd    = options.rnd[i];
+            Imath::V3f dPdx_(dPdx[i], dPdx[i + BatchWidth],
+                             dPdx[i + 2 * BatchWidth]);
+            Imath::V3f dPdy_(dPdy[i], dPdy[i + BatchWidth],
+                             dPdy[i + 2 * BatchWidth]);
+            Imath::V3f dPdz_(dPdz[i], dPdz[i + BatchWidth],
+                             dPdz[i + 2 * BatchWidth]);
+            if (si.Mlocal) {
+                si.Mlocal->multDirMatrix(Imath::V3f(dPdx_), dPdx_);
+                si.Mlocal->multDirMatrix(Imath::V3f(dPdy_), dPdy_);
+                si.Mlocal->multDirMatrix(Imath::V3f(dPdz_), dPdz_);
+            }
+            int lev[2];
+            float lw[2], trueaspect;
+            Imath::V3f axis;
+            nsamples[i] = texture3d_footprint(*texturefile, opt, aniso, dPdx_,
+                                              dPdy_, dPdz_, lev, lw, axis,
+                                              trueaspect);
+            if (trueaspect > stats.max_aniso)
+                stats.max_aniso = trueaspect;  // FIXME?
+            for (int l = 0; l < 2; ++l) {
+                miplevel[l][i]    = lev[l];
+                levelweight[l][i] = lw[l];
+            }
+            for (int a = 0; a < 3; ++a)
+                majoraxis[a][i] = axis[a];
+            invsamples[i] = 1.0f / nsamples[i];
+            maxsamples    = std::max(maxsamples, nsamples[i]);
+        }
+    }
+
+    bool ok = true;
+    FloatWide accum[4], daccumds[4], daccumdt[4], daccumdr[4];
+    for (int c = 0; c < 4; ++c) {
+        accum[c]    = FloatWide::Zero();
+        daccumds[c] = FloatWide::Zero();
+        daccumdt[c] = FloatWide::Zero();
+        daccumdr[c] = FloatWide::Zero();
+    }
+
+    // For each step along the sampling lines and each MIP level, sample all
+    // the lanes that have a sample there. Step pos exactly as the
+    // single-point lookup does, so both sample the same points.
+    int npointson = 0;
+    FloatWide invsamples_w(invsamples);
+    FloatWide pos = -0.5f + 0.5f * invsamples_w;
+    for (int sample = 0; sample < maxsamples;
+         ++sample, pos += invsamples_w) {
+        FloatWide Psamp[3];
+        for (int a = 0; a < 3; ++a)
+            Psamp[a] = P[a] + pos * FloatWide(majoraxis[a]);
+        for (int level = 0; level < 2; ++level) {
+            alignas(BatchAlign) float weight[BatchWidth];
+            RunMask lanes = 0;
+            for (int i = 0; i < BatchWidth; ++i) {
+                weight[i] = 0.0f;
+                if ((mask & (RunMask(1) << i)) && levelweight[level][i] != 0.0f
+                    && sample < nsamples[i]) {
+                    weight[i] = levelweight[level][i] * invsamples[i];
+                    lanes |= RunMask(1) << i;
+                    ++npointson;
                 }
-            } else {
-                ok &= texture3d(texture_handle, thread_info, opt, P_, dPdx_,
-                                dPdy_, dPdz_, nchannels, r);
-                for (int c = 0; c < nchannels; ++c) {
-                    result[c * Tex::BatchWidth + i] = r[c];
+            }
+            if (!lanes)
+                continue;
+            if (opt.interpmode == TextureOpt::InterpClosest) {
+                // Closest lookups are cheap enough that there's nothing to
+                // share, just do them one at a time.
+                for (int i = 0; i < BatchWidth; ++i) {
+                    if (!(lanes & (RunMask(1) << i)))
+                        continue;
+                    float r[4] = { 0, 0, 0, 0 }, drds[4] = { 0, 0, 0, 0 };
+                    float drdt[4] = { 0, 0, 0, 0 }, drdr[4] = { 0, 0, 0, 0 };
+                    Imath::V3f Pi(Psamp[0][i], Psamp[1][i], Psamp[2][i]);
+                    ok &= accum3d_sample_closest(Pi, miplevel[level][i],
+                                                 *texturefile, thread_info, opt,
+                                                 nchannels, actualchannels,
+                                                 weight[i], r,
+                                                 dresultds ? drds : nullptr,
+                                                 dresultds ? drdt : nullptr,
+                                                 dresultds ? drdr : nullptr);
+                    for (int c = 0; c < nchannels; ++c) {
+                        accum[c][i] += r[c];
+                        if (dresultds) {
+                            daccumds[c][i] += drds[c];
+                            daccumdt[c][i] += drdt[c];
+                            daccumdr[c][i] += drdr[c];
+                        }
+                    }
                 }
+            } else {
+                // FIXME: bicubic volume lookups are bilinear, as in the
+                // single-point lookups.
+                ok &= accum3d_sample_bilinear(lanes, Psamp, miplevel[level],
+                                              weight, *texturefile,
+                                              thread_info, opt, nchannels,
+                                              actualchannels, accum,
+                                              dresultds ? daccumds : nullptr,
+                                              dresultds ? daccumdt : nullptr,
+                                              dresultds ? daccumdr : nullptr);
             }
         }
     }
+
+    // Update stats
+    stats.aniso_queries += nlanes;
+    stats.aniso_probes += npointson;
+    switch (opt.interpmode) {
+    case TextureOpt::InterpClosest: stats.closest_interps += npointson; break;
+    case TextureOpt::InterpBilinear: stats.bilinear_interps += npointson; break;
+    case TextureOpt::InterpBicubic: stats.cubic_interps += npointson; break;
+    case TextureOpt::InterpSmartBicubic:
+        stats.bilinear_interps += npointson;
+        break;
+    }
+
+    if (actualchannels < nchannels && opt.firstchannel == 0 && m_gray_to_rgb)
+        fill_gray_channels(spec, nchannels, accum,
+                           dresultds ? daccumds : nullptr,
+                           dresultds ? daccumdt : nullptr,
+                           dresultds ? daccumdr : nullptr);
+
+    for (int c = 0; c < nchannels; ++c) {
+        accum[c].store_mask(int(mask), result + c * BatchWidth);
+        if (dresultds) {
+            daccumds[c].store_mask(int(mask), dresultds + c * BatchWidth);
+            daccumdt[c].store_mask(int(mask), dresultdt + c * BatchWidth);
+            daccumdr[c].store_mask(int(mask), dresultdr + c * BatchWidth);
+        }
+    }
     return ok;
 }
 
@@ -343,6 +343,8 @@ public:
     virtual void inventory_udim(TextureHandle* udimfile, Perthread* thread_info,
                                 std::vector<ustring>& filenames, int& nutiles,
                                 int& nvtiles);
+    virtual void prewarm_udim(ustring udimpattern);
+    virtual void prewarm_udim(TextureHandle* udimfile, Perthread* thread_info);
 
     virtual bool has_error() const;
     virtual std::string geterror(bool clear = true) const;
@@ -467,6 +469,19 @@ private:
                         simd::vfloat4* accum, simd::vfloat4* daccumds,
                         simd::vfloat4* daccumdt);
 
+    /// Bilinearly sample one point for each lane in `mask`, adding
+    /// `weight[lane]` times the sample into the SOA accumulators (which
+    /// hold one Tex::FloatWide per channel). Each lane may use its own MIP
+    /// level; lanes sharing a level are processed together, and lanes
+    /// whose texels all lie on the same tile share a single tile lookup.
+    bool sample_bilinear_batch(Tex::RunMask mask, const float* s,
+                               const float* t, const int* miplevel,
+                               const float* weight, TextureFile& texturefile,
+                               PerThreadInfo* thread_info, TextureOpt& options,
+                               int nchannels_result, int actualchannels,
+                               Tex::FloatWide* accum, Tex::FloatWide* daccumds,
+                               Tex::FloatWide* daccumdt);
+
     // Define a prototype of a member function pointer for texture3d
     // lookups.
     typedef bool (TextureSystemImpl::*texture3d_lookup_prototype)(
@@ -481,6 +496,22 @@ private:
                                 const Imath::V3f& dPdy, const Imath::V3f& dPdz,
                                 float* result, float* dresultds,
                                 float* dresultdt, float* dresultdr);
+    bool texture3d_lookup(TextureFile& texfile, PerThreadInfo* thread_info,
+                          TextureOpt& options, int nchannels_result,
+                          int actualchannels, const Imath::V3f& P,
+                          const Imath::V3f& dPdx, const Imath::V3f& dPdy,
+                          const Imath::V3f& dPdz, float* result,
+                          float* dresultds, float* dresultdt,
+                          float* dresultdr);
+    /// Compute the MIP levels and their weights for a filtered volume
+    /// lookup with the given local-space derivatives, and (if aniso) the
+    /// axis along which to place the samples. Return the number of
+    /// samples to take along the axis.
+    int texture3d_footprint(TextureFile& texturefile, TextureOpt& options,
+                            bool aniso, const Imath::V3f& dPdx,
+                            const Imath::V3f& dPdy, const Imath::V3f& dPdz,
+                            int* miplevel, float* levelweight,
+                            Imath::V3f& majoraxis, float& trueaspect);
     typedef bool (TextureSystemImpl::*accum3d_prototype)(
         const Imath::V3f& P, int level, TextureFile& texturefile,
         PerThreadInfo* thread_info, TextureOpt& options, int nchannels_result,
@@ -499,6 +530,19 @@ private:
                                  int actualchannels, float weight, float* accum,
                                  float* daccumds, float* daccumdt,
                                  float* daccumdr);
+    /// Batched trilinear volume sampling of the lanes in mask, at the
+    /// points P (x, y, z arrays of all lanes) and per-lane MIP levels.
+    /// Adds weight times the result of each lane into the per-channel
+    /// accumulators.
+    bool accum3d_sample_bilinear(Tex::RunMask mask, const Tex::FloatWide* P,
+                                 const int* miplevel, const float* weight,
+                                 TextureFile& texturefile,
+                                 PerThreadInfo* thread_info,
+                                 TextureOpt& options, int nchannels_result,
+                                 int actualchannels, Tex::FloatWide* accum,
+                                 Tex::FloatWide* daccumds,
+                                 Tex::FloatWide* daccumdt,
+                                 Tex::FloatWide* daccumdr);
 
     /// Helper function to calculate the anisotropic aspect ratio from
     /// the major and minor ellipse axis lengths.  The "clamped" aspect
@@ -528,10 +572,23 @@ private:
     void fill_gray_channels(const ImageSpec& spec, int nchannels, float* result,
                             float* dresultds, float* dresultdt,
                             float* dresultdr = NULL);
+    /// Gray-to-RGB promotion of batched results (one FloatWide per
+    /// channel).
+    void fill_gray_channels(const ImageSpec& spec, int nchannels,
+                            Tex::FloatWide* result, Tex::FloatWide* dresultds,
+                            Tex::FloatWide* dresultdt,
+                            Tex::FloatWide* dresultdr = nullptr);
 
     static bool wrap_periodic_sharedborder(int& coord, int origin, int width);
     static const wrap_impl wrap_functions[];
 
+    /// Wrap functions operating on all Tex::BatchWidth lanes at once,
+    /// returning a mask of which lanes hold valid texel coordinates.
+    typedef Tex::IntWide::vbool_t (*wrap_impl_wide)(Tex::IntWide& coord,
+                                                    const Tex::IntWide& origin,
+                                                    const Tex::IntWide& width);
+    static const wrap_impl_wide wrap_functions_wide[];
+
     /// Helper function for lat-long environment maps: compute a "pole"
     /// pixel that's the average of all of row y.  This will only be
     /// called for levels where the whole mipmap level fits on one tile.
@@ -659,6 +716,36 @@ TextureSystemImpl::st_to_texel(float s, float t, TextureFile& texturefile,
 
 
 
+// Load the first four channels of a texel of the given pixel type,
+// converting to float.
+OIIO_FORCEINLINE simd::vfloat4
+texel_to_float4(const unsigned char* p, TypeDesc::BASETYPE pixeltype)
+{
+    if (pixeltype == TypeDesc::UINT8)
+        return simd::vfloat4(p) * (1.0f / 255.0f);
+    if (pixeltype == TypeDesc::UINT16)
+        return simd::vfloat4((const unsigned short*)p) * (1.0f / 65535.0f);
+    if (pixeltype == TypeDesc::HALF)
+        return simd::vfloat4((const half*)p);
+    OIIO_DASSERT(pixeltype == TypeDesc::FLOAT);
+    return simd::vfloat4((const float*)p);
+}
+
+
+
+// Index of the lowest lane that is on in a (nonzero) run mask.
+inline int
+first_lane(Tex::RunMask mask)
+{
+    OIIO_DASSERT(mask);
+    int lane = 0;
+    for (; !(mask & 1); mask >>= 1)
+        ++lane;
+    return lane;
+}
+
+
+
 }  // end namespace pvt
 
 OIIO_NAMESPACE_END
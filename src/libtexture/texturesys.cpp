@@ -176,89 +176,93 @@ const TextureSystemImpl::wrap_impl TextureSystemImpl::wrap_functions[] = {
 
 
 
-simd::vbool4
-wrap_black_simd(simd::vint4& coord_, const simd::vint4& origin,
-                const simd::vint4& width)
-{
-    simd::vint4 coord(coord_);
+// SIMD versions of the wrap functions. These are templated on the integer
+// vector type so that the same code serves both the 4-wide lookups within
+// a single point and the Tex::BatchWidth-wide batched lookups.
+template<typename VINT>
+typename VINT::vbool_t
+wrap_black_simd(VINT& coord_, const VINT& origin, const VINT& width)
+{
+    VINT coord(coord_);
     return (coord >= origin) & (coord < (width + origin));
 }
 
 
-simd::vbool4
-wrap_clamp_simd(simd::vint4& coord_, const simd::vint4& origin,
-                const simd::vint4& width)
+template<typename VINT>
+typename VINT::vbool_t
+wrap_clamp_simd(VINT& coord_, const VINT& origin, const VINT& width)
 {
-    simd::vint4 coord(coord_);
-    coord = simd::blend(coord, origin, coord < origin);
-    coord = simd::blend(coord, (origin + width - 1), coord >= (origin + width));
+    VINT coord(coord_);
+    coord  = simd::blend(coord, origin, coord < origin);
+    coord  = simd::blend(coord, (origin + width - 1), coord >= (origin + width));
     coord_ = coord;
-    return simd::vbool4::True();
+    return VINT::vbool_t::True();
 }
 
 
-simd::vbool4
-wrap_periodic_simd(simd::vint4& coord_, const simd::vint4& origin,
-                   const simd::vint4& width)
+template<typename VINT>
+typename VINT::vbool_t
+wrap_periodic_simd(VINT& coord_, const VINT& origin, const VINT& width)
 {
-    simd::vint4 coord(coord_);
+    VINT coord(coord_);
     coord  = coord - origin;
     coord  = coord % width;
-    coord  = simd::blend(coord, coord + width, coord < 0);
+    coord  = simd::blend(coord, coord + width, coord < VINT::Zero());
     coord  = coord + origin;
     coord_ = coord;
-    return simd::vbool4::True();
+    return VINT::vbool_t::True();
 }
 
 
-simd::vbool4
-wrap_periodic_pow2_simd(simd::vint4& coord_, const simd::vint4& origin,
-                        const simd::vint4& width)
+template<typename VINT>
+typename VINT::vbool_t
+wrap_periodic_pow2_simd(VINT& coord_, const VINT& origin, const VINT& width)
 {
-    simd::vint4 coord(coord_);
+    VINT coord(coord_);
     // OIIO_DASSERT (ispow2(width));
     coord = coord - origin;
     coord = coord
             & (width - 1);  // Shortcut periodic if we're sure it's a pow of 2
     coord  = coord + origin;
     coord_ = coord;
-    return simd::vbool4::True();
+    return VINT::vbool_t::True();
 }
 
 
-simd::vbool4
-wrap_mirror_simd(simd::vint4& coord_, const simd::vint4& origin,
-                 const simd::vint4& width)
+template<typename VINT>
+typename VINT::vbool_t
+wrap_mirror_simd(VINT& coord_, const VINT& origin, const VINT& width)
 {
-    simd::vint4 coord(coord_);
-    coord            = coord - origin;
-    coord            = simd::blend(coord, -1 - coord, coord < 0);
-    simd::vint4 iter = coord / width;  // Which iteration of the pattern?
+    VINT coord(coord_);
+    coord     = coord - origin;
+    coord     = simd::blend(coord, VINT(-1) - coord, coord < VINT::Zero());
+    VINT iter = coord / width;  // Which iteration of the pattern?
     coord -= iter * width;
     // Odd iterations -- flip the sense
-    coord = blend(coord, (width - 1) - coord, (iter & 1) != 0);
+    coord = blend(coord, (width - 1) - coord, (iter & VINT(1)) != VINT::Zero());
     // OIIO_DASSERT_MSG (coord >= 0 && coord < width,
     //              "width=%d, origin=%d, result=%d", width, origin, coord);
     coord += origin;
     coord_ = coord;
-    return simd::vbool4::True();
+    return VINT::vbool_t::True();
 }
 
 
-simd::vbool4
-wrap_periodic_sharedborder_simd(simd::vint4& coord_, const simd::vint4& origin,
-                                const simd::vint4& width)
+template<typename VINT>
+typename VINT::vbool_t
+wrap_periodic_sharedborder_simd(VINT& coord_, const VINT& origin,
+                                const VINT& width)
 {
     // Like periodic, but knowing that the first column and last are
     // actually the same position, so we essentially skip the last
     // column in the next cycle.
-    simd::vint4 coord(coord_);
+    VINT coord(coord_);
     coord = coord - origin;
     coord = safe_mod(coord, (width - 1));
-    coord += blend(simd::vint4(origin), width + origin,
-                   coord < 0);  // Fix negative values
+    coord += blend(VINT(origin), width + origin,
+                   coord < VINT::Zero());  // Fix negative values
     coord_ = coord;
-    return true;
+    return VINT::vbool_t::True();
 }
 
 
@@ -270,16 +274,29 @@ typedef simd::vbool4 (*wrap_impl_simd)(simd::vint4& coord,
 
 const wrap_impl_simd wrap_functions_simd[] = {
     // Must be in same order as Wrap enum
-    wrap_black_simd,
-    wrap_black_simd,
-    wrap_clamp_simd,
-    wrap_periodic_simd,
-    wrap_mirror_simd,
-    wrap_periodic_pow2_simd,
-    wrap_periodic_sharedborder_simd
+    wrap_black_simd<vint4>,
+    wrap_black_simd<vint4>,
+    wrap_clamp_simd<vint4>,
+    wrap_periodic_simd<vint4>,
+    wrap_mirror_simd<vint4>,
+    wrap_periodic_pow2_simd<vint4>,
+    wrap_periodic_sharedborder_simd<vint4>
 };
 
 
+const TextureSystemImpl::wrap_impl_wide
+    TextureSystemImpl::wrap_functions_wide[] = {
+        // Must be in same order as Wrap enum
+        wrap_black_simd<Tex::IntWide>,
+        wrap_black_simd<Tex::IntWide>,
+        wrap_clamp_simd<Tex::IntWide>,
+        wrap_periodic_simd<Tex::IntWide>,
+        wrap_mirror_simd<Tex::IntWide>,
+        wrap_periodic_pow2_simd<Tex::IntWide>,
+        wrap_periodic_sharedborder_simd<Tex::IntWide>
+    };
+
+
 
 const char*
 texture_format_name(TexFormat f)
@@ -696,6 +713,26 @@ TextureSystemImpl::inventory_udim(TextureHandle* udimfile,
 
 
 
+void
+TextureSystemImpl::prewarm_udim(ustring udimpattern)
+{
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info();
+    TextureFile* udimfile      = find_texturefile(udimpattern, thread_info);
+    prewarm_udim((TextureHandle*)udimfile, (Perthread*)thread_info);
+}
+
+
+
+void
+TextureSystemImpl::prewarm_udim(TextureHandle* udimfile,
+                                Perthread* thread_info)
+{
+    m_imagecache->prewarm_udim((ImageCache::ImageHandle*)udimfile,
+                               (ImageCache::Perthread*)thread_info);
+}
+
+
+
 bool
 TextureSystemImpl::get_texels(ustring filename, TextureOpt& options,
                               int miplevel, int xbegin, int xend, int ybegin,
@@ -978,6 +1015,33 @@ TextureSystemImpl::fill_gray_channels(const ImageSpec& spec, int nchannels,
 
 
 
+void
+TextureSystemImpl::fill_gray_channels(const ImageSpec& spec, int nchannels,
+                                      Tex::FloatWide* result,
+                                      Tex::FloatWide* dresultds,
+                                      Tex::FloatWide* dresultdt,
+                                      Tex::FloatWide* dresultdr)
+{
+    // Same as above, but for SOA batch results, one FloatWide per channel.
+    Tex::FloatWide* results[4] = { result, dresultds, dresultdt, dresultdr };
+    for (Tex::FloatWide* r : results) {
+        if (!r)
+            continue;
+        if (spec.nchannels == 1 && nchannels >= 3) {
+            r[1] = r[0];
+            r[2] = r[0];
+        } else if (spec.nchannels == 2 && nchannels == 4
+                   && spec.alpha_channel == 1) {
+            Tex::FloatWide a = r[1];
+            r[1]             = r[0];
+            r[2]             = r[0];
+            r[3]             = a;
+        }
+    }
+}
+
+
+
 bool
 TextureSystemImpl::texture(ustring filename, TextureOptions& options,
                            Runflag* runflags, int beginactive, int endactive,
@@ -1240,63 +1304,6 @@ TextureSystemImpl::texture(ustring filename, TextureOptBatch& options,
 }
 
 
-bool
-TextureSystemImpl::texture(TextureHandle* texture_handle,
-                           Perthread* thread_info, TextureOptBatch& options,
-                           Tex::RunMask mask, const float* s, const float* t,
-                           const float* dsdx, const float* dtdx,
-                           const float* dsdy, const float* dtdy, int nchannels,
-                           float* result, float* dresultds, float* dresultdt)
-{
-    // (FIXME) CHEAT! Texture points individually
-    TextureOpt opt;
-    opt.firstchannel        = options.firstchannel;
-    opt.subimage            = options.subimage;
-    opt.subimagename        = options.subimagename;
-    opt.swrap               = (TextureOpt::Wrap)options.swrap;
-    opt.twrap               = (TextureOpt::Wrap)options.twrap;
-    opt.mipmode             = (TextureOpt::MipMode)options.mipmode;
-    opt.interpmode          = (TextureOpt::InterpMode)options.interpmode;
-    opt.anisotropic         = options.anisotropic;
-    opt.conservative_filter = options.conservative_filter;
-    opt.fill                = options.fill;
-    opt.missingcolor        = options.missingcolor;
-    // rwrap not needed for 2D texture
-
-    bool ok          = true;
-    Tex::RunMask bit = 1;
-    for (int i = 0; i < Tex::BatchWidth; ++i, bit <<= 1) {
-        float r[4], drds[4], drdt[4];  // temp result
-        if (mask & bit) {
-            opt.sblur  = options.sblur[i];
-            opt.tblur  = options.tblur[i];
-            opt.swidth = options.swidth[i];
-            opt.twidth = options.twidth[i];
-            opt.rnd    = options.rnd[i];
-            // rblur, rwidth not needed for 2D texture
-            if (dresultds) {
-                ok &= texture(texture_handle, thread_info, opt, s[i], t[i],
-                              dsdx[i], dtdx[i], dsdy[i], dtdy[i], nchannels, r,
-                              drds, drdt);
-                for (int c = 0; c < nchannels; ++c) {
-                    result[c * Tex::BatchWidth + i]    = r[c];
-                    dresultds[c * Tex::BatchWidth + i] = drds[c];
-                    dresultdt[c * Tex::BatchWidth + i] = drdt[c];
-                }
-            } else {
-                ok &= texture(texture_handle, thread_info, opt, s[i], t[i],
-                              dsdx[i], dtdx[i], dsdy[i], dtdy[i], nchannels, r);
-                for (int c = 0; c < nchannels; ++c) {
-                    result[c * Tex::BatchWidth + i] = r[c];
-                }
-            }
-        }
-    }
-    return ok;
-}
-
-
-
 bool
 TextureSystemImpl::texture_lookup_nomip(
     TextureFile& texturefile, PerThreadInfo* thread_info, TextureOpt& options,
@@ -1404,6 +1411,44 @@ adjust_width(float& dsdx, float& dtdx, float& dsdy, float& dtdy, float swidth,
 
 
 
+// Batched version of adjust_width, operating on all lanes at once.
+inline void
+adjust_width(Tex::FloatWide& dsdx, Tex::FloatWide& dtdx, Tex::FloatWide& dsdy,
+             Tex::FloatWide& dtdy, const Tex::FloatWide& swidth,
+             const Tex::FloatWide& twidth)
+{
+    using Tex::FloatWide;
+    dsdx *= swidth;
+    dtdx *= twidth;
+    dsdy *= swidth;
+    dtdy *= twidth;
+
+    // Clamp degenerate derivatives, making the same substitutions as the
+    // single-point version, but with selects rather than branches.
+    static const float eps = 1.0e-8f, eps2 = eps * eps;
+    FloatWide dxlen2 = dsdx * dsdx + dtdx * dtdx;
+    FloatWide dylen2 = dsdy * dsdy + dtdy * dtdy;
+    auto tinydx      = dxlen2 < FloatWide(eps2);
+    auto tinydy      = dylen2 < FloatWide(eps2);
+    if (none(tinydx | tinydy))
+        return;  // The usual case: all derivs are sane
+    // Tiny dx, sane dy -- pick a small dx orthogonal to dy, and vice versa.
+    FloatWide xscale  = FloatWide(eps) / sqrt(max(dylen2, FloatWide(eps2)));
+    FloatWide yscale  = FloatWide(eps) / sqrt(max(dxlen2, FloatWide(eps2)));
+    FloatWide newdsdx = select(tinydx, dtdy * xscale, dsdx);
+    FloatWide newdtdx = select(tinydx, -dsdy * xscale, dtdx);
+    FloatWide newdsdy = select(tinydy, -dtdx * yscale, dsdy);
+    FloatWide newdtdy = select(tinydy, dsdx * yscale, dtdy);
+    // Tiny dx and dy: essentially point sampling.
+    auto tinyboth = tinydx & tinydy;
+    dsdx          = select(tinyboth, FloatWide(eps), newdsdx);
+    dtdx          = select(tinyboth, FloatWide::Zero(), newdtdx);
+    dsdy          = select(tinyboth, FloatWide::Zero(), newdsdy);
+    dtdy          = select(tinyboth, FloatWide(eps), newdtdy);
+}
+
+
+
 // Adjust the ellipse major and minor axes based on the blur, if nonzero.
 // Trust user not to use nonsensical blur<0
 //
@@ -1474,6 +1519,17 @@ compute_miplevels(TextureSystemImpl::TextureFile& texturefile,
     float levelblend  = 0.0f;
     int nmiplevels    = (int)subinfo.levels.size();
     int min_mip_level = subinfo.min_mip_level;
+    int mip_bias      = texturefile.mip_bias();
+    if (mip_bias) {
+        // The cache is thrashing: also cap the finest level we'll read
+        // (if requested), and below, shift toward coarser levels.
+        int maxres = texturefile.imagecache().degrade_max_res();
+        while (maxres && min_mip_level < nmiplevels - 1
+               && std::max(subinfo.spec(min_mip_level).width,
+                           subinfo.spec(min_mip_level).height)
+                      > maxres)
+            ++min_mip_level;
+    }
     for (int m = min_mip_level; m < nmiplevels; ++m) {
         // Compute the filter size (minor axis) in raster space at this
         // MIP level.  We use the smaller of the two texture resolutions,
@@ -1521,6 +1577,10 @@ compute_miplevels(TextureSystemImpl::TextureFile& texturefile,
                                  float(options.anisotropic));
         }
     }
+    if (mip_bias) {
+        miplevel[0] = std::min(miplevel[0] + mip_bias, nmiplevels - 1);
+        miplevel[1] = std::min(miplevel[1] + mip_bias, nmiplevels - 1);
+    }
     if (options.mipmode == TextureOpt::MipModeOneLevel) {
         miplevel[0] = miplevel[1];
         levelblend  = 0;
@@ -1691,6 +1751,37 @@ ellipse_axes(float dsdx, float dtdx, float dsdy, float dtdy, float& majorlength,
 
 
 
+// Batched version of ellipse_axes. Rather than the orientation angle
+// itself, it returns the (y,x) arguments of the atan2 that computes it, so
+// that only lanes that need the angle pay for it. The ellipse coefficients
+// are computed for all lanes at once, in float just as ellipse_axes does,
+// but the axis lengths then come from the same double precision formulas,
+// lane by lane, so that batched and single-point lookups choose the same
+// MIP levels and anisotropy even for nearly degenerate derivatives.
+inline void
+ellipse_axes(const Tex::FloatWide& dsdx, const Tex::FloatWide& dtdx,
+             const Tex::FloatWide& dsdy, const Tex::FloatWide& dtdy,
+             Tex::FloatWide& majorlength, Tex::FloatWide& minorlength,
+             Tex::FloatWide& theta_y, Tex::FloatWide& theta_x)
+{
+    using Tex::FloatWide;
+    FloatWide A = dtdx * dtdx + dtdy * dtdy;
+    FloatWide B = -2.0f * (dsdx * dtdx + dsdy * dtdy);
+    FloatWide C = dsdx * dsdx + dsdy * dsdy;
+    for (int i = 0; i < Tex::BatchWidth; ++i) {
+        double a = A[i], b = B[i], c = C[i];
+        double root    = hypot(a - c, b);
+        double Aprime  = (a + c - root) * 0.5;
+        double Cprime  = (a + c + root) * 0.5;
+        majorlength[i] = std::min(safe_sqrt(float(Cprime)), 1000.0f);
+        minorlength[i] = std::min(safe_sqrt(float(Aprime)), 1000.0f);
+        theta_x[i]     = float(a - c);
+    }
+    theta_y = B;
+}
+
+
+
 // Given the aspect ratio, major axis orientation angle, and axis lengths,
 // calculate the smajor & tmajor values that give the orientation of the
 // line on which samples should be distributed.  If there are n samples,
@@ -1923,6 +2014,601 @@ TextureSystemImpl::texture_lookup(TextureFile& texturefile,
 
 
 
+bool
+TextureSystemImpl::texture(TextureHandle* texture_handle_,
+                           Perthread* thread_info_, TextureOptBatch& options,
+                           Tex::RunMask mask, const float* s_, const float* t_,
+                           const float* dsdx_, const float* dtdx_,
+                           const float* dsdy_, const float* dtdy_,
+                           int nchannels, float* result, float* dresultds,
+                           float* dresultdt)
+{
+    using namespace Tex;
+
+    // Handle >4 channel lookups by recursion.
+    if (nchannels > 4) {
+        int save_firstchannel = options.firstchannel;
+        bool ok               = true;
+        while (nchannels && ok) {
+            int n = std::min(nchannels, 4);
+            ok    = texture(texture_handle_, thread_info_, options, mask, s_,
+                         t_, dsdx_, dtdx_, dsdy_, dtdy_, n /* chans */,
+                         result, dresultds, dresultdt);
+            result += n * BatchWidth;
+            if (dresultds) {
+                dresultds += n * BatchWidth;
+                dresultdt += n * BatchWidth;
+            }
+            options.firstchannel += n;
+            nchannels -= n;
+        }
+        options.firstchannel = save_firstchannel;  // restore what we changed
+        return ok;
+    }
+
+    PerThreadInfo* thread_info = m_imagecache->get_perthread_info(
+        (PerThreadInfo*)thread_info_);
+    TextureFile* texturefile = (TextureFile*)texture_handle_;
+    if (texturefile && texturefile->is_udim()) {
+        // Each lane may land in a different UDIM tile. Resolve them all,
+        // then look up each set of lanes that share a tile as one batch,
+        // with s,t adjusted to be within the tile.
+        TextureFile* lanefile[BatchWidth];
+        alignas(BatchAlign) float sfrac[BatchWidth], tfrac[BatchWidth];
+        for (int i = 0; i < BatchWidth; ++i) {
+            lanefile[i] = nullptr;
+            sfrac[i] = tfrac[i] = 0.0f;
+            if (mask & (RunMask(1) << i)) {
+                lanefile[i] = (TextureFile*)resolve_udim(
+                    texture_handle_, (Perthread*)thread_info, s_[i], t_[i]);
+                sfrac[i] = s_[i] - floorf(s_[i]);
+                tfrac[i] = t_[i] - floorf(t_[i]);
+            }
+        }
+        bool ok = true;
+        for (RunMask remaining = mask; remaining;) {
+            TextureFile* file = lanefile[first_lane(remaining)];
+            RunMask group     = 0;
+            for (int i = 0; i < BatchWidth; ++i)
+                if ((remaining & (RunMask(1) << i)) && lanefile[i] == file)
+                    group |= RunMask(1) << i;
+            remaining &= ~group;
+            ok &= texture((TextureHandle*)file, (Perthread*)thread_info,
+                          options, group, sfrac, tfrac, dsdx_, dtdx_, dsdy_,
+                          dtdy_, nchannels, result, dresultds, dresultdt);
+        }
+        return ok;
+    }
+
+    texturefile = verify_texturefile(texturefile, thread_info);
+
+    int nlanes = 0;
+    for (RunMask m = mask; m; m >>= 1)
+        nlanes += int(m & 1);
+    ImageCacheStatistics& stats(thread_info->m_stats);
+    ++stats.texture_batches;
+    stats.texture_queries += nlanes;
+
+    TextureOpt opt;
+    opt.firstchannel        = options.firstchannel;
+    opt.subimage            = options.subimage;
+    opt.subimagename        = options.subimagename;
+    opt.swrap               = (TextureOpt::Wrap)options.swrap;
+    opt.twrap               = (TextureOpt::Wrap)options.twrap;
+    opt.mipmode             = (TextureOpt::MipMode)options.mipmode;
+    opt.interpmode          = (TextureOpt::InterpMode)options.interpmode;
+    opt.anisotropic         = options.anisotropic;
+    opt.conservative_filter = options.conservative_filter;
+    opt.fill                = options.fill;
+    opt.missingcolor        = options.missingcolor;
+    // rwrap not needed for 2D texture
+
+    // Store the same value (with zero derivatives) in all active lanes.
+    auto broadcast_result = [&](const float* r) {
+        for (int c = 0; c < nchannels; ++c) {
+            FloatWide(r[c]).store_mask(int(mask), result + c * BatchWidth);
+            if (dresultds) {
+                FloatWide::Zero().store_mask(int(mask),
+                                             dresultds + c * BatchWidth);
+                FloatWide::Zero().store_mask(int(mask),
+                                             dresultdt + c * BatchWidth);
+            }
+        }
+    };
+
+    if (!texturefile || texturefile->broken()) {
+        float r[4];
+        bool ok = missing_texture(opt, nchannels, r, nullptr, nullptr);
+        broadcast_result(r);
+        return ok;
+    }
+
+    if (!opt.subimagename.empty()) {
+        // If subimage was specified by name, figure out its index.
+        int s = m_imagecache->subimage_from_name(texturefile,
+                                                 opt.subimagename);
+        if (s < 0) {
+            error("Unknown subimage \"{}\" in texture \"{}\"",
+                  opt.subimagename, texturefile->filename());
+            float r[4];
+            bool ok = missing_texture(opt, nchannels, r, nullptr, nullptr);
+            broadcast_result(r);
+            return ok;
+        }
+        opt.subimage = s;
+        opt.subimagename.clear();
+    }
+
+    const ImageCacheFile::SubimageInfo& subinfo(
+        texturefile->subimageinfo(opt.subimage));
+    const ImageSpec& spec(texturefile->spec(opt.subimage, 0));
+
+    int actualchannels = OIIO::clamp(spec.nchannels - opt.firstchannel, 0,
+                                     nchannels);
+
+    // Figure out the wrap functions
+    if (opt.swrap == TextureOpt::WrapDefault)
+        opt.swrap = (TextureOpt::Wrap)texturefile->swrap();
+    if (opt.swrap == TextureOpt::WrapPeriodic && ispow2(spec.width))
+        opt.swrap = TextureOpt::WrapPeriodicPow2;
+    if (opt.twrap == TextureOpt::WrapDefault)
+        opt.twrap = (TextureOpt::Wrap)texturefile->twrap();
+    if (opt.twrap == TextureOpt::WrapPeriodic && ispow2(spec.height))
+        opt.twrap = TextureOpt::WrapPeriodicPow2;
+
+    if (subinfo.is_constant_image && opt.swrap != TextureOpt::WrapBlack
+        && opt.twrap != TextureOpt::WrapBlack) {
+        // Lookup of constant color texture, non-black wrap -- every lane
+        // gets the same answer, skip all the hard stuff.
+        float r[4];
+        for (int c = 0; c < actualchannels; ++c)
+            r[c] = subinfo.average_color[c + opt.firstchannel];
+        for (int c = actualchannels; c < nchannels; ++c)
+            r[c] = opt.fill;
+        if (actualchannels < nchannels && opt.firstchannel == 0
+            && m_gray_to_rgb)
+            fill_gray_channels(spec, nchannels, r, nullptr, nullptr);
+        broadcast_result(r);
+        return true;
+    }
+
+    // Remap the texture coordinates of all lanes at once.
+    FloatWide s(s_), t(t_), dsdx(dsdx_), dtdx(dtdx_), dsdy(dsdy_), dtdy(dtdy_);
+    if (m_flip_t) {
+        t    = FloatWide(1.0f) - t;
+        dtdx = -dtdx;
+        dtdy = -dtdy;
+    }
+    if (!subinfo.full_pixel_range) {  // remap st for overscan or crop
+        s = s * subinfo.sscale + subinfo.soffset;
+        dsdx *= subinfo.sscale;
+        dsdy *= subinfo.sscale;
+        t = t * subinfo.tscale + subinfo.toffset;
+        dtdx *= subinfo.tscale;
+        dtdy *= subinfo.tscale;
+    }
+
+    static const texture_lookup_prototype lookup_functions[] = {
+        // Must be in the same order as Mipmode enum
+        &TextureSystemImpl::texture_lookup,
+        &TextureSystemImpl::texture_lookup_nomip,
+        &TextureSystemImpl::texture_lookup_trilinear_mipmap,
+        &TextureSystemImpl::texture_lookup_trilinear_mipmap,
+        &TextureSystemImpl::texture_lookup,
+        &TextureSystemImpl::texture_lookup_trilinear_mipmap,
+        &TextureSystemImpl::texture_lookup
+    };
+    texture_lookup_prototype lookup = lookup_functions[(int)opt.mipmode];
+    bool aniso = (lookup == &TextureSystemImpl::texture_lookup);
+
+    // Bilinear lookups (including "smart bicubic" ones that turn out to
+    // be bilinear) are done for all lanes at once. Anything else is done
+    // one lane at a time by the single-point lookup functions.
+    RunMask bilinear_lanes = 0, single_lanes = mask;
+    if (opt.interpmode == TextureOpt::InterpBilinear
+        || opt.interpmode == TextureOpt::InterpSmartBicubic) {
+        bilinear_lanes = mask;
+        single_lanes   = 0;
+    }
+
+    // For the batched lanes: the MIP level(s) and their weights, and the
+    // line of samples along the major axis of the filter ellipse.
+    alignas(BatchAlign) int miplevel[2][BatchWidth];
+    alignas(BatchAlign) float levelweight[2][BatchWidth];
+    alignas(BatchAlign) float smajor[BatchWidth], tmajor[BatchWidth];
+    alignas(BatchAlign) float invsamples[BatchWidth];
+    int nsamples[BatchWidth];
+    int maxsamples        = 1;
+    int lineweight_stride = round_to_multiple_of_pow2(2 * opt.anisotropic, 4);
+    float* lineweight     = aniso && bilinear_lanes
+                                ? OIIO_ALLOCA(float,
+                                          BatchWidth * lineweight_stride)
+                                : nullptr;
+    for (int i = 0; i < BatchWidth; ++i) {
+        miplevel[0][i] = miplevel[1][i] = subinfo.min_mip_level;
+        levelweight[0][i]               = 1.0f;
+        levelweight[1][i]               = 0.0f;
+        smajor[i] = tmajor[i] = 0.0f;
+        invsamples[i]         = 1.0f;
+        nsamples[i]           = 1;
+    }
+
+    if (bilinear_lanes && opt.mipmode != TextureOpt::MipModeNoMIP) {
+        // Compute the filter footprint for all lanes at once.
+        FloatWide sfilt_noblur = max(max(abs(dsdx), abs(dsdy)),
+                                     FloatWide(1e-8f));
+        FloatWide tfilt_noblur = max(max(abs(dtdx), abs(dtdy)),
+                                     FloatWide(1e-8f));
+        FloatWide dsdx_w(dsdx), dtdx_w(dtdx), dsdy_w(dsdy), dtdy_w(dtdy);
+        adjust_width(dsdx_w, dtdx_w, dsdy_w, dtdy_w, FloatWide(options.swidth),
+                     FloatWide(options.twidth));
+        FloatWide majorlength, minorlength, theta_y, theta_x;
+        if (aniso) {
+            ellipse_axes(dsdx_w, dtdx_w, dsdy_w, dtdy_w, majorlength,
+                         minorlength, theta_y, theta_x);
+        } else {
+            FloatWide sfilt = max(abs(dsdx_w), abs(dsdy_w));
+            FloatWide tfilt = max(abs(dtdx_w), abs(dtdy_w));
+            majorlength     = opt.conservative_filter ? max(sfilt, tfilt)
+                                                      : min(sfilt, tfilt);
+            // account for blur
+            majorlength += max(FloatWide(options.sblur),
+                               FloatWide(options.tblur));
+            minorlength = majorlength;
+        }
+
+        // MIP level selection walks the level list, one lane at a time.
+        for (int i = 0; i < BatchWidth; ++i) {
+            if (!(bilinear_lanes & (RunMask(1) << i)))
+                continue;
+            opt.sblur     = options.sblur[i];
+            opt.tblur     = options.tblur[i];
+            opt.rnd       = options.rnd[i];
+            float major   = majorlength[i];
+            float minor   = minorlength[i];
+            float aspect  = 1.0f;
+            int* lev      = &miplevel[0][i];
+            float* levwt  = &levelweight[0][i];
+            int level[2]  = { -1, -1 };
+            float lw[2]   = { 0.0f, 0.0f };
+            float theta   = 0.0f;
+            float trueaspect = 1.0f;
+            if (aniso) {
+                theta = fast_atan2(theta_y[i], theta_x[i]) * 0.5f
+                        + float(M_PI_2);
+                adjust_blur(major, minor, theta, opt.sblur, opt.tblur);
+                aspect = anisotropic_aspect(major, minor, opt, trueaspect);
+            }
+            compute_miplevels(*texturefile, opt, major, minor, aspect, level,
+                              lw);
+            lev[0]                  = level[0];
+            lev[BatchWidth]         = level[1];
+            levwt[0]                = lw[0];
+            levwt[BatchWidth]       = lw[1];
+            if (aniso) {
+                if (trueaspect > stats.max_aniso)
+                    stats.max_aniso = trueaspect;  // FIXME?
+                nsamples[i] = compute_ellipse_sampling(
+                    aspect, theta, major, minor, smajor[i], tmajor[i],
+                    invsamples[i], lineweight + i * lineweight_stride);
+                // Derivs are pixel-to-pixel, so the ellipse sampling line
+                // needs to be halved (see texture_lookup).
+                smajor[i] *= 0.5f;
+                tmajor[i] *= 0.5f;
+                maxsamples = std::max(maxsamples, nsamples[i]);
+                if (opt.interpmode == TextureOpt::InterpSmartBicubic) {
+                    // Smart bicubic is bicubic when magnifying (or at the
+                    // finest level), which we leave to the single-point
+                    // lookup.
+                    int naturalsres = (int)(1.0f / sfilt_noblur[i]);
+                    int naturaltres = (int)(1.0f / tfilt_noblur[i]);
+                    for (int l = 0; l < 2; ++l) {
+                        if (!lw[l])
+                            continue;
+                        const ImageSpec& lspec(
+                            texturefile->spec(opt.subimage, level[l]));
+                        if (level[l] == 0 || lspec.width < naturalsres / 2
+                            || lspec.height < naturaltres / 2) {
+                            bilinear_lanes &= ~(RunMask(1) << i);
+                            single_lanes |= RunMask(1) << i;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    bool ok = true;
+    FloatWide accum[4], daccumds[4], daccumdt[4];
+    for (int c = 0; c < 4; ++c) {
+        accum[c]    = FloatWide::Zero();
+        daccumds[c] = FloatWide::Zero();
+        daccumdt[c] = FloatWide::Zero();
+    }
+
+    if (bilinear_lanes) {
+        // Sample all the batched lanes at once: for each step along the
+        // sampling line and each MIP level, one lane-parallel bilinear
+        // lookup of every lane that still has a sample there.
+        alignas(BatchAlign) float sval[BatchWidth], tval[BatchWidth];
+        alignas(BatchAlign) float weight[BatchWidth];
+        FloatWide smajor_w(smajor), tmajor_w(tmajor), invsamples_w(invsamples);
+        for (int sample = 0; sample < maxsamples; ++sample) {
+            FloatWide pos = 2.0f * ((float(sample) + 0.5f) * invsamples_w
+                                    - 0.5f);
+            (s + pos * smajor_w).store(sval);
+            (t + pos * tmajor_w).store(tval);
+            for (int level = 0; level < 2; ++level) {
+                RunMask lanes = 0;
+                for (int i = 0; i < BatchWidth; ++i) {
+                    weight[i] = 0.0f;
+                    if ((bilinear_lanes & (RunMask(1) << i))
+                        && levelweight[level][i] != 0.0f
+                        && sample < nsamples[i]) {
+                        weight[i] = levelweight[level][i];
+                        if (lineweight)
+                            weight[i] *= lineweight[i * lineweight_stride
+                                                    + sample];
+                        lanes |= RunMask(1) << i;
+                    }
+                }
+                if (lanes)
+                    ok &= sample_bilinear_batch(lanes, sval, tval,
+                                                miplevel[level], weight,
+                                                *texturefile, thread_info, opt,
+                                                nchannels, actualchannels,
+                                                accum, daccumds, daccumdt);
+            }
+        }
+
+        // Update stats
+        for (int i = 0; i < BatchWidth; ++i) {
+            if (!(bilinear_lanes & (RunMask(1) << i)))
+                continue;
+            int npointson = int(levelweight[0][i] != 0.0f)
+                            + int(levelweight[1][i] != 0.0f);
+            stats.aniso_queries += npointson;
+            stats.aniso_probes += npointson * nsamples[i];
+            stats.bilinear_interps += npointson * nsamples[i];
+        }
+    }
+
+    // The rest of the lanes go one at a time.
+    for (int i = 0; single_lanes && i < BatchWidth; ++i) {
+        if (!(single_lanes & (RunMask(1) << i)))
+            continue;
+        opt.sblur  = options.sblur[i];
+        opt.tblur  = options.tblur[i];
+        opt.swidth = options.swidth[i];
+        opt.twidth = options.twidth[i];
+        opt.rnd    = options.rnd[i];
+        // rblur, rwidth not needed for 2D texture
+        vfloat4 r, drds, drdt;
+        ok &= (this->*lookup)(*texturefile, thread_info, opt, nchannels,
+                              actualchannels, s[i], t[i], dsdx[i], dtdx[i],
+                              dsdy[i], dtdy[i], (float*)&r,
+                              dresultds ? (float*)&drds : nullptr,
+                              dresultds ? (float*)&drdt : nullptr);
+        for (int c = 0; c < nchannels; ++c) {
+            accum[c][i] = r[c];
+            if (dresultds) {
+                daccumds[c][i] = drds[c];
+                daccumdt[c][i] = drdt[c];
+            }
+        }
+    }
+
+    if (actualchannels < nchannels && opt.firstchannel == 0 && m_gray_to_rgb)
+        fill_gray_channels(spec, nchannels, accum,
+                           dresultds ? daccumds : nullptr,
+                           dresultds ? daccumdt : nullptr);
+
+    for (int c = 0; c < nchannels; ++c) {
+        accum[c].store_mask(int(mask), result + c * BatchWidth);
+        if (dresultds) {
+            if (m_flip_t)
+                daccumdt[c] = -daccumdt[c];
+            daccumds[c].store_mask(int(mask), dresultds + c * BatchWidth);
+            daccumdt[c].store_mask(int(mask), dresultdt + c * BatchWidth);
+        }
+    }
+    return ok;
+}
+
+
+
+bool
+TextureSystemImpl::sample_bilinear_batch(
+    Tex::RunMask mask, const float* s_, const float* t_, const int* miplevel_,
+    const float* weight_, TextureFile& texturefile, PerThreadInfo* thread_info,
+    TextureOpt& options, int nchannels_result, int actualchannels,
+    Tex::FloatWide* accum, Tex::FloatWide* daccumds, Tex::FloatWide* daccumdt)
+{
+    using namespace Tex;
+    typedef IntWide::vbool_t BoolWide;
+    bool allok                   = true;
+    TypeDesc::BASETYPE pixeltype = texturefile.pixeltype(options.subimage);
+    size_t channelsize           = texturefile.channelsize(options.subimage);
+    wrap_impl_wide swrap_func    = wrap_functions_wide[(int)options.swrap];
+    wrap_impl_wide twrap_func    = wrap_functions_wide[(int)options.twrap];
+    bool use_fill    = (nchannels_result > actualchannels && options.fill);
+    int firstchannel = options.firstchannel;
+    FloatWide s(s_), t(t_), weight(weight_);
+    IntWide levels(miplevel_);
+
+    while (mask) {
+        // Take all the lanes that use the same MIP level as the first
+        // remaining lane.
+        int miplevel       = miplevel_[first_lane(mask)];
+        RunMask levellanes = mask
+                             & RunMask((levels == IntWide(miplevel)).bitmask());
+        mask &= ~levellanes;
+
+        const ImageSpec& spec(texturefile.spec(options.subimage, miplevel));
+        const ImageCacheFile::LevelInfo& levelinfo(
+            texturefile.levelinfo(options.subimage, miplevel));
+        int tile_chbegin = 0, tile_chend = spec.nchannels;
+        // need_pole: do we potentially need to fade to special pole color?
+        // If we do, can't restrict channel range or fade_to_pole won't work.
+        bool need_pole = (options.envlayout == LayoutLatLong
+                          && levelinfo.onetile);
+        if (spec.nchannels > m_max_tile_channels && !need_pole) {
+            // For files with many channels, narrow the range we cache
+            tile_chbegin = options.firstchannel;
+            tile_chend   = options.firstchannel + actualchannels;
+        }
+        TileID id(texturefile, options.subimage, miplevel, 0, 0, 0,
+                  tile_chbegin, tile_chend);
+
+        // Convert to texel coordinates and wrap, for all lanes at once.
+        // See st_to_texel for the two sample border conventions.
+        FloatWide sc, tc;
+        if (texturefile.sample_border() == 0) {
+            sc = s * float(spec.width) + (spec.x - 0.5f);
+            tc = t * float(spec.height) + (spec.y - 0.5f);
+        } else {
+            sc = s * float(spec.width - 1) + float(spec.x);
+            tc = t * float(spec.height - 1) + float(spec.y);
+        }
+        IntWide s0, t0;
+        FloatWide sfrac = floorfrac(sc, &s0);
+        FloatWide tfrac = floorfrac(tc, &t0);
+        IntWide s1 = s0 + IntWide(1), t1 = t0 + IntWide(1);
+        IntWide xorigin(spec.x), yorigin(spec.y);
+        IntWide width(spec.width), height(spec.height);
+        BoolWide s0valid = swrap_func(s0, xorigin, width);
+        BoolWide s1valid = swrap_func(s1, xorigin, width);
+        BoolWide t0valid = twrap_func(t0, yorigin, height);
+        BoolWide t1valid = twrap_func(t1, yorigin, height);
+        if (!levelinfo.full_pixel_range) {  // Account for crop windows
+            s0valid = s0valid & (s0 >= xorigin) & (s0 < (xorigin + width));
+            s1valid = s1valid & (s1 >= xorigin) & (s1 < (xorigin + width));
+            t0valid = t0valid & (t0 >= yorigin) & (t0 < (yorigin + height));
+            t1valid = t1valid & (t1 >= yorigin) & (t1 < (yorigin + height));
+        }
+
+        IntWide tilew(spec.tile_width), tileh(spec.tile_height);
+        IntWide tile_s = s0 - xorigin, tile_t = t0 - yorigin;
+        if (ispow2(spec.tile_width) && ispow2(spec.tile_height)) {
+            tile_s = tile_s & (tilew - IntWide(1));
+            tile_t = tile_t & (tileh - IntWide(1));
+        } else {
+            tile_s = tile_s % tilew;
+            tile_t = tile_t % tileh;
+        }
+        IntWide tile_x = s0 - tile_s, tile_y = t0 - tile_t;
+
+        // The fast lanes have all four texels valid and on one tile. Lanes
+        // straddling tiles or the black wrap region go one at a time, and
+        // lanes entirely in the black wrap region contribute nothing.
+        BoolWide onetile = (tile_s != (tilew - IntWide(1)))
+                           & (s1 == (s0 + IntWide(1)))
+                           & (tile_t != (tileh - IntWide(1)))
+                           & (t1 == (t0 + IntWide(1)));
+        BoolWide allvalid = s0valid & s1valid & t0valid & t1valid;
+        BoolWide anyvalid = s0valid | s1valid | t0valid | t1valid;
+        RunMask fastlanes = need_pole ? RunMask(0)
+                                      : (levellanes
+                                         & RunMask((onetile & allvalid)
+                                                       .bitmask()));
+        RunMask slowlanes = levellanes & ~fastlanes
+                            & RunMask(anyvalid.bitmask());
+
+        if (fastlanes) {
+            // Gather the texels into SOA layout, [corner][channel][lane],
+            // with one tile lookup for each set of lanes on the same tile.
+            alignas(BatchAlign) float texel[4][4][BatchWidth];
+            std::memset(texel, 0, sizeof(texel));
+            for (RunMask remaining = fastlanes; remaining;) {
+                int lane = first_lane(remaining);
+                RunMask tilelanes
+                    = remaining
+                      & RunMask(((tile_x == IntWide(tile_x[lane]))
+                                 & (tile_y == IntWide(tile_y[lane])))
+                                    .bitmask());
+                remaining &= ~tilelanes;
+                id.xy(tile_x[lane], tile_y[lane]);
+                bool ok = find_tile(id, thread_info, true);
+                if (!ok)
+                    error("{}", m_imagecache->geterror());
+                TileRef& tile(thread_info->tile);
+                if (!tile || !tile->valid())
+                    return false;
+                size_t pixelsize = tile->pixelsize();
+                size_t rowsize   = pixelsize * spec.tile_width;
+                const unsigned char* base
+                    = tile->bytedata()
+                      + channelsize * (firstchannel - id.chbegin());
+                for (int i = lane; i < BatchWidth; ++i) {
+                    if (!(tilelanes & (RunMask(1) << i)))
+                        continue;
+                    const unsigned char* p
+                        = base + tile->pixel_offset(tile_s[i], tile_t[i]);
+                    vfloat4 t00 = texel_to_float4(p, pixeltype);
+                    vfloat4 t01 = texel_to_float4(p + pixelsize, pixeltype);
+                    vfloat4 t10 = texel_to_float4(p + rowsize, pixeltype);
+                    vfloat4 t11 = texel_to_float4(p + rowsize + pixelsize,
+                                                  pixeltype);
+                    for (int c = 0; c < 4; ++c) {
+                        texel[0][c][i] = t00[c];
+                        texel[1][c][i] = t01[c];
+                        texel[2][c][i] = t10[c];
+                        texel[3][c][i] = t11[c];
+                    }
+                }
+            }
+
+            // Filter all the fast lanes at once, one channel at a time.
+            FloatWide w = select(BoolWide::from_bitmask(int(fastlanes)),
+                                 weight, FloatWide::Zero());
+            for (int c = 0; c < actualchannels; ++c) {
+                FloatWide t00(texel[0][c]), t01(texel[1][c]);
+                FloatWide t10(texel[2][c]), t11(texel[3][c]);
+                accum[c] += w * bilerp(t00, t01, t10, t11, sfrac, tfrac);
+                if (daccumds) {
+                    daccumds[c] += (w * float(spec.width))
+                                   * lerp(t01 - t00, t11 - t10, tfrac);
+                    daccumdt[c] += (w * float(spec.height))
+                                   * lerp(t10 - t00, t11 - t01, sfrac);
+                }
+            }
+            if (use_fill) {
+                // All texels were valid, so these lanes get the full
+                // weighted fill color in the extra channels.
+                for (int c = actualchannels; c < nchannels_result; ++c)
+                    accum[c] += w * options.fill;
+            }
+        }
+
+        for (int i = 0; slowlanes && i < BatchWidth; ++i) {
+            if (!(slowlanes & (RunMask(1) << i)))
+                continue;
+            OIIO_SIMD4_ALIGN float sval[4] = { s_[i], 0.0f, 0.0f, 0.0f };
+            OIIO_SIMD4_ALIGN float tval[4] = { t_[i], 0.0f, 0.0f, 0.0f };
+            static OIIO_SIMD4_ALIGN float unitweight[4] = { 1.0f, 0.0f, 0.0f,
+                                                            0.0f };
+            vfloat4 r, drds, drdt;
+            allok &= sample_bilinear(1, sval, tval, miplevel, texturefile,
+                                     thread_info, options, nchannels_result,
+                                     actualchannels, unitweight, &r,
+                                     daccumds ? &drds : nullptr,
+                                     daccumds ? &drdt : nullptr);
+            float w = weight_[i];
+            for (int c = 0; c < nchannels_result; ++c) {
+                accum[c][i] += w * r[c];
+                if (daccumds) {
+                    daccumds[c][i] += w * drds[c];
+                    daccumdt[c][i] += w * drdt[c];
+                }
+            }
+        }
+    }
+    return allok;
+}
+
+
+
 const float*
 TextureSystemImpl::pole_color(TextureFile& texturefile,
                               PerThreadInfo* /*thread_info*/,
@@ -1593,6 +1593,12 @@ void test_mathfuncs ()
                 mkvec<VEC>(fast_log(expA[0]), fast_log(expA[1]), fast_log(expA[2]), fast_log(expA[3])), 0.00001f);
     OIIO_CHECK_SIMD_EQUAL_THRESH (fast_pow_pos(VEC(2.0f), A),
                            mkvec<VEC>(0.5f, 1.0f, 2.0f, 22.62741699796952f), 0.0001f);
+    VEC C = mkvec<VEC> (-1.0f, -0.3f, 0.0f, 0.8f);
+    VEC D = mkvec<VEC> (0.5f, -2.0f, -0.0f, 0.0f);
+    OIIO_CHECK_SIMD_EQUAL_THRESH (fast_acos(C),
+                mkvec<VEC>(fast_acos(C[0]), fast_acos(C[1]), fast_acos(C[2]), fast_acos(C[3])), 1e-6f);
+    OIIO_CHECK_SIMD_EQUAL_THRESH (fast_atan2(C, D),
+                mkvec<VEC>(fast_atan2(C[0], D[0]), fast_atan2(C[1], D[1]), fast_atan2(C[2], D[2]), fast_atan2(C[3], D[3])), 1e-6f);
 
     OIIO_CHECK_SIMD_EQUAL (safe_div(mkvec<VEC>(1.0f,2.0f,3.0f,4.0f), mkvec<VEC>(2.0f,0.0f,2.0f,0.0f)),
                            mkvec<VEC>(0.5f,0.0f,1.5f,0.0f));
@@ -1406,6 +1406,42 @@ Strutil::base64_encode(string_view str)
 
 
 
+std::string
+Strutil::base64_decode(string_view str)
+{
+    auto decode = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z')
+            return c - 'A';
+        if (c >= 'a' && c <= 'z')
+            return c - 'a' + 26;
+        if (c >= '0' && c <= '9')
+            return c - '0' + 52;
+        if (c == '+')
+            return 62;
+        if (c == '/')
+            return 63;
+        return -1;
+    };
+    std::string ret;
+    ret.reserve(str.size() * 3 / 4);
+    unsigned int bits = 0;
+    int nbits         = 0;
+    for (char c : str) {
+        int d = decode(c);
+        if (d < 0)
+            break;
+        bits = (bits << 6) | unsigned(d);
+        nbits += 6;
+        if (nbits >= 8) {
+            nbits -= 8;
+            ret += char((bits >> nbits) & 0xff);
+        }
+    }
+    return ret;
+}
+
+
+
 // Helper: Eat the given number of chars from str, then return the next
 // char, or 0 if no more chars are in str.
 inline unsigned char
@@ -1488,6 +1488,25 @@ test_edit_distance()
 
 
 
+void
+test_base64()
+{
+    using namespace Strutil;
+    print("test_base64\n");
+    OIIO_CHECK_EQUAL(base64_encode("foob"), "Zm9vYg==");
+    OIIO_CHECK_EQUAL(base64_decode("Zm9vYg=="), "foob");
+    OIIO_CHECK_EQUAL(base64_decode("Zm9vYmFy"), "foobar");
+    OIIO_CHECK_EQUAL(base64_decode(""), "");
+    std::string bytes;
+    for (int i = 0; i < 256; ++i)
+        bytes += char(i);
+    for (size_t n = 0; n <= 4; ++n)
+        OIIO_CHECK_EQUAL(base64_decode(base64_encode(bytes.substr(n))),
+                         bytes.substr(n));
+}
+
+
+
 int
 main(int /*argc*/, char* /*argv*/[])
 {
@@ -1520,6 +1539,7 @@ main(int /*argc*/, char* /*argv*/[])
     test_string_compare_function();
     test_datetime();
     test_edit_distance();
+    test_base64();
 
     return unit_test_failures;
 }
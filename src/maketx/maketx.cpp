@@ -148,7 +148,7 @@ getargs(int argc, char* argv[], ImageSpec& configspec)
     std::string dataformatname = "";
     std::string fileformatname = "";
     std::vector<std::string> mipimages;
-    int tile[3] = { 64, 64, 1 };  // FIXME if we ever support volume MIPmaps
+    int tile[3] = { 64, 64, 1 };
     std::string compression = "zip";
     bool updatemode         = false;
     bool checknan           = false;
@@ -170,6 +170,7 @@ getargs(int argc, char* argv[], ImageSpec& configspec)
     bool monochrome_detect     = false;
     bool opaque_detect         = false;
     bool compute_average       = true;
+    bool tile_stats            = false;
     int nchannels              = -1;
     bool prman                 = false;
     bool oiio                  = false;
@@ -218,6 +219,8 @@ getargs(int argc, char* argv[], ImageSpec& configspec)
       .help("Set the output data format to one of: uint8, sint8, uint16, sint16, half, float");
     ap.arg("--tile %d:WIDTH %d:HEIGHT", &tile[0], &tile[1])
       .help("Specify tile size");
+    ap.arg("--tiledepth %d:DEPTH", &tile[2])
+      .help("Specify tile depth (for volume textures)");
     ap.arg("--separate", &separate)
       .help("Use planarconfig separate (default: contiguous)");
     ap.arg("--compression %s:NAME", &compression)
@@ -282,6 +285,8 @@ getargs(int argc, char* argv[], ImageSpec& configspec)
       .help("Drop alpha channel that is always 1.0");
     ap.arg("--no-compute-average %!", &compute_average)
       .help("Don't compute and store average color");
+    ap.arg("--tilestats", &tile_stats)
+      .help("Store the min, max, and average of every tile");
     ap.arg("--ignore-unassoc", &ignore_unassoc)
       .help("Ignore unassociated alpha tags in input (don't autoconvert)");
     ap.arg("--runstats", &runstats)
@@ -417,6 +422,7 @@ getargs(int argc, char* argv[], ImageSpec& configspec)
     configspec.attribute("maketx:monochrome_detect", monochrome_detect);
     configspec.attribute("maketx:opaque_detect", opaque_detect);
     configspec.attribute("maketx:compute_average", compute_average);
+    configspec.attribute("maketx:tile_stats", tile_stats);
     configspec.attribute("maketx:unpremult", unpremult);
     configspec.attribute("maketx:incolorspace", incolorspace);
     configspec.attribute("maketx:outcolorspace", outcolorspace);
@@ -5127,6 +5127,8 @@ prep_texture_config(ImageSpec& configspec, ParamValueList& fileoptions)
                          fileoptions.get_int("opaque_detect"));
     configspec.attribute("maketx:compute_average",
                          fileoptions.get_int("compute_average", 1));
+    configspec.attribute("maketx:tile_stats",
+                         fileoptions.get_int("tile_stats"));
     configspec.attribute("maketx:unpremult", fileoptions.get_int("unpremult"));
     configspec.attribute("maketx:incolorspace",
                          fileoptions.get_string("incolorspace"));
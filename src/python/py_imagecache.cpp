@@ -117,6 +117,16 @@ declare_imagecache(py::module& m)
         // .def("get_thumbnail", &ImageCacheWrap::get_thumbnail,
         //      "subimage"_a=0)
         .def("get_pixels", &ImageCacheWrap::get_pixels)
+        .def(
+            "prefetch",
+            [](ImageCacheWrap& ic, const std::string& filename, int subimage,
+               int miplevel, ROI roi, int chbegin, int chend) {
+                py::gil_scoped_release gil;
+                return ic.m_cache->prefetch(ustring(filename), subimage,
+                                            miplevel, roi, chbegin, chend);
+            },
+            "filename"_a, "subimage"_a = 0, "miplevel"_a = 0,
+            "roi"_a = ROI::All(), "chbegin"_a = 0, "chend"_a = -1)
         // .def("get_tile", &ImageCacheWrap::get_tile)
         // .def("release_tile", &ImageCacheWrap::release_tile)
         // .def("tile_pixels", &ImageCacheWrap::tile_pixels)
@@ -138,6 +148,11 @@ declare_imagecache(py::module& m)
                 return PY_STR(ic.m_cache->getstats(level));
             },
             "level"_a = 1)
+        .def("access_stats_json",
+             [](ImageCacheWrap& ic) {
+                 py::gil_scoped_release gil;
+                 return PY_STR(ic.m_cache->access_stats_json());
+             })
         .def(
             "invalidate",
             [](ImageCacheWrap& ic, const std::string& filename, bool force) {
@@ -332,6 +332,13 @@ declare_texturesystem(py::module& m)
                 return ret;
             },
             "filename"_a)
+        .def(
+            "prewarm_udim",
+            [](TextureSystemWrap& ts, const std::string& filename) {
+                py::gil_scoped_release gil;
+                ts.m_texsys->prewarm_udim(ustring(filename));
+            },
+            "filename"_a)
         .def(
             "invalidate",
             [](TextureSystemWrap& ts, const std::string& filename, bool force) {
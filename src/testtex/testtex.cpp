@@ -10,6 +10,8 @@
 #include <ctime>
 #include <iostream>
 #include <iterator>
+#include <memory>
+#include <type_traits>
 
 #include <OpenImageIO/Imath.h>
 #include <OpenImageIO/argparse.h>
@@ -58,6 +60,7 @@ static bool filtertest        = false;
 static TextureSystem* texsys  = NULL;
 static std::string searchpath;
 static bool batch        = false;
+static bool batchbench   = false;
 static bool nowarp       = false;
 static bool tube         = false;
 static bool use_handle   = false;
@@ -83,9 +86,11 @@ static bool test_statquery         = false;
 static bool invalidate_before_iter = true;
 static bool close_before_iter      = false;
 static bool runstats               = false;
+static bool udimprewarm            = false;
 static Imath::M33f xform;
 static std::string texoptions;
 static std::string gtiname;
+static std::string replayname;
 void* dummyptr;
 
 typedef void (*Mapping2D)(const int&, const int&, float&, float&, float&,
@@ -162,6 +167,8 @@ getargs(int argc, const char* argv[])
       .help("Set auto-MIPmap for the image cache");
     ap.arg("--batch", &batch)
       .help(Strutil::sprintf("Use batched shading, batch size = %d", Tex::BatchWidth));
+    ap.arg("--batchbench", &batchbench)
+      .help("Benchmark batched vs. single-point texture lookups");
     ap.arg("--handle", &use_handle)
       .help("Use texture handle rather than name lookup");
     ap.arg("--searchpath %s:PATHLIST", &searchpath)
@@ -208,6 +215,8 @@ getargs(int argc, const char* argv[])
       .help("Test the tile hashing function");
     ap.arg("--threadtimes %d:MODE", &threadtimes)
       .help("Do thread timings (arg = workload profile)");
+    ap.arg("--udimprewarm", &udimprewarm)
+      .help("Prewarm the UDIM set before each --threadtimes trial (for workload 9)");
     ap.arg("--trials %d:N", &ntrials)
       .help("Number of trials for timings");
     ap.arg("--wedge", &wedge)
@@ -222,12 +231,14 @@ getargs(int argc, const char* argv[])
       .help("Test queries of statistics");
     ap.arg("--runstats", &runstats)
       .help("Print runtime statistics");
+    ap.arg("--replay %s:TRACEFILE", &replayname)
+      .help("Replay a tile trace recorded by the ImageCache \"tile_trace\" option (uses --threads, --iters)");
 
     // clang-format on
     ap.parse(argc, argv);
 
     if (filenames.size() < 1 && !test_construction && !test_getimagespec
-        && !testhash) {
+        && !testhash && replayname.empty()) {
         std::cerr << "testtex: Must have at least one input file\n";
         ap.usage();
         exit(EXIT_FAILURE);
@@ -775,6 +786,98 @@ plain_tex_region_batch(ImageBuf& image, ustring filename, Mapping2DWide mapping,
 }
 
 
+// An array of `n` default-constructed values of a type such as
+// Tex::FloatWide that needs more alignment than std::vector guarantees
+// before C++17.
+struct AlignedFree {
+    void operator()(void* p) const { aligned_free(p); }
+};
+template<typename T> using AlignedArray = std::unique_ptr<T[], AlignedFree>;
+
+template<typename T>
+static AlignedArray<T>
+make_aligned_array(size_t n)
+{
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "AlignedArray does not run destructors");
+    T* p = (T*)aligned_malloc(std::max(n, size_t(1)) * sizeof(T), alignof(T));
+    for (size_t i = 0; i < n; ++i)
+        new (p + i) T();
+    return AlignedArray<T>(p);
+}
+
+
+
+// Compare the throughput of `nbatches` batched lookups, each done by
+// batched(b, result), against the same points done one at a time by
+// single(b, i, result), for `nchannels` channels of results.
+static void
+bench_batch_vs_single(string_view name, int nbatches, int nchannels,
+                      const std::function<void(int, float*)>& batched,
+                      const std::function<void(int, int, float*)>& single)
+{
+    auto result = make_aligned_array<Tex::FloatWide>(nchannels);
+    std::vector<float> r(nchannels);
+    Benchmarker bench;
+    bench.work(size_t(nbatches * Tex::BatchWidth));
+    bench.units(Benchmarker::Unit::ns);
+    bench(Strutil::fmt::format("{} batched ", name), [&]() {
+        for (int b = 0; b < nbatches; ++b)
+            batched(b, (float*)result.get());
+        DoNotOptimize(result[0]);
+    });
+    bench(Strutil::fmt::format("{} single  ", name), [&]() {
+        for (int b = 0; b < nbatches; ++b)
+            for (int i = 0; i < Tex::BatchWidth; ++i)
+                single(b, i, r.data());
+        DoNotOptimize(r[0]);
+    });
+}
+
+
+
+// Compare the throughput of batched texture lookups against doing the
+// same points one at a time, over one row of the warped mapping.
+static void
+bench_batch_texture(ustring filename, Mapping2DWide mapping)
+{
+    using namespace Tex;
+    std::cout << "\nBenchmarking batched vs. single-point texture "
+              << filename << " (batch size = " << BatchWidth << ")\n";
+    TextureSystem::Perthread* perthread_info     = texsys->get_perthread_info();
+    TextureSystem::TextureHandle* texture_handle = texsys->get_texture_handle(
+        filename);
+    const int nchannels = nchannels_override ? nchannels_override : 4;
+    const int nbatches  = std::max(1, output_xres / BatchWidth);
+    auto s    = make_aligned_array<FloatWide>(nbatches);
+    auto t    = make_aligned_array<FloatWide>(nbatches);
+    auto dsdx = make_aligned_array<FloatWide>(nbatches);
+    auto dtdx = make_aligned_array<FloatWide>(nbatches);
+    auto dsdy = make_aligned_array<FloatWide>(nbatches);
+    auto dtdy = make_aligned_array<FloatWide>(nbatches);
+    for (int b = 0; b < nbatches; ++b)
+        mapping(IntWide::Iota(b * BatchWidth), IntWide(output_yres / 2), s[b],
+                t[b], dsdx[b], dtdx[b], dsdy[b], dtdy[b]);
+    TextureOptBatch optbatch;
+    initialize_opt(optbatch);
+    TextureOpt opt;
+    initialize_opt(opt);
+    bench_batch_vs_single(
+        "texture", nbatches, nchannels,
+        [&](int b, float* result) {
+            texsys->texture(texture_handle, perthread_info, optbatch, RunMaskOn,
+                            s[b].data(), t[b].data(), dsdx[b].data(),
+                            dtdx[b].data(), dsdy[b].data(), dtdy[b].data(),
+                            nchannels, result);
+        },
+        [&](int b, int i, float* result) {
+            texsys->texture(texture_handle, perthread_info, opt, s[b][i],
+                            t[b][i], dsdx[b][i], dtdx[b][i], dsdy[b][i],
+                            dtdy[b][i], nchannels, result);
+        });
+}
+
+
 
 void
 test_plain_texture_batch(Mapping2DWide mapping)
@@ -964,6 +1067,50 @@ test_texture3d(ustring filename, Mapping3D mapping)
 }
 
 
+// Compare the throughput of batched volume lookups against doing the same
+// points one at a time, over one row of the mapping.
+static void
+bench_batch_texture3d(ustring filename, Mapping3DWide mapping)
+{
+    using namespace Tex;
+    std::cout << "\nBenchmarking batched vs. single-point texture3d "
+              << filename << " (batch size = " << BatchWidth << ")\n";
+    TextureSystem::Perthread* perthread_info     = texsys->get_perthread_info();
+    TextureSystem::TextureHandle* texture_handle = texsys->get_texture_handle(
+        filename);
+    const int nchannels = nchannels_override ? nchannels_override : 4;
+    const int nbatches  = std::max(1, output_xres / BatchWidth);
+    auto P    = make_aligned_array<Imath::Vec3<FloatWide>>(nbatches);
+    auto dPdx = make_aligned_array<Imath::Vec3<FloatWide>>(nbatches);
+    auto dPdy = make_aligned_array<Imath::Vec3<FloatWide>>(nbatches);
+    auto dPdz = make_aligned_array<Imath::Vec3<FloatWide>>(nbatches);
+    for (int b = 0; b < nbatches; ++b)
+        mapping(IntWide::Iota(b * BatchWidth), IntWide(output_yres / 2), P[b],
+                dPdx[b], dPdy[b], dPdz[b]);
+    TextureOptBatch optbatch;
+    initialize_opt(optbatch);
+    TextureOpt opt;
+    initialize_opt(opt);
+    auto point = [](const Imath::Vec3<FloatWide>& v, int i) {
+        return Imath::V3f(v.x[i], v.y[i], v.z[i]);
+    };
+    bench_batch_vs_single(
+        "texture3d", nbatches, nchannels,
+        [&](int b, float* result) {
+            texsys->texture3d(texture_handle, perthread_info, optbatch,
+                              RunMaskOn, (float*)&P[b], (float*)&dPdx[b],
+                              (float*)&dPdy[b], (float*)&dPdz[b], nchannels,
+                              result);
+        },
+        [&](int b, int i, float* result) {
+            texsys->texture3d(texture_handle, perthread_info, opt,
+                              point(P[b], i), point(dPdx[b], i),
+                              point(dPdy[b], i), point(dPdz[b], i), nchannels,
+                              result);
+        });
+}
+
+
 
 void
 test_texture3d_batch(ustring filename, Mapping3DWide mapping)
@@ -1177,6 +1324,7 @@ static const char* workload_names[] = {
     /*6*/ "Coherent access, many files, each thread in different spots",
     /*7*/ "Coherent access, many files, partially overlapping texture sets",
     /*8*/ "Coherent access, many files, partially overlapping texture sets, no extra busy work",
+    /*9*/ "UDIM access through the pattern's handle, each lookup on a different tile",
     NULL
 };
 
@@ -1200,8 +1348,31 @@ do_tex_thread_workout(int iterations, int mythread)
     for (auto f : filenames)
         texture_handles.emplace_back(texsys->get_texture_handle(f));
 
+    // For the UDIM workload, lookups go through the handle of the UDIM
+    // pattern, but take their resolution from its first tile.
+    ustring specfile = filenames[0];
+    std::vector<Imath::V2i> udimtiles;
+    if (threadtimes == 9) {
+        std::vector<ustring> tilenames;
+        int nutiles = 0, nvtiles = 0;
+        texsys->inventory_udim(texture_handles[0], perthread_info, tilenames,
+                               nutiles, nvtiles);
+        for (int i = 0, n = nutiles * nvtiles; i < n; ++i) {
+            if (tilenames[i].empty())
+                continue;  // unpopulated
+            if (udimtiles.empty())
+                specfile = tilenames[i];
+            udimtiles.emplace_back(i % nutiles, i / nutiles);
+        }
+        if (udimtiles.empty()) {
+            Strutil::print(std::cerr, "{} is not a UDIM pattern\n",
+                           filenames[0]);
+            return;
+        }
+    }
+
     ImageSpec spec0;
-    bool ok = texsys->get_imagespec(filenames[0], 0, spec0);
+    bool ok = texsys->get_imagespec(specfile, 0, spec0);
     if (!ok) {
         Strutil::fprintf(std::cerr, "Unexpected error: %s\n",
                          texsys->geterror());
@@ -1277,6 +1448,23 @@ do_tex_thread_workout(int iterations, int mythread)
                 pixel += 57557 * mythread;
             }
             break;
+        case 9:
+            // Workload 9: Like OSL shading a UDIM asset: every lookup is
+            // made with the UDIM pattern's handle, and lands on a
+            // different tile of the set than the last one did.
+            {
+                int ntiles = int(udimtiles.size());
+                const Imath::V2i& tile(udimtiles[(i + 7 * mythread) % ntiles]);
+                pixel = i / ntiles + 57557 * mythread;
+                s = (((2 * pixel) % spec0.width) + 0.5f) / spec0.width;
+                t = (((2 * ((2 * pixel) / spec0.width)) % spec0.height) + 0.5f)
+                    / spec0.height;
+                ok = texsys->texture(texture_handles[0], perthread_info, opt,
+                                     s + tile.x, t + tile.y, dsdx, dtdx, dsdy,
+                                     dtdy, nchannels, result, dresultds,
+                                     dresultdt);
+            }
+            break;
         default:
             OIIO_ASSERT_MSG(0, "Unkonwn thread work pattern %d", threadtimes);
         }
@@ -1320,6 +1508,8 @@ launch_tex_threads(int numthreads, int iterations)
 {
     if (invalidate_before_iter)
         texsys->invalidate_all(true);
+    if (udimprewarm)
+        texsys->prewarm_udim(filenames[0]);
     OIIO::thread_group threads;
     for (int i = 0; i < numthreads; ++i) {
         threads.create_thread(std::bind(do_tex_thread_workout, iterations, i));
@@ -1330,6 +1520,103 @@ launch_tex_threads(int numthreads, int iterations)
 
 
 
+// Play back the tile requests of a trace recorded with the ImageCache
+// "tile_trace" attribute --iters times over, the requests of recorded
+// thread i in order on replay thread i % nthreads, and report how the
+// cache fared.
+static void
+replay_tile_trace()
+{
+    using OIIO::pvt::TileTrace;
+    using OIIO::pvt::TileTraceRecord;
+    std::vector<ustring> files;
+    std::vector<TileTraceRecord> records;
+    std::string err;
+    if (!TileTrace::read(replayname, files, records, err)) {
+        std::cerr << "testtex: " << err << "\n";
+        return;
+    }
+    int nt = nthreads ? nthreads : Sysutil::hardware_concurrency();
+    std::vector<std::vector<const TileTraceRecord*>> perthread(nt);
+    uint32_t nrecorded = 0;
+    uint64_t duration  = 0;
+    for (const auto& r : records) {
+        perthread[r.thread % nt].push_back(&r);
+        nrecorded = std::max(nrecorded, r.thread + 1);
+        duration  = std::max(duration, r.time);
+    }
+    for (auto& requests : perthread)
+        std::stable_sort(requests.begin(), requests.end(),
+                         [](const TileTraceRecord* a,
+                            const TileTraceRecord* b) {
+                             return a->time < b->time;
+                         });
+
+    ImageCache* ic = texsys->imagecache();
+    if (invalidate_before_iter)
+        ic->invalidate_all(true);
+    ic->reset_stats();
+    std::atomic<long long> failures(0);
+    auto replay = [&](int t) {
+        ImageCache::Perthread* thread_info = ic->get_perthread_info();
+        std::vector<ImageCache::ImageHandle*> handles(files.size(), nullptr);
+        for (int i = 0; i < iters; ++i) {
+            for (const TileTraceRecord* r : perthread[t]) {
+                auto& handle(handles[r->file]);
+                if (!handle)
+                    handle = ic->get_image_handle(files[r->file], thread_info);
+                ImageCache::Tile* tile
+                    = ic->get_tile(handle, thread_info, r->subimage,
+                                   r->miplevel, r->x, r->y, r->z, r->chbegin,
+                                   r->chend);
+                if (tile)
+                    ic->release_tile(tile);
+                else
+                    ++failures;
+            }
+        }
+    };
+    Timer timer;
+    OIIO::thread_group threads;
+    for (int t = 0; t < nt; ++t)
+        threads.create_thread(replay, t);
+    threads.join_all();
+    double walltime = timer();
+    ic->geterror();  // Failures are counted; don't leave errors behind
+
+    long long calls = 0, microcache_misses = 0, bytesread = 0;
+    int cache_misses = 0;
+    float iotime = 0.0f, filelocktime = 0.0f, tilelocktime = 0.0f;
+    ic->getattribute("stat:find_tile_calls", TypeInt64, &calls);
+    ic->getattribute("stat:find_tile_microcache_misses", TypeInt64,
+                     &microcache_misses);
+    ic->getattribute("stat:find_tile_cache_misses", TypeInt, &cache_misses);
+    ic->getattribute("stat:bytes_read", TypeInt64, &bytesread);
+    ic->getattribute("stat:fileio_time", TypeFloat, &iotime);
+    ic->getattribute("stat:file_locking_time", TypeFloat, &filelocktime);
+    ic->getattribute("stat:tile_locking_time", TypeFloat, &tilelocktime);
+    calls = std::max(calls, 1LL);
+    Strutil::print("Replayed {} tile requests x {} ({} files, {} recorded "
+                   "threads over {}) on {} threads\n",
+                   records.size(), iters, files.size(), nrecorded,
+                   Strutil::timeintervalformat(duration * 1.0e-9, 2), nt);
+    Strutil::print("  cache size {} MB, wall time {}\n", cachesize,
+                   Strutil::timeintervalformat(walltime, 2));
+    Strutil::print("  micro-cache hit rate {:.2f}%, cache hit rate {:.2f}%\n",
+                   100.0 * (calls - microcache_misses) / calls,
+                   100.0 * (calls - cache_misses) / calls);
+    Strutil::print("  read {} in {} (I/O time)\n",
+                   Strutil::memformat(bytesread),
+                   Strutil::timeintervalformat(iotime, 2));
+    Strutil::print("  lock wait time: files {}, tiles {}\n",
+                   Strutil::timeintervalformat(filelocktime, 2),
+                   Strutil::timeintervalformat(tilelocktime, 2));
+    if (failures)
+        Strutil::print("  {} requests failed\n", failures.load());
+}
+
+
+
 class GridImageInput final : public ImageInput {
 public:
     GridImageInput()
@@ -1553,6 +1840,11 @@ main(int argc, const char* argv[])
         test_hash();
     }
 
+    if (replayname.size()) {
+        replay_tile_trace();
+        iters = 0;
+    }
+
     Imath::M33f scale;
     scale.scale(Imath::V2f(0.3, 0.3));
     Imath::M33f rot;
@@ -1608,7 +1900,9 @@ main(int argc, const char* argv[])
                                  TypeDesc::STRING, &texturetype);
         Timer timer;
         if (!strcmp(texturetype, "Plain Texture")) {
-            if (batch) {
+            if (batchbench) {
+                bench_batch_texture(filename, map_warp);
+            } else if (batch) {
                 if (nowarp)
                     test_plain_texture_batch(map_default);
                 else if (tube)
@@ -1630,7 +1924,12 @@ main(int argc, const char* argv[])
             }
         }
         if (!strcmp(texturetype, "Volume Texture")) {
-            if (batch) {
+            if (batchbench) {
+                if (nowarp)
+                    bench_batch_texture3d(filename, map_default_3D);
+                else
+                    bench_batch_texture3d(filename, map_warp_3D);
+            } else if (batch) {
                 if (nowarp)
                     test_texture3d_batch(filename, map_default_3D);
                 else
@@ -1276,6 +1276,11 @@ TIFFInput::readspec(bool read_meta)
         m_spec.attribute("oiio:AverageColor", ac);
         updatedDesc = true;
     }
+    auto ts = Strutil::excise_string_after_head(desc, "oiio:TileStats=");
+    if (ts.size()) {
+        m_spec.attribute("oiio:TileStats", ts);
+        updatedDesc = true;
+    }
     std::string sha = Strutil::excise_string_after_head(desc, "oiio:SHA-1=");
     if (sha.empty())  // back compatibility with OIIO < 1.5
         sha = Strutil::excise_string_after_head(desc, "SHA-1=");
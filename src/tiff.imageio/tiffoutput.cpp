@@ -308,8 +308,10 @@ TIFFOutput::supports(string_view feature) const
     if (feature == "ioproxy")
         return true;
     // N.B. TIFF doesn't support arbitrary metadata.
+    if (feature == "volumes")
+        return true;  // only tiled ones, though
 
-    // FIXME: we could support "volumes" and "empty"
+    // FIXME: we could support "empty"
 
     // Everything else, we either don't support or don't know about
     return false;
@@ -405,6 +407,10 @@ TIFFOutput::open(const std::string& name, const ImageSpec& userspec,
     }
     if (m_spec.depth < 1)
         m_spec.depth = 1;
+    if (m_spec.depth > 1 && !m_spec.tile_width) {
+        errorf("%s volumes must be tiled", format_name());
+        return false;
+    }
     if (m_spec.channelformats.size()) {
         if (allval(m_spec.channelformats, m_spec.format))
             m_spec.channelformats.clear();
@@ -460,6 +466,8 @@ TIFFOutput::open(const std::string& name, const ImageSpec& userspec,
 
     TIFFSetField(m_tif, TIFFTAG_IMAGEWIDTH, m_spec.width);
     TIFFSetField(m_tif, TIFFTAG_IMAGELENGTH, m_spec.height);
+    if (m_spec.depth > 1)
+        TIFFSetField(m_tif, TIFFTAG_IMAGEDEPTH, m_spec.depth);
 
     // Handle display window or "full" size. Note that TIFF can't represent
     // nonzero offsets of the full size, so we may need to expand the
@@ -477,6 +485,9 @@ TIFFOutput::open(const std::string& name, const ImageSpec& userspec,
     if (m_spec.tile_width) {
         TIFFSetField(m_tif, TIFFTAG_TILEWIDTH, m_spec.tile_width);
         TIFFSetField(m_tif, TIFFTAG_TILELENGTH, m_spec.tile_height);
+        if (m_spec.depth > 1)
+            TIFFSetField(m_tif, TIFFTAG_TILEDEPTH,
+                         std::max(1, m_spec.tile_depth));
     } else {
         // Scanline images must set rowsperstrip
         m_rowsperstrip = 32;